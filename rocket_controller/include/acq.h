@@ -0,0 +1,108 @@
+/** 
+ * @file acq.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-12
+ * @brief Declarations for the sensor acquisition
+ *
+ * acq_service() finds new data by polling: the LSM6DS3 FIFO level over
+ * SPI 1 every call, and the LIS2MDL and BMP588 status registers over I2C a
+ * few times per sample period. New data starts the sensor's DMA or I2C read
+ * in the background. Finished samples are queued by the completion
+ * interrupt (one single producer, single consumer queue per sensor, the IMU
+ * uses its driver's double buffer) and acq_service() drains them into the
+ * history and the telemetry port.
+ *
+ * On boards that wire the sensor interrupt lines (BOARD_HAS_SENSOR_IRQS in
+ * board.h) each line raises an EXTI interrupt that starts the read instead.
+ * Lines that are levels (LSM6DS3 watermark, LIS2MDL DRDY) stay high if a
+ * read could not be started, so acq_service() also restarts any line that
+ * has been left high.
+ *
+ * IMU samples are decimated by the filter chain in filt.h. The attitude and
+ * altitude filters take its estimator tap, the history and the telemetry
+ * port its slower logger tap.
+ *
+ * acq_configure() changes the sensor rates and how many samples are passed
+ * to the history (and so the flight log), the telemetry port always gets
+ * every sample. The flight phase (phase.h) picks these as the flight goes on.
+ */
+
+
+#ifndef ACQ_H
+#define ACQ_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lsm6ds3.h"
+#include "lis2mdl.h"
+#include "bmp588.h"
+
+typedef enum {
+    ACQ_IMU,
+    ACQ_MAG,
+    ACQ_BARO,
+    ACQ_NUM_SENSORS
+} acq_sensor_t;
+
+/// Per sensor counters
+typedef struct {
+    bool present;           ///< The sensor responded at start up
+    uint32_t events;        ///< New data (IMU FIFO watermarks) found by polling or interrupt
+    uint32_t samples;       ///< Samples delivered
+    uint32_t missed;        ///< Samples lost at the sensor (read still running, IMU FIFO overrun)
+    uint32_t dropped;       ///< Samples lost because the queue was full
+    uint16_t rate_hz;       ///< Samples delivered in the last second
+    uint16_t queue_high_water; ///< Most samples waiting in the queue
+} acq_stats_t;
+
+/// Sensor rates and logging
+typedef struct {
+    lsm6ds3_odr_t imu_odr;
+    lis2mdl_odr_t mag_odr;      ///< Ignored when the mag is read by the IMU sensor hub
+    bmp588_odr_t baro_odr;
+    uint8_t log_div[ACQ_NUM_SENSORS]; ///< Log one sample in this many, 0 logs none
+    bool ahrs_accel;            ///< The accelerometer measures gravity alone and corrects the attitude
+} acq_config_t;
+
+/** 
+ * @brief Initialise the sensor buses and sensors, and the data ready
+ * interrupts on boards that wire them
+ * 
+ */
+void acq_init(void);
+
+/** 
+ * @brief Drain finished samples, call every millisecond
+ * 
+ */
+void acq_service(void);
+
+/** 
+ * @brief Change the sensor rates and logging, call from the acquisition
+ * task. The IMU change waits for its burst in progress, the I2C sensors
+ * change in the background.
+ * @param config the new configuration
+ * 
+ */
+void acq_configure(const acq_config_t *config);
+
+/** 
+ * @brief Get the counters of a sensor
+ * @param sensor the sensor
+ * @param stats the counters to fill
+ * 
+ */
+void acq_get_stats(acq_sensor_t sensor, acq_stats_t *stats);
+
+/** 
+ * @brief Get the name of a sensor
+ * @param sensor the sensor
+ * 
+ * @return the name
+ */
+const char *acq_sensor_name(acq_sensor_t sensor);
+
+
+#endif // ACQ_H
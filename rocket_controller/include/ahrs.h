@@ -0,0 +1,95 @@
+/** 
+ * @file ahrs.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-14
+ * @brief Declarations for the fixed point Mahony attitude filter
+ *
+ * A Mahony complementary filter run on every LSM6DS3 sample. The attitude
+ * is a Q30 unit quaternion (body to earth). Gyro rates are integrated with
+ * the accelerometer (and the magnetometer when a new sample is given)
+ * correcting drift through a proportional and integral feedback. All gains
+ * are pre-scaled by the sample period at compile time so the update is a
+ * handful of 32x32 multiplies and a single division per vector normalised.
+ * Slower IMU rates are power of 2 multiples of the full rate period, so the
+ * constants are scaled with a shift.
+ *
+ * The accelerometer only measures gravity when the rocket is not
+ * accelerating. In flight it reads thrust or drag, and drag during coast
+ * would turn the attitude towards inverted, so the accelerometer
+ * correction is switched off outside the pad and descent phases
+ * (ahrs_set_accel_enabled()). The correction is also skipped for any sample
+ * whose magnitude is more than AHRS_ACCEL_GATE_G away from 1 g. The gyro
+ * alone carries the attitude through boost and coast.
+ *
+ * The magnetometer must already be in the IMU axes with the hard iron
+ * offset removed (see acq.c).
+ */
+
+
+#ifndef AHRS_H
+#define AHRS_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fixed.h"
+
+/// Feedback gains
+#define AHRS_KP 1.0
+#define AHRS_KI 0.02
+
+/// Accelerometer samples further than this from 1 g do not correct the attitude
+#define AHRS_ACCEL_GATE_G 0.15
+
+/// Longest sample period, 2^7 times the full rate period (13 Hz)
+#define AHRS_MAX_PERIOD_SHIFT 7
+
+/** 
+ * @brief Reset the attitude to level
+ * 
+ */
+void ahrs_init(void);
+
+/** 
+ * @brief Set the sample period
+ * @param shift the period is LSM6DS3_PERIOD_US << shift, at most
+ * AHRS_MAX_PERIOD_SHIFT
+ * 
+ */
+void ahrs_set_period_shift(uint8_t shift);
+
+/** 
+ * @brief Use the accelerometer to correct the attitude, only when it
+ * measures gravity alone (on the pad and under the parachute)
+ * @param enabled true to use it
+ * 
+ */
+void ahrs_set_accel_enabled(bool enabled);
+
+/** 
+ * @brief Update the attitude with one IMU sample
+ * @param gyro the raw gyro counts (70 mdps)
+ * @param accel the raw accelerometer counts
+ * @param mag the raw magnetometer counts, NULL if there is no new sample
+ * 
+ */
+void ahrs_update(const int16_t gyro[3], const int16_t accel[3], const int16_t mag[3]);
+
+/** 
+ * @brief Rotate an accelerometer sample onto the earth vertical
+ * @param accel the raw accelerometer counts
+ * 
+ * @return the upwards component in counts (includes gravity)
+ */
+int32_t ahrs_vertical_accel(const int16_t accel[3]);
+
+/** 
+ * @brief Get the attitude
+ * @param q the quaternion w, x, y, z in Q30
+ * 
+ */
+void ahrs_get_quat(q30_t q[4]);
+
+
+#endif // AHRS_H
@@ -0,0 +1,124 @@
+/** 
+ * @file altitude.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-15
+ * @brief Declarations for the altitude/velocity Kalman filter and apogee
+ * detector
+ *
+ * A three state (height, vertical velocity, accelerometer bias) Kalman
+ * filter. Every IMU sample predicts with the vertical acceleration from the
+ * attitude filter, every barometer sample corrects the height. The matrices
+ * are fixed size and the products are written out by hand so there are no
+ * loops or general matrix code.
+ *
+ * Height is relative to the pad, taken from the first ALT_GROUND_SAMPLES
+ * barometer readings.
+ *
+ * Apogee is declared once the filter has seen the rocket climb faster than
+ * ALT_ARM_VELOCITY and the velocity has then been below zero by at least
+ * ALT_APOGEE_SIGMA standard deviations for ALT_APOGEE_SAMPLES samples in a
+ * row. A larger sigma or sample count trades detection delay for confidence.
+ */
+
+
+#ifndef ALTITUDE_H
+#define ALTITUDE_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Barometer readings averaged for the pad altitude
+#define ALT_GROUND_SAMPLES 32
+
+/// Climb rate that arms the apogee detector, m/s
+#define ALT_ARM_VELOCITY 15.0f
+
+/// Standard deviations the velocity must be below zero by
+#define ALT_APOGEE_SIGMA 2.0f
+
+/// Consecutive IMU samples that must agree
+#define ALT_APOGEE_SAMPLES 8
+
+/// Accelerometer noise, m/s^2
+#define ALT_ACCEL_NOISE 0.5f
+
+/// Accelerometer bias drift, m/s^2 per root second
+#define ALT_BIAS_NOISE 0.05f
+
+/// Barometer height noise, m
+#define ALT_BARO_NOISE 0.5f
+
+/// Filter state and apogee detector
+typedef struct {
+    float height;           ///< Above the pad, m
+    float velocity;         ///< Up, m/s
+    float accel_bias;       ///< m/s^2
+    float height_var;       ///< Height variance, m^2
+    float velocity_var;     ///< Velocity variance, m^2/s^2
+    bool ground_set;        ///< The pad altitude has been measured
+    bool armed;             ///< The climb rate has passed ALT_ARM_VELOCITY
+    bool apogee;            ///< Apogee has been detected
+    float max_height;       ///< Highest height estimate, m
+    uint32_t max_height_us; ///< Time of the highest height estimate
+    uint32_t apogee_us;     ///< Time apogee was detected
+} alt_state_t;
+
+/** 
+ * @brief Reset the filter, the pad altitude is measured again
+ * 
+ */
+void alt_init(void);
+
+/** 
+ * @brief Predict forward one IMU sample
+ * @param accel_up the upwards acceleration, gravity removed, m/s^2
+ * @param dt the time since the last prediction, s
+ * @param time_us the time of the sample
+ * 
+ */
+void alt_predict(float accel_up, float dt, uint32_t time_us);
+
+/** 
+ * @brief Correct with a barometer reading
+ * @param pressure the pressure in Pa / 64
+ * 
+ */
+void alt_update_baro(uint32_t pressure);
+
+/** 
+ * @brief Convert a pressure to an altitude in the standard atmosphere
+ * 
+ * Interpolates the table in baro_alt_table.h, accurate to
+ * BARO_ALT_TABLE_MAX_ERROR_MM between 0 m and 3000 m. Pressures outside the
+ * table are clamped to its ends.
+ * @param pressure the pressure in Pa / 64
+ * 
+ * @return the altitude in mm
+ */
+int32_t alt_pressure_to_mm(uint32_t pressure);
+
+/** 
+ * @brief Convert a pressure to an altitude in the standard atmosphere
+ * @param pressure the pressure in Pa / 64
+ * 
+ * @return the altitude in m
+ */
+float alt_pressure_to_altitude(uint32_t pressure);
+
+/** 
+ * @brief Check if apogee has been detected
+ * 
+ * @return true once detected
+ */
+bool alt_apogee(void);
+
+/** 
+ * @brief Get the filter state
+ * @param state the state to fill
+ * 
+ */
+void alt_get_state(alt_state_t *state);
+
+
+#endif // ALTITUDE_H
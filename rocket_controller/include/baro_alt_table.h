@@ -0,0 +1,53 @@
+/**
+ * @file baro_alt_table.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-16
+ * @brief Pressure to altitude lookup table
+ *
+ * GENERATED by tools/gen_baro_table.py, do not edit.
+ *
+ * Standard atmosphere altitude in mm every 512 Pa from 49664 Pa to 110080 Pa.
+ * Maximum interpolation error against the exact formula is 22.7 mm
+ * between 0 m and 3000 m.
+ */
+
+
+#ifndef BARO_ALT_TABLE_H
+#define BARO_ALT_TABLE_H
+
+
+#include <stdint.h>
+
+/// Pressure of the first entry in Pa / 64
+#define BARO_ALT_TABLE_BASE 3178496UL
+
+/// Log2 of the spacing between entries in Pa / 64
+#define BARO_ALT_TABLE_SHIFT 15
+
+/// Number of entries
+#define BARO_ALT_TABLE_LEN 119
+
+/// Maximum error over 0 m to 3000 m, mm
+#define BARO_ALT_TABLE_MAX_ERROR_MM 23
+
+/// Altitude in mm at each entry, highest altitude first
+static const int32_t g_baro_alt_table[BARO_ALT_TABLE_LEN] = {
+    5624865, 5549248, 5474255, 5399871, 5326088, 5252894, 5180279, 5108232,
+    5036744, 4965805, 4895406, 4825538, 4756192, 4687358, 4619030, 4551198,
+    4483855, 4416993, 4350604, 4284681, 4219216, 4154203, 4089634, 4025503,
+    3961804, 3898529, 3835673, 3773229, 3711192, 3649555, 3588313, 3527460,
+    3466992, 3406901, 3347183, 3287834, 3228847, 3170219, 3111943, 3054017,
+    2996433, 2939190, 2882281, 2825703, 2769451, 2713521, 2657909, 2602611,
+    2547623, 2492942, 2438563, 2384482, 2330697, 2277203, 2223997, 2171075,
+    2118435, 2066073, 2013985, 1962169, 1910621, 1859338, 1808317, 1757555,
+    1707050, 1656798, 1606796, 1557042, 1507534, 1458267, 1409241, 1360451,
+    1311896, 1263573, 1215480, 1167614, 1119973, 1072554, 1025355, 978375,
+    931610, 885058, 838718, 792586, 746662, 700943, 655427, 610111,
+    564995, 520076, 475351, 430821, 386481, 342331, 298369, 254592,
+    211000, 167591, 124362, 81312, 38440, -4256, -46778, -89128,
+    -131306, -173315, -215155, -256829, -298338, -339684, -380867, -421889,
+    -462752, -503457, -544006, -584399, -624638, -664724, -704659,
+};
+
+
+#endif // BARO_ALT_TABLE_H
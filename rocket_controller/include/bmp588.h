@@ -0,0 +1,106 @@
+/** 
+ * @file bmp588.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-11
+ * @brief Declarations for the BMP588 barometer driver
+ *
+ * The barometer runs in normal mode at 50 Hz (or a slower rate from
+ * bmp588_set_odr()) with 8x pressure oversampling.
+ * Reads are queued on I2C 2 and complete in the background.
+ *
+ * bmp588_poll() reads INT_STATUS and queues the read of the data registers
+ * from the I2C interrupt if new data is ready, for boards without the INT
+ * line. Call it a few times per sample period, see bmp588_period_us().
+ */
+
+
+#ifndef BMP588_H
+#define BMP588_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BMP588_ODR_HZ 50
+
+/// Output data rates, the register code of each
+typedef enum {
+    BMP588_ODR_50HZ = 0x0F,
+    BMP588_ODR_25HZ = 0x14,
+    BMP588_ODR_10HZ = 0x17,
+    BMP588_ODR_5HZ = 0x18,
+} bmp588_odr_t;
+
+/// A barometer sample
+typedef struct {
+    uint32_t time_us;       ///< Time the read was started
+    uint32_t pressure;      ///< Pressure in Pa / 64
+    int32_t temperature;    ///< Temperature in deg C / 65536
+} bmp588_sample_t;
+
+/// Polling counters
+typedef struct {
+    uint32_t polls;         ///< Status reads made
+    uint32_t ready;         ///< Status reads that found new data
+    uint32_t missed;        ///< New data found but the read could not be queued
+} bmp588_stats_t;
+
+/// Receives a finished sample
+typedef void (*bmp588_handler_t)(const bmp588_sample_t *sample);
+
+/** 
+ * @brief Reset and configure the barometer, I2C 2 must be initialised
+ * 
+ * @return 0 if successful
+ */
+int bmp588_init(void);
+
+/** 
+ * @brief Queue a read of the temperature and pressure registers, safe to
+ * call from interrupts
+ * 
+ * @return true if queued, false if a read is still in progress
+ */
+bool bmp588_start_read(void);
+
+/** 
+ * @brief Queue a read of the interrupt status, then of the data registers
+ * if new data is ready. The sample is timed at the call. A transaction of
+ * the bus past its deadline is failed first, see i2c_check_timeout().
+ * 
+ * @return true if queued, false if a status or data read is still in
+ * progress
+ */
+bool bmp588_poll(void);
+
+/** 
+ * @brief Queue a change of output data rate, safe to call from interrupts
+ * @param odr the new rate
+ * 
+ * @return true if queued, false if the last change is still in progress
+ */
+bool bmp588_set_odr(bmp588_odr_t odr);
+
+/** 
+ * @brief Get the sample period of the rate last set
+ * 
+ * @return the period in us
+ */
+uint32_t bmp588_period_us(void);
+
+/** 
+ * @brief Get the polling counters
+ * @param stats the counters to fill
+ * 
+ */
+void bmp588_get_stats(bmp588_stats_t *stats);
+
+/** 
+ * @brief Set the function given each sample as its read completes
+ * @param handler the handler, called from the I2C interrupt
+ * 
+ */
+void bmp588_set_handler(bmp588_handler_t handler);
+
+
+#endif // BMP588_H
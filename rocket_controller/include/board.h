@@ -0,0 +1,66 @@
+/** 
+ * @file board.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Pin and peripheral allocation of the flight computer
+ *
+ * See doc/rocket_controller_hardware.md for the bus allocation.
+ */
+
+
+#ifndef BOARD_H
+#define BOARD_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <libopencm3/stm32/gpio.h>
+
+/// Status LED (active low)
+#define LED_PORT GPIOC
+#define LED_PIN GPIO13
+
+/// SPI 1 - Accelerometer/gyro (LSM6DS3TR-C)
+#define IMU_SPI SPI1
+#define IMU_CS_PORT GPIOA
+#define IMU_CS_PIN GPIO4
+
+/// The sensor interrupt lines are wired to the MCU. The schematic has no
+/// such nets, so by default the sensors' status registers are polled.
+#define BOARD_HAS_SENSOR_IRQS 0
+
+#if BOARD_HAS_SENSOR_IRQS
+/// Accelerometer/gyro INT1, the FIFO watermark
+#define IMU_INT1_PORT GPIOB
+#define IMU_INT1_PIN GPIO0
+
+/// I2C 1 - Magnetometer (LIS2MDL) data ready
+#define MAG_DRDY_PORT GPIOB
+#define MAG_DRDY_PIN GPIO1
+
+/// I2C 2 - Barometer (BMP588) data ready
+#define BARO_INT_PORT GPIOA
+#define BARO_INT_PIN GPIO8
+#endif
+
+/// Read the magnetometer through the LSM6DS3 sensor hub rather than I2C 1
+#define MAG_VIA_IMU_HUB 1
+
+/// Magnetometer axes in the IMU axes: IMU axis i is MAG_AXIS_SIGN[i] times
+/// LIS2MDL axis MAG_AXIS_MAP[i]. Set from the footprint rotations of the two
+/// parts once the board is laid out; the defaults have them lined up.
+#define MAG_AXIS_MAP { 0, 1, 2 }
+#define MAG_AXIS_SIGN { 1, 1, 1 }
+
+/// Hard iron offset of the board in LIS2MDL counts and axes, the centre of
+/// the readings taken while turning the board through every orientation
+#define MAG_HARD_IRON { 0, 0, 0 }
+
+/// SPI 2 - Flash memory
+#define FLASH_SPI SPI2
+#define FLASH_CS_PORT GPIOB
+#define FLASH_CS_PIN GPIO12
+
+
+#endif // BOARD_H
@@ -12,6 +12,19 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+/** 
+ * @brief Reads a chunk of a streamed file
+ * @param ctx the context given to cli_stream_start()
+ * @param offset the offset of the chunk in the file
+ * @param buf the buffer to fill
+ * @param len the size of the buffer
+ * 
+ * @return the number of bytes read, 0 at the end of the file or -1 if the
+ * data is not ready and the read should be retried
+ */
+typedef int (*cli_read_chunk_t)(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
 
 /** 
  * @brief Initialise the cli interface
@@ -27,7 +40,33 @@ int cli_init(void);
  */
 void cli_update(void);
 
-void cli_printf(const char *format, ...);
+/** 
+ * @brief Stream a file to the console a chunk at a time. Chunks are read
+ * straight into the tx ring as it drains, so any size of file streams at
+ * link speed in constant memory. The shell waits until the stream ends, any
+ * input meanwhile is discarded and Ctrl-C stops the stream.
+ * @param read the chunk reader
+ * @param ctx passed to the reader, must stay valid until the stream ends
+ * 
+ * @return true if started, false if a stream is already running
+ */
+bool cli_stream_start(cli_read_chunk_t read, void *ctx);
+
+/** 
+ * @brief Check if a file is being streamed
+ * 
+ * @return true if streaming
+ */
+bool cli_streaming(void);
+
+/** 
+ * @brief Print to the console with fmt_vprint() (see fmt.h), use \r\n for
+ * new lines. Never blocks, the output is cut short if the tx ring fills.
+ * @param format the format
+ * 
+ * @return the number of bytes written
+ */
+int cli_printf(const char *format, ...);
 
 void cli_add_input(char c);
 
@@ -0,0 +1,98 @@
+/** 
+ * @file dump.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-20
+ * @brief Declarations for the flight log download protocol
+ *
+ * /bin/dump starts a binary transfer of one flight on the telemetry port,
+ * the shell carries on as usual. Every message is a frame (see frame.h) so
+ * each one carries a CRC. Telemetry records keep being sent between the
+ * blocks, the host skips any frame type that is not a DUMP_MSG_*.
+ *
+ * The device starts with a 0 delimiter and DUMP_MSG_INFO, sent together
+ * once the tx ring has room for both. The host then asks for blocks with
+ * DUMP_MSG_REQ and the device answers each block with DUMP_MSG_DATA,
+ * serving requests in the order they arrive. The host keeps
+ * at most DUMP_MAX_REQS blocks outstanding, asks again for any block that
+ * is skipped or fails its CRC and can start from any offset, so a download
+ * can be resumed. A request with no blocks clears those still queued.
+ * DUMP_MSG_END, or DUMP_IDLE_MS without a request, ends the transfer.
+ * Bytes that reach the port between transfers are thrown away when the
+ * next one starts.
+ *
+ * The host side is tools/log_dump.c, test/host/test_dump.c runs it on ptys
+ * against this file and the simulated flash.
+ */
+
+
+#ifndef DUMP_H
+#define DUMP_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "flight_log.h"
+
+/// Data in a full block
+#define DUMP_BLOCK_SIZE 240
+
+/// Requests the device queues, also the most blocks the host has outstanding
+#define DUMP_MAX_REQS 32
+
+/// Time without a request before the device gives up
+#define DUMP_IDLE_MS 3000
+
+/// Frame types, kept apart from the telemetry records
+typedef enum {
+    DUMP_MSG_INFO = 0x10,   ///< Device to host, dump_info_t
+    DUMP_MSG_REQ = 0x11,    ///< Host to device, dump_req_t
+    DUMP_MSG_DATA = 0x12,   ///< Device to host, dump_data_t
+    DUMP_MSG_END = 0x13,    ///< Host to device, no payload
+} dump_msg_t;
+
+/// The flight being sent
+typedef struct __attribute__((packed)) {
+    uint32_t seq;           ///< Flight sequence number, to check a resume
+    uint32_t len;           ///< Bytes in the flight
+    uint16_t block_size;
+} dump_info_t;
+
+/// A run of blocks
+typedef struct __attribute__((packed)) {
+    uint32_t offset;        ///< Offset of the first block, a multiple of the block size
+    uint16_t count;         ///< Blocks, 0 clears the queue
+} dump_req_t;
+
+/// A block, the last in the flight may be short
+typedef struct __attribute__((packed)) {
+    uint32_t offset;
+    uint8_t data[DUMP_BLOCK_SIZE];
+} dump_data_t;
+
+/** 
+ * @brief Start sending a flight on the telemetry port
+ * @param entry the flight
+ * 
+ * @return true if started, false if a transfer is already running or the
+ * host does not have the telemetry port open
+ */
+bool dump_start(const flight_log_entry_t *entry);
+
+/** 
+ * @brief Check if a transfer is running
+ * 
+ * @return true if running
+ */
+bool dump_active(void);
+
+/** 
+ * @brief Handle requests and send blocks as the tx ring allows, call from
+ * the main loop while dump_active()
+ * 
+ */
+void dump_service(void);
+
+
+#endif // DUMP_H
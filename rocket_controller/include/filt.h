@@ -0,0 +1,138 @@
+/** 
+ * @file filt.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-18
+ * @brief Declarations for the fixed point multi-rate FIR filters
+ *
+ * A chain of symmetric FIR stages, each of which can decimate, run on
+ * blocks of six channel samples (gyro then accel). Coefficients are Q15
+ * and the sums are 32 bit, with each pair of taps either side of the centre
+ * folded into one multiply. Half-band stages also skip their zero taps, so
+ * a 15 tap half-band decimator costs 5 multiplies per channel per output.
+ *
+ * The output of any stage can be taken as a tap. The estimator takes an
+ * early tap at a high rate and the logger a later, slower one. An output
+ * is given the time of the centre input, which removes the group delay.
+ *
+ * The designs are Kaiser windowed sinc filters. Frequencies are relative
+ * to the input rate of the stage (0.5 is the Nyquist frequency):
+ *
+ *     filt_halfband15  -0.25 dB at 0.15, -31 dB at 0.35, -63 dB at 0.4
+ *     filt_halfband19  -0.08 dB at 0.15, -40 dB at 0.35, -78 dB at 0.5
+ *     filt_lowpass23   -0.31 dB at 0.125, -6 dB at 0.18, -46 dB at 0.25
+ *
+ * These are the responses of the Q15 coefficients, test/host/test_filt.c
+ * checks them and this code against them. tools/filt_response.c measures
+ * the responses of the chain used by the acquisition through this code.
+ *
+ * This file has no hardware dependencies so it is shared with the host tools.
+ */
+
+
+#ifndef FILT_H
+#define FILT_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Channels in a sample: gyro x, y, z then accel x, y, z
+#define FILT_CHANNELS 6
+
+/// Most stages in a chain
+#define FILT_MAX_STAGES 4
+
+/// A sample going into or out of a stage
+typedef struct {
+    uint32_t time_us;
+    int16_t ch[FILT_CHANNELS];
+} filt_sample_t;
+
+/// A filter design
+typedef struct {
+    const int16_t *coef;    ///< All taps in Q15, symmetric and summing to 1
+    uint8_t taps;           ///< Number of taps, odd
+    uint8_t factor;         ///< Decimation factor, 1 for none
+    bool half_band;         ///< Every second tap either side of the centre is zero
+} filt_design_t;
+
+/// A running stage, its history holds design->taps samples
+typedef struct {
+    const filt_design_t *design;
+    filt_sample_t *hist;
+    uint8_t pos;            ///< Where the next input goes, the oldest input
+    uint8_t filled;         ///< Inputs held, up to the number of taps
+    uint8_t phase;          ///< Inputs since the last output
+} filt_stage_t;
+
+/// A chain of stages with two output taps, tap 0 is the input and tap n
+/// the output of stage n
+typedef struct {
+    filt_stage_t stages[FILT_MAX_STAGES];
+    uint8_t count;
+    uint8_t est_tap;
+    uint8_t log_tap;
+} filt_chain_t;
+
+/// History needed by the IMU chain, see filt_imu_chain_init()
+#define FILT_IMU_HIST_LEN (15 + 19 + 23)
+
+extern const filt_design_t filt_halfband15;
+extern const filt_design_t filt_halfband19;
+extern const filt_design_t filt_lowpass23;
+
+/** 
+ * @brief Set up a stage
+ * @param stage the stage
+ * @param design the design
+ * @param hist the history, design->taps samples
+ * 
+ */
+void filt_stage_init(filt_stage_t *stage, const filt_design_t *design, filt_sample_t *hist);
+
+/** 
+ * @brief Add an input to a stage
+ * @param stage the stage
+ * @param in the input
+ * @param out set to the output if there is one
+ * 
+ * @return true if an output was made
+ */
+bool filt_stage_push(filt_stage_t *stage, const filt_sample_t *in, filt_sample_t *out);
+
+/** 
+ * @brief Run a block through a chain, each output array must hold n samples
+ * @param chain the chain, stages set up with filt_stage_init()
+ * @param in the inputs
+ * @param n the number of inputs
+ * @param est_out the estimator tap outputs
+ * @param n_est set to the number of estimator outputs
+ * @param log_out the logger tap outputs
+ * @param n_log set to the number of logger outputs
+ * 
+ */
+void filt_chain_process(filt_chain_t *chain, const filt_sample_t *in, size_t n,
+                        filt_sample_t *est_out, size_t *n_est, filt_sample_t *log_out, size_t *n_log);
+
+/** 
+ * @brief Set up the IMU chain: filt_halfband15 and filt_halfband19 then
+ * filt_lowpass23. The estimator taps the first stage (1/2 rate), the logger
+ * the last (1/4 rate).
+ * @param chain the chain
+ * @param hist the history of all stages, FILT_IMU_HIST_LEN samples
+ * 
+ */
+void filt_imu_chain_init(filt_chain_t *chain, filt_sample_t *hist);
+
+/** 
+ * @brief Get the total decimation of a tap
+ * @param chain the chain
+ * @param tap the tap
+ * 
+ * @return the input samples per tap output
+ */
+uint16_t filt_chain_factor(const filt_chain_t *chain, uint8_t tap);
+
+
+#endif // FILT_H
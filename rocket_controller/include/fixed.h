@@ -0,0 +1,119 @@
+/** 
+ * @file fixed.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-14
+ * @brief Q format fixed point helpers
+ *
+ * The STM32F103 has no FPU so filters run in fixed point. Values are int32_t
+ * with the number of fractional bits in the name of the type or function,
+ * e.g. a q30_t holds x * 2^30 (range +-2). Products are formed in 64 bits and
+ * saturate rather than wrap when converted back to 32 bits.
+ */
+
+
+#ifndef FIXED_H
+#define FIXED_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int32_t q30_t;
+typedef int32_t q16_t;
+
+#define Q30_ONE (1L << 30)
+#define Q16_ONE (1L << 16)
+
+/// Convert a constant to Q format at compile time
+#define Q30(x) ((q30_t)((x) * (double)Q30_ONE + ((x) >= 0 ? 0.5 : -0.5)))
+#define Q16(x) ((q16_t)((x) * (double)Q16_ONE + ((x) >= 0 ? 0.5 : -0.5)))
+
+/** 
+ * @brief Saturate a 64 bit value to 32 bits
+ * @param x the value
+ * 
+ * @return x clamped to the int32_t range
+ */
+static inline int32_t fx_sat32(int64_t x) {
+    if (x > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (x < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)x;
+}
+
+/** 
+ * @brief Saturating add
+ * @param a the first value
+ * @param b the second value
+ * 
+ * @return a + b
+ */
+static inline int32_t fx_add(int32_t a, int32_t b) {
+    return fx_sat32((int64_t)a + b);
+}
+
+/** 
+ * @brief Saturating multiply of two Q30 values
+ * @param a the first value
+ * @param b the second value
+ * 
+ * @return a * b in Q30
+ */
+static inline q30_t q30_mul(q30_t a, q30_t b) {
+    return fx_sat32(((int64_t)a * b) >> 30);
+}
+
+/** 
+ * @brief Integer square root
+ * @param x the value
+ * 
+ * @return floor(sqrt(x))
+ */
+static inline uint32_t fx_isqrt64(uint64_t x) {
+    uint64_t res = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (x >= res + bit) {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)res;
+}
+
+/** 
+ * @brief Normalise a vector to unit length
+ * @param v the vector, e.g. raw sensor counts (each below 2^24)
+ * @param out the unit vector in Q30
+ * 
+ * @return false if the vector is zero
+ */
+static inline bool fx_normalise3(const int32_t v[3], q30_t out[3]) {
+    uint64_t sq = (uint64_t)((int64_t)v[0] * v[0]) + (uint64_t)((int64_t)v[1] * v[1])
+                + (uint64_t)((int64_t)v[2] * v[2]);
+    uint32_t len = fx_isqrt64(sq);
+    if (len == 0) {
+        return false;
+    }
+
+    // One division, then a multiply per component
+    int64_t inv = ((int64_t)1 << 46) / len;
+    for (int i = 0; i < 3; i++) {
+        out[i] = fx_sat32(((int64_t)v[i] * inv) >> 16);
+    }
+    return true;
+}
+
+
+#endif // FIXED_H
@@ -0,0 +1,150 @@
+/** 
+ * @file flight_log.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Declarations for the log structured flight recorder
+ *
+ * The whole W25Q128 is used as one circular log. Each flight starts on a
+ * fresh 4 KB sector with a small header and following flights are written
+ * after it, so erases are spread evenly over every block of the chip.
+ *
+ * Writes are copied into one of two page buffers and never touch the flash
+ * directly. flight_log_service() programs full pages and erases sectors (or
+ * 64 KB blocks) ahead of the write head, suspending an erase whenever a page
+ * is waiting so capture never stalls behind an erase.
+ */
+
+
+#ifndef FLIGHT_LOG_H
+#define FLIGHT_LOG_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Most flights that are indexed, older flights are still on the chip until erased
+#define FLIGHT_LOG_MAX_FLIGHTS 8
+
+/// Distance the erased region is kept ahead of the write head
+#define FLIGHT_LOG_ERASE_AHEAD (64UL * 1024)
+
+/// Erased ahead of the next flight by flight_log_prepare(), enough for the
+/// first seconds of a flight at the highest rates even if every erase after
+/// it takes the maximum datasheet time
+#define FLIGHT_LOG_PREPARE_AHEAD (256UL * 1024)
+
+/// A flight found in the log
+typedef struct {
+    uint32_t seq;           ///< Flight sequence number, increments every flight
+    uint32_t start;         ///< Flash address of the flight header
+    uint32_t len;           ///< Bytes of data after the header (page granular)
+} flight_log_entry_t;
+
+/// Counters for the recorder
+typedef struct {
+    uint32_t pages_written;
+    uint32_t sector_erases;
+    uint32_t block_erases;
+    uint32_t erase_suspends;
+    uint32_t bytes_dropped;     ///< Bytes rejected because both page buffers were full
+} flight_log_stats_t;
+
+/** 
+ * @brief Scan the flash for flights, the flash must be initialised first
+ * 
+ * @return 0 if successful
+ */
+int flight_log_init(void);
+
+/** 
+ * @brief Erase FLIGHT_LOG_PREPARE_AHEAD past where the next flight will start
+ * while nothing is recording, so flight_log_start() can program straight
+ * away. Reads return -1 until the erases are done.
+ * 
+ * @return 0 if successful
+ */
+int flight_log_prepare(void);
+
+/** 
+ * @brief Start recording a new flight after the most recent one. Nothing
+ * can be programmed until the first erase completes, unless
+ * flight_log_prepare() was called, so call this before samples start
+ * arriving (the page buffers cover the gap only at low rates).
+ * 
+ * @return 0 if successful
+ */
+int flight_log_start(void);
+
+/** 
+ * @brief Flush the last partial page and stop recording once it is written
+ * 
+ */
+void flight_log_stop(void);
+
+/** 
+ * @brief Check if a flight is being recorded (including the final flush)
+ * 
+ * @return true if recording
+ */
+bool flight_log_recording(void);
+
+/** 
+ * @brief Append data to the flight being recorded, never waits on the flash
+ * @param data the data to append
+ * @param len the number of bytes
+ * 
+ * @return the number of bytes accepted
+ */
+size_t flight_log_write(const void *data, size_t len);
+
+/** 
+ * @brief Get the number of bytes that can be written without dropping any
+ * 
+ * @return the free space in the page buffers
+ */
+size_t flight_log_space(void);
+
+/** 
+ * @brief Run the program/erase state machine, call as often as possible
+ * 
+ */
+void flight_log_service(void);
+
+/** 
+ * @brief Get the number of flights in the index
+ * 
+ * @return the number of flights
+ */
+int flight_log_count(void);
+
+/** 
+ * @brief Look up a flight
+ * @param n the flight number, 1 is the most recent
+ * @param entry set to the flight
+ * 
+ * @return true if the flight exists
+ */
+bool flight_log_get_flight(int n, flight_log_entry_t *entry);
+
+/** 
+ * @brief Read the data of a flight
+ * @param entry the flight to read
+ * @param offset the offset into the flight data
+ * @param buf the buffer to fill
+ * @param len the size of the buffer
+ * 
+ * @return the number of bytes read, 0 at the end of the flight or -1 if
+ * the flash is busy and the read should be retried
+ */
+int flight_log_read(const flight_log_entry_t *entry, uint32_t offset, void *buf, size_t len);
+
+/** 
+ * @brief Get a snapshot of the recorder counters
+ * @param stats the struct to fill
+ * 
+ */
+void flight_log_get_stats(flight_log_stats_t *stats);
+
+
+#endif // FLIGHT_LOG_H
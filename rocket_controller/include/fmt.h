@@ -0,0 +1,67 @@
+/** 
+ * @file fmt.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-22
+ * @brief Declarations for the compact printf style formatter
+ *
+ * A small replacement for printf that needs no soft-float or 64 bit
+ * division. It supports %d %i %u %x %X %c %s and %%, with the '-' and '0'
+ * flags, a width, a precision for %s and an 'l' modifier. Values are 32
+ * bits, as long is on the target.
+ *
+ * Fixed point values are printed with %q followed by the number of
+ * fractional bits, taking an int32_t. The precision is the number of
+ * decimal places (3 by default, at most 9) and the value is rounded to the
+ * nearest last digit: "%.4q30" prints a q30_t as 0.7071.
+ *
+ * Output goes to a sink, a window of memory that can be refilled when it
+ * is used up, so the formatter can write straight into a ring buffer. When
+ * the sink has no more room formatting stops. Unknown conversions are
+ * printed as they are.
+ *
+ * This file has no hardware dependencies so it is shared with the host tools.
+ */
+
+
+#ifndef FMT_H
+#define FMT_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/// Where the output goes
+typedef struct fmt_sink {
+    char *buf;              ///< The current window
+    size_t size;
+    size_t len;             ///< Bytes written to the window
+    size_t total;           ///< Bytes written to earlier windows
+    /// Hand over a full window and get the next, false when there is none.
+    /// NULL for a single window.
+    bool (*more)(struct fmt_sink *sink);
+} fmt_sink_t;
+
+/** 
+ * @brief Format into a sink
+ * @param sink the sink
+ * @param format the format
+ * @param args the arguments
+ * 
+ * @return false if the sink ran out of room and the output is cut short
+ */
+bool fmt_vprint(fmt_sink_t *sink, const char *format, va_list args);
+
+/** 
+ * @brief Format into a buffer, always terminated
+ * @param buf the buffer
+ * @param size the size of the buffer
+ * @param format the format
+ * 
+ * @return the length of the output, without the terminator
+ */
+size_t fmt_snprintf(char *buf, size_t size, const char *format, ...);
+
+
+#endif // FMT_H
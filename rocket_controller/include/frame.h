@@ -0,0 +1,86 @@
+/** 
+ * @file frame.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Declarations for the COBS + CRC framing used by binary streams
+ *
+ * A frame on the wire is COBS(type | payload | crc16) followed by a 0x00
+ * delimiter. The CRC is CRC-16/CCITT-FALSE over the type and payload, sent
+ * little endian. COBS guarantees the delimiter never appears inside a frame
+ * so a receiver can resynchronise at the next zero after any corruption.
+ *
+ * This file has no hardware dependencies so it is shared with the host tools.
+ */
+
+
+#ifndef FRAME_H
+#define FRAME_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Largest type + payload that can be framed
+#define FRAME_MAX_PAYLOAD 250
+
+/// Worst case encoded size for a given raw (type + payload + crc) length
+#define FRAME_COBS_MAX(len) ((len) + ((len) / 254) + 1)
+
+/// Worst case size on the wire of a frame with a given payload length
+#define FRAME_MAX_SIZE(payload_len) (FRAME_COBS_MAX((payload_len) + 3) + 1)
+
+/** 
+ * @brief Update a CRC-16/CCITT-FALSE (poly 0x1021)
+ * @param crc the running crc, start with 0xFFFF
+ * @param data the data to add
+ * @param len the length of the data
+ * 
+ * @return the updated crc
+ */
+uint16_t frame_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+/** 
+ * @brief COBS encode a buffer, no delimiter is added
+ * @param in the data to encode
+ * @param len the length of the data
+ * @param out the output, must hold FRAME_COBS_MAX(len) bytes
+ * 
+ * @return the encoded length
+ */
+size_t frame_cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/** 
+ * @brief COBS decode a buffer which does not include the delimiter
+ * @param in the encoded data
+ * @param len the length of the encoded data
+ * @param out the output, must hold len bytes
+ * 
+ * @return the decoded length or 0 if the encoding is invalid
+ */
+size_t frame_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+/** 
+ * @brief Build a complete frame including the crc and trailing delimiter
+ * @param type the frame type
+ * @param payload the payload
+ * @param len the length of the payload, at most FRAME_MAX_PAYLOAD - 1
+ * @param out the output, must hold FRAME_MAX_SIZE(len) bytes
+ * 
+ * @return the frame length
+ */
+size_t frame_encode(uint8_t type, const void *payload, size_t len, uint8_t *out);
+
+/** 
+ * @brief Decode a frame received up to (but not including) its delimiter
+ * @param in the received bytes, decoded in place
+ * @param len the number of bytes received
+ * @param type set to the frame type
+ * @param payload set to point at the payload inside in
+ * 
+ * @return the payload length or -1 if the frame is corrupt
+ */
+int frame_decode(uint8_t *in, size_t len, uint8_t *type, uint8_t **payload);
+
+
+#endif // FRAME_H
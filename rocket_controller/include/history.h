@@ -0,0 +1,99 @@
+/** 
+ * @file history.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-04
+ * @brief Declarations for the pre-launch sample history
+ *
+ * While on the pad the most recent samples are kept in a RAM ring and the
+ * oldest are discarded, so nothing is written to flash. On launch the ring
+ * is handed to the flight log: the recorded history is written out first
+ * and samples that keep arriving queue up behind it, so the log holds the
+ * moments before launch followed by the flight without any gap. For that
+ * the flash ahead of the next flight is erased on the pad (history_arm()),
+ * otherwise the first pages would wait up to 400 ms on a sector erase while
+ * the ring overflows.
+ *
+ * Samples are delta encoded into blocks (see logpack.h) on the way out, a
+ * block is written once it is full.
+ *
+ * history_push() and history_service() must be called from the same
+ * context (the acquisition task).
+ */
+
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "telem.h"
+
+/// Samples held in the ring, must be a power of 2. At 1 kHz IMU plus mag
+/// and baro this covers a little over 100 ms, more at the slower pad rates.
+#define HISTORY_LEN 128
+
+/// Counters for the history ring
+typedef struct {
+    uint32_t pushed;            ///< Samples added
+    uint32_t discarded;         ///< Old samples dropped on the pad
+    uint32_t dropped;           ///< Samples lost after launch because the ring was full
+                                ///< or the flight log stopped before they were written
+    uint16_t high_water;        ///< Most samples waiting after launch
+    uint32_t blocks;            ///< Packed blocks written to the flight log
+} history_stats_t;
+
+/** 
+ * @brief Add a sample, once triggered it is queued for the flight log
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * 
+ */
+void history_push(telem_rec_type_t type, const void *rec, size_t len);
+
+/** 
+ * @brief Erase ahead of the next flight while on the pad so the history can
+ * be written as soon as it is triggered
+ * 
+ */
+void history_arm(void);
+
+/** 
+ * @brief Start the flight log and begin streaming the history into it
+ * 
+ */
+void history_trigger(void);
+
+/** 
+ * @brief Check if the history has been triggered
+ * 
+ * @return true once triggered
+ */
+bool history_triggered(void);
+
+/** 
+ * @brief Move queued samples into the flight log as space allows
+ * 
+ */
+void history_service(void);
+
+/** 
+ * @brief Write out the queued samples and the last partial block then stop
+ * the flight log. history_service() finishes the job if the flight log has
+ * no space for it yet, after which the history goes back to the pad ring.
+ * 
+ */
+void history_stop(void);
+
+/** 
+ * @brief Get a snapshot of the history counters
+ * @param stats the struct to fill
+ * 
+ */
+void history_get_stats(history_stats_t *stats);
+
+
+#endif // HISTORY_H
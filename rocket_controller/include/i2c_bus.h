@@ -0,0 +1,142 @@
+/** 
+ * @file i2c_bus.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-11
+ * @brief Declarations for the interrupt/DMA driven I2C transaction engine
+ *
+ * Each bus has a small queue of register transactions that are run from the
+ * I2C event and DMA interrupts, so I2C 1 and I2C 2 progress in parallel and
+ * the caller only hears about a transaction when it completes. Reads of two
+ * or more bytes are received by DMA.
+ *
+ * A transaction must stay valid (not on the stack of a returning function)
+ * until it completes.
+ *
+ * A lost interrupt or a device holding SDA low would stall a bus for good,
+ * so each transaction has a deadline. i2c_check_timeout(), called by the
+ * sensor polls, fails a transaction that has run past it, clocks SCL by
+ * hand to free SDA, sends a stop and resets the peripheral.
+ */
+
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Transactions that can be waiting on one bus
+#define I2C_QUEUE_LEN 4
+
+/// Longest a transaction may run from its start, us. A 6 byte read takes
+/// 85 us at 400 kHz.
+#define I2C_TXN_TIMEOUT_US 1000
+
+typedef enum {
+    I2C_BUS_1,
+    I2C_BUS_2,
+    I2C_NUM_BUSES
+} i2c_bus_t;
+
+typedef enum {
+    I2C_TXN_IDLE,
+    I2C_TXN_QUEUED,
+    I2C_TXN_DONE,
+    I2C_TXN_ERROR,
+} i2c_txn_status_t;
+
+struct i2c_txn;
+
+/// Called from interrupt context when a transaction completes
+typedef void (*i2c_done_cb_t)(struct i2c_txn *txn);
+
+/// A register read or write
+typedef struct i2c_txn {
+    uint8_t addr;                       ///< 7 bit device address
+    uint8_t reg;                        ///< First register
+    bool read;                          ///< Read into buf, otherwise write buf
+    uint8_t len;                        ///< Bytes to transfer, at least 1
+    uint8_t *buf;                       ///< Data
+    i2c_done_cb_t done;                 ///< Completion callback, may be NULL
+    volatile i2c_txn_status_t status;   ///< Set when the transaction is submitted and completes
+} i2c_txn_t;
+
+/// Bus counters
+typedef struct {
+    uint32_t txns;          ///< Transactions completed
+    uint32_t errors;        ///< Transactions that failed (NACK, arbitration, bus error, timeout)
+    uint32_t bytes;         ///< Data bytes transferred
+    uint32_t rejected;      ///< Submits refused because the queue was full
+    uint32_t timeouts;      ///< Transactions failed at their deadline, each followed by a recovery
+} i2c_stats_t;
+
+/** 
+ * @brief Initialise a bus at 400 kHz
+ * @param bus the bus
+ * 
+ */
+void i2c_bus_init(i2c_bus_t bus);
+
+/** 
+ * @brief Queue a transaction, safe to call from interrupts
+ * @param bus the bus
+ * @param txn the transaction
+ * 
+ * @return true if queued
+ */
+bool i2c_submit(i2c_bus_t bus, i2c_txn_t *txn);
+
+/** 
+ * @brief Fail the current transaction of a bus and recover the bus if it
+ * has run past I2C_TXN_TIMEOUT_US. Call from thread context only, a
+ * recovery takes about 100 us.
+ * @param bus the bus
+ * 
+ * @return true if the bus was recovered
+ */
+bool i2c_check_timeout(i2c_bus_t bus);
+
+/** 
+ * @brief Run a transaction and wait for it, for use during initialisation
+ * @param bus the bus
+ * @param txn the transaction
+ * 
+ * @return true if successful
+ */
+bool i2c_transfer(i2c_bus_t bus, i2c_txn_t *txn);
+
+/** 
+ * @brief Write a single register and wait for it
+ * @param bus the bus
+ * @param addr the 7 bit device address
+ * @param reg the register
+ * @param val the value
+ * 
+ * @return true if successful
+ */
+bool i2c_write_reg(i2c_bus_t bus, uint8_t addr, uint8_t reg, uint8_t val);
+
+/** 
+ * @brief Read registers and wait for them
+ * @param bus the bus
+ * @param addr the 7 bit device address
+ * @param reg the first register
+ * @param buf the buffer to fill
+ * @param len the number of bytes
+ * 
+ * @return true if successful
+ */
+bool i2c_read_regs(i2c_bus_t bus, uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len);
+
+/** 
+ * @brief Get the counters of a bus
+ * @param bus the bus
+ * @param stats the counters to fill
+ * 
+ */
+void i2c_get_stats(i2c_bus_t bus, i2c_stats_t *stats);
+
+
+#endif // I2C_BUS_H
@@ -16,6 +16,8 @@
 #define MANUFACTURER_STR "Hunter Inc"
 #define PRODUCT_STR "Hermes 01"
 #define SERIAL_NUMBER "H01251901"
+#define SHELL_IFACE_STR "Hermes 01 Shell"
+#define TELEM_IFACE_STR "Hermes 01 Telemetry"
 
 
 #endif // INFO_H
\ No newline at end of file
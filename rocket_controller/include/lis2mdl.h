@@ -0,0 +1,109 @@
+/** 
+ * @file lis2mdl.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-11
+ * @brief Declarations for the LIS2MDL magnetometer driver
+ *
+ * The magnetometer runs continuously at 100 Hz (or a slower rate from
+ * lis2mdl_set_odr()) with temperature compensation and offset cancellation. Reads are queued on I2C 1 and complete in the
+ * background. Counts are 1.5 mgauss.
+ *
+ * lis2mdl_poll() reads STATUS_REG and queues the read of the output
+ * registers from the I2C interrupt if new data is ready, for boards without
+ * the DRDY line. Call it a few times per sample period, see
+ * lis2mdl_period_us().
+ */
+
+
+#ifndef LIS2MDL_H
+#define LIS2MDL_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LIS2MDL_ODR_HZ 100
+
+/// Address and first output register, also used by the LSM6DS3 sensor hub
+#define LIS2MDL_ADDR        0x1E
+#define LIS2MDL_REG_OUTX_L  0x68
+
+/// Output data rates, the register code of each
+typedef enum {
+    LIS2MDL_ODR_10HZ = 0,
+    LIS2MDL_ODR_20HZ = 1,
+    LIS2MDL_ODR_50HZ = 2,
+    LIS2MDL_ODR_100HZ = 3,
+} lis2mdl_odr_t;
+
+/// A magnetometer sample
+typedef struct {
+    uint32_t time_us;       ///< Time the read was started
+    int16_t mag[3];         ///< Raw counts x, y, z
+} lis2mdl_sample_t;
+
+/// Polling counters
+typedef struct {
+    uint32_t polls;         ///< Status reads made
+    uint32_t ready;         ///< Status reads that found new data
+    uint32_t missed;        ///< New data found but the read could not be queued
+} lis2mdl_stats_t;
+
+/// Receives a finished sample
+typedef void (*lis2mdl_handler_t)(const lis2mdl_sample_t *sample);
+
+/** 
+ * @brief Configure the magnetometer, I2C 1 must be initialised
+ * 
+ * @return 0 if successful
+ */
+int lis2mdl_init(void);
+
+/** 
+ * @brief Queue a read of the output registers, safe to call from interrupts
+ * 
+ * @return true if queued, false if a read is still in progress
+ */
+bool lis2mdl_start_read(void);
+
+/** 
+ * @brief Queue a read of the status register, then of the output registers
+ * if new data is ready. The sample is timed at the call. A transaction of
+ * the bus past its deadline is failed first, see i2c_check_timeout().
+ * 
+ * @return true if queued, false if a status or output read is still in
+ * progress
+ */
+bool lis2mdl_poll(void);
+
+/** 
+ * @brief Queue a change of output data rate, safe to call from interrupts
+ * @param odr the new rate
+ * 
+ * @return true if queued, false if the last change is still in progress
+ */
+bool lis2mdl_set_odr(lis2mdl_odr_t odr);
+
+/** 
+ * @brief Get the sample period of the rate last set
+ * 
+ * @return the period in us
+ */
+uint32_t lis2mdl_period_us(void);
+
+/** 
+ * @brief Get the polling counters
+ * @param stats the counters to fill
+ * 
+ */
+void lis2mdl_get_stats(lis2mdl_stats_t *stats);
+
+/** 
+ * @brief Set the function given each sample as its read completes
+ * @param handler the handler, called from the I2C interrupt
+ * 
+ */
+void lis2mdl_set_handler(lis2mdl_handler_t handler);
+
+
+#endif // LIS2MDL_H
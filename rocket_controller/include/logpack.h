@@ -0,0 +1,102 @@
+/** 
+ * @file logpack.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-19
+ * @brief Declarations for the delta encoded flight log blocks
+ *
+ * Records are packed into blocks of up to LOGPACK_BLOCK_SIZE bytes which
+ * are written to the flight log as single TELEM_REC_PACKED frames, so each
+ * block has a CRC and a reader can resynchronise at any frame delimiter.
+ *
+ * Every record starts with a tag byte holding its type. The first record
+ * of each type in a block is a key frame: the time and every field are
+ * stored whole. After that the time is stored as the change in the sample
+ * spacing (zero for a steady rate) and each field as the change from the
+ * last record of the type. All values are zig-zag varints, so small changes
+ * of either sign take one byte. Since every block starts with key frames
+ * any block can be decoded on its own.
+ *
+ * Encoding a record is a fixed number of fields of at most five bytes each,
+ * so the cost per record is bounded.
+ *
+ * This file has no hardware dependencies so it is shared with the host tools.
+ */
+
+
+#ifndef LOGPACK_H
+#define LOGPACK_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "telem.h"
+
+/// Largest block, fits a frame
+#define LOGPACK_BLOCK_SIZE 240
+
+/// Most fields in a record (IMU: accel then gyro)
+#define LOGPACK_MAX_FIELDS 6
+
+/// Largest encoded record: tag, time and fields as 5 byte varints
+#define LOGPACK_MAX_RECORD (1 + 5 + LOGPACK_MAX_FIELDS * 5)
+
+/// Record types are telem_rec_type_t values below this
+#define LOGPACK_NUM_TYPES 4
+
+/// Set in the tag byte of a key frame
+#define LOGPACK_TAG_KEY 0x80
+
+/// What the last record of a type held
+typedef struct {
+    bool have_key;          ///< A key frame of this type is in the block
+    uint32_t time_us;
+    uint32_t dt_us;         ///< Spacing of the last two records
+    int32_t fields[LOGPACK_MAX_FIELDS];
+} logpack_chan_t;
+
+/// A block being filled
+typedef struct {
+    uint8_t buf[LOGPACK_BLOCK_SIZE];
+    uint16_t len;
+    uint16_t records;
+    logpack_chan_t chan[LOGPACK_NUM_TYPES];
+} logpack_t;
+
+/// Receives each decoded record
+typedef void (*logpack_handler_t)(telem_rec_type_t type, const void *rec, size_t len, void *ctx);
+
+/** 
+ * @brief Start a new empty block
+ * @param pack the block
+ * 
+ */
+void logpack_init(logpack_t *pack);
+
+/** 
+ * @brief Add a record to the block
+ * @param pack the block
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * 
+ * @return true if added, false if the block is full (start a new one and
+ * add it again) or the record is not a known type
+ */
+bool logpack_add(logpack_t *pack, telem_rec_type_t type, const void *rec, size_t len);
+
+/** 
+ * @brief Decode a block
+ * @param block the block
+ * @param len the size of the block
+ * @param handler called with each record
+ * @param ctx passed to the handler
+ * 
+ * @return the number of records or -1 if the block is corrupt (the records
+ * before the error have been handled)
+ */
+int logpack_decode(const uint8_t *block, size_t len, logpack_handler_t handler, void *ctx);
+
+
+#endif // LOGPACK_H
@@ -0,0 +1,200 @@
+/** 
+ * @file lsm6ds3.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-10
+ * @brief Declarations for the LSM6DS3TR-C accelerometer/gyro driver
+ *
+ * The gyro and accelerometer both run at 1.66 kHz into the sensor FIFO
+ * (slower rates can be chosen with lsm6ds3_set_odr()). lsm6ds3_poll() reads
+ * the FIFO level from FIFO_STATUS1/2 and once it has reached the watermark a
+ * single DMA burst reads the FIFO status followed by a watermark sized block
+ * of data into one half of a double buffer. The CPU is only involved to
+ * check the level, start a burst and parse a finished block, while the next
+ * block is read into the other half. The watermark is also routed to INT1
+ * for boards that wire it to the MCU.
+ *
+ * In sensor hub mode the LSM6DS3 I2C master also reads the magnetometer on
+ * every eighth ODR slot and stores each read in the FIFO as data set 3. The
+ * TR-C FIFO has no tags so the words are told apart by their position in the
+ * FIFO pattern: every 8 ODR slots hold gyro, accel, mag, then 7 times gyro,
+ * accel. The mag is attached to the sample of the slot it was stored in.
+ *
+ * Accelerometer counts are 0.488 mg (+-16 g), gyro counts 70 mdps (+-2000 dps).
+ */
+
+
+#ifndef LSM6DS3_H
+#define LSM6DS3_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Output data rate of both sensors and the FIFO at start up
+#define LSM6DS3_ODR_HZ 1666
+#define LSM6DS3_PERIOD_US (1000000 / LSM6DS3_ODR_HZ)
+
+/// Accelerometer scale, g per count
+#define LSM6DS3_ACCEL_G_PER_COUNT 0.000488f
+
+/// 16 bit words per FIFO data set (x, y, z)
+#define LSM6DS3_SET_WORDS 3
+
+/// ODR slots read per burst
+#define LSM6DS3_BURST_SLOTS 16
+
+/// Data set 3 (sensor hub) decimation. The hub reads the mag on every
+/// eighth accelerometer sample, the slowest SLAVE0_CONFIG allows, and every
+/// read is stored, two mag samples per burst.
+#define LSM6DS3_HUB_DEC 8
+
+/// Longest FIFO pattern: gyro and accel in every slot plus one mag
+#define LSM6DS3_MAX_PATTERN (LSM6DS3_BURST_SLOTS * 2 * LSM6DS3_SET_WORDS + LSM6DS3_SET_WORDS)
+
+/// FIFO words per burst with the sensor hub on
+#define LSM6DS3_BURST_WORDS (LSM6DS3_BURST_SLOTS * 2 * LSM6DS3_SET_WORDS \
+                             + LSM6DS3_BURST_SLOTS / LSM6DS3_HUB_DEC * LSM6DS3_SET_WORDS)
+
+/// Bytes per burst: the four FIFO status registers then the data
+#define LSM6DS3_BURST_LEN (4 + LSM6DS3_BURST_WORDS * 2)
+
+/// Most samples one block can produce (a slot may be completed from the last block)
+#define LSM6DS3_MAX_SAMPLES (LSM6DS3_BURST_SLOTS + 1)
+
+/// Output data rates, the register code of each
+typedef enum {
+    LSM6DS3_ODR_26HZ = 2,
+    LSM6DS3_ODR_52HZ = 3,
+    LSM6DS3_ODR_104HZ = 4,
+    LSM6DS3_ODR_208HZ = 5,
+    LSM6DS3_ODR_416HZ = 6,
+    LSM6DS3_ODR_833HZ = 7,
+    LSM6DS3_ODR_1666HZ = 8,
+} lsm6ds3_odr_t;
+
+/// A combined accelerometer, gyro and (in sensor hub mode) magnetometer sample
+typedef struct {
+    uint32_t time_us;       ///< Time of the sample (low 32 bits of the monotonic clock)
+    int16_t accel[3];       ///< Raw accelerometer counts x, y, z
+    int16_t gyro[3];        ///< Raw gyroscope counts x, y, z
+    int16_t mag[3];         ///< Raw magnetometer counts x, y, z, if mag_valid
+    bool mag_valid;
+} lsm6ds3_sample_t;
+
+/// Keeps track of the FIFO pattern across blocks
+typedef struct {
+    uint8_t dest[LSM6DS3_MAX_PATTERN];  ///< Slot word of each pattern position, see lsm6ds3_parser_init()
+    uint16_t pattern_len;               ///< Words in the pattern
+    uint8_t slots;                      ///< ODR slots in the pattern
+    uint32_t period_us;                 ///< Time between ODR slots
+    int16_t words[3 * LSM6DS3_SET_WORDS]; ///< Gyro, accel then mag of the current slot
+    uint16_t pos;                       ///< Pattern position of the next word
+    bool partial;                       ///< The slot in words[] is missing its first words
+    uint32_t resyncs;                   ///< Times the pattern position was lost
+} lsm6ds3_parser_t;
+
+/// Driver counters
+typedef struct {
+    uint32_t bursts;        ///< Burst reads completed
+    uint32_t samples;       ///< Samples parsed
+    uint32_t mag_samples;   ///< Samples carrying sensor hub data
+    uint32_t polls;         ///< FIFO level checks made
+    uint32_t busy;          ///< Watermarks ignored because no buffer was free
+    uint32_t fifo_overruns; ///< Times the sensor FIFO overflowed
+    uint32_t resyncs;       ///< Times the pattern position was lost
+} lsm6ds3_stats_t;
+
+/** 
+ * @brief Initialise SPI 1, configure the sensor and start the FIFO
+ * 
+ * @return 0 if successful
+ */
+int lsm6ds3_init(void);
+
+/** 
+ * @brief Switch to sensor hub mode, the LSM6DS3 reads six output bytes of an
+ * I2C device on every eighth accelerometer sample and stores each read in the
+ * FIFO. The device must already be configured and nothing else may use its
+ * bus afterwards.
+ * @param addr the 7 bit device address
+ * @param reg the first output register (x low byte)
+ * 
+ */
+void lsm6ds3_enable_hub(uint8_t addr, uint8_t reg);
+
+/** 
+ * @brief Change the output data rate of both sensors and the FIFO. Waits
+ * for any burst in progress, the watermark interrupt must be masked. Samples
+ * already in the FIFO are timed with the new rate.
+ * @param odr the new rate
+ * 
+ */
+void lsm6ds3_set_odr(lsm6ds3_odr_t odr);
+
+/** 
+ * @brief Get the time between samples at the current rate
+ * 
+ * @return the period in us
+ */
+uint32_t lsm6ds3_period_us(void);
+
+/** 
+ * @brief Read the FIFO level and start a burst read once it has reached the
+ * watermark. Makes two blocking register reads unless a burst is running or
+ * the last block is still waiting to be parsed. Must not be called while
+ * lsm6ds3_on_watermark() can run from an interrupt.
+ * 
+ * @return true if a burst was started
+ */
+bool lsm6ds3_poll(void);
+
+/** 
+ * @brief Start a burst read of the FIFO, call when INT1 (the watermark) is
+ * high on boards that wire it
+ * 
+ * @return true if a burst was started
+ */
+bool lsm6ds3_on_watermark(void);
+
+/** 
+ * @brief Parse a finished block if there is one
+ * @param out the samples
+ * @param max the size of out, at least LSM6DS3_MAX_SAMPLES to never lose data
+ * 
+ * @return the number of samples written
+ */
+size_t lsm6ds3_read(lsm6ds3_sample_t *out, size_t max);
+
+/** 
+ * @brief Get the driver counters
+ * @param stats the counters to fill
+ * 
+ */
+void lsm6ds3_get_stats(lsm6ds3_stats_t *stats);
+
+/** 
+ * @brief Set up the FIFO pattern layout and reset the parser, the period
+ * is set to LSM6DS3_PERIOD_US
+ * @param parser the parser
+ * @param hub_dec the data set 3 decimation, 0 if the sensor hub is off
+ * 
+ */
+void lsm6ds3_parser_init(lsm6ds3_parser_t *parser, uint8_t hub_dec);
+
+/** 
+ * @brief Parse one burst block. Has no hardware dependencies.
+ * @param parser the pattern state from lsm6ds3_parser_init()
+ * @param block the FIFO status registers followed by the FIFO data
+ * @param len the size of block
+ * @param time_us the time the burst was started
+ * @param out the samples
+ * @param max the size of out
+ * 
+ * @return the number of samples written
+ */
+size_t lsm6ds3_fifo_parse(lsm6ds3_parser_t *parser, const uint8_t *block, size_t len,
+                          uint32_t time_us, lsm6ds3_sample_t *out, size_t max);
+
+
+#endif // LSM6DS3_H
@@ -0,0 +1,118 @@
+/** 
+ * @file perf.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-08
+ * @brief Declarations for the cycle counter profiling zones
+ *
+ * Wrap code in PERF_ZONE_ENTER() / PERF_ZONE_EXIT() to collect the count,
+ * min, mean, max and a log2 histogram of its run time in cycles. On the
+ * target the DWT cycle counter is used, native builds fall back to a
+ * nanosecond clock so the same instrumentation can be used on the host.
+ *
+ * A zone must only be entered from one context (task or interrupt).
+ */
+
+
+#ifndef PERF_H
+#define PERF_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__arm__)
+#include <libopencm3/cm3/dwt.h>
+#else
+#include <time.h>
+#endif
+
+/// The zones that can be profiled, add new zones here
+#define PERF_ZONE_LIST(ZONE) \
+    ZONE(PERF_ZONE_USB_ISR, "usb_isr") \
+    ZONE(PERF_ZONE_I2C1_ISR, "i2c1_isr") \
+    ZONE(PERF_ZONE_I2C2_ISR, "i2c2_isr") \
+    ZONE(PERF_ZONE_IMU, "imu") \
+    ZONE(PERF_ZONE_FILT, "filt") \
+    ZONE(PERF_ZONE_AHRS, "ahrs") \
+    ZONE(PERF_ZONE_ALT, "alt") \
+    ZONE(PERF_ZONE_LOG, "log") \
+    ZONE(PERF_ZONE_CLI, "cli")
+
+#define PERF_ZONE_ENUM(zone, name) zone,
+typedef enum {
+    PERF_ZONE_LIST(PERF_ZONE_ENUM)
+    PERF_NUM_ZONES
+} perf_zone_t;
+#undef PERF_ZONE_ENUM
+
+/// Number of histogram buckets, bucket n counts times in [2^n, 2^(n+1))
+#define PERF_HIST_BUCKETS 16
+
+/// Statistics for a zone
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PERF_HIST_BUCKETS];
+} perf_stats_t;
+
+/// Start timing a zone
+#define PERF_ZONE_ENTER(zone) uint32_t perf_start_##zone = perf_cycles()
+
+/// Stop timing a zone, must be in the same scope as PERF_ZONE_ENTER()
+#define PERF_ZONE_EXIT(zone) perf_record((zone), perf_cycles() - perf_start_##zone)
+
+/** 
+ * @brief Read the free running cycle counter
+ * 
+ * @return the cycle count (ns on the host)
+ */
+static inline uint32_t perf_cycles(void) {
+#if defined(__arm__)
+    return DWT_CYCCNT;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+/** 
+ * @brief Start the cycle counter and clear the statistics
+ * 
+ */
+void perf_init(void);
+
+/** 
+ * @brief Add a measurement to a zone
+ * @param zone the zone
+ * @param cycles the time spent in the zone
+ * 
+ */
+void perf_record(perf_zone_t zone, uint32_t cycles);
+
+/** 
+ * @brief Clear the statistics of every zone
+ * 
+ */
+void perf_reset(void);
+
+/** 
+ * @brief Get the statistics of a zone
+ * @param zone the zone
+ * @param stats the struct to fill
+ * 
+ */
+void perf_get_stats(perf_zone_t zone, perf_stats_t *stats);
+
+/** 
+ * @brief Get the name of a zone
+ * @param zone the zone
+ * 
+ * @return the name
+ */
+const char *perf_zone_name(perf_zone_t zone);
+
+
+#endif // PERF_H
@@ -0,0 +1,117 @@
+/** 
+ * @file phase.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-17
+ * @brief Declarations for the flight phase state machine
+ *
+ * The flight is split into phases that only ever move forward:
+ *
+ *     pad -> boost -> coast -> apogee -> descent -> landed
+ *
+ * Each phase has its own sensor rates and logging dividers (see
+ * acq_configure()) so the log has the most samples where they matter. On
+ * the pad everything runs slowly into the history ring only, launch starts
+ * the flight log (history_trigger()) and landing stops it.
+ *
+ * Every transition needs its condition to hold for a time, and a condition
+ * that starts at one threshold is only reset by crossing a second one, so
+ * noise around a threshold can not cause a false transition.
+ *
+ * Approximate log use with the rates in phase.c for a 5 s burn, 20 s coast
+ * and 5 minute descent. The logged IMU rate is a quarter of its ODR (see
+ * filt.h) and the mag comes from the sensor hub at the ODR / 8 (see
+ * lsm6ds3.h), not at the mag rates in the table. IMU frames are 21 bytes,
+ * mag 15, baro 17.
+ *
+ *     boost    5 s x 12.7 KB/s =  64 KB
+ *     coast   20 s x 6.8 KB/s  = 136 KB
+ *     apogee   3 s x 12.7 KB/s =  38 KB
+ *     descent 300 s x 1.9 KB/s = 570 KB
+ *
+ * About 810 KB a flight, where logging every raw sample at the full rate
+ * would need 12 MB. The W25Q128 holds a two hour descent or many flights.
+ * With the mag on I2C 1 at the table's rates a flight is about 770 KB.
+ */
+
+
+#ifndef PHASE_H
+#define PHASE_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Upwards acceleration (gravity removed) that starts a launch, m/s^2
+#define PHASE_LAUNCH_ACCEL 30.0f
+/// Acceleration below which a launch is forgotten, m/s^2
+#define PHASE_LAUNCH_RESET_ACCEL 15.0f
+/// Time the launch acceleration must last, ms
+#define PHASE_LAUNCH_HOLD_MS 50
+
+/// Acceleration that marks burnout (gravity and drag only), m/s^2
+#define PHASE_BURNOUT_ACCEL -3.0f
+/// Acceleration above which burnout is forgotten, m/s^2
+#define PHASE_BURNOUT_RESET_ACCEL 3.0f
+/// Time the burnout acceleration must last, ms
+#define PHASE_BURNOUT_HOLD_MS 100
+
+/// Time spent in the apogee phase at the full rate for deployment, ms
+#define PHASE_APOGEE_MS 3000
+
+/// Speed below which the rocket may have landed, m/s
+#define PHASE_LANDED_VELOCITY 1.0f
+/// Speed above which landing is forgotten, m/s
+#define PHASE_LANDED_RESET_VELOCITY 3.0f
+/// Time the rocket must be still, ms
+#define PHASE_LANDED_HOLD_MS 5000
+
+typedef enum {
+    PHASE_PAD,
+    PHASE_BOOST,
+    PHASE_COAST,
+    PHASE_APOGEE,
+    PHASE_DESCENT,
+    PHASE_LANDED,
+    PHASE_COUNT
+} phase_t;
+
+/** 
+ * @brief Start on the pad and apply its rates, the sensors must be
+ * initialised
+ * 
+ */
+void phase_init(void);
+
+/** 
+ * @brief Check for a phase change, call from the acquisition task after
+ * the samples have been processed
+ * @param accel_up the newest upwards acceleration, gravity removed, m/s^2
+ * @param now_ms the current time
+ * 
+ */
+void phase_update(float accel_up, uint32_t now_ms);
+
+/** 
+ * @brief Get the current phase
+ * 
+ * @return the phase
+ */
+phase_t phase_get(void);
+
+/** 
+ * @brief Get the time the current phase started
+ * 
+ * @return the time in ms
+ */
+uint32_t phase_since_ms(void);
+
+/** 
+ * @brief Get the name of a phase
+ * @param phase the phase
+ * 
+ * @return the name
+ */
+const char *phase_name(phase_t phase);
+
+
+#endif // PHASE_H
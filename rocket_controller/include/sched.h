@@ -0,0 +1,109 @@
+/** 
+ * @file sched.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-06
+ * @brief Declarations for the cooperative task scheduler
+ *
+ * Tasks run to completion from sched_run(). When several tasks are ready
+ * the one with the highest priority (lowest number) runs first, ties are
+ * broken by the earliest deadline. Each task keeps counters of how late it
+ * started and how often it finished after its deadline, timed in us on the
+ * timebase. Periods and delays are whole ms and must be under 35 minutes
+ * since times are kept as 32 bit us.
+ */
+
+
+#ifndef SCHED_H
+#define SCHED_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHED_MAX_TASKS 8
+
+/// Priorities, lower runs first
+#define SCHED_PRIO_HIGHEST 0
+#define SCHED_PRIO_LOWEST 7
+
+typedef void (*sched_task_fn_t)(void);
+
+/// Counters for a task
+typedef struct {
+    const char *name;
+    uint32_t runs;
+    uint32_t overruns;          ///< Runs that finished after their deadline (or were skipped)
+    uint32_t max_latency;       ///< Longest time from release to start in us
+    uint32_t max_runtime;       ///< Longest run in us
+} sched_stats_t;
+
+/** 
+ * @brief Initialise the scheduler, the timebase must already be running
+ * 
+ */
+void sched_init(void);
+
+/** 
+ * @brief Add a task which runs every period
+ * @param name the name shown in the statistics
+ * @param fn the task function
+ * @param period the period in ms
+ * @param deadline the time after each release it must finish by in ms, 0 for the period
+ * @param priority the priority, SCHED_PRIO_HIGHEST to SCHED_PRIO_LOWEST
+ * 
+ * @return the task id or -1 if there is no room
+ */
+int sched_add_periodic(const char *name, sched_task_fn_t fn, uint32_t period, uint32_t deadline, uint8_t priority);
+
+/** 
+ * @brief Add a task which runs once after a delay
+ * @param name the name shown in the statistics
+ * @param fn the task function
+ * @param delay the delay before it runs in ms
+ * @param deadline the time after the release it must finish by in ms
+ * @param priority the priority, SCHED_PRIO_HIGHEST to SCHED_PRIO_LOWEST
+ * 
+ * @return the task id or -1 if there is no room
+ */
+int sched_add_oneshot(const char *name, sched_task_fn_t fn, uint32_t delay, uint32_t deadline, uint8_t priority);
+
+/** 
+ * @brief Stop a task from running again
+ * @param id the task id
+ * 
+ */
+void sched_cancel(int id);
+
+/** 
+ * @brief Run the tasks forever
+ * 
+ */
+void sched_run(void) __attribute__((noreturn));
+
+#if !defined(__arm__)
+/** 
+ * @brief Called by host builds in place of wfi when no task is ready, with
+ * interrupts masked. A simulation moves its clock on to the next tick here.
+ * 
+ */
+void sched_host_wait(void);
+#endif
+
+/** 
+ * @brief Get the time the scheduler runs on
+ * 
+ * @return the time in ms
+ */
+uint32_t sched_now(void);
+
+/** 
+ * @brief Get the counters of a task
+ * @param id the task id
+ * @param stats the struct to fill
+ * 
+ * @return true if the task exists
+ */
+bool sched_get_stats(int id, sched_stats_t *stats);
+
+
+#endif // SCHED_H
@@ -0,0 +1,158 @@
+/** 
+ * @file slog.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-21
+ * @brief Declarations for the deferred format system log
+ *
+ * SLOG() stores a message id, the time and up to three raw arguments in a
+ * RAM ring, nothing is formatted. It takes a fixed handful of cycles so it
+ * can be used from interrupts and the acquisition path (tools/slog_bench.c
+ * measures it against formatting the line). When full the oldest message is
+ * lost.
+ *
+ * Messages are formatted only when read, from /var/log/syslog or on the
+ * host. While a flight is recording they are also copied into the flight
+ * log as TELEM_REC_SYSLOG frames, which tools/telem_decode formats with the
+ * same table.
+ *
+ * Add messages to SLOG_MSG_LIST with the number of arguments and a format
+ * using %d, %u or %x (each argument is 32 bits), ids must not be reused.
+ */
+
+
+#ifndef SLOG_H
+#define SLOG_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// The messages: id, number of arguments, format
+#define SLOG_MSG_LIST(MSG) \
+    MSG(SLOG_BOOT, 0, "boot") \
+    MSG(SLOG_PHASE, 2, "phase %u at %u ms") \
+    MSG(SLOG_LOG_START, 0, "flight log started") \
+    MSG(SLOG_LOG_STOP, 2, "flight log stopped, %u blocks, %u samples dropped") \
+    MSG(SLOG_I2C_ERROR, 2, "i2c%u error, address 0x%x") \
+    MSG(SLOG_IMU_OVERRUN, 1, "imu fifo overrun %u")
+
+#define SLOG_MSG_ENUM(id, nargs, format) id,
+typedef enum {
+    SLOG_MSG_LIST(SLOG_MSG_ENUM)
+    SLOG_NUM_MSGS
+} slog_id_t;
+#undef SLOG_MSG_ENUM
+
+/// Most arguments of a message
+#define SLOG_MAX_ARGS 3
+
+/// Messages held in the ring, must be a power of 2
+#define SLOG_LEN 64
+
+/// Longest formatted message, with the time and line ending
+#define SLOG_LINE_MAX 96
+
+/// A stored message, only the arguments used are sent in a frame
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;       ///< Time of the message (low 32 bits of the monotonic clock)
+    uint16_t id;
+    uint16_t seq;           ///< Counts every message so gaps can be seen
+    uint32_t args[SLOG_MAX_ARGS];
+} slog_rec_t;
+
+/// Size of a message with n arguments
+#define SLOG_REC_LEN(n) (offsetof(slog_rec_t, args) + (n) * sizeof(uint32_t))
+
+/// Counters for the log
+typedef struct {
+    uint32_t writes;
+    uint32_t lost;              ///< Messages overwritten because the ring was full
+    uint32_t spilled;           ///< Messages copied to the flight log
+} slog_stats_t;
+
+/// Reads the log for the console a line at a time, see slog_read_chunk()
+typedef struct {
+    uint16_t idx;
+    uint16_t end;
+    uint8_t line_len;
+    uint8_t line_pos;
+    char line[SLOG_LINE_MAX];
+} slog_reader_t;
+
+/// Log a message: SLOG(SLOG_PHASE, phase, now_ms)
+#define SLOG(...) SLOG_PICK_(__VA_ARGS__, 0, 0, 0, 0)
+#define SLOG_PICK_(id, a, b, c, ...) slog_write((id), (uint32_t)(a), (uint32_t)(b), (uint32_t)(c))
+
+/** 
+ * @brief Store a message, use SLOG()
+ * @param id the message
+ * @param a0 the first argument
+ * @param a1 the second argument
+ * @param a2 the third argument
+ * 
+ */
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2);
+
+/** 
+ * @brief Copy a message out of the ring
+ * @param idx the message to read, moved on to the oldest held if it has
+ * been overwritten, the caller moves it on after using the message
+ * @param rec the message
+ * 
+ * @return true if there was a message
+ */
+bool slog_read(uint16_t *idx, slog_rec_t *rec);
+
+/** 
+ * @brief Copy new messages into the flight log while it is recording
+ * 
+ */
+void slog_service(void);
+
+/** 
+ * @brief Start reading the messages held now
+ * @param reader the reader
+ * 
+ */
+void slog_reader_init(slog_reader_t *reader);
+
+/** 
+ * @brief Format the next messages into a buffer, a cli_read_chunk_t
+ * @param ctx the reader
+ * @param offset unused, the reader keeps its place
+ * @param buf the buffer
+ * @param len the size of the buffer
+ * 
+ * @return the number of bytes written, 0 at the end
+ */
+int slog_read_chunk(void *ctx, uint32_t offset, uint8_t *buf, size_t len);
+
+/** 
+ * @brief Get a snapshot of the log counters
+ * @param stats the struct to fill
+ * 
+ */
+void slog_get_stats(slog_stats_t *stats);
+
+/** 
+ * @brief Format the text of a message (in slog_fmt.c, shared with the host)
+ * @param rec the message
+ * @param len the size of the message, shorter when sent in a frame
+ * @param buf the buffer
+ * @param size the size of the buffer
+ * 
+ * @return the length of the text
+ */
+size_t slog_format(const slog_rec_t *rec, size_t len, char *buf, size_t size);
+
+/** 
+ * @brief Get the number of arguments of a message
+ * @param id the message
+ * 
+ * @return the number of arguments, -1 if the id is not known
+ */
+int slog_nargs(uint16_t id);
+
+
+#endif // SLOG_H
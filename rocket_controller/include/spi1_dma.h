@@ -0,0 +1,67 @@
+/** 
+ * @file spi1_dma.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-10
+ * @brief Declarations for the SPI 1 register and DMA burst layer
+ *
+ * Everything the LSM6DS3 driver needs from the hardware goes through these
+ * functions so the driver can be built natively against a replacement that
+ * plays back captured FIFO data.
+ */
+
+
+#ifndef SPI1_DMA_H
+#define SPI1_DMA_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Called from the DMA interrupt when a burst read has finished
+typedef void (*spi1_dma_done_cb_t)(void);
+
+/** 
+ * @brief Initialise SPI 1, the chip select and the DMA channels
+ * 
+ */
+void spi1_dma_init(void);
+
+/** 
+ * @brief Write a register, blocking. Must not be used while a burst is
+ * running.
+ * @param reg the register address
+ * @param val the value to write
+ * 
+ */
+void spi1_write_reg(uint8_t reg, uint8_t val);
+
+/** 
+ * @brief Read a register, blocking. Must not be used while a burst is
+ * running.
+ * @param reg the register address
+ * 
+ * @return the register value
+ */
+uint8_t spi1_read_reg(uint8_t reg);
+
+/** 
+ * @brief Start a DMA read of consecutive registers
+ * @param reg the first register address
+ * @param buf the buffer to fill, must stay valid until done is called
+ * @param len the number of bytes to read
+ * @param done the completion callback (interrupt context)
+ * 
+ * @return true if the burst was started, false if one is already running
+ */
+bool spi1_dma_read(uint8_t reg, uint8_t *buf, size_t len, spi1_dma_done_cb_t done);
+
+/** 
+ * @brief Check if a burst is running
+ * 
+ * @return true if busy
+ */
+bool spi1_dma_busy(void);
+
+
+#endif // SPI1_DMA_H
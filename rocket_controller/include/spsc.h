@@ -0,0 +1,172 @@
+/**
+ * @file spsc.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-13
+ * @brief Typed single producer, single consumer queue
+ *
+ * SPSC_DECLARE(name, type, size) declares a queue type name_t of size
+ * entries (a power of 2, at most 32768) and static inline functions
+ * name_push(), name_pop(), name_push_n(), name_pop_n(), ... for it.
+ *
+ * Unlike CBUF.h the indices are published with a data memory barrier, so an
+ * entry is always fully written before the consumer can see it and fully
+ * read before the producer can reuse it. The producer owns the head, the
+ * overflow count and the high water mark, the consumer owns the tail.
+ *
+ * Records can also be produced or consumed in place: name_write_span()
+ * returns the contiguous free entries and name_commit() publishes them,
+ * name_read_span() / name_release() do the same for the consumer.
+ *
+ * @code
+ * SPSC_DECLARE(mag_queue, telem_mag_t, 8)
+ * static mag_queue_t g_mag_queue;
+ *
+ * // interrupt
+ * mag_queue_push(&g_mag_queue, &rec);
+ *
+ * // task
+ * const telem_mag_t *recs;
+ * size_t n = mag_queue_read_span(&g_mag_queue, &recs);
+ * ...
+ * mag_queue_release(&g_mag_queue, n);
+ * @endcode
+ */
+
+
+#ifndef SPSC_H
+#define SPSC_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__arm__)
+#include <libopencm3/cm3/cortex.h>
+#define SPSC_DMB() __dmb()
+#else
+#define SPSC_DMB() __sync_synchronize()
+#endif
+
+#define SPSC_DECLARE(name, type, size)                                          \
+_Static_assert((size) > 0 && ((size) & ((size) - 1)) == 0 && (size) <= 32768,   \
+               #name " size must be a power of 2");                             \
+                                                                                \
+typedef struct {                                                                \
+    volatile uint16_t head;         /* Entries pushed, producer only */         \
+    volatile uint16_t tail;         /* Entries popped, consumer only */         \
+    uint16_t high_water;            /* Most entries queued, producer only */    \
+    uint32_t overflows;             /* Entries refused, producer only */        \
+    type entries[size];                                                         \
+} name##_t;                                                                     \
+                                                                                \
+static inline void name##_init(name##_t *q) {                                   \
+    q->head = q->tail = 0;                                                      \
+    q->high_water = 0;                                                          \
+    q->overflows = 0;                                                           \
+}                                                                               \
+                                                                                \
+static inline size_t name##_len(const name##_t *q) {                            \
+    return (uint16_t)(q->head - q->tail);                                       \
+}                                                                               \
+                                                                                \
+static inline size_t name##_space(const name##_t *q) {                          \
+    return (size) - name##_len(q);                                              \
+}                                                                               \
+                                                                                \
+static inline size_t name##_write_span(name##_t *q, type **span) {              \
+    uint16_t head = q->head;                                                    \
+    size_t space = (size) - (uint16_t)(head - q->tail);                         \
+    size_t contig = (size) - (head & ((size) - 1));                             \
+    *span = &q->entries[head & ((size) - 1)];                                   \
+    return space < contig ? space : contig;                                     \
+}                                                                               \
+                                                                                \
+static inline void name##_commit(name##_t *q, size_t n) {                       \
+    /* The entries must be written before the consumer can see them */          \
+    SPSC_DMB();                                                                 \
+    q->head = q->head + n;                                                      \
+    size_t len = (uint16_t)(q->head - q->tail);                                 \
+    if (len > q->high_water) {                                                  \
+        q->high_water = len;                                                    \
+    }                                                                           \
+}                                                                               \
+                                                                                \
+static inline size_t name##_read_span(name##_t *q, const type **span) {         \
+    uint16_t tail = q->tail;                                                    \
+    size_t len = (uint16_t)(q->head - tail);                                    \
+    size_t contig = (size) - (tail & ((size) - 1));                             \
+    /* The head must be read before the entries it covers */                    \
+    SPSC_DMB();                                                                 \
+    *span = &q->entries[tail & ((size) - 1)];                                   \
+    return len < contig ? len : contig;                                         \
+}                                                                               \
+                                                                                \
+static inline void name##_release(name##_t *q, size_t n) {                      \
+    /* The entries must be read before the producer can reuse them */           \
+    SPSC_DMB();                                                                 \
+    q->tail = q->tail + n;                                                      \
+}                                                                               \
+                                                                                \
+static inline bool name##_push(name##_t *q, const type *item) {                 \
+    type *span;                                                                 \
+    if (name##_write_span(q, &span) == 0) {                                     \
+        q->overflows++;                                                         \
+        return false;                                                           \
+    }                                                                           \
+    *span = *item;                                                              \
+    name##_commit(q, 1);                                                        \
+    return true;                                                                \
+}                                                                               \
+                                                                                \
+static inline bool name##_pop(name##_t *q, type *item) {                        \
+    const type *span;                                                           \
+    if (name##_read_span(q, &span) == 0) {                                      \
+        return false;                                                           \
+    }                                                                           \
+    *item = *span;                                                              \
+    name##_release(q, 1);                                                       \
+    return true;                                                                \
+}                                                                               \
+                                                                                \
+/* Push as many of n items as fit, the rest are counted as overflows */         \
+static inline size_t name##_push_n(name##_t *q, const type *items, size_t n) {  \
+    size_t done = 0;                                                            \
+    while (done < n) {                                                          \
+        type *span;                                                             \
+        size_t k = name##_write_span(q, &span);                                 \
+        if (k == 0) {                                                           \
+            break;                                                              \
+        }                                                                       \
+        if (k > n - done) {                                                     \
+            k = n - done;                                                       \
+        }                                                                       \
+        memcpy(span, items + done, k * sizeof(type));                           \
+        name##_commit(q, k);                                                    \
+        done += k;                                                              \
+    }                                                                           \
+    q->overflows += n - done;                                                   \
+    return done;                                                                \
+}                                                                               \
+                                                                                \
+static inline size_t name##_pop_n(name##_t *q, type *items, size_t n) {         \
+    size_t done = 0;                                                            \
+    while (done < n) {                                                          \
+        const type *span;                                                       \
+        size_t k = name##_read_span(q, &span);                                  \
+        if (k == 0) {                                                           \
+            break;                                                              \
+        }                                                                       \
+        if (k > n - done) {                                                     \
+            k = n - done;                                                       \
+        }                                                                       \
+        memcpy(items + done, span, k * sizeof(type));                           \
+        name##_release(q, k);                                                   \
+        done += k;                                                              \
+    }                                                                           \
+    return done;                                                                \
+}
+
+
+#endif // SPSC_H
@@ -0,0 +1,69 @@
+/** 
+ * @file telem.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Declarations for the binary telemetry records and stream
+ *
+ * Samples are sent as raw sensor counts in frames (see frame.h) on the
+ * telemetry CDC port, scaling to physical units is left to the host. The
+ * record layouts are shared with the host decoder in tools/telem_decode.c.
+ */
+
+
+#ifndef TELEM_H
+#define TELEM_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/// Frame types of the telemetry records
+typedef enum {
+    TELEM_REC_IMU = 1,
+    TELEM_REC_MAG = 2,
+    TELEM_REC_BARO = 3,
+    TELEM_REC_PACKED = 4,   ///< A block of delta encoded records, flight log only (see logpack.h)
+    TELEM_REC_SYSLOG = 5,   ///< A system log message, flight log only (see slog.h)
+} telem_rec_type_t;
+
+/// LSM6DS3 sample
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;       ///< Time of the sample (low 32 bits of the monotonic clock)
+    int16_t accel[3];       ///< Raw accelerometer counts x, y, z
+    int16_t gyro[3];        ///< Raw gyroscope counts x, y, z
+} telem_imu_t;
+
+/// LIS2MDL sample
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;       ///< Time of the sample
+    int16_t mag[3];         ///< Raw magnetometer counts x, y, z
+} telem_mag_t;
+
+/// BMP588 sample
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;       ///< Time of the sample
+    uint32_t pressure;      ///< Pressure in Pa / 64 (raw 24 bit)
+    int32_t temperature;    ///< Temperature in deg C / 65536 (raw 24 bit)
+} telem_baro_t;
+
+/** 
+ * @brief Send a record on the telemetry port. The frame is written whole or
+ * not at all so a full ring never leaves a partial frame on the wire.
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * 
+ * @return true if the record was queued
+ */
+bool telem_send(telem_rec_type_t type, const void *rec, size_t len);
+
+/** 
+ * @brief Get the number of records dropped because the port was busy or closed
+ * 
+ * @return the drop count
+ */
+uint32_t telem_get_dropped(void);
+
+
+#endif // TELEM_H
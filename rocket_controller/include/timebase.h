@@ -0,0 +1,42 @@
+/** 
+ * @file timebase.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-09
+ * @brief Declarations for the monotonic microsecond clock
+ *
+ * The clock is built from SysTick: the interrupt counts milliseconds into a
+ * 64 bit count and the sub-millisecond part is read from the counter
+ * itself. Reading is lock free and safe from any interrupt, including ones
+ * that preempt (or are higher priority than) the SysTick handler.
+ */
+
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** 
+ * @brief Start SysTick, the system clock must already be configured
+ * 
+ */
+void timebase_init(void);
+
+/** 
+ * @brief Get the time since boot
+ * 
+ * @return the time in us
+ */
+uint64_t timebase_now_us(void);
+
+/** 
+ * @brief Get the time since boot in whole milliseconds
+ * 
+ * @return the time in ms (wraps after 49 days)
+ */
+uint32_t timebase_now_ms(void);
+
+
+#endif // TIMEBASE_H
@@ -30,9 +30,25 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef void (*CdcRxCB_t)(char* buf, uint16_t len);
 
+/// The CDC-ACM functions of the composite device
+typedef enum {
+    USB_CDC_PORT_SHELL = 0,     ///< Microshell CLI, used by the usb_cdc_* calls without a port
+    USB_CDC_PORT_TELEM,         ///< Binary telemetry and log download
+    USB_CDC_NUM_PORTS,
+} usb_cdc_port_t;
+
+/// Counters for measuring the throughput of the tx engine
+typedef struct {
+    uint32_t tx_bytes;                  ///< Bytes sent to the host
+    uint32_t tx_packets;                ///< Packets sent to the host (including ZLPs)
+    uint32_t frames;                    ///< Start of frames seen (1 ms each)
+    uint16_t max_packets_per_frame;     ///< Most packets sent in a single frame
+} usb_cdc_stats_t;
+
 /**
  * @brief Initialise the USB CDC device, 48MHz usb clock must be enabled first
  *
@@ -47,11 +63,102 @@ int usb_cdc_init(void);
  */
 bool usb_cdc_connected(void);
 
+/** 
+ * @brief Get a snapshot of the tx throughput counters
+ * @param stats the struct to fill
+ * 
+ */
+void usb_cdc_get_stats(usb_cdc_stats_t *stats);
+
 uint16_t usb_cdc_avail(void);
 int usb_cdc_recv_byte(void);
+
+/** 
+ * @brief Copy received bytes out of the rx ring. The OUT end point is
+ * NAKed while the ring is nearly full and re-armed from here (and from
+ * usb_cdc_recv_byte) once there is room again.
+ * @param buf the buffer to fill
+ * @param len the size of the buffer
+ * 
+ * @return the number of bytes copied
+ */
+size_t usb_cdc_read(void *buf, size_t len);
 void usb_cdc_send_byte(uint8_t ch);
 void usb_cdc_send_strn(const char *str, size_t len);
 
+/** 
+ * @brief Copy as much of a buffer into the tx ring as will fit
+ * @param data the data to send
+ * @param len the number of bytes to send
+ * 
+ * @return the number of bytes accepted, the rest must be retried later
+ */
+size_t usb_cdc_write(const void *data, size_t len);
+
+/** 
+ * @brief Reserve the contiguous free region at the head of the tx ring so it
+ * can be written in place. Finish with usb_cdc_write_commit().
+ * @param len set to the number of bytes that may be written
+ * 
+ * @return a pointer to the region or NULL if the ring is full
+ */
+uint8_t *usb_cdc_write_reserve(size_t *len);
+
+/** 
+ * @brief Hand bytes written into a reserved region over to the tx engine
+ * @param len the number of bytes written, must not exceed the reserved length
+ * 
+ */
+void usb_cdc_write_commit(size_t len);
+
+/** 
+ * @brief Get the number of bytes that can currently be written
+ * 
+ * @return free space in the tx ring
+ */
+size_t usb_cdc_write_space(void);
+
+
+/** 
+ * @brief Check if the host has a port open
+ * @param port the port to check
+ * 
+ * @return true if connected
+ */
+bool usb_cdc_port_connected(usb_cdc_port_t port);
+
+/** 
+ * @brief Get a snapshot of the tx throughput counters of a port
+ * @param port the port to read
+ * @param stats the struct to fill
+ * 
+ */
+void usb_cdc_port_get_stats(usb_cdc_port_t port, usb_cdc_stats_t *stats);
+
+/** 
+ * @brief usb_cdc_read() for a given port
+ */
+size_t usb_cdc_port_read(usb_cdc_port_t port, void *buf, size_t len);
+
+/** 
+ * @brief usb_cdc_write() for a given port
+ */
+size_t usb_cdc_port_write(usb_cdc_port_t port, const void *data, size_t len);
+
+/** 
+ * @brief usb_cdc_write_reserve() for a given port
+ */
+uint8_t *usb_cdc_port_write_reserve(usb_cdc_port_t port, size_t *len);
+
+/** 
+ * @brief usb_cdc_write_commit() for a given port
+ */
+void usb_cdc_port_write_commit(usb_cdc_port_t port, size_t len);
+
+/** 
+ * @brief usb_cdc_write_space() for a given port
+ */
+size_t usb_cdc_port_write_space(usb_cdc_port_t port);
 
 
 bool usb_cdc_ready(void);
@@ -18,13 +18,32 @@
 
 #include "info.h"
 
+/// Interface numbers and end points of the shell CDC-ACM function
+#define SHELL_COMM_IFACE    0
+#define SHELL_DATA_IFACE    1
+#define SHELL_EP_OUT        0x01
+#define SHELL_EP_IN         0x82
+#define SHELL_EP_NOTIF      0x83
+
+/// Interface numbers and end points of the telemetry CDC-ACM function
+#define TELEM_COMM_IFACE    2
+#define TELEM_DATA_IFACE    3
+#define TELEM_EP_OUT        0x04
+#define TELEM_EP_IN         0x85
+#define TELEM_EP_NOTIF      0x86
+
+/*
+ * Composite device made of two CDC-ACM functions, each grouped by an
+ * interface association descriptor so the host binds a driver per function.
+ * The packet memory holds EP0 (128 bytes) plus 144 bytes per function.
+ */
 static const struct usb_device_descriptor dev = {
 	.bLength = USB_DT_DEVICE_SIZE,
 	.bDescriptorType = USB_DT_DEVICE,
 	.bcdUSB = 0x0200,
-	.bDeviceClass = USB_CLASS_CDC,
-	.bDeviceSubClass = 0,
-	.bDeviceProtocol = 0,
+	.bDeviceClass = USB_CLASS_MISCELLANEOUS,
+	.bDeviceSubClass = 2,		// Common class
+	.bDeviceProtocol = 1,		// Interface association descriptor
 	.bMaxPacketSize0 = 64,
 	.idVendor = 0x0483,
 	.idProduct = 0x5740,
@@ -40,87 +59,173 @@ static const struct usb_device_descriptor dev = {
  * optional, but its absence causes a NULL pointer dereference in Linux
  * cdc_acm driver.
  */
-static const struct usb_endpoint_descriptor comm_endp[] = {{
+static const struct usb_endpoint_descriptor shell_comm_endp[] = {{
 	.bLength = USB_DT_ENDPOINT_SIZE,
 	.bDescriptorType = USB_DT_ENDPOINT,
-	.bEndpointAddress = 0x83,
+	.bEndpointAddress = SHELL_EP_NOTIF,
 	.bmAttributes = USB_ENDPOINT_ATTR_INTERRUPT,
 	.wMaxPacketSize = 16,
 	.bInterval = 255,
 }};
 
-static const struct usb_endpoint_descriptor data_endp[] = {{
+static const struct usb_endpoint_descriptor shell_data_endp[] = {{
 	.bLength = USB_DT_ENDPOINT_SIZE,
 	.bDescriptorType = USB_DT_ENDPOINT,
-	.bEndpointAddress = 0x01,
+	.bEndpointAddress = SHELL_EP_OUT,
 	.bmAttributes = USB_ENDPOINT_ATTR_BULK,
 	.wMaxPacketSize = 64,
 	.bInterval = 1,
 }, {
 	.bLength = USB_DT_ENDPOINT_SIZE,
 	.bDescriptorType = USB_DT_ENDPOINT,
-	.bEndpointAddress = 0x82,
+	.bEndpointAddress = SHELL_EP_IN,
 	.bmAttributes = USB_ENDPOINT_ATTR_BULK,
 	.wMaxPacketSize = 64,
 	.bInterval = 1,
 }};
 
-static const struct {
+static const struct usb_endpoint_descriptor telem_comm_endp[] = {{
+	.bLength = USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType = USB_DT_ENDPOINT,
+	.bEndpointAddress = TELEM_EP_NOTIF,
+	.bmAttributes = USB_ENDPOINT_ATTR_INTERRUPT,
+	.wMaxPacketSize = 16,
+	.bInterval = 255,
+}};
+
+static const struct usb_endpoint_descriptor telem_data_endp[] = {{
+	.bLength = USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType = USB_DT_ENDPOINT,
+	.bEndpointAddress = TELEM_EP_OUT,
+	.bmAttributes = USB_ENDPOINT_ATTR_BULK,
+	.wMaxPacketSize = 64,
+	.bInterval = 1,
+}, {
+	.bLength = USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType = USB_DT_ENDPOINT,
+	.bEndpointAddress = TELEM_EP_IN,
+	.bmAttributes = USB_ENDPOINT_ATTR_BULK,
+	.wMaxPacketSize = 64,
+	.bInterval = 1,
+}};
+
+typedef struct {
 	struct usb_cdc_header_descriptor header;
 	struct usb_cdc_call_management_descriptor call_mgmt;
 	struct usb_cdc_acm_descriptor acm;
 	struct usb_cdc_union_descriptor cdc_union;
-} __attribute__((packed)) cdcacm_functional_descriptors = {
-	.header = {
-		.bFunctionLength = sizeof(struct usb_cdc_header_descriptor),
-		.bDescriptorType = CS_INTERFACE,
-		.bDescriptorSubtype = USB_CDC_TYPE_HEADER,
-		.bcdCDC = 0x0110,
-	},
-	.call_mgmt = {
-		.bFunctionLength =
-			sizeof(struct usb_cdc_call_management_descriptor),
-		.bDescriptorType = CS_INTERFACE,
-		.bDescriptorSubtype = USB_CDC_TYPE_CALL_MANAGEMENT,
-		.bmCapabilities = 0,
-		.bDataInterface = 1,
-	},
-	.acm = {
-		.bFunctionLength = sizeof(struct usb_cdc_acm_descriptor),
-		.bDescriptorType = CS_INTERFACE,
-		.bDescriptorSubtype = USB_CDC_TYPE_ACM,
-		.bmCapabilities = 0,
-	},
-	.cdc_union = {
-		.bFunctionLength = sizeof(struct usb_cdc_union_descriptor),
-		.bDescriptorType = CS_INTERFACE,
-		.bDescriptorSubtype = USB_CDC_TYPE_UNION,
-		.bControlInterface = 0,
-		.bSubordinateInterface0 = 1,
-	 },
+} __attribute__((packed)) cdcacm_functional_descriptors_t;
+
+#define CDCACM_FUNCTIONAL_DESCRIPTORS(comm_iface, data_iface) { \
+	.header = { \
+		.bFunctionLength = sizeof(struct usb_cdc_header_descriptor), \
+		.bDescriptorType = CS_INTERFACE, \
+		.bDescriptorSubtype = USB_CDC_TYPE_HEADER, \
+		.bcdCDC = 0x0110, \
+	}, \
+	.call_mgmt = { \
+		.bFunctionLength = \
+			sizeof(struct usb_cdc_call_management_descriptor), \
+		.bDescriptorType = CS_INTERFACE, \
+		.bDescriptorSubtype = USB_CDC_TYPE_CALL_MANAGEMENT, \
+		.bmCapabilities = 0, \
+		.bDataInterface = (data_iface), \
+	}, \
+	.acm = { \
+		.bFunctionLength = sizeof(struct usb_cdc_acm_descriptor), \
+		.bDescriptorType = CS_INTERFACE, \
+		.bDescriptorSubtype = USB_CDC_TYPE_ACM, \
+		.bmCapabilities = 0, \
+	}, \
+	.cdc_union = { \
+		.bFunctionLength = sizeof(struct usb_cdc_union_descriptor), \
+		.bDescriptorType = CS_INTERFACE, \
+		.bDescriptorSubtype = USB_CDC_TYPE_UNION, \
+		.bControlInterface = (comm_iface), \
+		.bSubordinateInterface0 = (data_iface), \
+	 }, \
+}
+
+static const cdcacm_functional_descriptors_t shell_functional_descriptors =
+	CDCACM_FUNCTIONAL_DESCRIPTORS(SHELL_COMM_IFACE, SHELL_DATA_IFACE);
+
+static const cdcacm_functional_descriptors_t telem_functional_descriptors =
+	CDCACM_FUNCTIONAL_DESCRIPTORS(TELEM_COMM_IFACE, TELEM_DATA_IFACE);
+
+static const struct usb_iface_assoc_descriptor shell_assoc = {
+	.bLength = USB_DT_INTERFACE_ASSOCIATION_SIZE,
+	.bDescriptorType = USB_DT_INTERFACE_ASSOCIATION,
+	.bFirstInterface = SHELL_COMM_IFACE,
+	.bInterfaceCount = 2,
+	.bFunctionClass = USB_CLASS_CDC,
+	.bFunctionSubClass = USB_CDC_SUBCLASS_ACM,
+	.bFunctionProtocol = USB_CDC_PROTOCOL_AT,
+	.iFunction = 4,
+};
+
+static const struct usb_iface_assoc_descriptor telem_assoc = {
+	.bLength = USB_DT_INTERFACE_ASSOCIATION_SIZE,
+	.bDescriptorType = USB_DT_INTERFACE_ASSOCIATION,
+	.bFirstInterface = TELEM_COMM_IFACE,
+	.bInterfaceCount = 2,
+	.bFunctionClass = USB_CLASS_CDC,
+	.bFunctionSubClass = USB_CDC_SUBCLASS_ACM,
+	.bFunctionProtocol = USB_CDC_PROTOCOL_NONE,
+	.iFunction = 5,
 };
 
-static const struct usb_interface_descriptor comm_iface[] = {{
+static const struct usb_interface_descriptor shell_comm_iface[] = {{
 	.bLength = USB_DT_INTERFACE_SIZE,
 	.bDescriptorType = USB_DT_INTERFACE,
-	.bInterfaceNumber = 0,
+	.bInterfaceNumber = SHELL_COMM_IFACE,
 	.bAlternateSetting = 0,
 	.bNumEndpoints = 1,
 	.bInterfaceClass = USB_CLASS_CDC,
 	.bInterfaceSubClass = USB_CDC_SUBCLASS_ACM,
 	.bInterfaceProtocol = USB_CDC_PROTOCOL_AT,
+	.iInterface = 4,
+
+	.endpoint = shell_comm_endp,
+
+	.extra = &shell_functional_descriptors,
+	.extralen = sizeof(shell_functional_descriptors),
+}};
+
+static const struct usb_interface_descriptor shell_data_iface[] = {{
+	.bLength = USB_DT_INTERFACE_SIZE,
+	.bDescriptorType = USB_DT_INTERFACE,
+	.bInterfaceNumber = SHELL_DATA_IFACE,
+	.bAlternateSetting = 0,
+	.bNumEndpoints = 2,
+	.bInterfaceClass = USB_CLASS_DATA,
+	.bInterfaceSubClass = 0,
+	.bInterfaceProtocol = 0,
 	.iInterface = 0,
 
-	.endpoint = comm_endp,
+	.endpoint = shell_data_endp,
+}};
 
-	.extra = &cdcacm_functional_descriptors,
-	.extralen = sizeof(cdcacm_functional_descriptors),
+static const struct usb_interface_descriptor telem_comm_iface[] = {{
+	.bLength = USB_DT_INTERFACE_SIZE,
+	.bDescriptorType = USB_DT_INTERFACE,
+	.bInterfaceNumber = TELEM_COMM_IFACE,
+	.bAlternateSetting = 0,
+	.bNumEndpoints = 1,
+	.bInterfaceClass = USB_CLASS_CDC,
+	.bInterfaceSubClass = USB_CDC_SUBCLASS_ACM,
+	.bInterfaceProtocol = USB_CDC_PROTOCOL_NONE,
+	.iInterface = 5,
+
+	.endpoint = telem_comm_endp,
+
+	.extra = &telem_functional_descriptors,
+	.extralen = sizeof(telem_functional_descriptors),
 }};
 
-static const struct usb_interface_descriptor data_iface[] = {{
+static const struct usb_interface_descriptor telem_data_iface[] = {{
 	.bLength = USB_DT_INTERFACE_SIZE,
 	.bDescriptorType = USB_DT_INTERFACE,
-	.bInterfaceNumber = 1,
+	.bInterfaceNumber = TELEM_DATA_IFACE,
 	.bAlternateSetting = 0,
 	.bNumEndpoints = 2,
 	.bInterfaceClass = USB_CLASS_DATA,
@@ -128,22 +233,30 @@ static const struct usb_interface_descriptor data_iface[] = {{
 	.bInterfaceProtocol = 0,
 	.iInterface = 0,
 
-	.endpoint = data_endp,
+	.endpoint = telem_data_endp,
 }};
 
 static const struct usb_interface ifaces[] = {{
 	.num_altsetting = 1,
-	.altsetting = comm_iface,
+	.iface_assoc = &shell_assoc,
+	.altsetting = shell_comm_iface,
+}, {
+	.num_altsetting = 1,
+	.altsetting = shell_data_iface,
+}, {
+	.num_altsetting = 1,
+	.iface_assoc = &telem_assoc,
+	.altsetting = telem_comm_iface,
 }, {
 	.num_altsetting = 1,
-	.altsetting = data_iface,
+	.altsetting = telem_data_iface,
 }};
 
 static const struct usb_config_descriptor config = {
 	.bLength = USB_DT_CONFIGURATION_SIZE,
 	.bDescriptorType = USB_DT_CONFIGURATION,
 	.wTotalLength = 0,
-	.bNumInterfaces = 2,
+	.bNumInterfaces = 4,
 	.bConfigurationValue = 1,
 	.iConfiguration = 0,
 	.bmAttributes = 0x80,
@@ -152,12 +265,14 @@ static const struct usb_config_descriptor config = {
 	.interface = ifaces,
 };
 
-#define NUM_USB_STRINGS 3
+#define NUM_USB_STRINGS 5
 
 static const char *usb_strings[] = {
 	MANUFACTURER_STR,
 	PRODUCT_STR,
 	SERIAL_NUMBER,
+	SHELL_IFACE_STR,
+	TELEM_IFACE_STR,
 };
 
 
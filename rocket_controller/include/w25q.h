@@ -0,0 +1,87 @@
+/** 
+ * @file w25q.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Declarations for the W25Q128JV SPI flash driver
+ *
+ * The driver is polled and never waits for the flash to finish a program or
+ * erase, callers check w25q_busy() instead. Only the commands needed by the
+ * flight recorder are provided.
+ */
+
+
+#ifndef W25Q_H
+#define W25Q_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define W25Q_SIZE           (16UL * 1024 * 1024)
+#define W25Q_PAGE_SIZE      256
+#define W25Q_SECTOR_SIZE    4096
+#define W25Q_BLOCK_SIZE     65536
+
+/** 
+ * @brief Initialise SPI 2 and check the flash responds
+ * 
+ * @return 0 if successful
+ */
+int w25q_init(void);
+
+/** 
+ * @brief Read from the flash, must not be busy
+ * @param addr the address to read from
+ * @param buf the buffer to fill
+ * @param len the number of bytes to read
+ * 
+ */
+void w25q_read(uint32_t addr, void *buf, size_t len);
+
+/** 
+ * @brief Start programming (part of) a page, the write must not cross a page
+ * boundary
+ * @param addr the address to write to
+ * @param data the data to write
+ * @param len the number of bytes, at most W25Q_PAGE_SIZE
+ * 
+ */
+void w25q_page_program(uint32_t addr, const void *data, size_t len);
+
+/** 
+ * @brief Start erasing the 4 KB sector containing addr
+ * @param addr the address of the sector
+ * 
+ */
+void w25q_erase_sector(uint32_t addr);
+
+/** 
+ * @brief Start erasing the 64 KB block containing addr
+ * @param addr the address of the block
+ * 
+ */
+void w25q_erase_block(uint32_t addr);
+
+/** 
+ * @brief Suspend an erase in progress so pages outside it can be
+ * programmed, wait for w25q_busy() to clear before programming
+ * 
+ */
+void w25q_erase_suspend(void);
+
+/** 
+ * @brief Resume a suspended erase
+ * 
+ */
+void w25q_erase_resume(void);
+
+/** 
+ * @brief Check if a program or erase is in progress
+ * 
+ * @return true if busy
+ */
+bool w25q_busy(void);
+
+
+#endif // W25Q_H
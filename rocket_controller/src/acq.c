@@ -0,0 +1,527 @@
+/** 
+ * @file acq.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-12
+ * @brief Implementation of the sensor acquisition
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/exti.h>
+#include <libopencm3/cm3/nvic.h>
+
+#include "spsc.h"
+
+#include "board.h"
+#include "lsm6ds3.h"
+#include "i2c_bus.h"
+#include "lis2mdl.h"
+#include "bmp588.h"
+#include "history.h"
+#include "telem.h"
+#include "timebase.h"
+#include "perf.h"
+#include "ahrs.h"
+#include "altitude.h"
+#include "phase.h"
+#include "filt.h"
+
+#include "acq.h"
+
+#define STANDARD_GRAVITY 9.80665f
+
+#if BOARD_HAS_SENSOR_IRQS
+/// EXTI lines of the data ready pins
+#define IMU_EXTI    EXTI0
+#define MAG_EXTI    EXTI1
+#define BARO_EXTI   EXTI8
+
+/// Below the I2C and DMA interrupts so a completion is never held up
+#define ACQ_EXTI_PRIORITY (3 << 4)
+#else
+/// Status register reads per sample period of the I2C sensors, new data
+/// waits at most this fraction of a period to be found
+#define ACQ_POLLS_PER_PERIOD 4
+
+/// Time of the last status read of each sensor
+static uint32_t g_poll_us[ACQ_NUM_SENSORS];
+#endif
+
+SPSC_DECLARE(mag_queue, telem_mag_t, 8)
+SPSC_DECLARE(baro_queue, telem_baro_t, 4)
+
+static mag_queue_t g_mag_queue;
+static baro_queue_t g_baro_queue;
+
+static acq_stats_t g_acq_stats[ACQ_NUM_SENSORS];
+static uint32_t g_rate_samples[ACQ_NUM_SENSORS];
+static uint32_t g_rate_start_ms = 0;
+
+static const char *g_acq_names[ACQ_NUM_SENSORS] = {
+    [ACQ_IMU] = "imu",
+    [ACQ_MAG] = "mag",
+    [ACQ_BARO] = "baro",
+};
+
+/// The magnetometer is read by the LSM6DS3 sensor hub
+static bool g_mag_via_hub = false;
+
+/// Newest magnetometer sample in the IMU axes, handed to the attitude
+/// filter once
+static int16_t g_mag_last[3];
+static bool g_mag_fresh = false;
+
+/// Time of the last IMU sample given to the altitude filter
+static uint32_t g_alt_last_us = 0;
+
+/// Decimates the IMU for the estimator and the logger
+static filt_chain_t g_filt;
+static filt_sample_t g_filt_hist[FILT_IMU_HIST_LEN];
+
+/// Upwards acceleration of the newest estimator sample, m/s^2
+static float g_accel_up = 0;
+
+/// Logging divider of each sensor and the samples since one was logged
+static uint8_t g_log_div[ACQ_NUM_SENSORS] = { 1, 1, 1 };
+static uint8_t g_log_count[ACQ_NUM_SENSORS];
+
+/** 
+ * @brief Keep a magnetometer sample for the attitude filter, with the hard
+ * iron offset removed and turned into the IMU axes
+ * @param mag the raw LIS2MDL counts
+ * 
+ */
+static void acq_mag_to_imu(const int16_t mag[3]) {
+    static const uint8_t map[3] = MAG_AXIS_MAP;
+    static const int8_t sign[3] = MAG_AXIS_SIGN;
+    static const int16_t hard_iron[3] = MAG_HARD_IRON;
+
+    for (int i = 0; i < 3; i++) {
+        int32_t v = sign[i] * ((int32_t)mag[map[i]] - hard_iron[map[i]]);
+        g_mag_last[i] = v > INT16_MAX ? INT16_MAX : (v < -INT16_MAX ? -INT16_MAX : v);
+    }
+    g_mag_fresh = true;
+}
+
+/** 
+ * @brief Queue a magnetometer sample, runs in the I2C 1 interrupt
+ * @param sample the sample
+ * 
+ */
+static void acq_mag_handler(const lis2mdl_sample_t *sample) {
+    telem_mag_t rec;
+
+    rec.time_us = sample->time_us;
+    for (int i = 0; i < 3; i++) {
+        rec.mag[i] = sample->mag[i];
+    }
+    mag_queue_push(&g_mag_queue, &rec);
+}
+
+/** 
+ * @brief Queue a barometer sample, runs in the I2C 2 interrupt
+ * @param sample the sample
+ * 
+ */
+static void acq_baro_handler(const bmp588_sample_t *sample) {
+    telem_baro_t rec;
+
+    rec.time_us = sample->time_us;
+    rec.pressure = sample->pressure;
+    rec.temperature = sample->temperature;
+    baro_queue_push(&g_baro_queue, &rec);
+}
+
+#if BOARD_HAS_SENSOR_IRQS
+/** 
+ * @brief Set up a data ready pin as a rising edge interrupt
+ * @param port the GPIO port
+ * @param pin the GPIO pin
+ * @param exti the EXTI line
+ * @param irq the interrupt
+ * 
+ */
+static void acq_exti_init(uint32_t port, uint16_t pin, uint32_t exti, uint8_t irq) {
+    gpio_set_mode(port, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, pin);
+
+    exti_select_source(exti, port);
+    exti_set_trigger(exti, EXTI_TRIGGER_RISING);
+    exti_reset_request(exti);
+    exti_enable_request(exti);
+
+    nvic_set_priority(irq, ACQ_EXTI_PRIORITY);
+    nvic_enable_irq(irq);
+}
+#endif
+
+void acq_init(void) {
+    rcc_periph_clock_enable(RCC_GPIOA);
+    rcc_periph_clock_enable(RCC_GPIOB);
+    rcc_periph_clock_enable(RCC_AFIO);
+
+    mag_queue_init(&g_mag_queue);
+    baro_queue_init(&g_baro_queue);
+
+    g_acq_stats[ACQ_IMU].present = lsm6ds3_init() == 0;
+
+    i2c_bus_init(I2C_BUS_1);
+    i2c_bus_init(I2C_BUS_2);
+    g_acq_stats[ACQ_MAG].present = lis2mdl_init() == 0;
+    g_acq_stats[ACQ_BARO].present = bmp588_init() == 0;
+
+#if MAG_VIA_IMU_HUB
+    // The magnetometer is configured over I2C 1, then I2C 1 is left to the
+    // LSM6DS3 master
+    if (g_acq_stats[ACQ_IMU].present && g_acq_stats[ACQ_MAG].present) {
+        lsm6ds3_enable_hub(LIS2MDL_ADDR, LIS2MDL_REG_OUTX_L);
+        g_mag_via_hub = true;
+    }
+#endif
+
+    if (g_acq_stats[ACQ_MAG].present && !g_mag_via_hub) {
+        lis2mdl_set_handler(acq_mag_handler);
+    }
+    if (g_acq_stats[ACQ_BARO].present) {
+        bmp588_set_handler(acq_baro_handler);
+    }
+
+#if BOARD_HAS_SENSOR_IRQS
+    if (g_acq_stats[ACQ_IMU].present) {
+        acq_exti_init(IMU_INT1_PORT, IMU_INT1_PIN, IMU_EXTI, NVIC_EXTI0_IRQ);
+    }
+    if (g_acq_stats[ACQ_MAG].present && !g_mag_via_hub) {
+        acq_exti_init(MAG_DRDY_PORT, MAG_DRDY_PIN, MAG_EXTI, NVIC_EXTI1_IRQ);
+    }
+    if (g_acq_stats[ACQ_BARO].present) {
+        acq_exti_init(BARO_INT_PORT, BARO_INT_PIN, BARO_EXTI, NVIC_EXTI9_5_IRQ);
+    }
+#endif
+
+    filt_imu_chain_init(&g_filt, g_filt_hist);
+    ahrs_init();
+    alt_init();
+    phase_init();
+    g_rate_start_ms = timebase_now_ms();
+}
+
+void acq_configure(const acq_config_t *config) {
+    if (g_acq_stats[ACQ_IMU].present) {
+#if BOARD_HAS_SENSOR_IRQS
+        nvic_disable_irq(NVIC_EXTI0_IRQ);
+        lsm6ds3_set_odr(config->imu_odr);
+        nvic_enable_irq(NVIC_EXTI0_IRQ);
+#else
+        lsm6ds3_set_odr(config->imu_odr);
+#endif
+        // The estimator tap is a power of 2 slower than the IMU
+        uint8_t shift = LSM6DS3_ODR_1666HZ - config->imu_odr;
+        for (uint16_t f = filt_chain_factor(&g_filt, g_filt.est_tap); f > 1; f >>= 1) {
+            shift++;
+        }
+        ahrs_set_period_shift(shift);
+    }
+    ahrs_set_accel_enabled(config->ahrs_accel);
+    if (g_acq_stats[ACQ_MAG].present && !g_mag_via_hub) {
+        lis2mdl_set_odr(config->mag_odr);
+    }
+    if (g_acq_stats[ACQ_BARO].present) {
+        bmp588_set_odr(config->baro_odr);
+    }
+
+    for (int i = 0; i < ACQ_NUM_SENSORS; i++) {
+        g_log_div[i] = config->log_div[i];
+        g_log_count[i] = 0;
+    }
+}
+
+/** 
+ * @brief Pass a sample on to the history and telemetry
+ * @param sensor the sensor it came from
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * 
+ */
+static void acq_deliver(acq_sensor_t sensor, telem_rec_type_t type, const void *rec, size_t len) {
+    if (g_log_div[sensor] != 0 && ++g_log_count[sensor] >= g_log_div[sensor]) {
+        history_push(type, rec, len);
+        g_log_count[sensor] = 0;
+    }
+    telem_send(type, rec, len);
+    g_acq_stats[sensor].samples++;
+}
+
+/** 
+ * @brief Run one estimator tap sample through the attitude and altitude
+ * filters
+ * @param sample the sample
+ * 
+ */
+static void acq_estimate(const filt_sample_t *sample) {
+    const int16_t *gyro = &sample->ch[0];
+    const int16_t *accel = &sample->ch[3];
+
+    const int16_t *mag = NULL;
+    if (g_mag_fresh) {
+        mag = g_mag_last;
+        g_mag_fresh = false;
+    }
+    PERF_ZONE_ENTER(PERF_ZONE_AHRS);
+    ahrs_update(gyro, accel, mag);
+    PERF_ZONE_EXIT(PERF_ZONE_AHRS);
+
+    // Use the real sample spacing so lost samples do not stretch time
+    uint32_t period_us = lsm6ds3_period_us() * filt_chain_factor(&g_filt, g_filt.est_tap);
+    uint32_t gap_us = sample->time_us - g_alt_last_us;
+    if (g_alt_last_us == 0 || gap_us > 10 * period_us) {
+        gap_us = period_us;
+    }
+    g_alt_last_us = sample->time_us;
+
+    PERF_ZONE_ENTER(PERF_ZONE_ALT);
+    float accel_up = ahrs_vertical_accel(accel) * LSM6DS3_ACCEL_G_PER_COUNT * STANDARD_GRAVITY
+                     - STANDARD_GRAVITY;
+    alt_predict(accel_up, gap_us * 1e-6f, sample->time_us);
+    PERF_ZONE_EXIT(PERF_ZONE_ALT);
+    g_accel_up = accel_up;
+}
+
+/** 
+ * @brief Parse a finished IMU block and filter it down to the estimator and
+ * logger rates
+ * 
+ */
+static void acq_drain_imu(void) {
+    static filt_sample_t raw[LSM6DS3_MAX_SAMPLES];
+    // The driver samples are finished with before the filter outputs are
+    // written, so they share the space
+    static union {
+        lsm6ds3_sample_t samples[LSM6DS3_MAX_SAMPLES];
+        struct {
+            filt_sample_t est[LSM6DS3_MAX_SAMPLES];
+            filt_sample_t logged[LSM6DS3_MAX_SAMPLES];
+        };
+    } buf;
+    lsm6ds3_sample_t *samples = buf.samples;
+    filt_sample_t *est = buf.est;
+    filt_sample_t *logged = buf.logged;
+
+    size_t n = lsm6ds3_read(samples, LSM6DS3_MAX_SAMPLES);
+    if (n == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        raw[i].time_us = samples[i].time_us;
+        for (int j = 0; j < 3; j++) {
+            raw[i].ch[j] = samples[i].gyro[j];
+            raw[i].ch[3 + j] = samples[i].accel[j];
+        }
+
+        // Sensor hub samples are not filtered, they are used as they arrive
+        if (samples[i].mag_valid) {
+            telem_mag_t mag;
+            mag.time_us = samples[i].time_us;
+            for (int j = 0; j < 3; j++) {
+                mag.mag[j] = samples[i].mag[j];
+            }
+            acq_mag_to_imu(samples[i].mag);
+            acq_deliver(ACQ_MAG, TELEM_REC_MAG, &mag, sizeof(mag));
+        }
+    }
+
+    size_t n_est, n_log;
+    PERF_ZONE_ENTER(PERF_ZONE_FILT);
+    filt_chain_process(&g_filt, raw, n, est, &n_est, logged, &n_log);
+    PERF_ZONE_EXIT(PERF_ZONE_FILT);
+
+    for (size_t i = 0; i < n_est; i++) {
+        acq_estimate(&est[i]);
+    }
+
+    for (size_t i = 0; i < n_log; i++) {
+        telem_imu_t rec;
+        rec.time_us = logged[i].time_us;
+        for (int j = 0; j < 3; j++) {
+            rec.gyro[j] = logged[i].ch[j];
+            rec.accel[j] = logged[i].ch[3 + j];
+        }
+        acq_deliver(ACQ_IMU, TELEM_REC_IMU, &rec, sizeof(rec));
+    }
+}
+
+#if BOARD_HAS_SENSOR_IRQS
+/** 
+ * @brief Restart reads whose level data ready line was left high, the line's
+ * interrupt is masked so it can not start a read at the same time
+ * 
+ */
+static void acq_restart_stuck(void) {
+    if (g_acq_stats[ACQ_IMU].present && gpio_get(IMU_INT1_PORT, IMU_INT1_PIN)) {
+        nvic_disable_irq(NVIC_EXTI0_IRQ);
+        lsm6ds3_on_watermark();
+        nvic_enable_irq(NVIC_EXTI0_IRQ);
+    }
+
+    if (g_acq_stats[ACQ_MAG].present && !g_mag_via_hub && gpio_get(MAG_DRDY_PORT, MAG_DRDY_PIN)) {
+        nvic_disable_irq(NVIC_EXTI1_IRQ);
+        lis2mdl_start_read();
+        nvic_enable_irq(NVIC_EXTI1_IRQ);
+    }
+}
+#else
+/** 
+ * @brief Check the status registers of the I2C sensors a few times per
+ * sample period, new data is read in the background
+ * 
+ */
+static void acq_poll_i2c(void) {
+    uint32_t now = (uint32_t)timebase_now_us();
+
+    if (g_acq_stats[ACQ_MAG].present && !g_mag_via_hub
+        && now - g_poll_us[ACQ_MAG] >= lis2mdl_period_us() / ACQ_POLLS_PER_PERIOD) {
+        g_poll_us[ACQ_MAG] = now;
+        lis2mdl_poll();
+    }
+    if (g_acq_stats[ACQ_BARO].present
+        && now - g_poll_us[ACQ_BARO] >= bmp588_period_us() / ACQ_POLLS_PER_PERIOD) {
+        g_poll_us[ACQ_BARO] = now;
+        bmp588_poll();
+    }
+}
+#endif
+
+void acq_service(void) {
+    const telem_mag_t *mag;
+    size_t n;
+    while ((n = mag_queue_read_span(&g_mag_queue, &mag)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            acq_deliver(ACQ_MAG, TELEM_REC_MAG, &mag[i], sizeof(telem_mag_t));
+        }
+        // The record is packed, its fields are copied out
+        int16_t last[3];
+        for (int j = 0; j < 3; j++) {
+            last[j] = mag[n - 1].mag[j];
+        }
+        acq_mag_to_imu(last);
+        mag_queue_release(&g_mag_queue, n);
+    }
+
+    PERF_ZONE_ENTER(PERF_ZONE_IMU);
+    acq_drain_imu();
+    PERF_ZONE_EXIT(PERF_ZONE_IMU);
+
+#if !BOARD_HAS_SENSOR_IRQS
+    // The next burst is read while the rest of the task runs
+    if (g_acq_stats[ACQ_IMU].present && lsm6ds3_poll()) {
+        g_acq_stats[ACQ_IMU].events++;
+    }
+    acq_poll_i2c();
+#endif
+
+    const telem_baro_t *baro;
+    while ((n = baro_queue_read_span(&g_baro_queue, &baro)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            acq_deliver(ACQ_BARO, TELEM_REC_BARO, &baro[i], sizeof(telem_baro_t));
+            alt_update_baro(baro[i].pressure);
+        }
+        baro_queue_release(&g_baro_queue, n);
+    }
+
+#if BOARD_HAS_SENSOR_IRQS
+    acq_restart_stuck();
+#endif
+
+    uint32_t now = timebase_now_ms();
+    phase_update(g_accel_up, now);
+
+    if (now - g_rate_start_ms >= 1000) {
+        for (int i = 0; i < ACQ_NUM_SENSORS; i++) {
+            g_acq_stats[i].rate_hz = g_acq_stats[i].samples - g_rate_samples[i];
+            g_rate_samples[i] = g_acq_stats[i].samples;
+        }
+        g_rate_start_ms = now;
+    }
+}
+
+void acq_get_stats(acq_sensor_t sensor, acq_stats_t *stats) {
+    *stats = g_acq_stats[sensor];
+
+    if (sensor == ACQ_IMU) {
+        lsm6ds3_stats_t imu;
+        lsm6ds3_get_stats(&imu);
+        stats->missed = imu.fifo_overruns;
+    } else if (sensor == ACQ_MAG) {
+        stats->dropped = g_mag_queue.overflows;
+        stats->queue_high_water = g_mag_queue.high_water;
+#if !BOARD_HAS_SENSOR_IRQS
+        if (!g_mag_via_hub) {
+            lis2mdl_stats_t mag;
+            lis2mdl_get_stats(&mag);
+            stats->events = mag.ready;
+            stats->missed = mag.missed;
+        }
+#endif
+    } else if (sensor == ACQ_BARO) {
+        stats->dropped = g_baro_queue.overflows;
+        stats->queue_high_water = g_baro_queue.high_water;
+#if !BOARD_HAS_SENSOR_IRQS
+        bmp588_stats_t baro;
+        bmp588_get_stats(&baro);
+        stats->events = baro.ready;
+        stats->missed = baro.missed;
+#endif
+    }
+}
+
+const char *acq_sensor_name(acq_sensor_t sensor) {
+    return g_acq_names[sensor];
+}
+
+#if BOARD_HAS_SENSOR_IRQS
+/** 
+ * @brief LSM6DS3 FIFO watermark
+ * 
+ */
+void exti0_isr(void) {
+    exti_reset_request(IMU_EXTI);
+
+    if (lsm6ds3_on_watermark()) {
+        g_acq_stats[ACQ_IMU].events++;
+    }
+}
+
+/** 
+ * @brief LIS2MDL data ready
+ * 
+ */
+void exti1_isr(void) {
+    exti_reset_request(MAG_EXTI);
+    g_acq_stats[ACQ_MAG].events++;
+
+    if (!lis2mdl_start_read()) {
+        g_acq_stats[ACQ_MAG].missed++;
+    }
+}
+
+/** 
+ * @brief BMP588 data ready (pulsed)
+ * 
+ */
+void exti9_5_isr(void) {
+    if (!exti_get_flag_status(BARO_EXTI)) {
+        return;
+    }
+    exti_reset_request(BARO_EXTI);
+    g_acq_stats[ACQ_BARO].events++;
+
+    if (!bmp588_start_read()) {
+        g_acq_stats[ACQ_BARO].missed++;
+    }
+}
+#endif
@@ -0,0 +1,201 @@
+/** 
+ * @file ahrs.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-14
+ * @brief Implementation of the fixed point Mahony attitude filter
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fixed.h"
+#include "lsm6ds3.h"
+
+#include "ahrs.h"
+
+#define AHRS_PI 3.14159265358979
+
+/// Sample period at the full rate in seconds
+#define AHRS_DT (LSM6DS3_PERIOD_US * 1e-6)
+
+/// Gyro count to half the angle turned in one sample, in Q40 to keep the
+/// precision of the small constant
+#define GYRO_HALF_ANGLE_Q40 ((int64_t)(70e-3 * AHRS_PI / 180.0 * AHRS_DT / 2 * (double)(1LL << 40) + 0.5))
+
+/// Proportional correction (rad/s per unit error) as a half angle per sample
+#define KP_HALF_DT Q30(AHRS_KP * AHRS_DT / 2)
+
+/// Integral gain per sample, the integral is held in rad/s
+#define KI_DT Q30(AHRS_KI * AHRS_DT)
+
+/// Integral rad/s to a half angle per sample
+#define HALF_DT Q30(AHRS_DT / 2)
+
+/// Largest gyro bias the integral can learn, rad/s
+#define INTEGRAL_LIMIT Q30(0.2)
+
+/// Squared accelerometer magnitudes, in counts, that are close enough to 1 g
+#define ONE_G_COUNTS (1.0 / LSM6DS3_ACCEL_G_PER_COUNT)
+#define ACCEL_MIN_SQ ((uint64_t)((1 - AHRS_ACCEL_GATE_G) * (1 - AHRS_ACCEL_GATE_G) * ONE_G_COUNTS * ONE_G_COUNTS))
+#define ACCEL_MAX_SQ ((uint64_t)((1 + AHRS_ACCEL_GATE_G) * (1 + AHRS_ACCEL_GATE_G) * ONE_G_COUNTS * ONE_G_COUNTS))
+
+static q30_t g_q[4] = { Q30_ONE, 0, 0, 0 };
+static q30_t g_integral[3];
+
+/// The sample period is AHRS_DT << g_shift, the per sample constants scale with it
+static uint8_t g_shift = 0;
+
+static bool g_accel_enabled = true;
+
+void ahrs_init(void) {
+    g_q[0] = Q30_ONE;
+    g_q[1] = g_q[2] = g_q[3] = 0;
+    g_integral[0] = g_integral[1] = g_integral[2] = 0;
+}
+
+void ahrs_set_period_shift(uint8_t shift) {
+    if (shift > AHRS_MAX_PERIOD_SHIFT) {
+        shift = AHRS_MAX_PERIOD_SHIFT;
+    }
+    g_shift = shift;
+}
+
+void ahrs_set_accel_enabled(bool enabled) {
+    g_accel_enabled = enabled;
+}
+
+/** 
+ * @brief Check an accelerometer sample can be taken as gravity
+ * @param accel the raw accelerometer counts
+ * 
+ * @return true if it is within AHRS_ACCEL_GATE_G of 1 g
+ */
+static bool ahrs_accel_is_gravity(const int16_t accel[3]) {
+    uint64_t sq = (uint64_t)((int32_t)accel[0] * accel[0]) + (uint64_t)((int32_t)accel[1] * accel[1])
+                + (uint64_t)((int32_t)accel[2] * accel[2]);
+
+    return sq >= ACCEL_MIN_SQ && sq <= ACCEL_MAX_SQ;
+}
+
+/** 
+ * @brief Add the cross product a x b to err
+ * @param a the first vector
+ * @param b the second vector
+ * @param err the sum
+ * 
+ */
+static void ahrs_add_cross(const q30_t a[3], const q30_t b[3], q30_t err[3]) {
+    err[0] = fx_add(err[0], q30_mul(a[1], b[2]) - q30_mul(a[2], b[1]));
+    err[1] = fx_add(err[1], q30_mul(a[2], b[0]) - q30_mul(a[0], b[2]));
+    err[2] = fx_add(err[2], q30_mul(a[0], b[1]) - q30_mul(a[1], b[0]));
+}
+
+/** 
+ * @brief Find the magnetometer error against the reference field
+ * @param m the unit magnetometer vector
+ * @param err the error to add to
+ * 
+ */
+static void ahrs_mag_error(const q30_t m[3], q30_t err[3]) {
+    q30_t q0 = g_q[0], q1 = g_q[1], q2 = g_q[2], q3 = g_q[3];
+
+    q30_t q0q1 = q30_mul(q0, q1), q0q2 = q30_mul(q0, q2), q0q3 = q30_mul(q0, q3);
+    q30_t q1q1 = q30_mul(q1, q1), q1q2 = q30_mul(q1, q2), q1q3 = q30_mul(q1, q3);
+    q30_t q2q2 = q30_mul(q2, q2), q2q3 = q30_mul(q2, q3), q3q3 = q30_mul(q3, q3);
+    const q30_t half = Q30_ONE / 2;
+
+    // Field in the earth frame, 64 bit sums so the doubling can not overflow
+    int64_t hx = 2 * ((int64_t)q30_mul(m[0], half - q2q2 - q3q3) + q30_mul(m[1], q1q2 - q0q3)
+                      + q30_mul(m[2], q1q3 + q0q2));
+    int64_t hy = 2 * ((int64_t)q30_mul(m[0], q1q2 + q0q3) + q30_mul(m[1], half - q1q1 - q3q3)
+                      + q30_mul(m[2], q2q3 - q0q1));
+    q30_t bz = fx_sat32(2 * ((int64_t)q30_mul(m[0], q1q3 - q0q2) + q30_mul(m[1], q2q3 + q0q1)
+                             + q30_mul(m[2], half - q1q1 - q2q2)));
+    q30_t bx = fx_isqrt64((uint64_t)(hx * hx) + (uint64_t)(hy * hy));
+
+    // Reference field back in the body frame
+    q30_t w[3];
+    w[0] = fx_sat32(2 * ((int64_t)q30_mul(bx, half - q2q2 - q3q3) + q30_mul(bz, q1q3 - q0q2)));
+    w[1] = fx_sat32(2 * ((int64_t)q30_mul(bx, q1q2 - q0q3) + q30_mul(bz, q0q1 + q2q3)));
+    w[2] = fx_sat32(2 * ((int64_t)q30_mul(bx, q0q2 + q1q3) + q30_mul(bz, half - q1q1 - q2q2)));
+
+    ahrs_add_cross(m, w, err);
+}
+
+void ahrs_update(const int16_t gyro[3], const int16_t accel[3], const int16_t mag[3]) {
+    q30_t q0 = g_q[0], q1 = g_q[1], q2 = g_q[2], q3 = g_q[3];
+    q30_t err[3] = { 0, 0, 0 };
+    int32_t v[3];
+    q30_t unit[3];
+
+    // Accelerometer against the gravity direction of the current attitude
+    v[0] = accel[0];
+    v[1] = accel[1];
+    v[2] = accel[2];
+    if (g_accel_enabled && ahrs_accel_is_gravity(accel) && fx_normalise3(v, unit)) {
+        q30_t g[3];
+        g[0] = fx_sat32(2 * ((int64_t)q30_mul(q1, q3) - q30_mul(q0, q2)));
+        g[1] = fx_sat32(2 * ((int64_t)q30_mul(q0, q1) + q30_mul(q2, q3)));
+        g[2] = fx_sat32((int64_t)q30_mul(q0, q0) - q30_mul(q1, q1) - q30_mul(q2, q2) + q30_mul(q3, q3));
+        ahrs_add_cross(unit, g, err);
+    }
+
+    if (mag != NULL) {
+        v[0] = mag[0];
+        v[1] = mag[1];
+        v[2] = mag[2];
+        if (fx_normalise3(v, unit)) {
+            ahrs_mag_error(unit, err);
+        }
+    }
+
+    // Half the angle to turn this sample: gyro, plus the feedback
+    q30_t h[3];
+    for (int i = 0; i < 3; i++) {
+        g_integral[i] = fx_add(g_integral[i], q30_mul(err[i], KI_DT << g_shift));
+        if (g_integral[i] > INTEGRAL_LIMIT) {
+            g_integral[i] = INTEGRAL_LIMIT;
+        } else if (g_integral[i] < -INTEGRAL_LIMIT) {
+            g_integral[i] = -INTEGRAL_LIMIT;
+        }
+
+        h[i] = fx_sat32(((int64_t)gyro[i] * GYRO_HALF_ANGLE_Q40) >> (10 - g_shift));
+        h[i] = fx_add(h[i], q30_mul(err[i], KP_HALF_DT << g_shift));
+        h[i] = fx_add(h[i], q30_mul(g_integral[i], HALF_DT << g_shift));
+    }
+
+    // q += q * (0, h)
+    q30_t n0 = q0 - q30_mul(q1, h[0]) - q30_mul(q2, h[1]) - q30_mul(q3, h[2]);
+    q30_t n1 = q1 + q30_mul(q0, h[0]) + q30_mul(q2, h[2]) - q30_mul(q3, h[1]);
+    q30_t n2 = q2 + q30_mul(q0, h[1]) - q30_mul(q1, h[2]) + q30_mul(q3, h[0]);
+    q30_t n3 = q3 + q30_mul(q0, h[2]) + q30_mul(q1, h[1]) - q30_mul(q2, h[0]);
+
+    // The norm stays close to 1 so one Newton step of 1/sqrt from 1 is enough
+    int64_t norm = (int64_t)q30_mul(n0, n0) + q30_mul(n1, n1) + q30_mul(n2, n2) + q30_mul(n3, n3);
+    q30_t scale = fx_sat32((3 * (int64_t)Q30_ONE - norm) / 2);
+
+    g_q[0] = q30_mul(n0, scale);
+    g_q[1] = q30_mul(n1, scale);
+    g_q[2] = q30_mul(n2, scale);
+    g_q[3] = q30_mul(n3, scale);
+}
+
+int32_t ahrs_vertical_accel(const int16_t accel[3]) {
+    q30_t q0 = g_q[0], q1 = g_q[1], q2 = g_q[2], q3 = g_q[3];
+
+    // The earth vertical in the body frame is the third row of the rotation
+    int64_t up[3];
+    up[0] = 2 * ((int64_t)q30_mul(q1, q3) - q30_mul(q0, q2));
+    up[1] = 2 * ((int64_t)q30_mul(q0, q1) + q30_mul(q2, q3));
+    up[2] = (int64_t)q30_mul(q0, q0) - q30_mul(q1, q1) - q30_mul(q2, q2) + q30_mul(q3, q3);
+
+    return (int32_t)((up[0] * accel[0] + up[1] * accel[1] + up[2] * accel[2]) >> 30);
+}
+
+void ahrs_get_quat(q30_t q[4]) {
+    for (int i = 0; i < 4; i++) {
+        q[i] = g_q[i];
+    }
+}
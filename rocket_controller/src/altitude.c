@@ -0,0 +1,178 @@
+/** 
+ * @file altitude.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-15
+ * @brief Implementation of the altitude/velocity Kalman filter and apogee
+ * detector
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "altitude.h"
+#include "baro_alt_table.h"
+
+/// Initial uncertainty of the state
+#define ALT_INIT_HEIGHT_VAR 1.0f
+#define ALT_INIT_VELOCITY_VAR 0.1f
+#define ALT_INIT_BIAS_VAR 1.0f
+
+/// Covariance, symmetric so only the upper triangle is kept
+typedef struct {
+    float p00, p01, p02;
+    float p11, p12;
+    float p22;
+} alt_cov_t;
+
+static alt_state_t g_alt;
+static alt_cov_t g_cov;
+
+static float g_ground_sum = 0;
+static uint16_t g_ground_count = 0;
+static float g_ground_alt = 0;
+
+static uint16_t g_apogee_count = 0;
+
+void alt_init(void) {
+    memset(&g_alt, 0, sizeof(g_alt));
+    memset(&g_cov, 0, sizeof(g_cov));
+    g_cov.p00 = ALT_INIT_HEIGHT_VAR;
+    g_cov.p11 = ALT_INIT_VELOCITY_VAR;
+    g_cov.p22 = ALT_INIT_BIAS_VAR;
+
+    g_ground_sum = 0;
+    g_ground_count = 0;
+    g_ground_alt = 0;
+    g_apogee_count = 0;
+}
+
+int32_t alt_pressure_to_mm(uint32_t pressure) {
+    if (pressure <= BARO_ALT_TABLE_BASE) {
+        return g_baro_alt_table[0];
+    }
+
+    uint32_t offset = pressure - BARO_ALT_TABLE_BASE;
+    uint32_t index = offset >> BARO_ALT_TABLE_SHIFT;
+    if (index >= BARO_ALT_TABLE_LEN - 1) {
+        return g_baro_alt_table[BARO_ALT_TABLE_LEN - 1];
+    }
+
+    int32_t frac = offset & ((1UL << BARO_ALT_TABLE_SHIFT) - 1);
+    int32_t lo = g_baro_alt_table[index];
+    int32_t span = g_baro_alt_table[index + 1] - lo;
+
+    return lo + (int32_t)(((int64_t)span * frac) >> BARO_ALT_TABLE_SHIFT);
+}
+
+float alt_pressure_to_altitude(uint32_t pressure) {
+    return alt_pressure_to_mm(pressure) * 0.001f;
+}
+
+/** 
+ * @brief Run the apogee detector on the current state
+ * @param time_us the time of the state
+ * 
+ */
+static void alt_detect_apogee(uint32_t time_us) {
+    if (g_alt.height > g_alt.max_height) {
+        g_alt.max_height = g_alt.height;
+        g_alt.max_height_us = time_us;
+    }
+
+    if (!g_alt.armed) {
+        g_alt.armed = g_alt.velocity > ALT_ARM_VELOCITY;
+        return;
+    }
+    if (g_alt.apogee) {
+        return;
+    }
+
+    // v < -k sigma without the square root
+    float v = g_alt.velocity;
+    if (v < 0 && v * v > ALT_APOGEE_SIGMA * ALT_APOGEE_SIGMA * g_cov.p11) {
+        if (++g_apogee_count >= ALT_APOGEE_SAMPLES) {
+            g_alt.apogee = true;
+            g_alt.apogee_us = time_us;
+        }
+    } else {
+        g_apogee_count = 0;
+    }
+}
+
+void alt_predict(float accel_up, float dt, uint32_t time_us) {
+    if (!g_alt.ground_set) {
+        return;
+    }
+
+    float c = 0.5f * dt * dt;
+    float a = accel_up - g_alt.accel_bias;
+
+    // x = F x with F = [1 dt -c; 0 1 -dt; 0 0 1]
+    g_alt.height += g_alt.velocity * dt + c * a;
+    g_alt.velocity += a * dt;
+
+    // P = F P F' + Q, A = F P first
+    alt_cov_t p = g_cov;
+    float a00 = p.p00 + dt * p.p01 - c * p.p02;
+    float a01 = p.p01 + dt * p.p11 - c * p.p12;
+    float a02 = p.p02 + dt * p.p12 - c * p.p22;
+    float a11 = p.p11 - dt * p.p12;
+    float a12 = p.p12 - dt * p.p22;
+    float a22 = p.p22;
+
+    // Acceleration noise enters through G = [c dt 0], the bias walks
+    float qa = ALT_ACCEL_NOISE * ALT_ACCEL_NOISE;
+    g_cov.p00 = a00 + dt * a01 - c * a02 + c * c * qa;
+    g_cov.p01 = a01 - dt * a02 + c * dt * qa;
+    g_cov.p02 = a02;
+    g_cov.p11 = a11 - dt * a12 + dt * dt * qa;
+    g_cov.p12 = a12;
+    g_cov.p22 = a22 + ALT_BIAS_NOISE * ALT_BIAS_NOISE * dt;
+
+    alt_detect_apogee(time_us);
+}
+
+void alt_update_baro(uint32_t pressure) {
+    float alt = alt_pressure_to_altitude(pressure);
+
+    if (!g_alt.ground_set) {
+        g_ground_sum += alt;
+        if (++g_ground_count == ALT_GROUND_SAMPLES) {
+            g_ground_alt = g_ground_sum / ALT_GROUND_SAMPLES;
+            g_alt.ground_set = true;
+        }
+        return;
+    }
+
+    // H = [1 0 0]: the gain is the first column of P over its first element
+    float s = g_cov.p00 + ALT_BARO_NOISE * ALT_BARO_NOISE;
+    float k0 = g_cov.p00 / s;
+    float k1 = g_cov.p01 / s;
+    float k2 = g_cov.p02 / s;
+
+    float innov = (alt - g_ground_alt) - g_alt.height;
+    g_alt.height += k0 * innov;
+    g_alt.velocity += k1 * innov;
+    g_alt.accel_bias += k2 * innov;
+
+    // P = (I - K H) P
+    alt_cov_t p = g_cov;
+    g_cov.p00 = p.p00 - k0 * p.p00;
+    g_cov.p01 = p.p01 - k0 * p.p01;
+    g_cov.p02 = p.p02 - k0 * p.p02;
+    g_cov.p11 = p.p11 - k1 * p.p01;
+    g_cov.p12 = p.p12 - k1 * p.p02;
+    g_cov.p22 = p.p22 - k2 * p.p02;
+}
+
+bool alt_apogee(void) {
+    return g_alt.apogee;
+}
+
+void alt_get_state(alt_state_t *state) {
+    *state = g_alt;
+    state->height_var = g_cov.p00;
+    state->velocity_var = g_cov.p11;
+}
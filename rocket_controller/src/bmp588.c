@@ -0,0 +1,194 @@
+/** 
+ * @file bmp588.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-11
+ * @brief Implementation of the BMP588 barometer driver
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "i2c_bus.h"
+#include "timebase.h"
+
+#include "bmp588.h"
+
+#define BMP588_BUS          I2C_BUS_2
+#define BMP588_ADDR         0x46
+
+#define REG_CHIP_ID         0x01
+#define REG_INT_CONFIG      0x14
+#define REG_INT_SOURCE      0x15
+#define REG_TEMP_XLSB       0x1D    ///< Temperature then pressure, 3 bytes each
+#define REG_INT_STATUS      0x27    ///< Cleared by reading it
+#define REG_OSR_CONFIG      0x36
+#define REG_ODR_CONFIG      0x37
+#define REG_CMD             0x7E
+
+#define CHIP_ID_BMP588      0x50
+#define CMD_SOFT_RESET      0xB6
+
+#define OSR_PRESS_X8_TEMP_X1 0x58   ///< Pressure enabled, 8x pressure, 1x temperature
+#define ODR_NORMAL          0x81    ///< Deep standby disabled, normal mode, rate in bits 6:2
+#define ODR_SHIFT           2
+#define INT_CONFIG_PULSED_HIGH 0x0A ///< Enabled, active high, push-pull, pulsed
+#define INT_SOURCE_DRDY     0x01
+#define INT_STATUS_DRDY     0x01
+
+/// Time the barometer needs after a soft reset
+#define BMP588_RESET_MS     3
+
+static uint8_t g_raw[6];
+static uint32_t g_time_us;
+static bmp588_handler_t g_handler = NULL;
+
+/// Register value written by bmp588_set_odr()
+static uint8_t g_odr_config;
+static bmp588_odr_t g_odr = BMP588_ODR_50HZ;
+
+static uint8_t g_int_status;
+static bmp588_stats_t g_stats;
+
+static void bmp588_read_done(i2c_txn_t *txn);
+static void bmp588_status_done(i2c_txn_t *txn);
+
+static i2c_txn_t g_txn = {
+    .addr = BMP588_ADDR,
+    .reg = REG_TEMP_XLSB,
+    .read = true,
+    .len = sizeof(g_raw),
+    .buf = g_raw,
+    .done = bmp588_read_done,
+};
+
+static i2c_txn_t g_status_txn = {
+    .addr = BMP588_ADDR,
+    .reg = REG_INT_STATUS,
+    .read = true,
+    .len = 1,
+    .buf = &g_int_status,
+    .done = bmp588_status_done,
+};
+
+static i2c_txn_t g_odr_txn = {
+    .addr = BMP588_ADDR,
+    .reg = REG_ODR_CONFIG,
+    .read = false,
+    .len = 1,
+    .buf = &g_odr_config,
+};
+
+/** 
+ * @brief Data registers read, runs in the I2C interrupt
+ * @param txn the transaction
+ * 
+ */
+static void bmp588_read_done(i2c_txn_t *txn) {
+    bmp588_sample_t sample;
+
+    if (txn->status != I2C_TXN_DONE || g_handler == NULL) {
+        return;
+    }
+
+    sample.time_us = g_time_us;
+    // Both are 24 bit little endian, the temperature is signed
+    int32_t temp = g_raw[0] | (g_raw[1] << 8) | (g_raw[2] << 16);
+    if (temp & 0x800000) {
+        temp -= 0x1000000;
+    }
+    sample.temperature = temp;
+    sample.pressure = g_raw[3] | (g_raw[4] << 8) | ((uint32_t)g_raw[5] << 16);
+    g_handler(&sample);
+}
+
+/** 
+ * @brief Interrupt status read, runs in the I2C interrupt
+ * @param txn the transaction
+ * 
+ */
+static void bmp588_status_done(i2c_txn_t *txn) {
+    if (txn->status != I2C_TXN_DONE || !(g_int_status & INT_STATUS_DRDY)) {
+        return;
+    }
+
+    g_stats.ready++;
+    if (!i2c_submit(BMP588_BUS, &g_txn)) {
+        g_stats.missed++;
+    }
+}
+
+int bmp588_init(void) {
+    uint8_t id = 0;
+
+    i2c_write_reg(BMP588_BUS, BMP588_ADDR, REG_CMD, CMD_SOFT_RESET);
+    uint32_t start = timebase_now_ms();
+    while (timebase_now_ms() - start < BMP588_RESET_MS);
+
+    if (!i2c_read_regs(BMP588_BUS, BMP588_ADDR, REG_CHIP_ID, &id, 1)
+        || id != CHIP_ID_BMP588) {
+        return 1;
+    }
+
+    i2c_write_reg(BMP588_BUS, BMP588_ADDR, REG_OSR_CONFIG, OSR_PRESS_X8_TEMP_X1);
+    i2c_write_reg(BMP588_BUS, BMP588_ADDR, REG_INT_SOURCE, INT_SOURCE_DRDY);
+    i2c_write_reg(BMP588_BUS, BMP588_ADDR, REG_INT_CONFIG, INT_CONFIG_PULSED_HIGH);
+    i2c_write_reg(BMP588_BUS, BMP588_ADDR, REG_ODR_CONFIG,
+                  ODR_NORMAL | (BMP588_ODR_50HZ << ODR_SHIFT));
+
+    return 0;
+}
+
+bool bmp588_start_read(void) {
+    if (g_txn.status == I2C_TXN_QUEUED) {
+        return false;
+    }
+
+    g_time_us = (uint32_t)timebase_now_us();
+    return i2c_submit(BMP588_BUS, &g_txn);
+}
+
+bool bmp588_poll(void) {
+    // A read that never completed is failed here and the bus recovered
+    i2c_check_timeout(BMP588_BUS);
+
+    if (g_status_txn.status == I2C_TXN_QUEUED || g_txn.status == I2C_TXN_QUEUED) {
+        return false;
+    }
+
+    g_stats.polls++;
+    g_time_us = (uint32_t)timebase_now_us();
+    return i2c_submit(BMP588_BUS, &g_status_txn);
+}
+
+bool bmp588_set_odr(bmp588_odr_t odr) {
+    if (g_odr_txn.status == I2C_TXN_QUEUED) {
+        return false;
+    }
+
+    g_odr_config = ODR_NORMAL | (odr << ODR_SHIFT);
+    g_odr = odr;
+    return i2c_submit(BMP588_BUS, &g_odr_txn);
+}
+
+uint32_t bmp588_period_us(void) {
+    switch (g_odr) {
+    case BMP588_ODR_25HZ:
+        return 40000;
+    case BMP588_ODR_10HZ:
+        return 100000;
+    case BMP588_ODR_5HZ:
+        return 200000;
+    default:
+        return 1000000 / BMP588_ODR_HZ;
+    }
+}
+
+void bmp588_get_stats(bmp588_stats_t *stats) {
+    *stats = g_stats;
+}
+
+void bmp588_set_handler(bmp588_handler_t handler) {
+    g_handler = handler;
+}
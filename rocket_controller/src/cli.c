@@ -17,6 +17,8 @@
 #include <libopencm3/stm32/gpio.h>
 
 #include "usb_cdc.h"
+#include "dump.h"
+#include "fmt.h"
 
 // #define USH_CONFIG_CUSTOM_FILE "ush_config_platform.h"
 #define USH_CONFIG_PLATFORM_POSIX
@@ -38,9 +40,8 @@ static int ush_read(struct ush_object *self, char *ch) {
 // non-blocking write interface
 static int ush_write(struct ush_object *self, char ch) {
     (void)self;
-    // should be implemented as a FIFO
-    usb_cdc_send_byte(ch);
-    return 1;
+    // returning 0 makes microshell retry once the tx ring has drained
+    return usb_cdc_write(&ch, 1);
 }
 
 // I/O interface descriptor
@@ -96,6 +97,16 @@ static const struct ush_file_descriptor root_files[] = {
 // root directory handler
 static struct ush_node_object root;
 
+#define CLI_CTRL_C 0x03
+
+/// The file being streamed
+static struct {
+    bool active;
+    cli_read_chunk_t read;
+    void *ctx;
+    uint32_t offset;
+} g_stream;
+
 
 
 int cli_init(void) {
@@ -118,6 +129,96 @@ int cli_init(void) {
     return 0;
 }
 
+/** 
+ * @brief Move the next chunk of the streamed file into the tx ring
+ * 
+ */
+static void cli_stream_service(void) {
+    while (usb_cdc_avail() > 0) {
+        if (usb_cdc_recv_byte() == CLI_CTRL_C) {
+            g_stream.active = false;
+            return;
+        }
+    }
+
+    // Fill the ring, it takes two regions when the free space wraps
+    size_t len;
+    uint8_t *buf;
+    while ((buf = usb_cdc_write_reserve(&len)) != NULL) {
+        int n = g_stream.read(g_stream.ctx, g_stream.offset, buf, len);
+        if (n < 0) {
+            return;
+        }
+        if (n == 0) {
+            g_stream.active = false;
+            return;
+        }
+        usb_cdc_write_commit(n);
+        g_stream.offset += n;
+    }
+}
+
+bool cli_stream_start(cli_read_chunk_t read, void *ctx) {
+    if (g_stream.active) {
+        return false;
+    }
+    g_stream.read = read;
+    g_stream.ctx = ctx;
+    g_stream.offset = 0;
+    g_stream.active = true;
+    return true;
+}
+
+bool cli_streaming(void) {
+    return g_stream.active;
+}
+
+/** 
+ * @brief Commit a full window of the tx ring and reserve the next
+ * @param sink the sink
+ * 
+ * @return false if the ring is full
+ */
+static bool cli_printf_more(fmt_sink_t *sink) {
+    usb_cdc_write_commit(sink->len);
+    sink->total += sink->len;
+    sink->len = 0;
+
+    sink->buf = (char *)usb_cdc_write_reserve(&sink->size);
+    return sink->buf != NULL;
+}
+
+int cli_printf(const char *format, ...) {
+    va_list args;
+    fmt_sink_t sink = { .len = 0, .total = 0, .more = cli_printf_more };
+
+    // Formatted straight into the tx ring, whatever does not fit is dropped
+    sink.buf = (char *)usb_cdc_write_reserve(&sink.size);
+    if (sink.buf == NULL) {
+        return 0;
+    }
+
+    va_start(args, format);
+    fmt_vprint(&sink, format, args);
+    va_end(args);
+
+    if (sink.buf != NULL) {
+        usb_cdc_write_commit(sink.len);
+        sink.total += sink.len;
+    }
+    return sink.total;
+}
+
 void cli_update(void) {
+    // A download runs on the telemetry port alongside the shell
+    if (dump_active()) {
+        dump_service();
+    }
+
+    // The shell's own output (the prompt) waits until the stream is done
+    if (g_stream.active) {
+        cli_stream_service();
+        return;
+    }
     ush_service(&ush);
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+/** 
+ * @file dump.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-20
+ * @brief Implementation of the flight log download protocol
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "CBUF.h"
+
+#include "frame.h"
+#include "flight_log.h"
+#include "timebase.h"
+#include "usb_cdc.h"
+
+#include "dump.h"
+
+/// Largest frame the host sends
+#define DUMP_RX_MAX FRAME_MAX_SIZE(sizeof(dump_req_t))
+
+/// Largest frame the device sends
+#define DUMP_TX_MAX FRAME_MAX_SIZE(sizeof(dump_data_t))
+
+typedef struct {
+	volatile	uint16_t	m_get_idx;
+	volatile	uint16_t	m_put_idx;
+				dump_req_t	m_entry[DUMP_MAX_REQS];	// Size must be a power of 2
+} dump_req_buf_t;
+
+static bool g_dump_active = false;
+
+/// The delimiter and DUMP_MSG_INFO wait for space in the tx ring
+static bool g_dump_info_pending = false;
+
+static flight_log_entry_t g_dump_flight;
+
+static dump_req_buf_t g_dump_reqs;
+
+/// The frame being received
+static uint8_t g_dump_rx[DUMP_RX_MAX];
+static size_t g_dump_rx_len;
+static bool g_dump_rx_overflow;
+
+static uint32_t g_dump_last_rx_ms;
+
+/** 
+ * @brief Act on a frame from the host
+ * @param frame the frame without its delimiter
+ * @param len the length of the frame
+ * 
+ */
+static void dump_handle_frame(uint8_t *frame, size_t len) {
+    uint8_t type;
+    uint8_t *payload;
+    int payload_len = frame_decode(frame, len, &type, &payload);
+
+    if (payload_len < 0) {
+        return;
+    }
+
+    if (type == DUMP_MSG_END) {
+        g_dump_active = false;
+    } else if (type == DUMP_MSG_REQ && payload_len == sizeof(dump_req_t)) {
+        dump_req_t req;
+        memcpy(&req, payload, sizeof(req));
+        g_dump_last_rx_ms = timebase_now_ms();
+
+        if (req.count == 0) {
+            CBUF_Init(g_dump_reqs);
+        } else if (!CBUF_IsFull(g_dump_reqs)) {
+            // A full queue means the host broke the window, it asks again
+            // when the blocks do not arrive
+            CBUF_Push(g_dump_reqs, req);
+        }
+    }
+}
+
+/** 
+ * @brief Split the bytes from the host into frames
+ * 
+ */
+static void dump_receive(void) {
+    uint8_t buf[32];
+    size_t n;
+
+    while (g_dump_active && (n = usb_cdc_port_read(USB_CDC_PORT_TELEM, buf, sizeof(buf))) > 0) {
+        for (size_t i = 0; i < n && g_dump_active; i++) {
+            if (buf[i] != 0) {
+                if (g_dump_rx_len < sizeof(g_dump_rx)) {
+                    g_dump_rx[g_dump_rx_len++] = buf[i];
+                } else {
+                    g_dump_rx_overflow = true;
+                }
+                continue;
+            }
+
+            if (g_dump_rx_len && !g_dump_rx_overflow) {
+                dump_handle_frame(g_dump_rx, g_dump_rx_len);
+            }
+            g_dump_rx_len = 0;
+            g_dump_rx_overflow = false;
+        }
+    }
+}
+
+/** 
+ * @brief Send a frame, the caller checks there is space for it
+ * @param type the message type
+ * @param payload the payload
+ * @param len the length of the payload
+ * 
+ */
+static void dump_send(dump_msg_t type, const void *payload, size_t len) {
+    uint8_t frame[DUMP_TX_MAX];
+
+    size_t frame_len = frame_encode(type, payload, len, frame);
+    usb_cdc_port_write(USB_CDC_PORT_TELEM, frame, frame_len);
+}
+
+/** 
+ * @brief Send the delimiter and DUMP_MSG_INFO once the tx ring has room
+ * for both
+ * 
+ * @return true if sent
+ */
+static bool dump_send_info(void) {
+    if (usb_cdc_port_write_space(USB_CDC_PORT_TELEM) < 1 + FRAME_MAX_SIZE(sizeof(dump_info_t))) {
+        return false;
+    }
+
+    // The delimiter ends any frame the host has only seen part of
+    dump_info_t info = {
+        .seq = g_dump_flight.seq,
+        .len = g_dump_flight.len,
+        .block_size = DUMP_BLOCK_SIZE,
+    };
+    uint8_t delim = 0;
+    usb_cdc_port_write(USB_CDC_PORT_TELEM, &delim, 1);
+    dump_send(DUMP_MSG_INFO, &info, sizeof(info));
+    return true;
+}
+
+bool dump_start(const flight_log_entry_t *entry) {
+    uint8_t buf[32];
+
+    if (g_dump_active || !usb_cdc_port_connected(USB_CDC_PORT_TELEM)) {
+        return false;
+    }
+
+    // Nothing reads the port between downloads, what the host sent then
+    // (an END for the last one) must not reach this one
+    while (usb_cdc_port_read(USB_CDC_PORT_TELEM, buf, sizeof(buf)) > 0) {
+    }
+
+    g_dump_flight = *entry;
+    CBUF_Init(g_dump_reqs);
+    g_dump_rx_len = 0;
+    g_dump_rx_overflow = false;
+    g_dump_last_rx_ms = timebase_now_ms();
+    g_dump_active = true;
+    g_dump_info_pending = !dump_send_info();
+    return true;
+}
+
+bool dump_active(void) {
+    return g_dump_active;
+}
+
+void dump_service(void) {
+    static dump_data_t block;
+
+    dump_receive();
+
+    // The host asks for more as blocks arrive, if it stops it has gone
+    if (timebase_now_ms() - g_dump_last_rx_ms > DUMP_IDLE_MS) {
+        g_dump_active = false;
+    }
+    if (!g_dump_active) {
+        return;
+    }
+    if (g_dump_info_pending) {
+        // The host asks for nothing before it has the flight length
+        g_dump_info_pending = !dump_send_info();
+        return;
+    }
+
+    while (!CBUF_IsEmpty(g_dump_reqs)) {
+        dump_req_t *req = CBUF_GetPopEntryPtr(g_dump_reqs);
+
+        // Past the end there is nothing to send, the host knows the length
+        if (req->count == 0 || req->offset >= g_dump_flight.len) {
+            CBUF_AdvancePopIdx(g_dump_reqs);
+            continue;
+        }
+        if (usb_cdc_port_write_space(USB_CDC_PORT_TELEM) < DUMP_TX_MAX) {
+            return;
+        }
+
+        uint32_t len = g_dump_flight.len - req->offset;
+        if (len > DUMP_BLOCK_SIZE) {
+            len = DUMP_BLOCK_SIZE;
+        }
+        int n = flight_log_read(&g_dump_flight, req->offset, block.data, len);
+        if (n < 0) {
+            return;
+        }
+        block.offset = req->offset;
+        dump_send(DUMP_MSG_DATA, &block, sizeof(block.offset) + n);
+
+        req->offset += DUMP_BLOCK_SIZE;
+        req->count--;
+    }
+}
@@ -0,0 +1,183 @@
+/** 
+ * @file filt.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-18
+ * @brief Implementation of the fixed point multi-rate FIR filters
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "filt.h"
+
+/// Half-band, Kaiser beta 6
+static const int16_t g_halfband15[15] = {
+    -22, 0, 417, 0, -2055, 0, 9856, 16376, 9856, 0, -2055, 0, 417, 0, -22,
+};
+
+/// Half-band, Kaiser beta 7
+static const int16_t g_halfband19[19] = {
+    7, 0, -141, 0, 706, 0, -2403, 0, 10022, 16386, 10022, 0, -2403, 0, 706, 0, -141, 0, 7,
+};
+
+/// Low pass with the cut-off at 0.18, Kaiser beta 5
+static const int16_t g_lowpass23[23] = {
+    -4, -88, -129, 123, 546, 410, -756, -1890, -731, 3732, 9269, 11804,
+    9269, 3732, -731, -1890, -756, 410, 546, 123, -129, -88, -4,
+};
+
+const filt_design_t filt_halfband15 = { g_halfband15, 15, 2, true };
+const filt_design_t filt_halfband19 = { g_halfband19, 19, 2, true };
+const filt_design_t filt_lowpass23 = { g_lowpass23, 23, 1, false };
+
+/** 
+ * @brief Saturate a sum to 16 bits
+ * @param x the value
+ * 
+ * @return the saturated value
+ */
+static inline int16_t filt_sat16(int32_t x) {
+    if (x > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (x < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return x;
+}
+
+/** 
+ * @brief Filter the history of a stage into one output
+ * @param stage the stage, its history must be full
+ * @param out the output
+ * 
+ */
+static void filt_stage_output(const filt_stage_t *stage, filt_sample_t *out) {
+    const filt_design_t *design = stage->design;
+    const filt_sample_t *hist = stage->hist;
+    uint8_t taps = design->taps;
+    uint8_t centre = taps / 2;
+    uint8_t step = design->half_band ? 2 : 1;
+    int32_t acc[FILT_CHANNELS];
+
+    uint8_t mid = stage->pos + centre;
+    if (mid >= taps) {
+        mid -= taps;
+    }
+    int32_t c = design->coef[centre];
+    for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+        acc[ch] = c * hist[mid].ch[ch] + (1 << 14);
+    }
+
+    // Pairs of taps from the outside in, a half-band's first non-zero tap
+    // is an odd distance from the centre
+    uint8_t k = (design->half_band && (centre & 1) == 0) ? 1 : 0;
+    uint8_t lo = stage->pos + k;
+    if (lo >= taps) {
+        lo -= taps;
+    }
+    uint8_t hi = stage->pos + taps - 1 - k;
+    if (hi >= taps) {
+        hi -= taps;
+    }
+
+    for (; k < centre; k += step) {
+        c = design->coef[k];
+        for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+            acc[ch] += c * (hist[lo].ch[ch] + hist[hi].ch[ch]);
+        }
+
+        lo += step;
+        if (lo >= taps) {
+            lo -= taps;
+        }
+        hi = (hi >= step) ? hi - step : hi + taps - step;
+    }
+
+    out->time_us = hist[mid].time_us;
+    for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+        out->ch[ch] = filt_sat16(acc[ch] >> 15);
+    }
+}
+
+void filt_stage_init(filt_stage_t *stage, const filt_design_t *design, filt_sample_t *hist) {
+    stage->design = design;
+    stage->hist = hist;
+    stage->pos = 0;
+    stage->filled = 0;
+    stage->phase = 0;
+}
+
+bool filt_stage_push(filt_stage_t *stage, const filt_sample_t *in, filt_sample_t *out) {
+    uint8_t taps = stage->design->taps;
+
+    stage->hist[stage->pos] = *in;
+    stage->pos = (stage->pos + 1 == taps) ? 0 : stage->pos + 1;
+
+    // No output until the history is full so start up is never zero padded
+    if (stage->filled < taps) {
+        stage->filled++;
+        if (stage->filled < taps) {
+            return false;
+        }
+    }
+
+    if (++stage->phase < stage->design->factor) {
+        return false;
+    }
+    stage->phase = 0;
+
+    filt_stage_output(stage, out);
+    return true;
+}
+
+void filt_chain_process(filt_chain_t *chain, const filt_sample_t *in, size_t n,
+                        filt_sample_t *est_out, size_t *n_est, filt_sample_t *log_out, size_t *n_log) {
+    *n_est = 0;
+    *n_log = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        filt_sample_t sample = in[i];
+        uint8_t tap = 0;
+
+        // Each stage's output is the next stage's input, stop at the first
+        // stage that does not produce one
+        while (true) {
+            if (tap == chain->est_tap) {
+                est_out[(*n_est)++] = sample;
+            }
+            if (tap == chain->log_tap) {
+                log_out[(*n_log)++] = sample;
+            }
+            if (tap == chain->count || !filt_stage_push(&chain->stages[tap], &sample, &sample)) {
+                break;
+            }
+            tap++;
+        }
+    }
+}
+
+void filt_imu_chain_init(filt_chain_t *chain, filt_sample_t *hist) {
+    static const filt_design_t *const designs[] = {
+        &filt_halfband15, &filt_halfband19, &filt_lowpass23,
+    };
+
+    chain->count = sizeof(designs) / sizeof(designs[0]);
+    for (uint8_t i = 0; i < chain->count; i++) {
+        filt_stage_init(&chain->stages[i], designs[i], hist);
+        hist += designs[i]->taps;
+    }
+    chain->est_tap = 1;
+    chain->log_tap = chain->count;
+}
+
+uint16_t filt_chain_factor(const filt_chain_t *chain, uint8_t tap) {
+    uint16_t factor = 1;
+
+    for (uint8_t i = 0; i < tap && i < chain->count; i++) {
+        factor *= chain->stages[i].design->factor;
+    }
+    return factor;
+}
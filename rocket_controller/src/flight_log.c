@@ -0,0 +1,519 @@
+/** 
+ * @file flight_log.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Implementation of the log structured flight recorder
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "w25q.h"
+
+#include "flight_log.h"
+
+#define FLIGHT_LOG_MAGIC 0x544c4648     // "HFLT"
+
+#define SECTOR_COUNT (W25Q_SIZE / W25Q_SECTOR_SIZE)
+#define PAGES_PER_SECTOR (W25Q_SECTOR_SIZE / W25Q_PAGE_SIZE)
+
+/// A flight may use the whole chip apart from one erased sector which marks its end
+#define FLIGHT_LOG_LIMIT (W25Q_SIZE - W25Q_SECTOR_SIZE)
+
+/// Written at the start of the first sector of each flight
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t reserved[2];
+} flight_log_header_t;
+
+typedef enum {
+    FL_IDLE,
+    FL_PROGRAMMING,
+    FL_ERASING,
+    FL_SUSPENDING,              ///< Waiting for an erase suspend to take effect
+    FL_PROGRAMMING_SUSPENDED,   ///< Programming a page while an erase is suspended
+} flight_log_state_t;
+
+/// Flights found on the chip, most recent first
+static flight_log_entry_t g_flights[FLIGHT_LOG_MAX_FLIGHTS];
+static int g_flight_count = 0;
+
+/// Where and with what number the next flight starts
+static uint32_t g_next_start = 0;
+static uint32_t g_next_seq = 1;
+
+/// True once the flash has been found
+static bool g_flight_log_ready = false;
+
+/// The flight being recorded
+static flight_log_entry_t g_current;
+static bool g_recording = false;
+static bool g_stopping = false;
+
+/// True while erasing ahead of the next flight before it starts
+static bool g_preparing = false;
+
+/// Bytes programmed and erased relative to the start of the current flight
+static uint32_t g_written = 0;
+static uint32_t g_erased = 0;
+
+/// Size of the erase in progress
+static uint32_t g_erase_len = 0;
+
+/// Double buffered pages, one filling while the other waits to be programmed
+static uint8_t g_page_buf[2][W25Q_PAGE_SIZE];
+static uint8_t g_fill_idx = 0;
+static uint16_t g_fill_len = 0;
+static bool g_page_pending = false;
+
+static flight_log_state_t g_state = FL_IDLE;
+
+static flight_log_stats_t g_stats;
+
+/** 
+ * @brief Convert an offset from the start of a flight to a flash address
+ * @param start the start of the flight
+ * @param offset the offset into the flight
+ * 
+ * @return the flash address
+ */
+static inline uint32_t flight_log_addr(uint32_t start, uint32_t offset) {
+    return (start + offset) & (W25Q_SIZE - 1);
+}
+
+/** 
+ * @brief Read the start of a sector or page to see what it holds
+ * @param addr the address to check
+ * @param is_erased set to true if it looks erased
+ * @param seq set to the flight number if it is a flight header
+ * 
+ * @return true if it is a flight header
+ */
+static bool flight_log_probe(uint32_t addr, bool *is_erased, uint32_t *seq) {
+    flight_log_header_t header;
+    w25q_read(addr, &header, sizeof(header));
+
+    const uint8_t *bytes = (const uint8_t *)&header;
+    *is_erased = true;
+    for (size_t i = 0; i < sizeof(header); i++) {
+        if (bytes[i] != 0xff) {
+            *is_erased = false;
+            break;
+        }
+    }
+
+    if (seq != NULL) {
+        *seq = header.seq;
+    }
+    return header.magic == FLIGHT_LOG_MAGIC;
+}
+
+/** 
+ * @brief Add a flight to the index keeping it sorted most recent first
+ * @param entry the flight to add
+ * 
+ */
+static void flight_log_index_insert(const flight_log_entry_t *entry) {
+    int i = g_flight_count;
+    if (i == FLIGHT_LOG_MAX_FLIGHTS) {
+        if (entry->seq < g_flights[i - 1].seq) {
+            return;
+        }
+        i--;
+    } else {
+        g_flight_count++;
+    }
+
+    while (i > 0 && g_flights[i - 1].seq < entry->seq) {
+        g_flights[i] = g_flights[i - 1];
+        i--;
+    }
+    g_flights[i] = *entry;
+}
+
+/** 
+ * @brief Remove any flight whose header was just erased
+ * @param addr the start of the erased region
+ * @param len the length of the erased region
+ * 
+ */
+static void flight_log_index_erased(uint32_t addr, uint32_t len) {
+    int kept = 0;
+    for (int i = 0; i < g_flight_count; i++) {
+        if (g_flights[i].start - addr >= len) {
+            g_flights[kept++] = g_flights[i];
+        }
+    }
+    g_flight_count = kept;
+}
+
+/** 
+ * @brief Find how much data a flight holds by walking its sectors until an
+ * erased sector or the next flight
+ * @param start the address of the flight header
+ * 
+ * @return the data length after the header
+ */
+static uint32_t flight_log_measure(uint32_t start) {
+    bool is_erased;
+    uint32_t sectors = 1;
+
+    while (sectors < SECTOR_COUNT - 1) {
+        uint32_t addr = flight_log_addr(start, sectors * W25Q_SECTOR_SIZE);
+        if (flight_log_probe(addr, &is_erased, NULL) || is_erased) {
+            break;
+        }
+        sectors++;
+    }
+
+    // Pages are only ever programmed whole so find the last one used
+    uint32_t last = flight_log_addr(start, (sectors - 1) * W25Q_SECTOR_SIZE);
+    uint32_t page = PAGES_PER_SECTOR - 1;
+    while (page > 0) {
+        flight_log_probe(last + page * W25Q_PAGE_SIZE, &is_erased, NULL);
+        if (!is_erased) {
+            break;
+        }
+        page--;
+    }
+
+    return (sectors - 1) * W25Q_SECTOR_SIZE + (page + 1) * W25Q_PAGE_SIZE
+           - sizeof(flight_log_header_t);
+}
+
+/** 
+ * @brief Move a full fill buffer over to be programmed
+ * 
+ */
+static void flight_log_swap(void) {
+    if (g_fill_len == W25Q_PAGE_SIZE && !g_page_pending) {
+        g_page_pending = true;
+        g_fill_idx ^= 1;
+        g_fill_len = 0;
+    }
+}
+
+/** 
+ * @brief Check if the pending page can be programmed
+ * 
+ * @return true if the page is ready and lies in erased flash
+ */
+static bool flight_log_can_program(void) {
+    return g_page_pending && g_written + W25Q_PAGE_SIZE <= g_erased;
+}
+
+/** 
+ * @brief Start programming the pending page
+ * 
+ */
+static void flight_log_program(void) {
+    w25q_page_program(flight_log_addr(g_current.start, g_written),
+                      g_page_buf[g_fill_idx ^ 1], W25Q_PAGE_SIZE);
+}
+
+/** 
+ * @brief Called once the pending page has been programmed
+ * 
+ */
+static void flight_log_program_done(void) {
+    g_written += W25Q_PAGE_SIZE;
+    g_page_pending = false;
+    g_stats.pages_written++;
+    flight_log_swap();
+}
+
+/** 
+ * @brief Start the next erase if the erased region is not far enough ahead
+ * 
+ * @return true if an erase was started
+ */
+static bool flight_log_erase_ahead(void) {
+    uint32_t ahead = g_preparing ? FLIGHT_LOG_PREPARE_AHEAD : FLIGHT_LOG_ERASE_AHEAD;
+    if (g_erased >= g_written + ahead || g_erased >= FLIGHT_LOG_LIMIT) {
+        return false;
+    }
+
+    // The first erase of a flight is always a sector so the first pages can
+    // be programmed as soon as possible
+    uint32_t addr = flight_log_addr(g_current.start, g_erased);
+    if (g_erased > 0 && (addr % W25Q_BLOCK_SIZE) == 0 && g_erased + W25Q_BLOCK_SIZE <= FLIGHT_LOG_LIMIT) {
+        w25q_erase_block(addr);
+        g_erase_len = W25Q_BLOCK_SIZE;
+        g_stats.block_erases++;
+    } else {
+        w25q_erase_sector(addr);
+        g_erase_len = W25Q_SECTOR_SIZE;
+        g_stats.sector_erases++;
+    }
+    return true;
+}
+
+/** 
+ * @brief Called once an erase has finished
+ * 
+ */
+static void flight_log_erase_done(void) {
+    flight_log_index_erased(flight_log_addr(g_current.start, g_erased), g_erase_len);
+    g_erased += g_erase_len;
+}
+
+/** 
+ * @brief Check if a stopping flight has been completely written
+ * 
+ * @return true once every page is programmed and the sector after the
+ * flight is erased to mark its end
+ */
+static bool flight_log_flushed(void) {
+    if (g_erased >= FLIGHT_LOG_LIMIT) {
+        // The chip is full, whatever could not be written is lost
+        g_page_pending = false;
+        g_fill_len = 0;
+        return true;
+    }
+
+    uint32_t end = (g_written + W25Q_SECTOR_SIZE - 1) & ~(W25Q_SECTOR_SIZE - 1);
+    return !g_page_pending && g_fill_len == 0 && g_erased > end;
+}
+
+/** 
+ * @brief Add the finished flight to the index
+ * 
+ */
+static void flight_log_finish(void) {
+    g_current.len = g_written - sizeof(flight_log_header_t);
+    flight_log_index_insert(&g_current);
+
+    g_next_start = flight_log_addr(g_current.start,
+                                   (g_written + W25Q_SECTOR_SIZE - 1) & ~(W25Q_SECTOR_SIZE - 1));
+    g_recording = false;
+    g_stopping = false;
+}
+
+int flight_log_init(void) {
+    bool is_erased;
+    flight_log_entry_t entry = {0};
+
+    g_flight_count = 0;
+    for (uint32_t sector = 0; sector < SECTOR_COUNT; sector++) {
+        entry.start = sector * W25Q_SECTOR_SIZE;
+        if (flight_log_probe(entry.start, &is_erased, &entry.seq)) {
+            flight_log_index_insert(&entry);
+        }
+    }
+
+    for (int i = 0; i < g_flight_count; i++) {
+        g_flights[i].len = flight_log_measure(g_flights[i].start);
+    }
+
+    if (g_flight_count > 0) {
+        uint32_t used = g_flights[0].len + sizeof(flight_log_header_t);
+        g_next_start = flight_log_addr(g_flights[0].start,
+                                       (used + W25Q_SECTOR_SIZE - 1) & ~(W25Q_SECTOR_SIZE - 1));
+        g_next_seq = g_flights[0].seq + 1;
+    }
+
+    g_preparing = false;
+    g_flight_log_ready = true;
+    return 0;
+}
+
+int flight_log_prepare(void) {
+    if (!g_flight_log_ready || g_recording) {
+        return 1;
+    }
+    if (g_preparing) {
+        return 0;
+    }
+
+    g_current.start = g_next_start;
+    g_written = 0;
+    g_erased = 0;
+    g_page_pending = false;
+    g_state = FL_IDLE;
+    g_preparing = true;
+    return 0;
+}
+
+int flight_log_start(void) {
+    if (!g_flight_log_ready || g_recording) {
+        return 1;
+    }
+
+    // Carry on from whatever flight_log_prepare() has erased so far
+    if (!g_preparing) {
+        g_current.start = g_next_start;
+        g_erased = 0;
+        g_state = FL_IDLE;
+    }
+    g_preparing = false;
+
+    g_current.seq = g_next_seq++;
+    g_current.len = 0;
+    g_written = 0;
+    g_fill_idx = 0;
+    g_fill_len = 0;
+    g_page_pending = false;
+    g_recording = true;
+    g_stopping = false;
+
+    flight_log_header_t header = {
+        .magic = FLIGHT_LOG_MAGIC,
+        .seq = g_current.seq,
+    };
+    flight_log_write(&header, sizeof(header));
+
+    return 0;
+}
+
+void flight_log_stop(void) {
+    if (!g_recording || g_stopping) {
+        return;
+    }
+
+    // Pad with frame delimiters so the last page is programmed whole
+    if (g_fill_len > 0) {
+        memset(&g_page_buf[g_fill_idx][g_fill_len], 0, W25Q_PAGE_SIZE - g_fill_len);
+        g_fill_len = W25Q_PAGE_SIZE;
+        flight_log_swap();
+    }
+    g_stopping = true;
+}
+
+bool flight_log_recording(void) {
+    return g_recording;
+}
+
+size_t flight_log_write(const void *data, size_t len) {
+    const uint8_t *in = data;
+    size_t accepted = 0;
+
+    if (!g_recording || g_stopping) {
+        return 0;
+    }
+
+    while (accepted < len && g_fill_len < W25Q_PAGE_SIZE) {
+        size_t chunk = W25Q_PAGE_SIZE - g_fill_len;
+        if (chunk > len - accepted) {
+            chunk = len - accepted;
+        }
+        memcpy(&g_page_buf[g_fill_idx][g_fill_len], in + accepted, chunk);
+        g_fill_len += chunk;
+        accepted += chunk;
+        flight_log_swap();
+    }
+
+    g_stats.bytes_dropped += len - accepted;
+    return accepted;
+}
+
+size_t flight_log_space(void) {
+    if (!g_recording || g_stopping) {
+        return 0;
+    }
+    return (W25Q_PAGE_SIZE - g_fill_len) + (g_page_pending ? 0 : W25Q_PAGE_SIZE);
+}
+
+void flight_log_service(void) {
+    if (!g_recording && !g_preparing) {
+        return;
+    }
+
+    switch (g_state) {
+    case FL_PROGRAMMING:
+        if (w25q_busy()) {
+            return;
+        }
+        flight_log_program_done();
+        g_state = FL_IDLE;
+        break;
+
+    case FL_ERASING:
+        if (!w25q_busy()) {
+            flight_log_erase_done();
+            g_state = FL_IDLE;
+            break;
+        }
+        // Only interrupt the erase once the next page is close to filling
+        // so the erase still gets time to make progress
+        if (flight_log_can_program() && g_fill_len >= W25Q_PAGE_SIZE / 2) {
+            w25q_erase_suspend();
+            g_stats.erase_suspends++;
+            g_state = FL_SUSPENDING;
+        }
+        return;
+
+    case FL_SUSPENDING:
+        // If the erase finished before the suspend took effect then the
+        // resume is ignored by the flash and the erase is seen as done
+        if (w25q_busy()) {
+            return;
+        }
+        flight_log_program();
+        g_state = FL_PROGRAMMING_SUSPENDED;
+        return;
+
+    case FL_PROGRAMMING_SUSPENDED:
+        if (w25q_busy()) {
+            return;
+        }
+        flight_log_program_done();
+        w25q_erase_resume();
+        g_state = FL_ERASING;
+        return;
+
+    case FL_IDLE:
+        break;
+    }
+
+    // Programming always takes priority over erasing ahead
+    if (flight_log_can_program()) {
+        flight_log_program();
+        g_state = FL_PROGRAMMING;
+    } else if (g_stopping && flight_log_flushed()) {
+        flight_log_finish();
+    } else if (flight_log_erase_ahead()) {
+        g_state = FL_ERASING;
+    }
+}
+
+int flight_log_count(void) {
+    return g_flight_count;
+}
+
+bool flight_log_get_flight(int n, flight_log_entry_t *entry) {
+    if (n < 1 || n > g_flight_count) {
+        return false;
+    }
+    *entry = g_flights[n - 1];
+    return true;
+}
+
+int flight_log_read(const flight_log_entry_t *entry, uint32_t offset, void *buf, size_t len) {
+    if (offset >= entry->len) {
+        return 0;
+    }
+    if (g_state != FL_IDLE || w25q_busy()) {
+        return -1;
+    }
+    if (len > entry->len - offset) {
+        len = entry->len - offset;
+    }
+
+    // Split the read where the log wraps around the end of the chip
+    uint32_t addr = flight_log_addr(entry->start, sizeof(flight_log_header_t) + offset);
+    size_t first = W25Q_SIZE - addr;
+    if (first > len) {
+        first = len;
+    }
+    w25q_read(addr, buf, first);
+    w25q_read(0, (uint8_t *)buf + first, len - first);
+
+    return len;
+}
+
+void flight_log_get_stats(flight_log_stats_t *stats) {
+    *stats = g_stats;
+}
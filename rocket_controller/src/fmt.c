@@ -0,0 +1,301 @@
+/** 
+ * @file fmt.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-22
+ * @brief Implementation of the compact printf style formatter
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "fmt.h"
+
+#define FMT_FLAG_LEFT 0x01
+#define FMT_FLAG_ZERO 0x02
+
+/// Decimal places of %q without a precision
+#define FMT_Q_DEFAULT_PREC 3
+
+/// Most decimal places of %q, 10^9 still fits 32 bits
+#define FMT_Q_MAX_PREC 9
+
+static const uint32_t g_pow10[FMT_Q_MAX_PREC + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+/** 
+ * @brief Write a character to a sink
+ * @param sink the sink
+ * @param ch the character
+ * 
+ * @return false if there is no room
+ */
+static inline bool fmt_putc(fmt_sink_t *sink, char ch) {
+    if (sink->len == sink->size) {
+        if (sink->more == NULL || !sink->more(sink)) {
+            return false;
+        }
+    }
+    sink->buf[sink->len++] = ch;
+    return true;
+}
+
+/** 
+ * @brief Write characters padded to a width
+ * @param sink the sink
+ * @param prefix written before any zero padding (a sign), may be empty
+ * @param body the characters
+ * @param len the number of characters
+ * @param width the least to write
+ * @param flags FMT_FLAG_ values
+ * 
+ * @return false if there is no room
+ */
+static bool fmt_field(fmt_sink_t *sink, const char *prefix, const char *body, size_t len,
+                      unsigned width, uint8_t flags) {
+    size_t prefix_len = 0;
+    while (prefix[prefix_len] != '\0') {
+        prefix_len++;
+    }
+
+    size_t pad = (width > len + prefix_len) ? width - len - prefix_len : 0;
+    char pad_ch = ((flags & (FMT_FLAG_ZERO | FMT_FLAG_LEFT)) == FMT_FLAG_ZERO) ? '0' : ' ';
+    bool ok = true;
+
+    if (pad_ch == ' ' && !(flags & FMT_FLAG_LEFT)) {
+        for (; pad > 0 && ok; pad--) {
+            ok = fmt_putc(sink, ' ');
+        }
+    }
+    for (size_t i = 0; i < prefix_len && ok; i++) {
+        ok = fmt_putc(sink, prefix[i]);
+    }
+    if (pad_ch == '0') {
+        for (; pad > 0 && ok; pad--) {
+            ok = fmt_putc(sink, '0');
+        }
+    }
+    for (size_t i = 0; i < len && ok; i++) {
+        ok = fmt_putc(sink, body[i]);
+    }
+    for (; pad > 0 && ok; pad--) {
+        ok = fmt_putc(sink, ' ');
+    }
+    return ok;
+}
+
+/** 
+ * @brief Convert an unsigned value to digits
+ * @param x the value
+ * @param base 10 or 16
+ * @param upper use upper case hex digits
+ * @param end the end of the buffer, digits are written backwards from it
+ * @param min_digits the fewest digits, zero filled
+ * 
+ * @return the first digit
+ */
+static char *fmt_digits(uint32_t x, unsigned base, bool upper, char *end, unsigned min_digits) {
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char *p = end;
+    unsigned n = 0;
+
+    do {
+        *--p = digits[x % base];
+        x /= base;
+        n++;
+    } while (x != 0 || n < min_digits);
+    return p;
+}
+
+/** 
+ * @brief Write a Q format value
+ * @param sink the sink
+ * @param value the value
+ * @param frac_bits the fractional bits
+ * @param prec the decimal places
+ * @param width the least to write
+ * @param flags FMT_FLAG_ values
+ * 
+ * @return false if there is no room
+ */
+static bool fmt_fixed(fmt_sink_t *sink, int32_t value, unsigned frac_bits, unsigned prec,
+                      unsigned width, uint8_t flags) {
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    uint32_t mag = (value < 0) ? 0u - (uint32_t)value : (uint32_t)value;
+
+    if (frac_bits > 31) {
+        frac_bits = 31;
+    }
+    if (prec > FMT_Q_MAX_PREC) {
+        prec = FMT_Q_MAX_PREC;
+    }
+
+    // Scale the fraction to prec decimal places and round, a 32 x 32 bit
+    // multiply and a shift
+    uint32_t whole = (frac_bits == 0) ? mag : (uint32_t)((uint64_t)mag >> frac_bits);
+    uint32_t frac = mag - (uint32_t)((uint64_t)whole << frac_bits);
+    uint64_t scaled = (uint64_t)frac * g_pow10[prec];
+    if (frac_bits > 0) {
+        scaled = (scaled + (1ULL << (frac_bits - 1))) >> frac_bits;
+    }
+    if (scaled >= g_pow10[prec]) {
+        whole++;
+        scaled -= g_pow10[prec];
+    }
+
+    char *p = end;
+    if (prec > 0) {
+        p = fmt_digits((uint32_t)scaled, 10, false, p, prec);
+        *--p = '.';
+    }
+    p = fmt_digits(whole, 10, false, p, 1);
+
+    // A value that rounds to zero has no sign
+    bool negative = value < 0 && (whole != 0 || scaled != 0);
+    return fmt_field(sink, negative ? "-" : "", p, end - p, width, flags);
+}
+
+bool fmt_vprint(fmt_sink_t *sink, const char *format, va_list args) {
+    char buf[12];
+    char *end = buf + sizeof(buf);
+
+    for (const char *f = format; *f != '\0'; f++) {
+        if (*f != '%') {
+            if (!fmt_putc(sink, *f)) {
+                return false;
+            }
+            continue;
+        }
+
+        const char *start = f++;
+        uint8_t flags = 0;
+        unsigned width = 0;
+        int prec = -1;
+
+        for (;; f++) {
+            if (*f == '-') {
+                flags |= FMT_FLAG_LEFT;
+            } else if (*f == '0') {
+                flags |= FMT_FLAG_ZERO;
+            } else {
+                break;
+            }
+        }
+        if (*f == '*') {
+            int w = va_arg(args, int);
+            if (w < 0) {
+                flags |= FMT_FLAG_LEFT;
+                w = -w;
+            }
+            width = w;
+            f++;
+        }
+        while (*f >= '0' && *f <= '9') {
+            width = width * 10 + (*f++ - '0');
+        }
+        if (*f == '.') {
+            prec = 0;
+            f++;
+            if (*f == '*') {
+                prec = va_arg(args, int);
+                f++;
+            }
+            for (; *f >= '0' && *f <= '9'; f++) {
+                prec = prec * 10 + (*f - '0');
+            }
+        }
+        bool is_long = false;
+        while (*f == 'l') {
+            is_long = true;
+            f++;
+        }
+
+        bool ok;
+        switch (*f) {
+        case 'd':
+        case 'i': {
+            int32_t x = is_long ? va_arg(args, long) : va_arg(args, int);
+            char *p = fmt_digits((x < 0) ? 0u - (uint32_t)x : (uint32_t)x, 10, false, end, 1);
+            ok = fmt_field(sink, (x < 0) ? "-" : "", p, end - p, width, flags);
+            break;
+        }
+        case 'u': {
+            uint32_t x = is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned);
+            char *p = fmt_digits(x, 10, false, end, 1);
+            ok = fmt_field(sink, "", p, end - p, width, flags);
+            break;
+        }
+        case 'x':
+        case 'X': {
+            uint32_t x = is_long ? va_arg(args, unsigned long) : va_arg(args, unsigned);
+            char *p = fmt_digits(x, 16, *f == 'X', end, 1);
+            ok = fmt_field(sink, "", p, end - p, width, flags);
+            break;
+        }
+        case 'c': {
+            char ch = (char)va_arg(args, int);
+            ok = fmt_field(sink, "", &ch, 1, width, flags);
+            break;
+        }
+        case 's': {
+            const char *s = va_arg(args, const char *);
+            if (s == NULL) {
+                s = "(null)";
+            }
+            size_t len = 0;
+            while (s[len] != '\0' && (prec < 0 || len < (size_t)prec)) {
+                len++;
+            }
+            ok = fmt_field(sink, "", s, len, width, flags);
+            break;
+        }
+        case 'q': {
+            unsigned frac_bits = 0;
+            while (f[1] >= '0' && f[1] <= '9') {
+                frac_bits = frac_bits * 10 + (*++f - '0');
+            }
+            int32_t x = va_arg(args, int32_t);
+            ok = fmt_fixed(sink, x, frac_bits, (prec < 0) ? FMT_Q_DEFAULT_PREC : prec, width, flags);
+            break;
+        }
+        case '%':
+            ok = fmt_putc(sink, '%');
+            break;
+        default:
+            // Not understood, write it out as it is
+            if (*f == '\0') {
+                f--;
+            }
+            ok = true;
+            for (const char *c = start; c <= f && ok; c++) {
+                ok = fmt_putc(sink, *c);
+            }
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t fmt_snprintf(char *buf, size_t size, const char *format, ...) {
+    va_list args;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    // Keep room for the terminator
+    fmt_sink_t sink = { .buf = buf, .size = size - 1, .len = 0, .total = 0, .more = NULL };
+    va_start(args, format);
+    fmt_vprint(&sink, format, args);
+    va_end(args);
+
+    buf[sink.len] = '\0';
+    return sink.len;
+}
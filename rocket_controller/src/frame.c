@@ -0,0 +1,103 @@
+/** 
+ * @file frame.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Implementation of the COBS + CRC framing used by binary streams
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "frame.h"
+
+/// Nibble table for CRC-16/CCITT, trades a little speed for 32 bytes of flash
+static const uint16_t crc16_nibble_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+uint16_t frame_crc16(uint16_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (data[i] & 0x0f)];
+    }
+    return crc;
+}
+
+size_t frame_cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t code_idx = 0;
+    size_t out_idx = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_idx] = code;
+            code_idx = out_idx++;
+            code = 1;
+        } else {
+            out[out_idx++] = in[i];
+            code++;
+            if (code == 0xff) {
+                out[code_idx] = code;
+                code_idx = out_idx++;
+                code = 1;
+            }
+        }
+    }
+    out[code_idx] = code;
+
+    return out_idx;
+}
+
+size_t frame_cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t in_idx = 0;
+    size_t out_idx = 0;
+
+    while (in_idx < len) {
+        uint8_t code = in[in_idx++];
+        if (code == 0 || in_idx + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            out[out_idx++] = in[in_idx++];
+        }
+        if (code != 0xff && in_idx < len) {
+            out[out_idx++] = 0;
+        }
+    }
+
+    return out_idx;
+}
+
+size_t frame_encode(uint8_t type, const void *payload, size_t len, uint8_t *out) {
+    uint8_t raw[FRAME_MAX_PAYLOAD + 2];
+
+    raw[0] = type;
+    memcpy(&raw[1], payload, len);
+    uint16_t crc = frame_crc16(0xffff, raw, len + 1);
+    raw[len + 1] = crc & 0xff;
+    raw[len + 2] = crc >> 8;
+
+    size_t out_len = frame_cobs_encode(raw, len + 3, out);
+    out[out_len++] = 0;
+    return out_len;
+}
+
+int frame_decode(uint8_t *in, size_t len, uint8_t *type, uint8_t **payload) {
+    // Decoding never grows the data so it can be done in place
+    size_t raw_len = frame_cobs_decode(in, len, in);
+    if (raw_len < 3) {
+        return -1;
+    }
+
+    uint16_t crc = in[raw_len - 2] | (in[raw_len - 1] << 8);
+    if (frame_crc16(0xffff, in, raw_len - 2) != crc) {
+        return -1;
+    }
+
+    *type = in[0];
+    *payload = &in[1];
+    return raw_len - 3;
+}
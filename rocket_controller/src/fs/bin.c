@@ -8,11 +8,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 #include <libopencm3/stm32/gpio.h>
 
 #include "microshell.h"
 
+#include "perf.h"
+#include "flight_log.h"
+#include "dump.h"
+
 #include "fs/fs.h"
 
 static struct ush_node_object bin;
@@ -47,6 +52,35 @@ static void set_exec_callback(struct ush_object *self, struct ush_file_descripto
     }
 }
 
+// perfreset file execute callback
+static void perfreset_exec_callback(struct ush_object *self, struct ush_file_descriptor const *file, int argc, char *argv[]) {
+    perf_reset();
+}
+
+// dump file execute callback
+static void dump_exec_callback(struct ush_object *self, struct ush_file_descriptor const *file, int argc, char *argv[]) {
+    flight_log_entry_t entry;
+
+    if (argc > 2) {
+        ush_print_status(self, USH_STATUS_ERROR_COMMAND_WRONG_ARGUMENTS);
+        return;
+    }
+
+    int n = (argc == 2) ? atoi(argv[1]) : 1;
+    if (!flight_log_get_flight(n, &entry)) {
+        ush_print(self, "no such flight");
+        return;
+    }
+
+    if (dump_active()) {
+        ush_print(self, "a download is running");
+    } else if (!dump_start(&entry)) {
+        ush_print(self, "telemetry port not open");
+    } else {
+        ush_print(self, "sending on the telemetry port");
+    }
+}
+
 // bin directory files descriptor
 static const struct ush_file_descriptor bin_files[] = {
     {
@@ -61,6 +95,18 @@ static const struct ush_file_descriptor bin_files[] = {
         .help = "usage: set {0,1}\r\n",
         .exec = set_exec_callback
     },
+    {
+        .name = "perfreset",
+        .description = "clear /dev/perf",
+        .help = "usage: perfreset\r\n",
+        .exec = perfreset_exec_callback
+    },
+    {
+        .name = "dump",
+        .description = "download a flight (use tools/log_dump)",
+        .help = "usage: dump [flight], 1 is the most recent\r\n",
+        .exec = dump_exec_callback
+    },
 };
 
 void fs_mnt_bin(struct ush_object *ush) {
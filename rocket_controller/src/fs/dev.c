@@ -13,8 +13,28 @@
 
 #include "microshell.h"
 
+#include "usb_cdc.h"
+#include "flight_log.h"
+#include "sched.h"
+#include "perf.h"
+#include "timebase.h"
+#include "lsm6ds3.h"
+#include "i2c_bus.h"
+#include "acq.h"
+#include "ahrs.h"
+#include "altitude.h"
+#include "phase.h"
+#include "slog.h"
+#include "fmt.h"
+
 #include "fs/fs.h"
 
+/// Text of the file being read, the shell reads one file at a time. Sized
+/// for /dev/perf, the longest.
+#define DEV_BUF_LEN (PERF_NUM_ZONES * 96 + 48)
+
+static char g_dev_buf[DEV_BUF_LEN];
+
 // led file get data callback
 size_t led_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
 {
@@ -46,14 +66,235 @@ void led_set_data_callback(struct ush_object *self, struct ush_file_descriptor c
 // time file get data callback
 size_t time_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
 {
-    static char time_buf[16];
     // read current time
-    long current_time = 11011;
+    uint64_t current_time = timebase_now_us();
+    // convert
+    fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "%lu.%06lu\r\n",
+             (unsigned long)(current_time / 1000000), (unsigned long)(current_time % 1000000));
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// usb file get data callback
+size_t usb_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    static const char *port_names[USB_CDC_NUM_PORTS] = {"shell", "telem"};
+    size_t len = 0;
+    usb_cdc_stats_t stats;
+
+    for (int i = 0; i < USB_CDC_NUM_PORTS && len < sizeof(g_dev_buf); i++) {
+        usb_cdc_port_get_stats(i, &stats);
+        // convert
+        len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "%s: tx_bytes %lu tx_packets %lu max_packets_per_frame %u\r\n",
+                        port_names[i], (unsigned long)stats.tx_bytes, (unsigned long)stats.tx_packets,
+                        stats.max_packets_per_frame);
+    }
+    if (len < sizeof(g_dev_buf)) {
+        fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "frames: %lu\r\n", (unsigned long)stats.frames);
+    }
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// flash file get data callback
+size_t flash_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    flight_log_stats_t stats;
+    flight_log_get_stats(&stats);
+    // convert
+    fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "flights: %d\r\nrecording: %d\r\npages: %lu\r\nerases: %lu/%lu\r\nsuspends: %lu\r\ndropped: %lu\r\n",
+             flight_log_count(), flight_log_recording(), (unsigned long)stats.pages_written,
+             (unsigned long)stats.sector_erases, (unsigned long)stats.block_erases,
+             (unsigned long)stats.erase_suspends, (unsigned long)stats.bytes_dropped);
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// imu file get data callback
+size_t imu_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    lsm6ds3_stats_t stats;
+    lsm6ds3_get_stats(&stats);
+    // convert
+    fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "polls: %lu\r\nbursts: %lu\r\nsamples: %lu\r\nmag: %lu\r\nbusy: %lu\r\noverruns: %lu\r\nresyncs: %lu\r\n",
+             (unsigned long)stats.polls, (unsigned long)stats.bursts, (unsigned long)stats.samples,
+             (unsigned long)stats.mag_samples, (unsigned long)stats.busy,
+             (unsigned long)stats.fifo_overruns, (unsigned long)stats.resyncs);
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// acq file get data callback
+size_t acq_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    size_t len = 0;
+    acq_stats_t stats;
+
+    len += fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "sensor present rate events samples missed dropped high\r\n");
+    for (int i = 0; i < ACQ_NUM_SENSORS && len < sizeof(g_dev_buf); i++) {
+        acq_get_stats(i, &stats);
+        // convert
+        len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "%s %d %u %lu %lu %lu %lu %u\r\n",
+                        acq_sensor_name(i), stats.present, stats.rate_hz,
+                        (unsigned long)stats.events, (unsigned long)stats.samples,
+                        (unsigned long)stats.missed, (unsigned long)stats.dropped,
+                        stats.queue_high_water);
+    }
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// ahrs file get data callback
+size_t ahrs_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    size_t len = 0;
+    q30_t q[4];
+    ahrs_get_quat(q);
+
+    // convert, each component to 4 decimal places
+    len += fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "q:");
+    for (int i = 0; i < 4; i++) {
+        len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, " %.4q30", q[i]);
+    }
+    fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "\r\n");
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// alt file get data callback
+size_t alt_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    alt_state_t state;
+    alt_get_state(&state);
+    // convert, in cm and cm/s
+    fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "height: %ld\r\nvelocity: %ld\r\nbias: %ld\r\nground: %d\r\narmed: %d\r\n"
+             "apogee: %d\r\nmax: %ld @ %lu\r\ndetected: %lu\r\n",
+             (long)(state.height * 100), (long)(state.velocity * 100), (long)(state.accel_bias * 100),
+             state.ground_set, state.armed, state.apogee, (long)(state.max_height * 100),
+             (unsigned long)state.max_height_us, (unsigned long)state.apogee_us);
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// phase file get data callback
+size_t phase_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    // convert, time in the phase in ms
+    fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "%s %lu\r\n", phase_name(phase_get()),
+             (unsigned long)(timebase_now_ms() - phase_since_ms()));
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// i2c file get data callback
+size_t i2c_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    size_t len = 0;
+    i2c_stats_t stats;
+
+    len += fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "bus txns errors bytes rejected timeouts\r\n");
+    for (int i = 0; i < I2C_NUM_BUSES && len < sizeof(g_dev_buf); i++) {
+        i2c_get_stats(i, &stats);
+        // convert
+        len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "i2c%d %lu %lu %lu %lu %lu\r\n",
+                        i + 1, (unsigned long)stats.txns, (unsigned long)stats.errors,
+                        (unsigned long)stats.bytes, (unsigned long)stats.rejected,
+                        (unsigned long)stats.timeouts);
+    }
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// tasks file get data callback
+size_t tasks_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    size_t len = 0;
+    sched_stats_t stats;
+
+    len += fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "name runs overruns max_late_us max_run_us\r\n");
+    for (int i = 0; sched_get_stats(i, &stats) && len < sizeof(g_dev_buf); i++) {
+        // convert
+        len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "%s %lu %lu %lu %lu\r\n",
+                        stats.name, (unsigned long)stats.runs, (unsigned long)stats.overruns,
+                        (unsigned long)stats.max_latency, (unsigned long)stats.max_runtime);
+    }
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// perf file get data callback
+size_t perf_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    size_t len = 0;
+    perf_stats_t stats;
+
+    len += fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "zone count min mean max hist(log2:count)\r\n");
+    for (int zone = 0; zone < PERF_NUM_ZONES && len < sizeof(g_dev_buf); zone++) {
+        perf_get_stats(zone, &stats);
+        uint32_t mean = stats.count ? stats.total / stats.count : 0;
+        // convert
+        len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "%s %lu %lu %lu %lu",
+                        perf_zone_name(zone), (unsigned long)stats.count, (unsigned long)stats.min,
+                        (unsigned long)mean, (unsigned long)stats.max);
+        // only the buckets that have been hit
+        for (int bucket = 0; bucket < PERF_HIST_BUCKETS && len < sizeof(g_dev_buf); bucket++) {
+            if (stats.hist[bucket]) {
+                len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, " %d:%lu",
+                                bucket, (unsigned long)stats.hist[bucket]);
+            }
+        }
+        if (len < sizeof(g_dev_buf)) {
+            len += fmt_snprintf(g_dev_buf + len, sizeof(g_dev_buf) - len, "\r\n");
+        }
+    }
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
+    // return pointer to data
+    *data = (uint8_t*)g_dev_buf;
+    // return data size
+    return strlen((char*)(*data));
+}
+
+// slog file get data callback
+size_t slog_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data)
+{
+    slog_stats_t stats;
+    slog_get_stats(&stats);
     // convert
-    snprintf(time_buf, sizeof(time_buf), "%ld\r\n", current_time);
-    time_buf[sizeof(time_buf) - 1] = 0;
+    fmt_snprintf(g_dev_buf, sizeof(g_dev_buf), "writes: %lu\r\nlost: %lu\r\nspilled: %lu\r\n",
+             (unsigned long)stats.writes, (unsigned long)stats.lost, (unsigned long)stats.spilled);
+    g_dev_buf[sizeof(g_dev_buf) - 1] = 0;
     // return pointer to data
-    *data = (uint8_t*)time_buf;
+    *data = (uint8_t*)g_dev_buf;
     // return data size
     return strlen((char*)(*data));
 }
@@ -75,6 +316,83 @@ static const struct ush_file_descriptor dev_files[] = {
         .exec = NULL,
         .get_data = time_get_data_callback,
     },
+    {
+        .name = "usb",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = usb_get_data_callback,
+    },
+    {
+        .name = "flash",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = flash_get_data_callback,
+    },
+    {
+        .name = "imu",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = imu_get_data_callback,
+    },
+    {
+        .name = "acq",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = acq_get_data_callback,
+    },
+    {
+        .name = "ahrs",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = ahrs_get_data_callback,
+    },
+    {
+        .name = "alt",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = alt_get_data_callback,
+    },
+    {
+        .name = "phase",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = phase_get_data_callback,
+    },
+    {
+        .name = "i2c",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = i2c_get_data_callback,
+    },
+    {
+        .name = "tasks",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = tasks_get_data_callback,
+    },
+    {
+        .name = "perf",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = perf_get_data_callback,
+    },
+    {
+        .name = "slog",
+        .description = NULL,
+        .help = NULL,
+        .exec = NULL,
+        .get_data = slog_get_data_callback,
+    },
 };
 
 static struct ush_node_object dev;
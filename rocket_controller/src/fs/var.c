@@ -8,13 +8,86 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include <libopencm3/stm32/gpio.h>
 
 #include "microshell.h"
 
+#include "cli.h"
+#include "flight_log.h"
+#include "slog.h"
+
 #include "fs/fs.h"
 
+/// The flight being streamed by cat
+static flight_log_entry_t g_stream_flight;
+
+/** 
+ * @brief Read a chunk of a flight for the console stream
+ * @param ctx the flight
+ * @param offset the offset into the flight data
+ * @param buf the buffer to fill
+ * @param len the size of the buffer
+ * 
+ * @return the number of bytes read, 0 at the end or -1 to retry
+ */
+static int flight_read_chunk(void *ctx, uint32_t offset, uint8_t *buf, size_t len) {
+    return flight_log_read(ctx, offset, buf, len);
+}
+
+/** 
+ * @brief Start streaming a flight, the number is the end of the file name.
+ * The data is the raw flight log (frames, see tools/telem_decode.c).
+ * @param self the shell
+ * @param file the file
+ * @param data set to a message, empty when streaming
+ * 
+ * @return the length of the message
+ */
+static size_t flight_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data) {
+    (void)self;
+    static const char *missing = "no such flight\r\n";
+    static const char *busy = "busy\r\n";
+    int n = file->name[sizeof("flight_") - 1] - '0';
+
+    // Nothing is returned to the shell, the data follows as a stream
+    *data = (uint8_t *)"";
+    if (!flight_log_get_flight(n, &g_stream_flight)) {
+        *data = (uint8_t *)missing;
+    } else if (!cli_stream_start(flight_read_chunk, &g_stream_flight)) {
+        *data = (uint8_t *)busy;
+    }
+    return strlen((char *)*data);
+}
+
+/// The reader of the syslog being streamed by cat
+static slog_reader_t g_syslog_reader;
+
+/** 
+ * @brief Start streaming the system log, each message is formatted as it
+ * is sent
+ * @param self the shell
+ * @param file the file
+ * @param data set to a message, empty when streaming
+ * 
+ * @return the length of the message
+ */
+static size_t syslog_get_data_callback(struct ush_object *self, struct ush_file_descriptor const *file, uint8_t **data) {
+    (void)self;
+    (void)file;
+    static const char *busy = "busy\r\n";
+
+    *data = (uint8_t *)"";
+    if (!cli_streaming()) {
+        slog_reader_init(&g_syslog_reader);
+        cli_stream_start(slog_read_chunk, &g_syslog_reader);
+    } else {
+        *data = (uint8_t *)busy;
+    }
+    return strlen((char *)*data);
+}
+
 // dev directory files descriptor
 static const struct ush_file_descriptor var_files[] = {
     // {
@@ -34,26 +107,38 @@ static const struct ush_file_descriptor var_files[] = {
     // },
 };
 
+#define FLIGHT_FILE(num) \
+    { \
+        .name = "flight_" #num, \
+        .description = NULL, \
+        .help = NULL, \
+        .exec = NULL, \
+        .get_data = flight_get_data_callback, \
+        .set_data = NULL, \
+    }
+
+_Static_assert(FLIGHT_LOG_MAX_FLIGHTS == 8, "one flight file per flight in the index");
+
+// One file per flight in the index, flight_1 is the most recent
 static const struct ush_file_descriptor var_log_files[] = {
-    {
-        .name = "flight_1.csv",
-        .description = NULL,
-        .help = NULL,
-        .exec = NULL,
-        .get_data = NULL,      // optional data getter callback
-        .set_data = NULL,      // optional data setter callback
-    },
+    FLIGHT_FILE(1),
+    FLIGHT_FILE(2),
+    FLIGHT_FILE(3),
+    FLIGHT_FILE(4),
+    FLIGHT_FILE(5),
+    FLIGHT_FILE(6),
+    FLIGHT_FILE(7),
+    FLIGHT_FILE(8),
     {
         .name = "syslog",
         .description = NULL,
         .help = NULL,
         .exec = NULL,
-        .get_data = NULL,
+        .get_data = syslog_get_data_callback,
     },
 };
 
 
-
 static struct ush_node_object var;
 
 static struct ush_node_object var_log;
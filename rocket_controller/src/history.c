@@ -0,0 +1,178 @@
+/** 
+ * @file history.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-04
+ * @brief Implementation of the pre-launch sample history
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "CBUF.h"
+
+#include "frame.h"
+#include "flight_log.h"
+#include "logpack.h"
+#include "slog.h"
+
+#include "history.h"
+
+/// A sample of any type
+typedef struct {
+    uint8_t type;
+    uint8_t len;
+    union {
+        telem_imu_t imu;
+        telem_mag_t mag;
+        telem_baro_t baro;
+    } rec;
+} history_rec_t;
+
+typedef struct {
+	volatile	uint16_t		m_get_idx;
+	volatile	uint16_t		m_put_idx;
+				history_rec_t	m_entry[HISTORY_LEN];	// Size must be a power of 2
+} history_buf_t;
+
+static history_buf_t g_history;
+
+static bool g_history_triggered = false;
+
+/// True from history_stop() until the last block is in the flight log
+static bool g_history_stopping = false;
+
+static history_stats_t g_history_stats;
+
+/// The block being filled for the flight log
+static logpack_t g_pack;
+
+void history_push(telem_rec_type_t type, const void *rec, size_t len) {
+    if (len > sizeof(((history_rec_t *)0)->rec)) {
+        return;
+    }
+
+    if (CBUF_IsFull(g_history)) {
+        if (g_history_triggered) {
+            g_history_stats.dropped++;
+            return;
+        }
+        // On the pad only the most recent samples matter
+        CBUF_AdvancePopIdx(g_history);
+        g_history_stats.discarded++;
+    }
+
+    history_rec_t *entry = CBUF_GetPushEntryPtr(g_history);
+    entry->type = type;
+    entry->len = len;
+    memcpy(&entry->rec, rec, len);
+    CBUF_AdvancePushIdx(g_history);
+    g_history_stats.pushed++;
+
+    if (g_history_triggered && CBUF_Len(g_history) > g_history_stats.high_water) {
+        g_history_stats.high_water = CBUF_Len(g_history);
+    }
+}
+
+void history_arm(void) {
+    flight_log_prepare();
+}
+
+void history_trigger(void) {
+    if (g_history_triggered) {
+        return;
+    }
+    if (!flight_log_recording()) {
+        flight_log_start();
+    }
+    logpack_init(&g_pack);
+    g_history_triggered = true;
+    SLOG(SLOG_LOG_START);
+
+    // The ring is full on the pad, make room before the next sample arrives
+    history_service();
+}
+
+bool history_triggered(void) {
+    return g_history_triggered;
+}
+
+/** 
+ * @brief Write the packed block to the flight log and start a new one
+ * 
+ * @return true if written, false if the log has no space for it yet
+ */
+static bool history_write_block(void) {
+    uint8_t frame[FRAME_MAX_SIZE(LOGPACK_BLOCK_SIZE)];
+
+    size_t frame_len = frame_encode(TELEM_REC_PACKED, g_pack.buf, g_pack.len, frame);
+
+    // Frames go in whole or not at all so the log never holds a partial one
+    if (flight_log_space() < frame_len) {
+        return false;
+    }
+    flight_log_write(frame, frame_len);
+    g_history_stats.blocks++;
+    logpack_init(&g_pack);
+    return true;
+}
+
+/** 
+ * @brief Stop the flight log once everything queued has been written
+ * 
+ */
+static void history_finish(void) {
+    if (!flight_log_recording()) {
+        // Nowhere to write them, count what is left as dropped
+        g_history_stats.dropped += CBUF_Len(g_history) + g_pack.records;
+        CBUF_Init(g_history);
+        logpack_init(&g_pack);
+    } else if (!CBUF_IsEmpty(g_history) || (g_pack.len > 0 && !history_write_block())) {
+        return;
+    }
+
+    SLOG(SLOG_LOG_STOP, g_history_stats.blocks, g_history_stats.dropped);
+    flight_log_stop();
+    g_history_triggered = false;
+    g_history_stopping = false;
+}
+
+void history_service(void) {
+    if (!g_history_triggered) {
+        return;
+    }
+
+    while (!CBUF_IsEmpty(g_history)) {
+        history_rec_t *entry = CBUF_GetPopEntryPtr(g_history);
+
+        if (!logpack_add(&g_pack, entry->type, &entry->rec, entry->len)) {
+            if (g_pack.len == 0) {
+                // Cannot be packed at all, drop it rather than stall
+                g_history_stats.dropped++;
+            } else if (history_write_block()) {
+                continue;
+            } else {
+                break;
+            }
+        }
+        CBUF_AdvancePopIdx(g_history);
+    }
+
+    if (g_history_stopping) {
+        history_finish();
+    }
+}
+
+void history_stop(void) {
+    if (!g_history_triggered) {
+        return;
+    }
+
+    g_history_stopping = true;
+    history_service();
+}
+
+void history_get_stats(history_stats_t *stats) {
+    *stats = g_history_stats;
+}
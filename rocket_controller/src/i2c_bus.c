@@ -0,0 +1,466 @@
+/** 
+ * @file i2c_bus.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-11
+ * @brief Implementation of the interrupt/DMA driven I2C transaction engine
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/i2c.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/cortex.h>
+
+#include "CBUF.h"
+
+#include "perf.h"
+#include "slog.h"
+#include "timebase.h"
+
+#include "i2c_bus.h"
+
+/// Bus interrupt priority, the event, error and DMA interrupts of a bus
+/// share it so they never preempt each other
+#define I2C_IRQ_PRIORITY (2 << 4)
+
+/// Longest wait for the stop of the last transaction to go out. It takes a
+/// bit time (2.5 us, 180 cycles), if it never clears the start fails and
+/// the transaction is recovered at its deadline
+#define I2C_STOP_SPINS 500
+
+/// SCL clocks sent by hand to free SDA, a device holding it lets go by the
+/// acknowledge of the byte it is sending
+#define I2C_RECOVER_CLOCKS 9
+
+/// Half a bit of the hand clocked recovery (100 kHz)
+#define I2C_RECOVER_HALF_BIT_US 5
+
+typedef enum {
+    I2C_ST_IDLE,
+    I2C_ST_START,           ///< Waiting for the start, then send the write address
+    I2C_ST_ADDR_W,          ///< Waiting for the write address to be acked
+    I2C_ST_WRITE,           ///< Sending the register and any data
+    I2C_ST_RESTART,         ///< Waiting for the repeated start, then send the read address
+    I2C_ST_ADDR_R,          ///< Waiting for the read address to be acked
+    I2C_ST_RX_ONE,          ///< Waiting for a single byte
+    I2C_ST_RX_DMA,          ///< Waiting for the DMA to receive the data
+    I2C_ST_RECOVER,         ///< Timed out, the bus is being recovered
+} i2c_state_t;
+
+typedef struct {
+	volatile	uint8_t			m_get_idx;
+	volatile	uint8_t			m_put_idx;
+				i2c_txn_t		*m_entry[I2C_QUEUE_LEN];	// Size must be a power of 2
+} i2c_queue_t;
+
+/// The state of one bus
+typedef struct {
+    uint32_t i2c;
+    uint8_t dma_rx;
+    uint32_t port;              ///< GPIO port of SCL and SDA
+    uint16_t scl;
+    uint16_t sda;
+    uint8_t irqs[3];            ///< Event, error and DMA interrupts
+    i2c_queue_t queue;
+    i2c_txn_t *cur;
+    volatile i2c_state_t state;
+    uint8_t pos;                ///< Bytes of the current write sent
+    uint32_t start_us;          ///< When the current transaction started
+    i2c_stats_t stats;
+} i2c_bus_state_t;
+
+static i2c_bus_state_t g_buses[I2C_NUM_BUSES] = {
+    [I2C_BUS_1] = { .i2c = I2C1, .dma_rx = DMA_CHANNEL7, .port = GPIO_BANK_I2C1_SCL,
+                    .scl = GPIO_I2C1_SCL, .sda = GPIO_I2C1_SDA,
+                    .irqs = { NVIC_I2C1_EV_IRQ, NVIC_I2C1_ER_IRQ, NVIC_DMA1_CHANNEL7_IRQ } },
+    [I2C_BUS_2] = { .i2c = I2C2, .dma_rx = DMA_CHANNEL5, .port = GPIO_BANK_I2C2_SCL,
+                    .scl = GPIO_I2C2_SCL, .sda = GPIO_I2C2_SDA,
+                    .irqs = { NVIC_I2C2_EV_IRQ, NVIC_I2C2_ER_IRQ, NVIC_DMA1_CHANNEL5_IRQ } },
+};
+
+/** 
+ * @brief Start the next queued transaction if the bus is idle, interrupts
+ * of the bus must be masked
+ * @param b the bus
+ * 
+ */
+static void i2c_start_next(i2c_bus_state_t *b) {
+    if (b->state != I2C_ST_IDLE || CBUF_IsEmpty(b->queue)) {
+        return;
+    }
+
+    b->cur = CBUF_Pop(b->queue);
+    b->pos = 0;
+    b->state = I2C_ST_START;
+    b->start_us = (uint32_t)timebase_now_us();
+
+    // A stop from the last transaction may still be going out
+    for (uint32_t i = 0; (I2C_CR1(b->i2c) & I2C_CR1_STOP) && i < I2C_STOP_SPINS; i++);
+
+    i2c_enable_ack(b->i2c);
+    i2c_clear_dma_last_transfer(b->i2c);
+    i2c_send_start(b->i2c);
+}
+
+/** 
+ * @brief Complete the current transaction and start the next
+ * @param b the bus
+ * @param ok true if successful
+ * 
+ */
+static void i2c_finish(i2c_bus_state_t *b, bool ok) {
+    i2c_txn_t *txn = b->cur;
+
+    b->cur = NULL;
+    b->state = I2C_ST_IDLE;
+
+    if (ok) {
+        b->stats.txns++;
+        b->stats.bytes += txn->len;
+    } else {
+        b->stats.errors++;
+        SLOG(SLOG_I2C_ERROR, b - g_buses + 1, txn->addr);
+    }
+
+    txn->status = ok ? I2C_TXN_DONE : I2C_TXN_ERROR;
+    if (txn->done != NULL) {
+        txn->done(txn);
+    }
+
+    i2c_start_next(b);
+}
+
+/** 
+ * @brief Receive the data of a read by DMA
+ * @param b the bus
+ * 
+ */
+static void i2c_start_rx_dma(i2c_bus_state_t *b) {
+    dma_channel_reset(DMA1, b->dma_rx);
+    dma_set_peripheral_address(DMA1, b->dma_rx, (uint32_t)&I2C_DR(b->i2c));
+    dma_set_memory_address(DMA1, b->dma_rx, (uint32_t)b->cur->buf);
+    dma_set_number_of_data(DMA1, b->dma_rx, b->cur->len);
+    dma_set_read_from_peripheral(DMA1, b->dma_rx);
+    dma_enable_memory_increment_mode(DMA1, b->dma_rx);
+    dma_set_peripheral_size(DMA1, b->dma_rx, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, b->dma_rx, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, b->dma_rx, DMA_CCR_PL_MEDIUM);
+    dma_enable_transfer_complete_interrupt(DMA1, b->dma_rx);
+    dma_enable_channel(DMA1, b->dma_rx);
+
+    // The last byte received by DMA is NACKed
+    i2c_set_dma_last_transfer(b->i2c);
+    i2c_enable_dma(b->i2c);
+}
+
+/** 
+ * @brief Handle an I2C event interrupt
+ * @param b the bus
+ * 
+ */
+static void i2c_event(i2c_bus_state_t *b) {
+    uint32_t sr1 = I2C_SR1(b->i2c);
+    i2c_txn_t *txn = b->cur;
+
+    switch (b->state) {
+    case I2C_ST_START:
+        if (sr1 & I2C_SR1_SB) {
+            i2c_send_7bit_address(b->i2c, txn->addr, I2C_WRITE);
+            b->state = I2C_ST_ADDR_W;
+        }
+        break;
+
+    case I2C_ST_ADDR_W:
+        if (sr1 & I2C_SR1_ADDR) {
+            (void)I2C_SR2(b->i2c);
+            i2c_send_data(b->i2c, txn->reg);
+            b->state = I2C_ST_WRITE;
+        }
+        break;
+
+    case I2C_ST_WRITE:
+        if (!(sr1 & I2C_SR1_BTF)) {
+            break;
+        }
+        if (txn->read) {
+            i2c_send_start(b->i2c);
+            b->state = I2C_ST_RESTART;
+        } else if (b->pos < txn->len) {
+            i2c_send_data(b->i2c, txn->buf[b->pos++]);
+        } else {
+            i2c_send_stop(b->i2c);
+            i2c_finish(b, true);
+        }
+        break;
+
+    case I2C_ST_RESTART:
+        if (sr1 & I2C_SR1_SB) {
+            i2c_send_7bit_address(b->i2c, txn->addr, I2C_READ);
+            b->state = I2C_ST_ADDR_R;
+        }
+        break;
+
+    case I2C_ST_ADDR_R:
+        if (!(sr1 & I2C_SR1_ADDR)) {
+            break;
+        }
+        if (txn->len == 1) {
+            // The NACK and stop must be set up before ADDR is cleared
+            i2c_disable_ack(b->i2c);
+            (void)I2C_SR2(b->i2c);
+            i2c_send_stop(b->i2c);
+            i2c_enable_interrupt(b->i2c, I2C_CR2_ITBUFEN);
+            b->state = I2C_ST_RX_ONE;
+        } else {
+            i2c_start_rx_dma(b);
+            (void)I2C_SR2(b->i2c);
+            b->state = I2C_ST_RX_DMA;
+        }
+        break;
+
+    case I2C_ST_RX_ONE:
+        if (sr1 & I2C_SR1_RxNE) {
+            txn->buf[0] = i2c_get_data(b->i2c);
+            i2c_disable_interrupt(b->i2c, I2C_CR2_ITBUFEN);
+            i2c_finish(b, true);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/** 
+ * @brief Handle an I2C error interrupt, the transaction is abandoned
+ * @param b the bus
+ * 
+ */
+static void i2c_error(i2c_bus_state_t *b) {
+    I2C_SR1(b->i2c) &= ~(I2C_SR1_AF | I2C_SR1_ARLO | I2C_SR1_BERR | I2C_SR1_OVR | I2C_SR1_TIMEOUT);
+
+    i2c_disable_dma(b->i2c);
+    dma_disable_channel(DMA1, b->dma_rx);
+    i2c_disable_interrupt(b->i2c, I2C_CR2_ITBUFEN);
+    i2c_send_stop(b->i2c);
+
+    if (b->cur != NULL) {
+        i2c_finish(b, false);
+    }
+}
+
+/** 
+ * @brief Handle the end of a DMA read
+ * @param b the bus
+ * 
+ */
+static void i2c_rx_dma_done(i2c_bus_state_t *b) {
+    dma_clear_interrupt_flags(DMA1, b->dma_rx, DMA_TCIF);
+    dma_disable_channel(DMA1, b->dma_rx);
+    i2c_disable_dma(b->i2c);
+    i2c_send_stop(b->i2c);
+
+    if (b->state == I2C_ST_RX_DMA) {
+        i2c_finish(b, true);
+    }
+}
+
+/** 
+ * @brief Reset the peripheral and set it up, with the pins handed to it
+ * @param b the bus
+ * 
+ */
+static void i2c_configure(i2c_bus_state_t *b) {
+    gpio_set_mode(b->port, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_ALTFN_OPENDRAIN, b->scl | b->sda);
+
+    // APB1 is 36 MHz
+    i2c_reset(b->i2c);
+    i2c_peripheral_disable(b->i2c);
+    i2c_set_speed(b->i2c, i2c_speed_fm_400k, rcc_apb1_frequency / 1000000);
+    i2c_enable_interrupt(b->i2c, I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+    i2c_peripheral_enable(b->i2c);
+}
+
+/** 
+ * @brief Wait half a bit of the hand clocked recovery
+ * 
+ */
+static void i2c_recover_wait(void) {
+    uint32_t start = (uint32_t)timebase_now_us();
+    while ((uint32_t)timebase_now_us() - start < I2C_RECOVER_HALF_BIT_US);
+}
+
+/** 
+ * @brief Free a bus after a timeout: clock SCL by hand until any device
+ * holding SDA lets go, send a stop and reset the peripheral. The interrupts
+ * of the bus must be disabled.
+ * @param b the bus
+ * 
+ */
+static void i2c_recover(i2c_bus_state_t *b) {
+    i2c_disable_dma(b->i2c);
+    dma_disable_channel(DMA1, b->dma_rx);
+    i2c_peripheral_disable(b->i2c);
+
+    gpio_set(b->port, b->scl | b->sda);
+    gpio_set_mode(b->port, GPIO_MODE_OUTPUT_50_MHZ, GPIO_CNF_OUTPUT_OPENDRAIN, b->scl | b->sda);
+    for (int i = 0; i < I2C_RECOVER_CLOCKS && !gpio_get(b->port, b->sda); i++) {
+        gpio_clear(b->port, b->scl);
+        i2c_recover_wait();
+        gpio_set(b->port, b->scl);
+        i2c_recover_wait();
+    }
+
+    // SDA falling then rising with SCL high, a start and a stop
+    gpio_clear(b->port, b->sda);
+    i2c_recover_wait();
+    gpio_set(b->port, b->sda);
+    i2c_recover_wait();
+
+    i2c_configure(b);
+}
+
+void i2c_bus_init(i2c_bus_t bus) {
+    i2c_bus_state_t *b = &g_buses[bus];
+
+    rcc_periph_clock_enable(RCC_GPIOB);
+    rcc_periph_clock_enable(RCC_AFIO);
+    rcc_periph_clock_enable(RCC_DMA1);
+    rcc_periph_clock_enable(bus == I2C_BUS_1 ? RCC_I2C1 : RCC_I2C2);
+
+    CBUF_Init(b->queue);
+    b->cur = NULL;
+    b->state = I2C_ST_IDLE;
+
+    i2c_configure(b);
+
+    for (int i = 0; i < 3; i++) {
+        nvic_set_priority(b->irqs[i], I2C_IRQ_PRIORITY);
+        nvic_enable_irq(b->irqs[i]);
+    }
+}
+
+bool i2c_submit(i2c_bus_t bus, i2c_txn_t *txn) {
+    i2c_bus_state_t *b = &g_buses[bus];
+    bool queued = false;
+
+    CM_ATOMIC_BLOCK() {
+        if (CBUF_IsFull(b->queue)) {
+            b->stats.rejected++;
+        } else {
+            txn->status = I2C_TXN_QUEUED;
+            CBUF_Push(b->queue, txn);
+            i2c_start_next(b);
+            queued = true;
+        }
+    }
+
+    return queued;
+}
+
+bool i2c_check_timeout(i2c_bus_t bus) {
+    i2c_bus_state_t *b = &g_buses[bus];
+    uint32_t now = (uint32_t)timebase_now_us();
+    bool expired = false;
+
+    // Signed, a transaction may start after the clock was read
+    CM_ATOMIC_BLOCK() {
+        if (b->cur != NULL && b->state != I2C_ST_RECOVER
+            && (int32_t)(now - b->start_us) > I2C_TXN_TIMEOUT_US) {
+            // Submits only queue until the bus is back
+            b->state = I2C_ST_RECOVER;
+            for (int i = 0; i < 3; i++) {
+                nvic_disable_irq(b->irqs[i]);
+            }
+            expired = true;
+        }
+    }
+    if (!expired) {
+        return false;
+    }
+
+    // Clocked by hand with only this bus's interrupts off
+    i2c_recover(b);
+
+    CM_ATOMIC_BLOCK() {
+        for (int i = 0; i < 3; i++) {
+            nvic_clear_pending_irq(b->irqs[i]);
+            nvic_enable_irq(b->irqs[i]);
+        }
+        b->stats.timeouts++;
+        i2c_finish(b, false);
+    }
+
+    return true;
+}
+
+bool i2c_transfer(i2c_bus_t bus, i2c_txn_t *txn) {
+    if (!i2c_submit(bus, txn)) {
+        return false;
+    }
+
+    // Each transaction ahead of this one ends by its deadline
+    while (txn->status == I2C_TXN_QUEUED) {
+        i2c_check_timeout(bus);
+    }
+
+    return txn->status == I2C_TXN_DONE;
+}
+
+bool i2c_write_reg(i2c_bus_t bus, uint8_t addr, uint8_t reg, uint8_t val) {
+    i2c_txn_t txn = { .addr = addr, .reg = reg, .read = false, .len = 1, .buf = &val };
+
+    return i2c_transfer(bus, &txn);
+}
+
+bool i2c_read_regs(i2c_bus_t bus, uint8_t addr, uint8_t reg, uint8_t *buf, uint8_t len) {
+    i2c_txn_t txn = { .addr = addr, .reg = reg, .read = true, .len = len, .buf = buf };
+
+    return i2c_transfer(bus, &txn);
+}
+
+void i2c_get_stats(i2c_bus_t bus, i2c_stats_t *stats) {
+    *stats = g_buses[bus].stats;
+}
+
+void i2c1_ev_isr(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_I2C1_ISR);
+    i2c_event(&g_buses[I2C_BUS_1]);
+    PERF_ZONE_EXIT(PERF_ZONE_I2C1_ISR);
+}
+
+void i2c1_er_isr(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_I2C1_ISR);
+    i2c_error(&g_buses[I2C_BUS_1]);
+    PERF_ZONE_EXIT(PERF_ZONE_I2C1_ISR);
+}
+
+void dma1_channel7_isr(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_I2C1_ISR);
+    i2c_rx_dma_done(&g_buses[I2C_BUS_1]);
+    PERF_ZONE_EXIT(PERF_ZONE_I2C1_ISR);
+}
+
+void i2c2_ev_isr(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_I2C2_ISR);
+    i2c_event(&g_buses[I2C_BUS_2]);
+    PERF_ZONE_EXIT(PERF_ZONE_I2C2_ISR);
+}
+
+void i2c2_er_isr(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_I2C2_ISR);
+    i2c_error(&g_buses[I2C_BUS_2]);
+    PERF_ZONE_EXIT(PERF_ZONE_I2C2_ISR);
+}
+
+void dma1_channel5_isr(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_I2C2_ISR);
+    i2c_rx_dma_done(&g_buses[I2C_BUS_2]);
+    PERF_ZONE_EXIT(PERF_ZONE_I2C2_ISR);
+}
@@ -0,0 +1,176 @@
+/** 
+ * @file lis2mdl.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-11
+ * @brief Implementation of the LIS2MDL magnetometer driver
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "i2c_bus.h"
+#include "timebase.h"
+
+#include "lis2mdl.h"
+
+#define LIS2MDL_BUS         I2C_BUS_1
+
+#define REG_WHO_AM_I        0x4F
+#define REG_CFG_A           0x60
+#define REG_CFG_B           0x61
+#define REG_CFG_C           0x62
+#define REG_STATUS          0x67
+
+#define WHO_AM_I_LIS2MDL    0x40
+
+#define CFG_A_SOFT_RST      0x20
+#define CFG_A_COMP_CONT     0x80    ///< Temperature compensation, continuous, rate in bits 3:2
+#define CFG_A_ODR_SHIFT     2
+#define CFG_B_OFF_CANC      0x02
+#define CFG_C_BDU_DRDY      0x11    ///< Block data update, data ready on the INT pin
+#define STATUS_ZYXDA        0x08    ///< New x, y and z data
+
+static uint8_t g_raw[6];
+static uint32_t g_time_us;
+static lis2mdl_handler_t g_handler = NULL;
+
+/// Register value written by lis2mdl_set_odr()
+static uint8_t g_cfg_a;
+static lis2mdl_odr_t g_odr = LIS2MDL_ODR_100HZ;
+
+static uint8_t g_status;
+static lis2mdl_stats_t g_stats;
+
+static void lis2mdl_read_done(i2c_txn_t *txn);
+static void lis2mdl_status_done(i2c_txn_t *txn);
+
+static i2c_txn_t g_txn = {
+    .addr = LIS2MDL_ADDR,
+    .reg = LIS2MDL_REG_OUTX_L,
+    .read = true,
+    .len = sizeof(g_raw),
+    .buf = g_raw,
+    .done = lis2mdl_read_done,
+};
+
+static i2c_txn_t g_status_txn = {
+    .addr = LIS2MDL_ADDR,
+    .reg = REG_STATUS,
+    .read = true,
+    .len = 1,
+    .buf = &g_status,
+    .done = lis2mdl_status_done,
+};
+
+static i2c_txn_t g_cfg_txn = {
+    .addr = LIS2MDL_ADDR,
+    .reg = REG_CFG_A,
+    .read = false,
+    .len = 1,
+    .buf = &g_cfg_a,
+};
+
+/** 
+ * @brief Output registers read, runs in the I2C interrupt
+ * @param txn the transaction
+ * 
+ */
+static void lis2mdl_read_done(i2c_txn_t *txn) {
+    lis2mdl_sample_t sample;
+
+    if (txn->status != I2C_TXN_DONE || g_handler == NULL) {
+        return;
+    }
+
+    sample.time_us = g_time_us;
+    for (int i = 0; i < 3; i++) {
+        sample.mag[i] = (int16_t)(g_raw[2 * i] | (g_raw[2 * i + 1] << 8));
+    }
+    g_handler(&sample);
+}
+
+/** 
+ * @brief Status register read, runs in the I2C interrupt
+ * @param txn the transaction
+ * 
+ */
+static void lis2mdl_status_done(i2c_txn_t *txn) {
+    if (txn->status != I2C_TXN_DONE || !(g_status & STATUS_ZYXDA)) {
+        return;
+    }
+
+    g_stats.ready++;
+    if (!i2c_submit(LIS2MDL_BUS, &g_txn)) {
+        g_stats.missed++;
+    }
+}
+
+int lis2mdl_init(void) {
+    uint8_t who = 0;
+
+    if (!i2c_read_regs(LIS2MDL_BUS, LIS2MDL_ADDR, REG_WHO_AM_I, &who, 1)
+        || who != WHO_AM_I_LIS2MDL) {
+        return 1;
+    }
+
+    i2c_write_reg(LIS2MDL_BUS, LIS2MDL_ADDR, REG_CFG_A, CFG_A_SOFT_RST);
+    i2c_write_reg(LIS2MDL_BUS, LIS2MDL_ADDR, REG_CFG_B, CFG_B_OFF_CANC);
+    i2c_write_reg(LIS2MDL_BUS, LIS2MDL_ADDR, REG_CFG_C, CFG_C_BDU_DRDY);
+    i2c_write_reg(LIS2MDL_BUS, LIS2MDL_ADDR, REG_CFG_A,
+                  CFG_A_COMP_CONT | (LIS2MDL_ODR_100HZ << CFG_A_ODR_SHIFT));
+
+    return 0;
+}
+
+bool lis2mdl_start_read(void) {
+    if (g_txn.status == I2C_TXN_QUEUED) {
+        return false;
+    }
+
+    g_time_us = (uint32_t)timebase_now_us();
+    return i2c_submit(LIS2MDL_BUS, &g_txn);
+}
+
+bool lis2mdl_poll(void) {
+    // A read that never completed is failed here and the bus recovered
+    i2c_check_timeout(LIS2MDL_BUS);
+
+    if (g_status_txn.status == I2C_TXN_QUEUED || g_txn.status == I2C_TXN_QUEUED) {
+        return false;
+    }
+
+    g_stats.polls++;
+    g_time_us = (uint32_t)timebase_now_us();
+    return i2c_submit(LIS2MDL_BUS, &g_status_txn);
+}
+
+bool lis2mdl_set_odr(lis2mdl_odr_t odr) {
+    if (g_cfg_txn.status == I2C_TXN_QUEUED) {
+        return false;
+    }
+
+    g_cfg_a = CFG_A_COMP_CONT | (odr << CFG_A_ODR_SHIFT);
+    g_odr = odr;
+    return i2c_submit(LIS2MDL_BUS, &g_cfg_txn);
+}
+
+uint32_t lis2mdl_period_us(void) {
+    static const uint8_t odr_hz[] = {
+        [LIS2MDL_ODR_10HZ] = 10,
+        [LIS2MDL_ODR_20HZ] = 20,
+        [LIS2MDL_ODR_50HZ] = 50,
+        [LIS2MDL_ODR_100HZ] = 100,
+    };
+
+    return 1000000 / odr_hz[g_odr];
+}
+
+void lis2mdl_get_stats(lis2mdl_stats_t *stats) {
+    *stats = g_stats;
+}
+
+void lis2mdl_set_handler(lis2mdl_handler_t handler) {
+    g_handler = handler;
+}
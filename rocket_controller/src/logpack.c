@@ -0,0 +1,279 @@
+/** 
+ * @file logpack.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-19
+ * @brief Implementation of the delta encoded flight log blocks
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "telem.h"
+
+#include "logpack.h"
+
+#define LOGPACK_TAG_TYPE_MASK 0x7F
+
+/** 
+ * @brief Split a record into its time and fields
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * @param time_us set to the time
+ * @param fields set to the fields
+ * 
+ * @return the number of fields, 0 if the record is not known
+ */
+static int logpack_unpack(telem_rec_type_t type, const void *rec, size_t len,
+                          uint32_t *time_us, int32_t *fields) {
+    switch (type) {
+    case TELEM_REC_IMU: {
+        telem_imu_t imu;
+        if (len != sizeof(imu)) {
+            return 0;
+        }
+        memcpy(&imu, rec, sizeof(imu));
+        *time_us = imu.time_us;
+        for (int i = 0; i < 3; i++) {
+            fields[i] = imu.accel[i];
+            fields[3 + i] = imu.gyro[i];
+        }
+        return 6;
+    }
+    case TELEM_REC_MAG: {
+        telem_mag_t mag;
+        if (len != sizeof(mag)) {
+            return 0;
+        }
+        memcpy(&mag, rec, sizeof(mag));
+        *time_us = mag.time_us;
+        for (int i = 0; i < 3; i++) {
+            fields[i] = mag.mag[i];
+        }
+        return 3;
+    }
+    case TELEM_REC_BARO: {
+        telem_baro_t baro;
+        if (len != sizeof(baro)) {
+            return 0;
+        }
+        memcpy(&baro, rec, sizeof(baro));
+        *time_us = baro.time_us;
+        fields[0] = baro.pressure;
+        fields[1] = baro.temperature;
+        return 2;
+    }
+    default:
+        return 0;
+    }
+}
+
+/** 
+ * @brief Get the number of fields of a record type
+ * @param type the record type
+ * 
+ * @return the number of fields, 0 if the type is not known
+ */
+static int logpack_field_count(uint8_t type) {
+    switch (type) {
+    case TELEM_REC_IMU:
+        return 6;
+    case TELEM_REC_MAG:
+        return 3;
+    case TELEM_REC_BARO:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+/** 
+ * @brief Build a record and give it to a handler
+ * @param type the record type
+ * @param chan the decoded time and fields
+ * @param handler the handler
+ * @param ctx passed to the handler
+ * 
+ */
+static void logpack_emit(uint8_t type, const logpack_chan_t *chan, logpack_handler_t handler, void *ctx) {
+    switch (type) {
+    case TELEM_REC_IMU: {
+        telem_imu_t imu;
+        imu.time_us = chan->time_us;
+        for (int i = 0; i < 3; i++) {
+            imu.accel[i] = chan->fields[i];
+            imu.gyro[i] = chan->fields[3 + i];
+        }
+        handler(TELEM_REC_IMU, &imu, sizeof(imu), ctx);
+        break;
+    }
+    case TELEM_REC_MAG: {
+        telem_mag_t mag;
+        mag.time_us = chan->time_us;
+        for (int i = 0; i < 3; i++) {
+            mag.mag[i] = chan->fields[i];
+        }
+        handler(TELEM_REC_MAG, &mag, sizeof(mag), ctx);
+        break;
+    }
+    case TELEM_REC_BARO: {
+        telem_baro_t baro;
+        baro.time_us = chan->time_us;
+        baro.pressure = chan->fields[0];
+        baro.temperature = chan->fields[1];
+        handler(TELEM_REC_BARO, &baro, sizeof(baro), ctx);
+        break;
+    }
+    }
+}
+
+/** 
+ * @brief Write a varint, 7 bits a byte, low bits first
+ * @param out the output
+ * @param x the value
+ * 
+ * @return the number of bytes written
+ */
+static inline size_t logpack_put_varint(uint8_t *out, uint32_t x) {
+    size_t n = 0;
+    while (x >= 0x80) {
+        out[n++] = (x & 0x7F) | 0x80;
+        x >>= 7;
+    }
+    out[n++] = x;
+    return n;
+}
+
+/** 
+ * @brief Read a varint
+ * @param in the input
+ * @param len the bytes left in the input
+ * @param x set to the value
+ * 
+ * @return the number of bytes read, 0 if it is cut off or too long
+ */
+static inline size_t logpack_get_varint(const uint8_t *in, size_t len, uint32_t *x) {
+    uint32_t value = 0;
+    for (size_t n = 0; n < len && n < 5; n++) {
+        value |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) {
+            *x = value;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+/// Map signed to unsigned so small values of either sign are small
+static inline uint32_t logpack_zigzag(int32_t x) {
+    return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+static inline int32_t logpack_unzigzag(uint32_t x) {
+    return (int32_t)(x >> 1) ^ -(int32_t)(x & 1);
+}
+
+void logpack_init(logpack_t *pack) {
+    pack->len = 0;
+    pack->records = 0;
+    for (int i = 0; i < LOGPACK_NUM_TYPES; i++) {
+        pack->chan[i].have_key = false;
+    }
+}
+
+bool logpack_add(logpack_t *pack, telem_rec_type_t type, const void *rec, size_t len) {
+    uint8_t out[LOGPACK_MAX_RECORD];
+    uint32_t time_us;
+    int32_t fields[LOGPACK_MAX_FIELDS];
+
+    int count = (type < LOGPACK_NUM_TYPES) ? logpack_unpack(type, rec, len, &time_us, fields) : 0;
+    if (count == 0) {
+        return false;
+    }
+
+    // Encode first, the state only changes if the record fits
+    logpack_chan_t *chan = &pack->chan[type];
+    size_t n = 0;
+    uint32_t dt_us = 0;
+    if (!chan->have_key) {
+        out[n++] = type | LOGPACK_TAG_KEY;
+        n += logpack_put_varint(&out[n], time_us);
+        for (int i = 0; i < count; i++) {
+            n += logpack_put_varint(&out[n], logpack_zigzag(fields[i]));
+        }
+    } else {
+        dt_us = time_us - chan->time_us;
+        out[n++] = type;
+        n += logpack_put_varint(&out[n], logpack_zigzag(dt_us - chan->dt_us));
+        for (int i = 0; i < count; i++) {
+            n += logpack_put_varint(&out[n], logpack_zigzag(fields[i] - chan->fields[i]));
+        }
+    }
+
+    if (pack->len + n > LOGPACK_BLOCK_SIZE) {
+        return false;
+    }
+    memcpy(&pack->buf[pack->len], out, n);
+    pack->len += n;
+    pack->records++;
+
+    chan->have_key = true;
+    chan->time_us = time_us;
+    chan->dt_us = dt_us;
+    memcpy(chan->fields, fields, count * sizeof(fields[0]));
+    return true;
+}
+
+int logpack_decode(const uint8_t *block, size_t len, logpack_handler_t handler, void *ctx) {
+    logpack_chan_t chan[LOGPACK_NUM_TYPES];
+    size_t pos = 0;
+    int records = 0;
+
+    for (int i = 0; i < LOGPACK_NUM_TYPES; i++) {
+        chan[i].have_key = false;
+    }
+
+    while (pos < len) {
+        uint8_t tag = block[pos++];
+        uint8_t type = tag & LOGPACK_TAG_TYPE_MASK;
+        bool key = tag & LOGPACK_TAG_KEY;
+        int count = logpack_field_count(type);
+        if (count == 0 || (!key && !chan[type].have_key)) {
+            return -1;
+        }
+
+        logpack_chan_t *c = &chan[type];
+        uint32_t x;
+        size_t used = logpack_get_varint(&block[pos], len - pos, &x);
+        if (used == 0) {
+            return -1;
+        }
+        pos += used;
+
+        if (key) {
+            c->time_us = x;
+            c->dt_us = 0;
+        } else {
+            c->dt_us += logpack_unzigzag(x);
+            c->time_us += c->dt_us;
+        }
+
+        for (int i = 0; i < count; i++) {
+            used = logpack_get_varint(&block[pos], len - pos, &x);
+            if (used == 0) {
+                return -1;
+            }
+            pos += used;
+            c->fields[i] = key ? logpack_unzigzag(x) : c->fields[i] + logpack_unzigzag(x);
+        }
+        c->have_key = true;
+
+        logpack_emit(type, c, handler, ctx);
+        records++;
+    }
+
+    return records;
+}
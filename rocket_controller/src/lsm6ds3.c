@@ -0,0 +1,353 @@
+/** 
+ * @file lsm6ds3.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-10
+ * @brief Implementation of the LSM6DS3TR-C accelerometer/gyro driver
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "spi1_dma.h"
+#include "timebase.h"
+#include "slog.h"
+
+#include "lsm6ds3.h"
+
+#define REG_FUNC_CFG_ACCESS 0x01
+#define REG_SLV0_ADD        0x02    ///< Embedded function bank
+#define REG_SLV0_SUBADD     0x03    ///< Embedded function bank
+#define REG_SLAVE0_CONFIG   0x04    ///< Embedded function bank
+#define REG_FIFO_CTRL1      0x06
+#define REG_FIFO_CTRL2      0x07
+#define REG_FIFO_CTRL3      0x08
+#define REG_FIFO_CTRL4      0x09
+#define REG_FIFO_CTRL5      0x0A
+#define REG_INT1_CTRL       0x0D
+#define REG_WHO_AM_I        0x0F
+#define REG_CTRL1_XL        0x10
+#define REG_CTRL2_G         0x11
+#define REG_CTRL3_C         0x12
+#define REG_CTRL10_C        0x19
+#define REG_MASTER_CONFIG   0x1A
+#define REG_FIFO_STATUS1    0x3A
+#define REG_FIFO_STATUS2    0x3B
+
+#define WHO_AM_I_LSM6DS3TR  0x6A
+
+#define CTRL1_XL_16G        0x04    ///< Rate in the top four bits
+#define CTRL2_G_2000        0x0C    ///< Rate in the top four bits
+#define CTRL_ODR_SHIFT      4
+#define CTRL3_C_BDU_IF_INC  0x44
+#define CTRL3_C_SW_RESET    0x01
+#define CTRL10_C_FUNC_EN    0x04
+#define MASTER_CONFIG_ON    0x01
+#define FUNC_CFG_EN         0x80
+#define SLV0_READ           0x01
+#define SLAVE0_CONFIG_RATE8 0xC0    ///< Sensor hub reads on every eighth accelerometer sample
+#define FIFO_CTRL3_NO_DEC   0x09    ///< Gyro and accel in the FIFO, no decimation
+#define FIFO_CTRL4_DS3_DEC8 0x05    ///< Sensor hub data in the FIFO every 8 samples, as it is read
+#define FIFO_CTRL5_CONT     0x06    ///< Continuous mode, rate in bits 6:3
+#define FIFO_CTRL5_ODR_SHIFT 3
+#define FIFO_CTRL5_BYPASS   0x00
+#define INT1_CTRL_FTH       0x08
+
+#define STATUS2_OVER_RUN    0x40
+#define STATUS2_EMPTY       0x10
+#define STATUS2_DIFF_MASK   0x07
+
+/// Marks the last word of an ODR slot in lsm6ds3_parser_t.dest
+#define DEST_SLOT_END       0x80
+
+/// Double buffer, the DMA fills one half while the other is parsed
+static uint8_t g_block[2][LSM6DS3_BURST_LEN];
+static uint32_t g_block_time[2];
+static volatile bool g_block_ready[2];
+static volatile uint8_t g_fill = 0;
+static uint8_t g_parse = 0;
+
+/// Bytes read per burst, a whole number of FIFO patterns
+static uint16_t g_burst_len = 0;
+
+/// FIFO words read per burst, also the watermark
+static uint16_t g_burst_words = 0;
+
+static lsm6ds3_odr_t g_odr = LSM6DS3_ODR_1666HZ;
+
+static lsm6ds3_parser_t g_parser;
+static lsm6ds3_stats_t g_stats;
+
+/** 
+ * @brief Get the period of a rate, each code doubles the rate
+ * @param odr the rate
+ * 
+ * @return the period in us
+ */
+static inline uint32_t lsm6ds3_odr_period(lsm6ds3_odr_t odr) {
+    return LSM6DS3_PERIOD_US << (LSM6DS3_ODR_1666HZ - odr);
+}
+
+/** 
+ * @brief Burst complete, runs in the DMA interrupt
+ * 
+ */
+static void lsm6ds3_burst_done(void) {
+    g_block_ready[g_fill] = true;
+    g_fill ^= 1;
+    g_stats.bursts++;
+}
+
+/** 
+ * @brief Restart the FIFO with a burst sized watermark, the FIFO must be in
+ * bypass mode
+ * @param hub_dec the sensor hub decimation, 0 if off
+ * 
+ */
+static void lsm6ds3_fifo_start(uint8_t hub_dec) {
+    lsm6ds3_parser_init(&g_parser, hub_dec);
+    g_parser.period_us = lsm6ds3_odr_period(g_odr);
+
+    uint16_t words = g_parser.pattern_len * (LSM6DS3_BURST_SLOTS / g_parser.slots);
+    g_burst_words = words;
+    g_burst_len = 4 + words * 2;
+
+    g_block_ready[0] = g_block_ready[1] = false;
+    g_fill = g_parse = 0;
+
+    spi1_write_reg(REG_FIFO_CTRL1, words & 0xff);
+    spi1_write_reg(REG_FIFO_CTRL2, (words >> 8) & 0x07);
+    spi1_write_reg(REG_FIFO_CTRL3, FIFO_CTRL3_NO_DEC);
+    spi1_write_reg(REG_FIFO_CTRL4, hub_dec ? FIFO_CTRL4_DS3_DEC8 : 0);
+    spi1_write_reg(REG_FIFO_CTRL5, (g_odr << FIFO_CTRL5_ODR_SHIFT) | FIFO_CTRL5_CONT);
+}
+
+int lsm6ds3_init(void) {
+    spi1_dma_init();
+
+    spi1_write_reg(REG_CTRL3_C, CTRL3_C_SW_RESET);
+    for (int i = 0; i < 1000 && (spi1_read_reg(REG_CTRL3_C) & CTRL3_C_SW_RESET); i++);
+
+    if (spi1_read_reg(REG_WHO_AM_I) != WHO_AM_I_LSM6DS3TR) {
+        return 1;
+    }
+
+    // With IF_INC set a burst that reaches FIFO_DATA_OUT_H wraps back to
+    // FIFO_DATA_OUT_L, so one read returns the status and then the data
+    spi1_write_reg(REG_CTRL3_C, CTRL3_C_BDU_IF_INC);
+
+    spi1_write_reg(REG_FIFO_CTRL5, FIFO_CTRL5_BYPASS);
+    // Only used where INT1 is wired, lsm6ds3_poll() does not need it
+    spi1_write_reg(REG_INT1_CTRL, INT1_CTRL_FTH);
+
+    g_odr = LSM6DS3_ODR_1666HZ;
+    spi1_write_reg(REG_CTRL1_XL, (g_odr << CTRL_ODR_SHIFT) | CTRL1_XL_16G);
+    spi1_write_reg(REG_CTRL2_G, (g_odr << CTRL_ODR_SHIFT) | CTRL2_G_2000);
+
+    lsm6ds3_fifo_start(0);
+
+    return 0;
+}
+
+void lsm6ds3_enable_hub(uint8_t addr, uint8_t reg) {
+    spi1_write_reg(REG_FIFO_CTRL5, FIFO_CTRL5_BYPASS);
+
+    spi1_write_reg(REG_FUNC_CFG_ACCESS, FUNC_CFG_EN);
+    spi1_write_reg(REG_SLV0_ADD, (addr << 1) | SLV0_READ);
+    spi1_write_reg(REG_SLV0_SUBADD, reg);
+    spi1_write_reg(REG_SLAVE0_CONFIG, SLAVE0_CONFIG_RATE8 | 6);
+    spi1_write_reg(REG_FUNC_CFG_ACCESS, 0);
+
+    spi1_write_reg(REG_CTRL10_C, CTRL10_C_FUNC_EN);
+    spi1_write_reg(REG_MASTER_CONFIG, MASTER_CONFIG_ON);
+
+    lsm6ds3_fifo_start(LSM6DS3_HUB_DEC);
+}
+
+void lsm6ds3_set_odr(lsm6ds3_odr_t odr) {
+    if (odr == g_odr) {
+        return;
+    }
+
+    // The register writes share SPI 1 with the burst reads
+    while (spi1_dma_busy());
+
+    g_odr = odr;
+    spi1_write_reg(REG_CTRL1_XL, (odr << CTRL_ODR_SHIFT) | CTRL1_XL_16G);
+    spi1_write_reg(REG_CTRL2_G, (odr << CTRL_ODR_SHIFT) | CTRL2_G_2000);
+    // The FIFO stays in continuous mode so the pattern position carries on
+    spi1_write_reg(REG_FIFO_CTRL5, (odr << FIFO_CTRL5_ODR_SHIFT) | FIFO_CTRL5_CONT);
+
+    g_parser.period_us = lsm6ds3_odr_period(odr);
+}
+
+uint32_t lsm6ds3_period_us(void) {
+    return g_parser.period_us;
+}
+
+bool lsm6ds3_on_watermark(void) {
+    uint8_t fill = g_fill;
+
+    // Leave the data in the sensor FIFO until the block has been parsed
+    if (g_block_ready[fill] || spi1_dma_busy()) {
+        g_stats.busy++;
+        return false;
+    }
+
+    g_block_time[fill] = (uint32_t)timebase_now_us();
+    return spi1_dma_read(REG_FIFO_STATUS1, g_block[fill], g_burst_len,
+                         lsm6ds3_burst_done);
+}
+
+bool lsm6ds3_poll(void) {
+    // The status reads share SPI 1 with the burst
+    if (g_block_ready[g_fill] || spi1_dma_busy()) {
+        return false;
+    }
+
+    // FIFO_STATUS2 first, so a carry out of FIFO_STATUS1 between the two
+    // reads can only make the level look lower than it is
+    uint8_t status2 = spi1_read_reg(REG_FIFO_STATUS2);
+    uint8_t status1 = spi1_read_reg(REG_FIFO_STATUS1);
+    g_stats.polls++;
+
+    uint16_t unread = status1 | ((status2 & STATUS2_DIFF_MASK) << 8);
+    if ((status2 & STATUS2_EMPTY) || unread < g_burst_words) {
+        return false;
+    }
+
+    return lsm6ds3_on_watermark();
+}
+
+size_t lsm6ds3_read(lsm6ds3_sample_t *out, size_t max) {
+    if (!g_block_ready[g_parse]) {
+        return 0;
+    }
+
+    const uint8_t *block = g_block[g_parse];
+    if (block[1] & STATUS2_OVER_RUN) {
+        g_stats.fifo_overruns++;
+        SLOG(SLOG_IMU_OVERRUN, g_stats.fifo_overruns);
+    }
+
+    size_t n = lsm6ds3_fifo_parse(&g_parser, block, g_burst_len,
+                                  g_block_time[g_parse], out, max);
+    g_stats.samples += n;
+    for (size_t i = 0; i < n; i++) {
+        g_stats.mag_samples += out[i].mag_valid;
+    }
+
+    g_block_ready[g_parse] = false;
+    g_parse ^= 1;
+
+    return n;
+}
+
+void lsm6ds3_get_stats(lsm6ds3_stats_t *stats) {
+    *stats = g_stats;
+    stats->resyncs = g_parser.resyncs;
+}
+
+void lsm6ds3_parser_init(lsm6ds3_parser_t *parser, uint8_t hub_dec) {
+    memset(parser, 0, sizeof(*parser));
+
+    if (hub_dec > LSM6DS3_BURST_SLOTS) {
+        hub_dec = LSM6DS3_BURST_SLOTS;
+    }
+    parser->slots = hub_dec ? hub_dec : 1;
+
+    // Each slot holds gyro then accel, the first also holds the mag
+    uint16_t n = 0;
+    for (uint8_t slot = 0; slot < parser->slots; slot++) {
+        uint8_t slot_words = (slot == 0 && hub_dec) ? 3 * LSM6DS3_SET_WORDS : 2 * LSM6DS3_SET_WORDS;
+        for (uint8_t w = 0; w < slot_words; w++) {
+            parser->dest[n++] = w;
+        }
+        parser->dest[n - 1] |= DEST_SLOT_END;
+    }
+    parser->pattern_len = n;
+    parser->period_us = LSM6DS3_PERIOD_US;
+}
+
+/** 
+ * @brief Count the slots that end in a run of FIFO words
+ * @param parser the parser
+ * @param pos the pattern position of the first word
+ * @param words the number of words
+ * 
+ * @return the number of slot ends
+ */
+static uint32_t lsm6ds3_slot_ends(const lsm6ds3_parser_t *parser, uint16_t pos, uint32_t words) {
+    uint32_t ends = (words / parser->pattern_len) * parser->slots;
+
+    for (uint32_t i = words % parser->pattern_len; i > 0; i--) {
+        ends += (parser->dest[pos] & DEST_SLOT_END) != 0;
+        pos = (pos + 1 == parser->pattern_len) ? 0 : pos + 1;
+    }
+
+    return ends;
+}
+
+size_t lsm6ds3_fifo_parse(lsm6ds3_parser_t *parser, const uint8_t *block, size_t len,
+                          uint32_t time_us, lsm6ds3_sample_t *out, size_t max) {
+    if (len < 4 || parser->pattern_len == 0) {
+        return 0;
+    }
+
+    uint16_t unread = block[0] | ((block[1] & STATUS2_DIFF_MASK) << 8);
+    uint16_t pattern = block[2] | ((block[3] & 0x03) << 8);
+    if (block[1] & STATUS2_EMPTY) {
+        unread = 0;
+    }
+
+    // Words past the unread count are stale, never parse them
+    size_t words = (len - 4) / 2;
+    if (words > unread) {
+        words = unread;
+    }
+
+    if (pattern != parser->pos) {
+        parser->pos = pattern % parser->pattern_len;
+        parser->partial = parser->pos != 0 && !(parser->dest[parser->pos - 1] & DEST_SLOT_END);
+        parser->resyncs++;
+    }
+
+    // Slots still in the FIFO after a sample were taken later, back-date from
+    // the newest slot in the FIFO at the time of the burst
+    uint32_t ends_total = lsm6ds3_slot_ends(parser, parser->pos, unread);
+    uint32_t ends = 0;
+
+    const uint8_t *data = block + 4;
+    size_t n = 0;
+    for (size_t i = 0; i < words; i++) {
+        uint8_t dest = parser->dest[parser->pos];
+        parser->words[dest & ~DEST_SLOT_END] = (int16_t)(data[2 * i] | (data[2 * i + 1] << 8));
+        parser->pos = (parser->pos + 1 == parser->pattern_len) ? 0 : parser->pos + 1;
+
+        if (!(dest & DEST_SLOT_END)) {
+            continue;
+        }
+        ends++;
+
+        if (!parser->partial && n < max) {
+            lsm6ds3_sample_t *s = &out[n++];
+            s->time_us = time_us - (ends_total - ends) * parser->period_us;
+            for (int j = 0; j < 3; j++) {
+                s->gyro[j] = parser->words[j];
+                s->accel[j] = parser->words[LSM6DS3_SET_WORDS + j];
+            }
+            // The mag is the last data set of the slots that hold it
+            s->mag_valid = (dest & ~DEST_SLOT_END) == 3 * LSM6DS3_SET_WORDS - 1;
+            if (s->mag_valid) {
+                for (int j = 0; j < 3; j++) {
+                    s->mag[j] = parser->words[2 * LSM6DS3_SET_WORDS + j];
+                }
+            }
+        }
+        parser->partial = false;
+    }
+
+    return n;
+}
@@ -18,6 +18,7 @@
  */
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
 #include <libopencm3/cm3/nvic.h>
@@ -25,13 +26,44 @@
 
 #include "usb_cdc.h"
 #include "cli.h"
+#include "w25q.h"
+#include "flight_log.h"
+#include "history.h"
+#include "sched.h"
+#include "perf.h"
+#include "timebase.h"
+#include "acq.h"
+#include "slog.h"
+
+/** 
+ * @brief Move samples and pages towards the flash
+ * 
+ */
+static void log_task(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_LOG);
+    history_service();
+    slog_service();
+    flight_log_service();
+    PERF_ZONE_EXIT(PERF_ZONE_LOG);
+}
+
+/** 
+ * @brief Service the shell
+ * 
+ */
+static void cli_task(void) {
+    PERF_ZONE_ENTER(PERF_ZONE_CLI);
+    cli_update();
+    PERF_ZONE_EXIT(PERF_ZONE_CLI);
+}
 
 int main(void)
 {
-	int64_t i = 0;
-
 	rcc_clock_setup_pll(&rcc_hse_configs[RCC_CLOCK_HSE8_72MHZ]);
 
+    perf_init();
+    timebase_init();
+
 	rcc_periph_clock_enable(RCC_GPIOC);
     rcc_periph_clock_enable(RCC_USB);
 
@@ -48,19 +80,22 @@ int main(void)
     
     cli_init();
 
+    if (w25q_init() == 0) {
+        flight_log_init();
+    }
 
+    acq_init();
 
-	while (1) {
-        cli_update();
-        
-        if (i > 800000) {
-            // gpio_toggle(GPIOC, GPIO13);
-            // usb_cdc_send_byte(usb_cdc_avail()+'0');
-            // usb_cdc_send_strn("Hello World2", 13);
-            // usb_cdc_write("hello World8\r\n", 14);
-            // usb_cdc_write(buf, 12);
-            i = 0;
-        }
-        i++;
-    }
-}
\ No newline at end of file
+    SLOG(SLOG_BOOT);
+
+    sched_init();
+
+    // The shell is the lowest priority so it can never hold up acquisition
+    sched_add_periodic("acq", acq_service, 1, 0, SCHED_PRIO_HIGHEST);
+    sched_add_periodic("log", log_task, 1, 0, 2);
+    // Every ms so a streamed file refills the 1 KB tx ring about as fast as
+    // the link drains it
+    sched_add_periodic("cli", cli_task, 1, 0, SCHED_PRIO_LOWEST);
+
+    sched_run();
+}
@@ -0,0 +1,66 @@
+/** 
+ * @file perf.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-08
+ * @brief Implementation of the cycle counter profiling zones
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+#include "perf.h"
+
+#define PERF_ZONE_NAME(zone, name) name,
+static const char *g_perf_zone_names[PERF_NUM_ZONES] = {
+    PERF_ZONE_LIST(PERF_ZONE_NAME)
+};
+#undef PERF_ZONE_NAME
+
+static perf_stats_t g_perf_stats[PERF_NUM_ZONES];
+
+void perf_init(void) {
+#if defined(__arm__)
+    dwt_enable_cycle_counter();
+#endif
+    perf_reset();
+}
+
+void perf_record(perf_zone_t zone, uint32_t cycles) {
+    perf_stats_t *stats = &g_perf_stats[zone];
+
+    if (stats->count == 0 || cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max) {
+        stats->max = cycles;
+    }
+    stats->count++;
+    stats->total += cycles;
+
+    int bucket = (cycles == 0) ? 0 : 31 - __builtin_clz(cycles);
+    if (bucket >= PERF_HIST_BUCKETS) {
+        bucket = PERF_HIST_BUCKETS - 1;
+    }
+    stats->hist[bucket]++;
+}
+
+void perf_reset(void) {
+    // Zones are recorded from interrupts, none may be left half cleared
+    CM_ATOMIC_BLOCK() {
+        memset(g_perf_stats, 0, sizeof(g_perf_stats));
+    }
+}
+
+void perf_get_stats(perf_zone_t zone, perf_stats_t *stats) {
+    CM_ATOMIC_BLOCK() {
+        *stats = g_perf_stats[zone];
+    }
+}
+
+const char *perf_zone_name(perf_zone_t zone) {
+    return g_perf_zone_names[zone];
+}
@@ -0,0 +1,183 @@
+/** 
+ * @file phase.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-17
+ * @brief Implementation of the flight phase state machine
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "acq.h"
+#include "altitude.h"
+#include "history.h"
+#include "slog.h"
+
+#include "phase.h"
+
+/// A condition that has to last before it counts
+typedef struct {
+    bool active;
+    uint32_t since_ms;
+} phase_hold_t;
+
+/// Sensor rates, logging dividers (imu, mag, baro) and accelerometer
+/// attitude correction of each phase. Thrust and drag hide gravity from the
+/// accelerometer from launch until the parachute is out.
+///
+/// The mag rate only applies with the magnetometer on I2C 1. With
+/// MAG_VIA_IMU_HUB (the board default) the LIS2MDL stays at 100 Hz and the
+/// sensor hub reads it at the IMU rate / LSM6DS3_HUB_DEC: 52 Hz on the pad,
+/// 208 Hz in boost and apogee, 104 Hz in coast, 26 Hz in descent and 3 Hz
+/// landed.
+static const acq_config_t g_phase_config[PHASE_COUNT] = {
+    // Only the history ring is filled, it covers about a second (0.8 s with
+    // the mag on the sensor hub)
+    [PHASE_PAD] = {
+        LSM6DS3_ODR_416HZ, LIS2MDL_ODR_10HZ, BMP588_ODR_10HZ, { 1, 1, 1 }, true,
+    },
+    [PHASE_BOOST] = {
+        LSM6DS3_ODR_1666HZ, LIS2MDL_ODR_100HZ, BMP588_ODR_50HZ, { 1, 1, 1 }, false,
+    },
+    [PHASE_COAST] = {
+        LSM6DS3_ODR_833HZ, LIS2MDL_ODR_100HZ, BMP588_ODR_50HZ, { 1, 1, 1 }, false,
+    },
+    // Deployment shocks
+    [PHASE_APOGEE] = {
+        LSM6DS3_ODR_1666HZ, LIS2MDL_ODR_100HZ, BMP588_ODR_50HZ, { 1, 1, 1 }, false,
+    },
+    [PHASE_DESCENT] = {
+        LSM6DS3_ODR_208HZ, LIS2MDL_ODR_20HZ, BMP588_ODR_25HZ, { 1, 1, 1 }, true,
+    },
+    // Keep the attitude and altitude going for the shell, log nothing
+    [PHASE_LANDED] = {
+        LSM6DS3_ODR_26HZ, LIS2MDL_ODR_10HZ, BMP588_ODR_5HZ, { 0, 0, 0 }, true,
+    },
+};
+
+static const char *g_phase_names[PHASE_COUNT] = {
+    [PHASE_PAD] = "pad",
+    [PHASE_BOOST] = "boost",
+    [PHASE_COAST] = "coast",
+    [PHASE_APOGEE] = "apogee",
+    [PHASE_DESCENT] = "descent",
+    [PHASE_LANDED] = "landed",
+};
+
+static phase_t g_phase = PHASE_PAD;
+static uint32_t g_phase_since_ms = 0;
+
+/// The condition that moves on from the current phase
+static phase_hold_t g_hold;
+
+/** 
+ * @brief Track a condition with hysteresis
+ * @param hold the condition state
+ * @param set true if the start threshold is crossed
+ * @param reset true if the reset threshold is crossed
+ * @param now_ms the current time
+ * @param hold_ms the time the condition must last
+ * 
+ * @return true once the condition has lasted hold_ms
+ */
+static bool phase_held(phase_hold_t *hold, bool set, bool reset, uint32_t now_ms, uint32_t hold_ms) {
+    if (reset) {
+        hold->active = false;
+    } else if (set && !hold->active) {
+        hold->active = true;
+        hold->since_ms = now_ms;
+    }
+
+    return hold->active && now_ms - hold->since_ms >= hold_ms;
+}
+
+/** 
+ * @brief Move to a phase and apply its rates
+ * @param phase the new phase
+ * @param now_ms the current time
+ * 
+ */
+static void phase_enter(phase_t phase, uint32_t now_ms) {
+    g_phase = phase;
+    g_phase_since_ms = now_ms;
+    g_hold.active = false;
+    SLOG(SLOG_PHASE, phase, now_ms);
+
+    acq_configure(&g_phase_config[phase]);
+
+    if (phase == PHASE_BOOST) {
+        history_trigger();
+    } else if (phase == PHASE_LANDED) {
+        history_stop();
+    }
+}
+
+void phase_init(void) {
+    g_hold.active = false;
+    g_phase = PHASE_PAD;
+    g_phase_since_ms = 0;
+    acq_configure(&g_phase_config[PHASE_PAD]);
+    history_arm();
+}
+
+void phase_update(float accel_up, uint32_t now_ms) {
+    alt_state_t alt;
+    alt_get_state(&alt);
+    float speed = alt.velocity < 0 ? -alt.velocity : alt.velocity;
+
+    switch (g_phase) {
+    case PHASE_PAD:
+        // A slow motor may never reach the launch acceleration but it will
+        // arm the apogee detector
+        if (phase_held(&g_hold, accel_up > PHASE_LAUNCH_ACCEL, accel_up < PHASE_LAUNCH_RESET_ACCEL,
+                       now_ms, PHASE_LAUNCH_HOLD_MS) || alt.armed) {
+            phase_enter(PHASE_BOOST, now_ms);
+        }
+        break;
+
+    case PHASE_BOOST:
+        if (alt.apogee) {
+            phase_enter(PHASE_APOGEE, now_ms);
+        } else if (phase_held(&g_hold, accel_up < PHASE_BURNOUT_ACCEL, accel_up > PHASE_BURNOUT_RESET_ACCEL,
+                              now_ms, PHASE_BURNOUT_HOLD_MS)) {
+            phase_enter(PHASE_COAST, now_ms);
+        }
+        break;
+
+    case PHASE_COAST:
+        if (alt.apogee) {
+            phase_enter(PHASE_APOGEE, now_ms);
+        }
+        break;
+
+    case PHASE_APOGEE:
+        if (now_ms - g_phase_since_ms >= PHASE_APOGEE_MS) {
+            phase_enter(PHASE_DESCENT, now_ms);
+        }
+        break;
+
+    case PHASE_DESCENT:
+        if (phase_held(&g_hold, speed < PHASE_LANDED_VELOCITY, speed > PHASE_LANDED_RESET_VELOCITY,
+                       now_ms, PHASE_LANDED_HOLD_MS)) {
+            phase_enter(PHASE_LANDED, now_ms);
+        }
+        break;
+
+    case PHASE_LANDED:
+    case PHASE_COUNT:
+        break;
+    }
+}
+
+phase_t phase_get(void) {
+    return g_phase;
+}
+
+uint32_t phase_since_ms(void) {
+    return g_phase_since_ms;
+}
+
+const char *phase_name(phase_t phase) {
+    return g_phase_names[phase];
+}
@@ -0,0 +1,179 @@
+/** 
+ * @file sched.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-06
+ * @brief Implementation of the cooperative task scheduler
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+#include "timebase.h"
+
+#include "sched.h"
+
+#if defined(__arm__)
+#define SCHED_WAIT() __asm__ volatile ("wfi")
+#else
+#define SCHED_WAIT() sched_host_wait()
+#endif
+
+/// Task times are kept in us, the low 32 bits of the timebase
+typedef struct {
+    sched_task_fn_t fn;
+    bool active;
+    uint8_t priority;
+    uint32_t period;            ///< 0 for a one shot task
+    uint32_t deadline;          ///< Relative to the release
+    uint32_t release;           ///< Time the next run is due
+    sched_stats_t stats;
+} sched_task_t;
+
+static sched_task_t g_tasks[SCHED_MAX_TASKS];
+static int g_task_count = 0;
+
+/** 
+ * @brief Check if time a is before time b allowing for wrap around
+ */
+static inline bool sched_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+/** 
+ * @brief Get the time the tasks are released on
+ * 
+ * @return the time in us
+ */
+static inline uint32_t sched_now_us(void) {
+    return (uint32_t)timebase_now_us();
+}
+
+/** 
+ * @brief Find the task to run next
+ * @param now the time in us
+ * 
+ * @return the ready task with the highest priority then earliest deadline,
+ * or NULL if none are ready
+ */
+static sched_task_t *sched_pick(uint32_t now) {
+    sched_task_t *next = NULL;
+
+    for (int i = 0; i < g_task_count; i++) {
+        sched_task_t *task = &g_tasks[i];
+        if (!task->active || sched_before(now, task->release)) {
+            continue;
+        }
+        if (next == NULL || task->priority < next->priority
+            || (task->priority == next->priority
+                && sched_before(task->release + task->deadline, next->release + next->deadline))) {
+            next = task;
+        }
+    }
+    return next;
+}
+
+/** 
+ * @brief Add a task to the table, times are in ms
+ * 
+ * @return the task id or -1 if there is no room
+ */
+static int sched_add(const char *name, sched_task_fn_t fn, uint32_t delay, uint32_t period, uint32_t deadline, uint8_t priority) {
+    if (g_task_count == SCHED_MAX_TASKS) {
+        return -1;
+    }
+
+    sched_task_t *task = &g_tasks[g_task_count];
+    task->fn = fn;
+    task->priority = priority;
+    task->period = period * 1000;
+    task->deadline = (deadline ? deadline : period) * 1000;
+    // On the millisecond grid so releases line up with the SysTick that wakes the idle loop
+    task->release = sched_now() * 1000 + delay * 1000;
+    task->stats = (sched_stats_t){ .name = name };
+    task->active = true;
+
+    return g_task_count++;
+}
+
+void sched_init(void) {
+    g_task_count = 0;
+}
+
+int sched_add_periodic(const char *name, sched_task_fn_t fn, uint32_t period, uint32_t deadline, uint8_t priority) {
+    return sched_add(name, fn, 0, period, deadline, priority);
+}
+
+int sched_add_oneshot(const char *name, sched_task_fn_t fn, uint32_t delay, uint32_t deadline, uint8_t priority) {
+    return sched_add(name, fn, delay, 0, deadline, priority);
+}
+
+void sched_cancel(int id) {
+    if (id >= 0 && id < g_task_count) {
+        g_tasks[id].active = false;
+    }
+}
+
+void sched_run(void) {
+    while (1) {
+        uint32_t now = sched_now_us();
+        sched_task_t *next = sched_pick(now);
+
+        if (next == NULL) {
+            // Look again with interrupts masked, a release from a tick
+            // after the scan would otherwise be slept through until the
+            // next one. A masked interrupt still wakes the wfi and runs as
+            // soon as interrupts are enabled again.
+            cm_disable_interrupts();
+            if (sched_pick(sched_now_us()) == NULL) {
+                SCHED_WAIT();
+            }
+            cm_enable_interrupts();
+            continue;
+        }
+
+        uint32_t latency = now - next->release;
+        if (latency > next->stats.max_latency) {
+            next->stats.max_latency = latency;
+        }
+
+        next->fn();
+
+        uint32_t end = sched_now_us();
+        if (end - now > next->stats.max_runtime) {
+            next->stats.max_runtime = end - now;
+        }
+        if (sched_before(next->release + next->deadline, end)) {
+            next->stats.overruns++;
+        }
+        next->stats.runs++;
+
+        if (next->period == 0) {
+            next->active = false;
+            continue;
+        }
+
+        // Release on the period grid so there is no drift, skipping any
+        // releases that were missed entirely
+        next->release += next->period;
+        while (sched_before(next->release + next->period, end)) {
+            next->release += next->period;
+            next->stats.overruns++;
+        }
+    }
+}
+
+uint32_t sched_now(void) {
+    return timebase_now_ms();
+}
+
+bool sched_get_stats(int id, sched_stats_t *stats) {
+    if (id < 0 || id >= g_task_count) {
+        return false;
+    }
+    *stats = g_tasks[id].stats;
+    return true;
+}
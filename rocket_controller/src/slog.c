@@ -0,0 +1,150 @@
+/** 
+ * @file slog.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-21
+ * @brief Implementation of the deferred format system log
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <libopencm3/cm3/cortex.h>
+
+#include "CBUF.h"
+
+#include "frame.h"
+#include "flight_log.h"
+#include "fmt.h"
+#include "telem.h"
+#include "timebase.h"
+
+#include "slog.h"
+
+typedef struct {
+	volatile	uint16_t	m_get_idx;
+	volatile	uint16_t	m_put_idx;
+				slog_rec_t	m_entry[SLOG_LEN];	// Size must be a power of 2
+} slog_buf_t;
+
+static slog_buf_t g_slog;
+
+static uint16_t g_slog_seq = 0;
+
+/// The next message to copy into the flight log
+static uint16_t g_slog_spill_idx = 0;
+
+static slog_stats_t g_slog_stats;
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    uint32_t time_us = (uint32_t)timebase_now_us();
+
+    CM_ATOMIC_BLOCK() {
+        // The newest messages matter most
+        if (CBUF_IsFull(g_slog)) {
+            CBUF_AdvancePopIdx(g_slog);
+            g_slog_stats.lost++;
+        }
+
+        slog_rec_t *rec = CBUF_GetPushEntryPtr(g_slog);
+        rec->time_us = time_us;
+        rec->id = id;
+        rec->seq = g_slog_seq++;
+        rec->args[0] = a0;
+        rec->args[1] = a1;
+        rec->args[2] = a2;
+        CBUF_AdvancePushIdx(g_slog);
+        g_slog_stats.writes++;
+    }
+}
+
+bool slog_read(uint16_t *idx, slog_rec_t *rec) {
+    bool found = false;
+
+    CM_ATOMIC_BLOCK() {
+        if ((int16_t)(*idx - g_slog.m_get_idx) < 0) {
+            *idx = g_slog.m_get_idx;
+        }
+        if (*idx != g_slog.m_put_idx) {
+            *rec = g_slog.m_entry[*idx & CBUF_Mask(g_slog)];
+            found = true;
+        }
+    }
+    return found;
+}
+
+void slog_service(void) {
+    uint8_t frame[FRAME_MAX_SIZE(sizeof(slog_rec_t))];
+    slog_rec_t rec;
+
+    if (!flight_log_recording()) {
+        return;
+    }
+
+    while (slog_read(&g_slog_spill_idx, &rec)) {
+        int nargs = slog_nargs(rec.id);
+        size_t len = SLOG_REC_LEN(nargs > 0 ? nargs : 0);
+        size_t frame_len = frame_encode(TELEM_REC_SYSLOG, &rec, len, frame);
+
+        // Frames go in whole or not at all, as in history_service()
+        if (flight_log_space() < frame_len) {
+            break;
+        }
+        flight_log_write(frame, frame_len);
+        g_slog_spill_idx++;
+        g_slog_stats.spilled++;
+    }
+}
+
+void slog_reader_init(slog_reader_t *reader) {
+    CM_ATOMIC_BLOCK() {
+        reader->idx = g_slog.m_get_idx;
+        reader->end = g_slog.m_put_idx;
+    }
+    reader->line_len = 0;
+    reader->line_pos = 0;
+}
+
+int slog_read_chunk(void *ctx, uint32_t offset, uint8_t *buf, size_t len) {
+    slog_reader_t *reader = ctx;
+    size_t n = 0;
+    (void)offset;
+
+    while (n < len) {
+        if (reader->line_pos == reader->line_len) {
+            // Messages that arrive while reading are left for next time
+            slog_rec_t rec;
+            if ((int16_t)(reader->idx - reader->end) >= 0 || !slog_read(&reader->idx, &rec)) {
+                break;
+            }
+            reader->idx++;
+
+            // The line ending always fits, the text is cut short instead
+            size_t line_len = fmt_snprintf(reader->line, sizeof(reader->line), "[%5u.%06u] ",
+                                           (unsigned)(rec.time_us / 1000000), (unsigned)(rec.time_us % 1000000));
+            line_len += slog_format(&rec, sizeof(rec), &reader->line[line_len], sizeof(reader->line) - 2 - line_len);
+            reader->line[line_len++] = '\r';
+            reader->line[line_len++] = '\n';
+            reader->line_len = line_len;
+            reader->line_pos = 0;
+        }
+
+        size_t chunk = reader->line_len - reader->line_pos;
+        if (chunk > len - n) {
+            chunk = len - n;
+        }
+        memcpy(&buf[n], &reader->line[reader->line_pos], chunk);
+        reader->line_pos += chunk;
+        n += chunk;
+    }
+
+    return n;
+}
+
+void slog_get_stats(slog_stats_t *stats) {
+    CM_ATOMIC_BLOCK() {
+        *stats = g_slog_stats;
+    }
+}
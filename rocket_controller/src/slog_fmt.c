@@ -0,0 +1,51 @@
+/** 
+ * @file slog_fmt.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-21
+ * @brief Formatting of the system log messages
+ *
+ * This file has no hardware dependencies so it is shared with the host tools.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "slog.h"
+
+#define SLOG_MSG_NARGS(id, nargs, format) [id] = nargs,
+static const uint8_t g_slog_nargs[SLOG_NUM_MSGS] = {
+    SLOG_MSG_LIST(SLOG_MSG_NARGS)
+};
+#undef SLOG_MSG_NARGS
+
+#define SLOG_MSG_FORMAT(id, nargs, format) [id] = format,
+static const char *const g_slog_formats[SLOG_NUM_MSGS] = {
+    SLOG_MSG_LIST(SLOG_MSG_FORMAT)
+};
+#undef SLOG_MSG_FORMAT
+
+int slog_nargs(uint16_t id) {
+    return (id < SLOG_NUM_MSGS) ? g_slog_nargs[id] : -1;
+}
+
+size_t slog_format(const slog_rec_t *rec, size_t len, char *buf, size_t size) {
+    int nargs = slog_nargs(rec->id);
+
+    // Arguments past the end of a short message read as 0
+    uint32_t args[SLOG_MAX_ARGS] = { 0 };
+    if (len > sizeof(*rec)) {
+        len = sizeof(*rec);
+    }
+    if (len > SLOG_REC_LEN(0)) {
+        memcpy(args, (const uint8_t *)rec + SLOG_REC_LEN(0), len - SLOG_REC_LEN(0));
+    }
+
+    if (nargs < 0 || len < SLOG_REC_LEN(nargs)) {
+        return fmt_snprintf(buf, size, "unknown message %u", (unsigned)rec->id);
+    }
+    return fmt_snprintf(buf, size, g_slog_formats[rec->id], (int)args[0], (int)args[1], (int)args[2]);
+}
@@ -0,0 +1,148 @@
+/** 
+ * @file spi1_dma.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-10
+ * @brief Implementation of the SPI 1 register and DMA burst layer
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/spi.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/cm3/nvic.h>
+
+#include "board.h"
+
+#include "spi1_dma.h"
+
+/// SPI 1 uses DMA 1 channel 2 for receive and channel 3 for transmit
+#define SPI1_DMA_RX DMA_CHANNEL2
+#define SPI1_DMA_TX DMA_CHANNEL3
+
+#define SPI1_READ 0x80
+
+static volatile bool g_busy = false;
+static spi1_dma_done_cb_t g_done = NULL;
+
+/// Clocked out for every byte of a burst read
+static const uint8_t g_dummy = 0;
+
+static inline void spi1_select(void) {
+    gpio_clear(IMU_CS_PORT, IMU_CS_PIN);
+}
+
+static inline void spi1_deselect(void) {
+    while (SPI_SR(IMU_SPI) & SPI_SR_BSY);
+    gpio_set(IMU_CS_PORT, IMU_CS_PIN);
+}
+
+void spi1_dma_init(void) {
+    rcc_periph_clock_enable(RCC_GPIOA);
+    rcc_periph_clock_enable(RCC_AFIO);
+    rcc_periph_clock_enable(RCC_SPI1);
+    rcc_periph_clock_enable(RCC_DMA1);
+
+    gpio_set(IMU_CS_PORT, IMU_CS_PIN);
+    gpio_set_mode(IMU_CS_PORT, GPIO_MODE_OUTPUT_50_MHZ,
+                  GPIO_CNF_OUTPUT_PUSHPULL, IMU_CS_PIN);
+    gpio_set_mode(GPIOA, GPIO_MODE_OUTPUT_50_MHZ,
+                  GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, GPIO_SPI1_SCK | GPIO_SPI1_MOSI);
+    gpio_set_mode(GPIOA, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, GPIO_SPI1_MISO);
+
+    // APB2 is 72 MHz so this runs at 9 MHz (the LSM6DS3 maximum is 10), mode 3
+    spi_reset(IMU_SPI);
+    spi_init_master(IMU_SPI, SPI_CR1_BAUDRATE_FPCLK_DIV_8,
+                    SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE, SPI_CR1_CPHA_CLK_TRANSITION_2,
+                    SPI_CR1_DFF_8BIT, SPI_CR1_MSBFIRST);
+    spi_enable_software_slave_management(IMU_SPI);
+    spi_set_nss_high(IMU_SPI);
+    spi_enable(IMU_SPI);
+
+    nvic_set_priority(NVIC_DMA1_CHANNEL2_IRQ, 1 << 4);
+    nvic_enable_irq(NVIC_DMA1_CHANNEL2_IRQ);
+}
+
+void spi1_write_reg(uint8_t reg, uint8_t val) {
+    spi1_select();
+    spi_xfer(IMU_SPI, reg);
+    spi_xfer(IMU_SPI, val);
+    spi1_deselect();
+}
+
+uint8_t spi1_read_reg(uint8_t reg) {
+    spi1_select();
+    spi_xfer(IMU_SPI, reg | SPI1_READ);
+    uint8_t val = spi_xfer(IMU_SPI, 0);
+    spi1_deselect();
+
+    return val;
+}
+
+bool spi1_dma_read(uint8_t reg, uint8_t *buf, size_t len, spi1_dma_done_cb_t done) {
+    if (g_busy || len == 0) {
+        return false;
+    }
+    g_busy = true;
+    g_done = done;
+
+    // The address byte is sent by hand, which also leaves RXNE clear
+    spi1_select();
+    spi_xfer(IMU_SPI, reg | SPI1_READ);
+
+    dma_channel_reset(DMA1, SPI1_DMA_RX);
+    dma_set_peripheral_address(DMA1, SPI1_DMA_RX, (uint32_t)&SPI_DR(IMU_SPI));
+    dma_set_memory_address(DMA1, SPI1_DMA_RX, (uint32_t)buf);
+    dma_set_number_of_data(DMA1, SPI1_DMA_RX, len);
+    dma_set_read_from_peripheral(DMA1, SPI1_DMA_RX);
+    dma_enable_memory_increment_mode(DMA1, SPI1_DMA_RX);
+    dma_set_peripheral_size(DMA1, SPI1_DMA_RX, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, SPI1_DMA_RX, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, SPI1_DMA_RX, DMA_CCR_PL_VERY_HIGH);
+    dma_enable_transfer_complete_interrupt(DMA1, SPI1_DMA_RX);
+
+    dma_channel_reset(DMA1, SPI1_DMA_TX);
+    dma_set_peripheral_address(DMA1, SPI1_DMA_TX, (uint32_t)&SPI_DR(IMU_SPI));
+    dma_set_memory_address(DMA1, SPI1_DMA_TX, (uint32_t)&g_dummy);
+    dma_set_number_of_data(DMA1, SPI1_DMA_TX, len);
+    dma_set_read_from_memory(DMA1, SPI1_DMA_TX);
+    dma_disable_memory_increment_mode(DMA1, SPI1_DMA_TX);
+    dma_set_peripheral_size(DMA1, SPI1_DMA_TX, DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(DMA1, SPI1_DMA_TX, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(DMA1, SPI1_DMA_TX, DMA_CCR_PL_HIGH);
+
+    // Receive is armed first so no byte can be missed
+    dma_enable_channel(DMA1, SPI1_DMA_RX);
+    spi_enable_rx_dma(IMU_SPI);
+    dma_enable_channel(DMA1, SPI1_DMA_TX);
+    spi_enable_tx_dma(IMU_SPI);
+
+    return true;
+}
+
+bool spi1_dma_busy(void) {
+    return g_busy;
+}
+
+/** 
+ * @brief SPI 1 receive complete, the last byte has been clocked in
+ * 
+ */
+void dma1_channel2_isr(void) {
+    dma_clear_interrupt_flags(DMA1, SPI1_DMA_RX, DMA_TCIF);
+
+    spi_disable_tx_dma(IMU_SPI);
+    spi_disable_rx_dma(IMU_SPI);
+    dma_disable_channel(DMA1, SPI1_DMA_TX);
+    dma_disable_channel(DMA1, SPI1_DMA_RX);
+    spi1_deselect();
+
+    g_busy = false;
+    if (g_done != NULL) {
+        g_done();
+    }
+}
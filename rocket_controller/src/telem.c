@@ -0,0 +1,43 @@
+/** 
+ * @file telem.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Implementation of the binary telemetry stream
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "usb_cdc.h"
+#include "frame.h"
+
+#include "telem.h"
+
+/// Largest record that is sent on the telemetry port
+#define TELEM_MAX_RECORD 32
+
+/// Number of records that could not be sent
+static uint32_t g_telem_dropped = 0;
+
+bool telem_send(telem_rec_type_t type, const void *rec, size_t len) {
+    uint8_t frame[FRAME_MAX_SIZE(TELEM_MAX_RECORD)];
+
+    if (len > TELEM_MAX_RECORD || !usb_cdc_port_connected(USB_CDC_PORT_TELEM)) {
+        g_telem_dropped++;
+        return false;
+    }
+
+    size_t frame_len = frame_encode(type, rec, len, frame);
+    if (usb_cdc_port_write_space(USB_CDC_PORT_TELEM) < frame_len) {
+        g_telem_dropped++;
+        return false;
+    }
+
+    usb_cdc_port_write(USB_CDC_PORT_TELEM, frame, frame_len);
+    return true;
+}
+
+uint32_t telem_get_dropped(void) {
+    return g_telem_dropped;
+}
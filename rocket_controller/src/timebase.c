@@ -0,0 +1,76 @@
+/** 
+ * @file timebase.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-09
+ * @brief Implementation of the monotonic microsecond clock
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/cm3/systick.h>
+#include <libopencm3/cm3/scb.h>
+
+#include "timebase.h"
+
+/// Milliseconds since boot, the high word only changes when the low word wraps
+static volatile uint32_t g_ms_lo = 0;
+static volatile uint32_t g_ms_hi = 0;
+
+/// SysTick reload value and counts per microsecond
+static uint32_t g_reload = 0;
+static uint32_t g_ticks_per_us = 1;
+
+/** 
+ * @brief System tick handler, runs every ms
+ * 
+ */
+void sys_tick_handler(void) {
+    uint32_t lo = g_ms_lo + 1;
+    if (lo == 0) {
+        g_ms_hi++;
+    }
+    // Written last so a reader that sees the same low word twice has a
+    // consistent high word
+    g_ms_lo = lo;
+}
+
+void timebase_init(void) {
+    g_ticks_per_us = rcc_ahb_frequency / 1000000;
+    g_reload = rcc_ahb_frequency / 1000 - 1;
+
+    systick_set_clocksource(STK_CSR_CLKSOURCE_AHB);
+    systick_set_reload(g_reload);
+    systick_interrupt_enable();
+    systick_counter_enable();
+}
+
+uint64_t timebase_now_us(void) {
+    uint32_t lo, hi, val, val2;
+    bool pending;
+
+    // Retry if the tick handler ran or the counter reloaded part way through
+    do {
+        lo = g_ms_lo;
+        hi = g_ms_hi;
+        val = STK_CVR;
+        pending = SCB_ICSR & SCB_ICSR_PENDSTSET;
+        val2 = STK_CVR;
+    } while (lo != g_ms_lo || val2 > val);
+
+    uint64_t ms = ((uint64_t)hi << 32) | lo;
+
+    // Called from an interrupt that is blocking the tick handler: the
+    // counter has reloaded but the millisecond has not been counted yet
+    if (pending) {
+        ms++;
+    }
+
+    return ms * 1000 + (g_reload - val) / g_ticks_per_us;
+}
+
+uint32_t timebase_now_ms(void) {
+    return g_ms_lo;
+}
@@ -11,7 +11,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
-#include <stdarg.h>
+#include <string.h>
 
 #include <libopencm3/usb/usbd.h>
 #include <libopencm3/usb/cdc.h>
@@ -21,22 +21,83 @@
 
 #include "usb_cdc_desc.h"
 #include "usb_cdc.h"
+#include "perf.h"
 
 typedef struct {
 	volatile	uint16_t	m_get_idx;
 	volatile	uint16_t	m_put_idx;
 				uint8_t		m_entry[1024];	// Size must be a power of 2
-} buf_t;
+} tx_buf_t;
 
-/// Buffers to store data to send and receive
-static buf_t	usb_serial_rx_buf;
-static buf_t	usb_serial_tx_buf;
+typedef struct {
+	volatile	uint16_t	m_get_idx;
+	volatile	uint16_t	m_put_idx;
+				uint8_t		m_entry[256];	// Size must be a power of 2
+} rx_buf_t;
+
+/// State for one CDC-ACM function of the composite device
+typedef struct {
+	/// Buffers to store data to send and receive
+	rx_buf_t			rx_buf;
+	tx_buf_t			tx_buf;
+
+	/// End point addresses
+	uint8_t				ep_out;
+	uint8_t				ep_in;
+	uint8_t				ep_notif;
+
+	/// Communication interface number, control requests are routed on it
+	uint8_t				comm_iface;
 
-/// true if need to send an empty usb packet to flush system 
-static bool   	usb_serial_need_empty_tx = false;
+	/// Flag high when the host has the port open
+	bool				is_connected;
 
-/// Flag high when usb is connected
-static bool g_usbd_is_connected = false;
+	/// true if need to send an empty usb packet to flush system 
+	bool				need_empty_tx;
+
+	/// true while the OUT end point is NAKed because the rx ring is nearly full
+	volatile bool		rx_paused;
+
+	/// true while a packet is loaded into the IN end point waiting for the host
+	volatile bool		tx_busy;
+
+	/// Throughput counters for the tx engine
+	usb_cdc_stats_t		stats;
+
+	/// Number of packets sent since the last start of frame
+	uint16_t			frame_packets;
+} cdc_port_t;
+
+/// Free space needed in the rx ring before the OUT end point is re-armed
+#define USB_CDC_RX_RESUME_SPACE (2 * 64)
+
+/// The end points and interface of a port
+typedef struct {
+	uint8_t				ep_out;
+	uint8_t				ep_in;
+	uint8_t				ep_notif;
+	uint8_t				comm_iface;
+} cdc_port_cfg_t;
+
+/// The end points and interfaces, must match usb_cdc_desc.h
+static const cdc_port_cfg_t g_cdc_port_cfgs[USB_CDC_NUM_PORTS] = {
+	[USB_CDC_PORT_SHELL] = {
+		.ep_out = SHELL_EP_OUT,
+		.ep_in = SHELL_EP_IN,
+		.ep_notif = SHELL_EP_NOTIF,
+		.comm_iface = SHELL_COMM_IFACE,
+	},
+	[USB_CDC_PORT_TELEM] = {
+		.ep_out = TELEM_EP_OUT,
+		.ep_in = TELEM_EP_IN,
+		.ep_notif = TELEM_EP_NOTIF,
+		.comm_iface = TELEM_COMM_IFACE,
+	},
+};
+
+/// The ports, zero initialised so the rings stay out of .data, the end
+/// points are copied in by usb_cdc_init()
+static cdc_port_t g_cdc_ports[USB_CDC_NUM_PORTS];
 
 /// Buffer to be used for control requests
 static uint8_t g_usbd_control_buffer[128];
@@ -51,6 +112,22 @@ static const struct usb_cdc_line_coding line_coding = {
 	.bDataBits = 0x08
 };
 
+/** 
+ * @brief Find the port that owns an end point
+ * @param ep the end point number (direction bit is ignored)
+ * 
+ * @return the port
+ */
+static cdc_port_t *cdcacm_port_from_ep(uint8_t ep) {
+	ep &= 0x7f;
+	for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+		if ((g_cdc_ports[i].ep_out & 0x7f) == ep || (g_cdc_ports[i].ep_in & 0x7f) == ep) {
+			return &g_cdc_ports[i];
+		}
+	}
+	return &g_cdc_ports[USB_CDC_PORT_SHELL];
+}
+
 /**
  * @brief Process the control requests from the usb end point
  * @param usbd_dev the usb device
@@ -69,7 +146,11 @@ static enum usbd_request_return_codes cdcacm_control_request(usbd_device* usbd_d
     switch (req->bRequest) {
     case USB_CDC_REQ_SET_CONTROL_LINE_STATE: {
         uint16_t rtsdtr = req->wValue;	// DTR is bit 0, RTS is bit 1
-        g_usbd_is_connected = rtsdtr & 1;
+        for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+            if (g_cdc_ports[i].comm_iface == req->wIndex) {
+                g_cdc_ports[i].is_connected = rtsdtr & 1;
+            }
+        }
 
         /*
          * This Linux cdc_acm driver requires this to be implemented
@@ -83,7 +164,7 @@ static enum usbd_request_return_codes cdcacm_control_request(usbd_device* usbd_d
         notif->bmRequestType = 0xA1;
         notif->bNotification = USB_CDC_NOTIFY_SERIAL_STATE;
         notif->wValue = 0;
-        notif->wIndex = 0;
+        notif->wIndex = req->wIndex;
         notif->wLength = 2;
         local_buf[8] = req->wValue & 3;
         local_buf[9] = 0;
@@ -108,62 +189,148 @@ static enum usbd_request_return_codes cdcacm_control_request(usbd_device* usbd_d
  * 
  */
 static void cdcacm_data_rx_cb(usbd_device *usbd_dev, uint8_t ep) {
-	uint16_t space = CBUF_ContigSpace(usb_serial_rx_buf);
+	cdc_port_t *port = cdcacm_port_from_ep(ep);
+
+	// The end point is only armed while there is room for a whole packet so
+	// nothing is ever dropped. If this packet could leave less room than that
+	// keep NAKing the host until the consumer has drained the ring.
+	if (CBUF_Space(port->rx_buf) < USB_CDC_RX_RESUME_SPACE) {
+		usbd_ep_nak_set(usbd_dev, port->ep_out, 1);
+		port->rx_paused = true;
+	}
+
+	uint16_t space = CBUF_ContigSpace(port->rx_buf);
 	uint16_t len;
 	if (space >= 64) {
 		// We can read directly into our buffer
-		len = usbd_ep_read_packet(usbd_dev, ep, 
-								  CBUF_GetPushEntryPtr(usb_serial_rx_buf), 64);
-		CBUF_AdvancePushIdxBy(usb_serial_rx_buf, len);
+		len = usbd_ep_read_packet(usbd_dev, port->ep_out, 
+								  CBUF_GetPushEntryPtr(port->rx_buf), 64);
 	} else {
-		// Do it character by character. This covers 2 situations:
-		// 1 - We're near the end of the buffer (so free space isn't contiguous)
-		// 2 - We don't have much free space left.
-		char buf[64];
-		len = usbd_ep_read_packet(usbd_dev, ep, buf, 64);
-		for (int i = 0; i < len; i++) {
-			// If the Rx buffer fills, then we drop the new data.
-			if (CBUF_IsFull(usb_serial_rx_buf)) {
-				return;
-			}
-			CBUF_Push(usb_serial_rx_buf, buf[i]);
-		}
+		// We're near the end of the buffer so the free space isn't
+		// contiguous, split the packet across the wrap.
+		uint8_t buf[64];
+		len = usbd_ep_read_packet(usbd_dev, port->ep_out, buf, 64);
+		uint16_t first = (len < space) ? len : space;
+		memcpy(CBUF_GetPushEntryPtr(port->rx_buf), buf, first);
+		memcpy(port->rx_buf.m_entry, buf + first, len - first);
 	}
+	CBUF_AdvancePushIdxBy(port->rx_buf, len);
 }
 
+/** 
+ * @brief Re-arm the OUT end point once the consumer has made room for more
+ * packets
+ * @param port the port to check
+ * 
+ */
+static void cdcacm_rx_resume(cdc_port_t *port) {
+	if (!port->rx_paused || CBUF_Space(port->rx_buf) < USB_CDC_RX_RESUME_SPACE) {
+		return;
+	}
+
+	nvic_disable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
+	port->rx_paused = false;
+	usbd_ep_nak_set(g_usbd_device_cdc, port->ep_out, 0);
+	nvic_enable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
+}
 
 /** 
  * @brief USB on the go interrupt handler
  * 
  */
 void usb_lp_can_rx0_isr(void) {
+	PERF_ZONE_ENTER(PERF_ZONE_USB_ISR);
 	if (g_usbd_device_cdc) {
 		usbd_poll(g_usbd_device_cdc);
 	}
+	PERF_ZONE_EXIT(PERF_ZONE_USB_ISR);
 }
 
-static void cdcacm_sof_callback(void) {
-	if (!g_usbd_is_connected) {
-		// Host isn't connected - nothing to do.
-		return;
-	}
-
-	uint16_t len = CBUF_ContigLen(usb_serial_tx_buf);
-	if (len == 0 && !usb_serial_need_empty_tx) {
-		// Nothing to do.
+/** 
+ * @brief Queue the next packet from the tx buffer on the IN end point. Must
+ * only be called from the usb interrupt (or with it masked) and when the
+ * end point is not already busy.
+ * @param usbd_dev the usb device to send on
+ * @param port the port to send from
+ * 
+ */
+static void cdcacm_tx_next(usbd_device *usbd_dev, cdc_port_t *port) {
+	uint16_t len = CBUF_Len(port->tx_buf);
+	if (len == 0 && !port->need_empty_tx) {
+		// Nothing to do, the next SOF will restart the engine.
+		port->tx_busy = false;
 		return;
 	}
 	if (len > 64) {
 		len = 64;
 	}
-	uint8_t *pop_ptr = CBUF_GetPopEntryPtr(usb_serial_tx_buf);
-	uint16_t sent = usbd_ep_write_packet(g_usbd_device_cdc, 0x82, pop_ptr, len);
 
-	// If we just sent a packet of 64 bytes. If we get called again and
-	// there is no more data to send, then we need to send a zero byte
-	// packet to indicate to the host to release the data it has buffered.
-	usb_serial_need_empty_tx = (sent == 64);
-	CBUF_AdvancePopIdxBy(usb_serial_tx_buf, sent);
+	uint16_t contig = CBUF_ContigLen(port->tx_buf);
+	uint16_t sent;
+	if (contig >= len) {
+		// Send straight out of the ring
+		sent = usbd_ep_write_packet(usbd_dev, port->ep_in, 
+									CBUF_GetPopEntryPtr(port->tx_buf), len);
+	} else {
+		// The packet straddles the end of the ring so gather it into a full
+		// packet rather than sending a short one which ends the transfer.
+		uint8_t buf[64];
+		for (uint16_t i = 0; i < len; i++) {
+			buf[i] = CBUF_Get(port->tx_buf, i);
+		}
+		sent = usbd_ep_write_packet(usbd_dev, port->ep_in, buf, len);
+	}
+
+	// If we just sent a packet of 64 bytes and there is no more data to send
+	// next time, then we need to send a zero byte packet to indicate to the
+	// host to release the data it has buffered.
+	port->need_empty_tx = (sent == 64);
+	port->tx_busy = true;
+	CBUF_AdvancePopIdxBy(port->tx_buf, sent);
+
+	port->stats.tx_bytes += sent;
+	port->stats.tx_packets++;
+	port->frame_packets++;
+	if (port->frame_packets > port->stats.max_packets_per_frame) {
+		port->stats.max_packets_per_frame = port->frame_packets;
+	}
+}
+
+/** 
+ * @brief Called when the host has collected the last packet from the IN end
+ * point, keeps the end point busy back to back while there is data to send
+ * @param usbd_dev the device that generated the interrupt
+ * @param ep the endpoint that generated the interrupt
+ * 
+ */
+static void cdcacm_data_tx_cb(usbd_device *usbd_dev, uint8_t ep) {
+	cdc_port_t *port = cdcacm_port_from_ep(ep);
+
+	if (!port->is_connected) {
+		port->tx_busy = false;
+		return;
+	}
+	cdcacm_tx_next(usbd_dev, port);
+}
+
+/** 
+ * @brief Called at the start of every usb frame (1 ms), restarts the tx
+ * engines that have gone idle
+ * 
+ */
+static void cdcacm_sof_callback(void) {
+	for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+		cdc_port_t *port = &g_cdc_ports[i];
+		port->stats.frames++;
+		port->frame_packets = 0;
+
+		if (!port->is_connected || port->tx_busy) {
+			// Host isn't connected or the completion callback is still
+			// running the show - nothing to do.
+			continue;
+		}
+		cdcacm_tx_next(g_usbd_device_cdc, port);
+	}
 }
 
 /** 
@@ -176,9 +343,19 @@ static void cdcacm_set_config(usbd_device* usbd_dev, uint16_t wValue) {
     (void)wValue;
     (void)usbd_dev;
 
-    usbd_ep_setup(usbd_dev, 0x01, USB_ENDPOINT_ATTR_BULK, 64, cdcacm_data_rx_cb);
-    usbd_ep_setup(usbd_dev, 0x82, USB_ENDPOINT_ATTR_BULK, 64, NULL);
-    usbd_ep_setup(usbd_dev, 0x83, USB_ENDPOINT_ATTR_INTERRUPT, 16, NULL);
+    for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+        cdc_port_t *port = &g_cdc_ports[i];
+        port->tx_busy = false;
+        port->need_empty_tx = false;
+
+        usbd_ep_setup(usbd_dev, port->ep_out, USB_ENDPOINT_ATTR_BULK, 64, cdcacm_data_rx_cb);
+        usbd_ep_setup(usbd_dev, port->ep_in, USB_ENDPOINT_ATTR_BULK, 64, cdcacm_data_tx_cb);
+        usbd_ep_setup(usbd_dev, port->ep_notif, USB_ENDPOINT_ATTR_INTERRUPT, 16, NULL);
+
+        // Anything left in the rx ring from before the reset still counts
+        port->rx_paused = CBUF_Space(port->rx_buf) < USB_CDC_RX_RESUME_SPACE;
+        usbd_ep_nak_set(usbd_dev, port->ep_out, port->rx_paused);
+    }
 
     usbd_register_control_callback(
         usbd_dev,
@@ -190,6 +367,13 @@ static void cdcacm_set_config(usbd_device* usbd_dev, uint16_t wValue) {
 
 
 int usb_cdc_init(void) {
+    for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+        g_cdc_ports[i].ep_out = g_cdc_port_cfgs[i].ep_out;
+        g_cdc_ports[i].ep_in = g_cdc_port_cfgs[i].ep_in;
+        g_cdc_ports[i].ep_notif = g_cdc_port_cfgs[i].ep_notif;
+        g_cdc_ports[i].comm_iface = g_cdc_port_cfgs[i].comm_iface;
+    }
+
     g_usbd_device_cdc = usbd_init(&st_usbfs_v1_usb_driver, &dev, &config, 
                                 usb_strings, NUM_USB_STRINGS, 
                                 g_usbd_control_buffer, sizeof(g_usbd_control_buffer));
@@ -202,45 +386,133 @@ int usb_cdc_init(void) {
 
 }
 
+bool usb_cdc_port_connected(usb_cdc_port_t port) {
+    return g_cdc_ports[port].is_connected;
+}
+
+void usb_cdc_port_get_stats(usb_cdc_port_t port, usb_cdc_stats_t *stats) {
+	nvic_disable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
+	*stats = g_cdc_ports[port].stats;
+	nvic_enable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
+}
+
+size_t usb_cdc_port_read(usb_cdc_port_t port, void *buf, size_t len) {
+	cdc_port_t *p = &g_cdc_ports[port];
+	uint16_t avail = CBUF_Len(p->rx_buf);
+	if (len > avail) {
+		len = avail;
+	}
+
+	// Empty to the end of the ring then wrap around to the start
+	size_t first = CBUF_ContigLen(p->rx_buf);
+	if (first > len) {
+		first = len;
+	}
+	memcpy(buf, CBUF_GetPopEntryPtr(p->rx_buf), first);
+	memcpy((uint8_t *)buf + first, p->rx_buf.m_entry, len - first);
+
+	__asm__ volatile ("" ::: "memory");
+	CBUF_AdvancePopIdxBy(p->rx_buf, len);
+	cdcacm_rx_resume(p);
+	return len;
+}
+
+size_t usb_cdc_port_write(usb_cdc_port_t port, const void *data, size_t len) {
+	cdc_port_t *p = &g_cdc_ports[port];
+	uint16_t space = CBUF_Space(p->tx_buf);
+	if (len > space) {
+		len = space;
+	}
+
+	// The shell writes a character at a time, a memcpy() call costs more
+	if (len == 1) {
+		CBUF_Push(p->tx_buf, *(const uint8_t *)data);
+		return 1;
+	}
+
+	// Fill to the end of the ring then wrap around to the start
+	size_t first = CBUF_ContigSpace(p->tx_buf);
+	if (first > len) {
+		first = len;
+	}
+	memcpy(CBUF_GetPushEntryPtr(p->tx_buf), data, first);
+	if (len > first) {
+		memcpy(p->tx_buf.m_entry, (const uint8_t *)data + first, len - first);
+	}
+
+	// Data must be in the ring before the usb interrupt can see it
+	__asm__ volatile ("" ::: "memory");
+	CBUF_AdvancePushIdxBy(p->tx_buf, len);
+	return len;
+}
+
+uint8_t *usb_cdc_port_write_reserve(usb_cdc_port_t port, size_t *len) {
+	cdc_port_t *p = &g_cdc_ports[port];
+	*len = CBUF_ContigSpace(p->tx_buf);
+	if (*len == 0) {
+		return NULL;
+	}
+	return CBUF_GetPushEntryPtr(p->tx_buf);
+}
+
+void usb_cdc_port_write_commit(usb_cdc_port_t port, size_t len) {
+	__asm__ volatile ("" ::: "memory");
+	CBUF_AdvancePushIdxBy(g_cdc_ports[port].tx_buf, len);
+}
+
+size_t usb_cdc_port_write_space(usb_cdc_port_t port) {
+	return CBUF_Space(g_cdc_ports[port].tx_buf);
+}
+
 bool usb_cdc_connected(void) {
-    return g_usbd_is_connected;
+    return usb_cdc_port_connected(USB_CDC_PORT_SHELL);
+}
+
+void usb_cdc_get_stats(usb_cdc_stats_t *stats) {
+	usb_cdc_port_get_stats(USB_CDC_PORT_SHELL, stats);
 }
 
 uint16_t usb_cdc_avail(void) {
-	return CBUF_Len(usb_serial_rx_buf);
+	return CBUF_Len(g_cdc_ports[USB_CDC_PORT_SHELL].rx_buf);
 }
 
 int usb_cdc_recv_byte(void) {
-	if (CBUF_IsEmpty(usb_serial_rx_buf)) {
+	cdc_port_t *p = &g_cdc_ports[USB_CDC_PORT_SHELL];
+	if (CBUF_IsEmpty(p->rx_buf)) {
 		return -1;
 	}
-	return CBUF_Pop(usb_serial_rx_buf);
+	int ch = CBUF_Pop(p->rx_buf);
+	cdcacm_rx_resume(p);
+	return ch;
+}
+
+size_t usb_cdc_read(void *buf, size_t len) {
+	return usb_cdc_port_read(USB_CDC_PORT_SHELL, buf, len);
 }
 
 void usb_cdc_send_byte(uint8_t ch) {
-	if (!CBUF_IsFull(usb_serial_tx_buf)) {
-		CBUF_Push(usb_serial_tx_buf, ch);
+	cdc_port_t *p = &g_cdc_ports[USB_CDC_PORT_SHELL];
+	if (!CBUF_IsFull(p->tx_buf)) {
+		CBUF_Push(p->tx_buf, ch);
 	}
 }
 
 void usb_cdc_send_strn(const char *str, size_t len) {
-	for (const char *end = str + len; str < end; str++) {
-		usb_cdc_send_byte(*str);
-	}
+	usb_cdc_write(str, len);
 }
 
-static int usb_putc(void *out_param, int ch) {
-	(void)out_param;
-	if (ch == '\n') {
-		usb_cdc_send_byte('\r');
-	}
-	usb_cdc_send_byte(ch);
-	return 1;
+size_t usb_cdc_write(const void *data, size_t len) {
+	return usb_cdc_port_write(USB_CDC_PORT_SHELL, data, len);
+}
+
+uint8_t *usb_cdc_write_reserve(size_t *len) {
+	return usb_cdc_port_write_reserve(USB_CDC_PORT_SHELL, len);
 }
 
-// void usb_cdc_printf(const char *fmt, ...) {
-// 	va_list args;
-// 	va_start(args, fmt);
-// 	vStrXPrintf(usb_putc, NULL, fmt, args);
-// 	va_end(args);
-// }
\ No newline at end of file
+void usb_cdc_write_commit(size_t len) {
+	usb_cdc_port_write_commit(USB_CDC_PORT_SHELL, len);
+}
+
+size_t usb_cdc_write_space(void) {
+	return usb_cdc_port_write_space(USB_CDC_PORT_SHELL);
+}
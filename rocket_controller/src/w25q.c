@@ -0,0 +1,161 @@
+/** 
+ * @file w25q.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Implementation of the W25Q128JV SPI flash driver
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/spi.h>
+
+#include "board.h"
+
+#include "w25q.h"
+
+#define CMD_WRITE_ENABLE    0x06
+#define CMD_READ_STATUS1    0x05
+#define CMD_READ_DATA       0x03
+#define CMD_PAGE_PROGRAM    0x02
+#define CMD_SECTOR_ERASE    0x20
+#define CMD_BLOCK_ERASE     0xD8
+#define CMD_ERASE_SUSPEND   0x75
+#define CMD_ERASE_RESUME    0x7A
+#define CMD_RELEASE_PD      0xAB
+#define CMD_JEDEC_ID        0x9F
+
+#define STATUS1_BUSY        0x01
+
+#define JEDEC_WINBOND       0xEF
+#define JEDEC_W25Q128_JV    0x4018
+
+static inline void w25q_select(void) {
+    gpio_clear(FLASH_CS_PORT, FLASH_CS_PIN);
+}
+
+static inline void w25q_deselect(void) {
+    // Let the last byte clock out before releasing chip select
+    while (SPI_SR(FLASH_SPI) & SPI_SR_BSY);
+    gpio_set(FLASH_CS_PORT, FLASH_CS_PIN);
+}
+
+/** 
+ * @brief Send a command followed by a 24 bit address
+ * @param cmd the command
+ * @param addr the address
+ * 
+ */
+static void w25q_send_cmd_addr(uint8_t cmd, uint32_t addr) {
+    spi_xfer(FLASH_SPI, cmd);
+    spi_xfer(FLASH_SPI, (addr >> 16) & 0xff);
+    spi_xfer(FLASH_SPI, (addr >> 8) & 0xff);
+    spi_xfer(FLASH_SPI, addr & 0xff);
+}
+
+/** 
+ * @brief Send a single byte command
+ * @param cmd the command
+ * 
+ */
+static void w25q_send_cmd(uint8_t cmd) {
+    w25q_select();
+    spi_xfer(FLASH_SPI, cmd);
+    w25q_deselect();
+}
+
+int w25q_init(void) {
+    rcc_periph_clock_enable(RCC_GPIOB);
+    rcc_periph_clock_enable(RCC_AFIO);
+    rcc_periph_clock_enable(RCC_SPI2);
+
+    gpio_set(FLASH_CS_PORT, FLASH_CS_PIN);
+    gpio_set_mode(FLASH_CS_PORT, GPIO_MODE_OUTPUT_50_MHZ,
+                  GPIO_CNF_OUTPUT_PUSHPULL, FLASH_CS_PIN);
+    gpio_set_mode(GPIOB, GPIO_MODE_OUTPUT_50_MHZ,
+                  GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, GPIO_SPI2_SCK | GPIO_SPI2_MOSI);
+    gpio_set_mode(GPIOB, GPIO_MODE_INPUT, GPIO_CNF_INPUT_FLOAT, GPIO_SPI2_MISO);
+
+    // APB1 is 36 MHz so this runs the flash at 18 MHz, mode 0
+    spi_reset(FLASH_SPI);
+    spi_init_master(FLASH_SPI, SPI_CR1_BAUDRATE_FPCLK_DIV_2,
+                    SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE, SPI_CR1_CPHA_CLK_TRANSITION_1,
+                    SPI_CR1_DFF_8BIT, SPI_CR1_MSBFIRST);
+    spi_enable_software_slave_management(FLASH_SPI);
+    spi_set_nss_high(FLASH_SPI);
+    spi_enable(FLASH_SPI);
+
+    w25q_send_cmd(CMD_RELEASE_PD);
+
+    w25q_select();
+    spi_xfer(FLASH_SPI, CMD_JEDEC_ID);
+    uint8_t manufacturer = spi_xfer(FLASH_SPI, 0);
+    uint16_t device = spi_xfer(FLASH_SPI, 0) << 8;
+    device |= spi_xfer(FLASH_SPI, 0);
+    w25q_deselect();
+
+    if (manufacturer != JEDEC_WINBOND || device != JEDEC_W25Q128_JV) {
+        return 1;
+    }
+    return 0;
+}
+
+void w25q_read(uint32_t addr, void *buf, size_t len) {
+    uint8_t *out = buf;
+
+    w25q_select();
+    w25q_send_cmd_addr(CMD_READ_DATA, addr);
+    for (size_t i = 0; i < len; i++) {
+        out[i] = spi_xfer(FLASH_SPI, 0);
+    }
+    w25q_deselect();
+}
+
+void w25q_page_program(uint32_t addr, const void *data, size_t len) {
+    const uint8_t *in = data;
+
+    w25q_send_cmd(CMD_WRITE_ENABLE);
+
+    w25q_select();
+    w25q_send_cmd_addr(CMD_PAGE_PROGRAM, addr);
+    for (size_t i = 0; i < len; i++) {
+        spi_xfer(FLASH_SPI, in[i]);
+    }
+    w25q_deselect();
+}
+
+void w25q_erase_sector(uint32_t addr) {
+    w25q_send_cmd(CMD_WRITE_ENABLE);
+
+    w25q_select();
+    w25q_send_cmd_addr(CMD_SECTOR_ERASE, addr);
+    w25q_deselect();
+}
+
+void w25q_erase_block(uint32_t addr) {
+    w25q_send_cmd(CMD_WRITE_ENABLE);
+
+    w25q_select();
+    w25q_send_cmd_addr(CMD_BLOCK_ERASE, addr);
+    w25q_deselect();
+}
+
+void w25q_erase_suspend(void) {
+    w25q_send_cmd(CMD_ERASE_SUSPEND);
+}
+
+void w25q_erase_resume(void) {
+    w25q_send_cmd(CMD_ERASE_RESUME);
+}
+
+bool w25q_busy(void) {
+    w25q_select();
+    spi_xfer(FLASH_SPI, CMD_READ_STATUS1);
+    uint8_t status = spi_xfer(FLASH_SPI, 0);
+    w25q_deselect();
+
+    return status & STATUS1_BUSY;
+}
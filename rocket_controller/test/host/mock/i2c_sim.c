@@ -0,0 +1,718 @@
+/** 
+ * @file i2c_sim.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Implementation of the simulated I2C 1 and I2C 2 peripherals
+ *
+ * Each bus has at most one thing on the wire (a start, a byte, a read or a
+ * stop) and at most one interrupt waiting for the CPU. The wire event
+ * happens at its time and raises the interrupt, the interrupt runs once the
+ * CPU is free. Busy periods are kept as intervals so the overlap of the two
+ * buses is exact.
+ *
+ * SCL and SDA are followed through the GPIO calls while the pins are not
+ * handed to the peripheral, so the hand clocked recovery can be checked.
+ * The interrupt lines of a bus follow the NVIC calls, a raised interrupt
+ * waits while its bus's lines are disabled.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libopencm3/stm32/i2c.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/cm3/nvic.h>
+
+#include "mock_hw.h"
+#include "i2c_sim.h"
+
+/// Devices on one bus
+#define MAX_DEVICES 4
+
+/// Bit times of an address or data byte and its acknowledge
+#define BYTE_BITS 9
+
+#define NEVER UINT64_MAX
+
+/// Time a read of the clock outside the handlers lets pass, so spins end
+#define SPIN_NS 100
+
+/// What the wire is doing
+typedef enum {
+    WIRE_IDLE,
+    WIRE_START,         ///< Sending a start, SB when done
+    WIRE_ADDR,          ///< Sending the address, ADDR or AF when done
+    WIRE_BYTE,          ///< Sending a data byte, BTF when done
+    WIRE_RX_ONE,        ///< Receiving a single byte, RxNE when done
+    WIRE_RX_DMA,        ///< Receiving by DMA, the DMA interrupt when done
+    WIRE_STOP,          ///< Sending a stop, no interrupt
+} wire_t;
+
+/// Which handler a raised interrupt calls
+typedef enum {
+    IRQ_NONE,
+    IRQ_EVENT,
+    IRQ_ERROR,
+    IRQ_DMA,
+} irq_t;
+
+typedef struct {
+    uint8_t addr;
+    uint8_t *regs;
+} device_t;
+
+/// A period the bus was busy
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+} busy_t;
+
+typedef struct {
+    uint32_t i2c;
+    uint8_t dma_channel;
+    void (*ev_isr)(void);
+    void (*er_isr)(void);
+    void (*dma_isr)(void);
+    uint8_t irqns[3];       ///< NVIC numbers of the event, error and DMA interrupts
+    uint8_t irqs_off;       ///< Bit per interrupt line disabled in the NVIC
+    uint16_t scl;           ///< GPIOB pins
+    uint16_t sda;
+
+    device_t devices[MAX_DEVICES];
+    uint32_t num_devices;
+    device_t *device;       ///< The device addressed, NULL if nobody answered
+    bool reading;
+    uint8_t ptr;            ///< Register pointer of the device
+    bool ptr_set;           ///< The first byte written sets the pointer
+
+    wire_t wire;
+    uint64_t wire_ns;       ///< When the wire event ends
+    bool start_waiting;     ///< A start was asked for during a stop
+    bool stop_after_rx;     ///< A stop was asked for before a single byte read
+
+    irq_t irq;
+    uint32_t irq_sr1;
+    uint64_t irq_raised_ns;
+    bool lose_irq;          ///< The next interrupt raised is lost
+
+    uint32_t sda_hold;      ///< SCL clocks until the device holding SDA lets go, 0 if not held
+    bool pins_gpio;         ///< The pins are GPIO outputs rather than the peripheral's
+    bool scl_out;           ///< Levels set by the GPIO calls
+    bool sda_out;
+
+    bool dma_on;
+    uint8_t *dma_buf;
+    uint16_t dma_len;
+
+    busy_t *busy;           ///< Busy periods, the last is open while busy_open
+    uint32_t num_busy;
+    uint32_t max_busy;
+    bool busy_open;
+
+    i2c_sim_stats_t stats;
+} bus_t;
+
+extern void i2c1_ev_isr(void);
+extern void i2c1_er_isr(void);
+extern void dma1_channel7_isr(void);
+extern void i2c2_ev_isr(void);
+extern void i2c2_er_isr(void);
+extern void dma1_channel5_isr(void);
+
+static bus_t g_sim[I2C_NUM_BUSES];
+
+static uint64_t g_now_ns = 0;
+static uint64_t g_act_ns = 0;       ///< When a call made now takes effect
+static uint64_t g_cpu_free_ns = 0;
+static uint64_t g_cpu_ns = 0;
+static uint32_t g_irq_ns = 0;
+static bool g_in_irq = false;
+
+/** 
+ * @brief Find the bus of a peripheral
+ * @param i2c the peripheral
+ * 
+ * @return the bus
+ */
+static bus_t *i2c_sim_bus(uint32_t i2c) {
+    return &g_sim[i2c == I2C1 ? I2C_BUS_1 : I2C_BUS_2];
+}
+
+/** 
+ * @brief Find the bus of a DMA channel
+ * @param channel the channel
+ * 
+ * @return the bus, NULL if the channel is not an I2C one
+ */
+static bus_t *i2c_sim_dma_bus(uint8_t channel) {
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        if (g_sim[i].dma_channel == channel) {
+            return &g_sim[i];
+        }
+    }
+    return NULL;
+}
+
+/** 
+ * @brief Put something on the wire
+ * @param b the bus
+ * @param wire what
+ * @param bits how long it takes
+ * 
+ */
+static void i2c_sim_wire(bus_t *b, wire_t wire, uint32_t bits) {
+    if (b->wire != WIRE_IDLE) {
+        fprintf(stderr, "i2c_sim: I2C %d driven while busy\n", (int)(b - g_sim) + 1);
+        exit(2);
+    }
+    b->wire = wire;
+    b->wire_ns = g_act_ns + (uint64_t)bits * I2C_SIM_BIT_NS;
+
+    // The peripheral waits for a free bus to send a start
+    if (wire == WIRE_START && b->sda_hold > 0) {
+        b->wire_ns = NEVER;
+    }
+}
+
+/** 
+ * @brief Start or continue a busy period
+ * @param b the bus
+ * @param ns when
+ * 
+ */
+static void i2c_sim_busy_begin(bus_t *b, uint64_t ns) {
+    if (b->busy_open) {
+        return;
+    }
+    if (b->num_busy > 0 && b->busy[b->num_busy - 1].end == ns) {
+        b->busy_open = true;
+        return;
+    }
+    if (b->num_busy == b->max_busy) {
+        b->max_busy = b->max_busy ? 2 * b->max_busy : 256;
+        b->busy = realloc(b->busy, b->max_busy * sizeof(busy_t));
+        if (b->busy == NULL) {
+            fprintf(stderr, "i2c_sim: out of memory\n");
+            exit(2);
+        }
+    }
+    b->busy[b->num_busy++] = (busy_t){ .start = ns, .end = ns };
+    b->busy_open = true;
+}
+
+/** 
+ * @brief Raise an interrupt
+ * @param b the bus
+ * @param irq the handler
+ * @param sr1 the status flags it sees
+ * 
+ */
+static void i2c_sim_raise(bus_t *b, irq_t irq, uint32_t sr1) {
+    if (b->lose_irq) {
+        b->lose_irq = false;
+        b->stats.lost_irqs++;
+        return;
+    }
+    b->irq = irq;
+    b->irq_sr1 = sr1;
+    b->irq_raised_ns = g_now_ns;
+}
+
+/** 
+ * @brief Finish what is on the wire
+ * @param b the bus
+ * 
+ */
+static void i2c_sim_wire_done(bus_t *b) {
+    wire_t wire = b->wire;
+
+    b->wire = WIRE_IDLE;
+    g_act_ns = g_now_ns;
+
+    switch (wire) {
+    case WIRE_START:
+        i2c_sim_raise(b, IRQ_EVENT, I2C_SR1_SB);
+        break;
+
+    case WIRE_ADDR:
+        if (b->device == NULL) {
+            b->stats.naks++;
+            i2c_sim_raise(b, IRQ_ERROR, I2C_SR1_AF);
+        } else {
+            i2c_sim_raise(b, IRQ_EVENT, I2C_SR1_ADDR);
+        }
+        break;
+
+    case WIRE_BYTE:
+        i2c_sim_raise(b, IRQ_EVENT, I2C_SR1_BTF | I2C_SR1_TxE);
+        break;
+
+    case WIRE_RX_ONE:
+        I2C_DR(b->i2c) = b->device->regs[b->ptr++];
+        i2c_sim_raise(b, IRQ_EVENT, I2C_SR1_RxNE);
+        if (b->stop_after_rx) {
+            b->stop_after_rx = false;
+            i2c_sim_wire(b, WIRE_STOP, 1);
+        }
+        break;
+
+    case WIRE_RX_DMA:
+        for (uint16_t i = 0; i < b->dma_len; i++) {
+            b->dma_buf[i] = b->device->regs[b->ptr++];
+        }
+        DMA_CNDTR(DMA1, b->dma_channel) = 0;
+        i2c_sim_raise(b, IRQ_DMA, 0);
+        break;
+
+    case WIRE_STOP:
+        if (b->start_waiting) {
+            b->start_waiting = false;
+            i2c_sim_wire(b, WIRE_START, 1);
+        } else {
+            b->busy[b->num_busy - 1].end = g_now_ns;
+            b->busy_open = false;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+/** 
+ * @brief Run a raised interrupt
+ * @param b the bus
+ * 
+ */
+static void i2c_sim_dispatch(bus_t *b) {
+    irq_t irq = b->irq;
+    uint64_t wait = g_now_ns - b->irq_raised_ns;
+    bool read_addr = irq == IRQ_EVENT && b->irq_sr1 == I2C_SR1_ADDR && b->reading;
+
+    b->irq = IRQ_NONE;
+    b->stats.irqs++;
+    b->stats.irq_wait_ns += wait;
+    if (wait > b->stats.irq_wait_max_ns) {
+        b->stats.irq_wait_max_ns = wait;
+    }
+
+    // Calls made by the handler take effect as it returns
+    g_act_ns = g_now_ns + g_irq_ns;
+    g_cpu_free_ns = g_act_ns;
+    g_cpu_ns += g_irq_ns;
+
+    I2C_SR1(b->i2c) = b->irq_sr1;
+    g_in_irq = true;
+    if (irq == IRQ_EVENT) {
+        b->ev_isr();
+    } else if (irq == IRQ_ERROR) {
+        b->er_isr();
+    } else {
+        b->dma_isr();
+    }
+    g_in_irq = false;
+    I2C_SR1(b->i2c) = 0;
+
+    // The data of a read is clocked in once ADDR is cleared
+    if (read_addr) {
+        if (b->dma_on) {
+            i2c_sim_wire(b, WIRE_RX_DMA, (uint32_t)b->dma_len * BYTE_BITS);
+        } else if (I2C_CR2(b->i2c) & I2C_CR2_ITBUFEN) {
+            i2c_sim_wire(b, WIRE_RX_ONE, BYTE_BITS);
+        }
+    }
+
+    g_act_ns = g_now_ns;
+}
+
+/** 
+ * @brief Get the busy time of a bus up to now
+ * @param b the bus
+ * 
+ * @return the time in ns
+ */
+static uint64_t i2c_sim_busy_ns(const bus_t *b) {
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i < b->num_busy; i++) {
+        uint64_t end = (b->busy_open && i == b->num_busy - 1) ? g_now_ns : b->busy[i].end;
+        total += end - b->busy[i].start;
+    }
+    return total;
+}
+
+void i2c_sim_reset(uint32_t irq_ns) {
+    static const uint32_t i2cs[I2C_NUM_BUSES] = { I2C1, I2C2 };
+
+    // The DMA is given addresses as uint32_t
+    if ((uintptr_t)g_sim > UINT32_MAX) {
+        fprintf(stderr, "i2c_sim: statics above 4 GB, link with -no-pie\n");
+        exit(2);
+    }
+
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        free(g_sim[i].busy);
+        memset(&g_sim[i], 0, sizeof(g_sim[i]));
+        g_sim[i].i2c = i2cs[i];
+        I2C_SR1(i2cs[i]) = 0;
+        I2C_CR1(i2cs[i]) = 0;
+        I2C_CR2(i2cs[i]) = 0;
+    }
+    g_sim[I2C_BUS_1].dma_channel = DMA_CHANNEL7;
+    g_sim[I2C_BUS_1].ev_isr = i2c1_ev_isr;
+    g_sim[I2C_BUS_1].er_isr = i2c1_er_isr;
+    g_sim[I2C_BUS_1].dma_isr = dma1_channel7_isr;
+    g_sim[I2C_BUS_1].irqns[0] = NVIC_I2C1_EV_IRQ;
+    g_sim[I2C_BUS_1].irqns[1] = NVIC_I2C1_ER_IRQ;
+    g_sim[I2C_BUS_1].irqns[2] = NVIC_DMA1_CHANNEL7_IRQ;
+    g_sim[I2C_BUS_1].scl = GPIO_I2C1_SCL;
+    g_sim[I2C_BUS_1].sda = GPIO_I2C1_SDA;
+    g_sim[I2C_BUS_2].dma_channel = DMA_CHANNEL5;
+    g_sim[I2C_BUS_2].ev_isr = i2c2_ev_isr;
+    g_sim[I2C_BUS_2].er_isr = i2c2_er_isr;
+    g_sim[I2C_BUS_2].dma_isr = dma1_channel5_isr;
+    g_sim[I2C_BUS_2].irqns[0] = NVIC_I2C2_EV_IRQ;
+    g_sim[I2C_BUS_2].irqns[1] = NVIC_I2C2_ER_IRQ;
+    g_sim[I2C_BUS_2].irqns[2] = NVIC_DMA1_CHANNEL5_IRQ;
+    g_sim[I2C_BUS_2].scl = GPIO_I2C2_SCL;
+    g_sim[I2C_BUS_2].sda = GPIO_I2C2_SDA;
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        g_sim[i].scl_out = true;
+        g_sim[i].sda_out = true;
+    }
+
+    g_now_ns = 0;
+    g_act_ns = 0;
+    g_cpu_free_ns = 0;
+    g_cpu_ns = 0;
+    g_irq_ns = irq_ns;
+}
+
+void i2c_sim_add_device(i2c_bus_t bus, uint8_t addr, uint8_t *regs) {
+    bus_t *b = &g_sim[bus];
+
+    if (b->num_devices == MAX_DEVICES) {
+        fprintf(stderr, "i2c_sim: too many devices\n");
+        exit(2);
+    }
+    b->devices[b->num_devices++] = (device_t){ .addr = addr, .regs = regs };
+}
+
+void i2c_sim_run_until(uint64_t ns) {
+    for (;;) {
+        bus_t *next = NULL;
+        uint64_t next_ns = NEVER;
+        bool next_wire = false;
+
+        // Wire events first so an interrupt sees everything raised at its time
+        for (int i = 0; i < I2C_NUM_BUSES; i++) {
+            bus_t *b = &g_sim[i];
+            if (b->wire != WIRE_IDLE && b->wire_ns < next_ns) {
+                next = b;
+                next_ns = b->wire_ns;
+                next_wire = true;
+            }
+        }
+        for (int i = 0; i < I2C_NUM_BUSES; i++) {
+            bus_t *b = &g_sim[i];
+            if (b->irq == IRQ_NONE || (b->irqs_off & (1 << (b->irq - IRQ_EVENT)))) {
+                continue;
+            }
+            uint64_t at = b->irq_raised_ns > g_cpu_free_ns ? b->irq_raised_ns : g_cpu_free_ns;
+            if (at < next_ns) {
+                next = b;
+                next_ns = at;
+                next_wire = false;
+            }
+        }
+
+        if (next == NULL || next_ns > ns) {
+            break;
+        }
+        g_now_ns = next_ns;
+        if (next_wire) {
+            i2c_sim_wire_done(next);
+        } else {
+            i2c_sim_dispatch(next);
+        }
+    }
+
+    if (ns > g_now_ns) {
+        g_now_ns = ns;
+    }
+    g_act_ns = g_now_ns;
+}
+
+uint64_t i2c_sim_now_ns(void) {
+    return g_now_ns;
+}
+
+void i2c_sim_lose_irq(i2c_bus_t bus) {
+    g_sim[bus].lose_irq = true;
+}
+
+void i2c_sim_hold_sda(i2c_bus_t bus, uint32_t clocks) {
+    g_sim[bus].sda_hold = clocks;
+}
+
+uint64_t timebase_now_us(void) {
+    if (!g_in_irq && !mock_irq_masked) {
+        i2c_sim_run_until(g_now_ns + SPIN_NS);
+    }
+    return g_now_ns / 1000;
+}
+
+bool i2c_sim_idle(i2c_bus_t bus) {
+    const bus_t *b = &g_sim[bus];
+
+    return b->wire == WIRE_IDLE && b->irq == IRQ_NONE && !b->busy_open;
+}
+
+uint64_t i2c_sim_overlap_ns(void) {
+    const bus_t *a = &g_sim[I2C_BUS_1];
+    const bus_t *b = &g_sim[I2C_BUS_2];
+    uint64_t total = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+
+    while (i < a->num_busy && j < b->num_busy) {
+        uint64_t a_end = (a->busy_open && i == a->num_busy - 1) ? g_now_ns : a->busy[i].end;
+        uint64_t b_end = (b->busy_open && j == b->num_busy - 1) ? g_now_ns : b->busy[j].end;
+        uint64_t start = a->busy[i].start > b->busy[j].start ? a->busy[i].start : b->busy[j].start;
+        uint64_t end = a_end < b_end ? a_end : b_end;
+
+        if (end > start) {
+            total += end - start;
+        }
+        if (a_end < b_end) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return total;
+}
+
+uint64_t i2c_sim_cpu_ns(void) {
+    return g_cpu_ns;
+}
+
+void i2c_sim_get_stats(i2c_bus_t bus, i2c_sim_stats_t *stats) {
+    *stats = g_sim[bus].stats;
+    stats->busy_ns = i2c_sim_busy_ns(&g_sim[bus]);
+}
+
+/** 
+ * @brief Find the bus of an interrupt
+ * @param irqn the NVIC number
+ * @param line set to the line of the bus, 0 event, 1 error, 2 DMA
+ * 
+ * @return the bus, NULL if the interrupt is not an I2C one
+ */
+static bus_t *i2c_sim_irq_bus(uint8_t irqn, int *line) {
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        for (int j = 0; j < 3; j++) {
+            if (g_sim[i].irqns[j] == irqn) {
+                *line = j;
+                return &g_sim[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+void nvic_enable_irq(uint8_t irqn) {
+    int line;
+    bus_t *b = i2c_sim_irq_bus(irqn, &line);
+
+    if (b != NULL) {
+        b->irqs_off &= ~(1 << line);
+    }
+}
+
+void nvic_disable_irq(uint8_t irqn) {
+    int line;
+    bus_t *b = i2c_sim_irq_bus(irqn, &line);
+
+    if (b != NULL) {
+        b->irqs_off |= 1 << line;
+    }
+}
+
+void nvic_clear_pending_irq(uint8_t irqn) {
+    int line;
+    bus_t *b = i2c_sim_irq_bus(irqn, &line);
+
+    if (b != NULL && b->irq != IRQ_NONE && b->irq - IRQ_EVENT == line) {
+        b->irq = IRQ_NONE;
+    }
+}
+
+void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios) {
+    (void)mode;
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        if (gpioport == GPIOB && (gpios & g_sim[i].scl)) {
+            g_sim[i].pins_gpio = cnf == GPIO_CNF_OUTPUT_OPENDRAIN;
+        }
+    }
+}
+
+/** 
+ * @brief Drive SCL and SDA from the GPIO calls
+ * @param gpios the pins changed
+ * @param high their new level
+ * 
+ */
+static void i2c_sim_gpio(uint16_t gpios, bool high) {
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        bus_t *b = &g_sim[i];
+        bool scl_rise = (gpios & b->scl) && high && !b->scl_out;
+        bool sda_rise = (gpios & b->sda) && high && !b->sda_out;
+
+        if (gpios & b->scl) {
+            b->scl_out = high;
+        }
+        if (gpios & b->sda) {
+            b->sda_out = high;
+        }
+        if (!b->pins_gpio) {
+            continue;
+        }
+
+        if (scl_rise) {
+            b->stats.scl_clocks++;
+            if (b->sda_hold > 0) {
+                b->sda_hold--;
+            }
+        }
+        if (sda_rise && b->scl_out && b->sda_hold == 0) {
+            b->stats.gpio_stops++;
+        }
+    }
+}
+
+void gpio_set(uint32_t gpioport, uint16_t gpios) {
+    if (gpioport == GPIOB) {
+        i2c_sim_gpio(gpios, true);
+    }
+}
+
+void gpio_clear(uint32_t gpioport, uint16_t gpios) {
+    if (gpioport == GPIOB) {
+        i2c_sim_gpio(gpios, false);
+    }
+}
+
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios) {
+    uint16_t levels = 0;
+
+    for (int i = 0; i < I2C_NUM_BUSES; i++) {
+        const bus_t *b = &g_sim[i];
+        if (gpioport == GPIOB && b->scl_out) {
+            levels |= b->scl;
+        }
+        if (gpioport == GPIOB && b->sda_out && b->sda_hold == 0) {
+            levels |= b->sda;
+        }
+    }
+    return levels & gpios;
+}
+
+void i2c_reset(uint32_t i2c) {
+    bus_t *b = i2c_sim_bus(i2c);
+
+    // Whatever was on the wire is abandoned, a device holding SDA still does
+    b->wire = WIRE_IDLE;
+    b->irq = IRQ_NONE;
+    b->start_waiting = false;
+    b->stop_after_rx = false;
+    b->dma_on = false;
+    b->device = NULL;
+    if (b->busy_open) {
+        b->busy[b->num_busy - 1].end = g_now_ns;
+        b->busy_open = false;
+    }
+    I2C_CR1(i2c) = 0;
+    I2C_CR2(i2c) = 0;
+    I2C_SR1(i2c) = 0;
+    b->stats.resets++;
+}
+
+void i2c_send_start(uint32_t i2c) {
+    bus_t *b = i2c_sim_bus(i2c);
+
+    i2c_sim_busy_begin(b, g_act_ns);
+    if (b->wire == WIRE_STOP) {
+        b->start_waiting = true;
+    } else {
+        i2c_sim_wire(b, WIRE_START, 1);
+    }
+}
+
+void i2c_send_stop(uint32_t i2c) {
+    bus_t *b = i2c_sim_bus(i2c);
+
+    // STOP is left clear, the stop goes out after any byte being received
+    if (b->reading && b->wire == WIRE_IDLE && b->irq == IRQ_NONE && I2C_SR1(i2c) == I2C_SR1_ADDR) {
+        b->stop_after_rx = true;
+    } else {
+        i2c_sim_wire(b, WIRE_STOP, 1);
+    }
+}
+
+void i2c_send_7bit_address(uint32_t i2c, uint8_t slave, uint8_t readwrite) {
+    bus_t *b = i2c_sim_bus(i2c);
+
+    b->device = NULL;
+    for (uint32_t i = 0; i < b->num_devices; i++) {
+        if (b->devices[i].addr == slave) {
+            b->device = &b->devices[i];
+        }
+    }
+    b->reading = readwrite == I2C_READ;
+    b->ptr_set = false;
+    i2c_sim_wire(b, WIRE_ADDR, BYTE_BITS);
+}
+
+void i2c_send_data(uint32_t i2c, uint8_t data) {
+    bus_t *b = i2c_sim_bus(i2c);
+
+    if (!b->ptr_set) {
+        b->ptr = data;
+        b->ptr_set = true;
+    } else {
+        b->device->regs[b->ptr++] = data;
+    }
+    i2c_sim_wire(b, WIRE_BYTE, BYTE_BITS);
+}
+
+void i2c_enable_dma(uint32_t i2c) {
+    i2c_sim_bus(i2c)->dma_on = true;
+}
+
+void i2c_disable_dma(uint32_t i2c) {
+    i2c_sim_bus(i2c)->dma_on = false;
+}
+
+void dma_set_memory_address(uint32_t dma, uint8_t channel, uint32_t address) {
+    bus_t *b = i2c_sim_dma_bus(channel);
+
+    (void)dma;
+    if (b != NULL) {
+        b->dma_buf = (uint8_t *)(uintptr_t)address;
+    }
+}
+
+void dma_set_number_of_data(uint32_t dma, uint8_t channel, uint16_t number) {
+    bus_t *b = i2c_sim_dma_bus(channel);
+
+    DMA_CNDTR(dma, channel) = number;
+    if (b != NULL) {
+        b->dma_len = number;
+    }
+}
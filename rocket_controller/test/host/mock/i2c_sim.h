@@ -0,0 +1,123 @@
+/** 
+ * @file i2c_sim.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Declarations for the simulated I2C 1 and I2C 2 peripherals
+ *
+ * i2c_sim.c models the two I2C peripherals and their DMA receive channels
+ * behind the libopencm3 calls src/i2c_bus.c makes, so the real transaction
+ * engine runs unchanged on the host. Each bus moves at 400 kHz on a shared
+ * simulated clock: a start or stop takes one bit time, an address or data
+ * byte nine. Every event the hardware would raise calls the firmware's
+ * interrupt handler, and every handler is charged a fixed CPU time. The
+ * event, error and DMA interrupts of both buses share one priority, so one
+ * bus's event waits while the other's handler runs, and the time it waits
+ * is recorded.
+ *
+ * Devices are 256 byte register files that auto-increment on reads and
+ * writes. An address with no device is NACKed. Faults can be set up: an
+ * interrupt lost, or a device holding SDA low, which keeps the peripheral
+ * from sending a start until SCL is clocked by hand.
+ *
+ * The sim provides timebase_now_us(). Read outside an interrupt handler
+ * with interrupts unmasked it runs the buses on a little, so spins on the
+ * clock or on a transaction status (i2c_transfer()) see time pass.
+ * The DMA is given buffer addresses as uint32_t, so host builds must be
+ * linked with -no-pie to keep static buffers below 4 GB.
+ */
+
+
+#ifndef I2C_SIM_H
+#define I2C_SIM_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c_bus.h"
+
+/// One bit at 400 kHz
+#define I2C_SIM_BIT_NS 2500
+
+/// Counters of one bus
+typedef struct {
+    uint64_t busy_ns;       ///< From the start being sent to the stop finishing
+    uint32_t irqs;          ///< Interrupt handlers run
+    uint32_t naks;          ///< Addresses nobody answered
+    uint64_t irq_wait_ns;   ///< Time events waited for the CPU, summed
+    uint64_t irq_wait_max_ns;
+    uint32_t lost_irqs;     ///< Interrupts lost by i2c_sim_lose_irq()
+    uint32_t resets;        ///< Peripheral resets
+    uint32_t scl_clocks;    ///< SCL clocks sent by hand
+    uint32_t gpio_stops;    ///< Stops sent by hand, on a free SDA
+} i2c_sim_stats_t;
+
+/** 
+ * @brief Reset both buses and the clock
+ * @param irq_ns the CPU time each interrupt handler takes
+ */
+void i2c_sim_reset(uint32_t irq_ns);
+
+/** 
+ * @brief Attach a device
+ * @param bus the bus
+ * @param addr the 7 bit address
+ * @param regs the 256 registers of the device, kept by the caller
+ */
+void i2c_sim_add_device(i2c_bus_t bus, uint8_t addr, uint8_t *regs);
+
+/** 
+ * @brief Run the buses until a time, calling the interrupt handlers as
+ * events happen
+ * @param ns the time to stop at
+ */
+void i2c_sim_run_until(uint64_t ns);
+
+/** 
+ * @brief Get the simulated clock
+ * @return nanoseconds since the reset
+ */
+uint64_t i2c_sim_now_ns(void);
+
+/** 
+ * @brief Lose the next interrupt a bus raises
+ * @param bus the bus
+ */
+void i2c_sim_lose_irq(i2c_bus_t bus);
+
+/** 
+ * @brief Have a device hold SDA low, as one cut off part way through a read
+ * would
+ * @param bus the bus
+ * @param clocks the SCL clocks until it lets go
+ */
+void i2c_sim_hold_sda(i2c_bus_t bus, uint32_t clocks);
+
+/** 
+ * @brief Check if a bus has nothing in progress
+ * @param bus the bus
+ * @return true if idle
+ */
+bool i2c_sim_idle(i2c_bus_t bus);
+
+/** 
+ * @brief Get the time both buses were busy at once
+ * @return the overlap in ns
+ */
+uint64_t i2c_sim_overlap_ns(void);
+
+/** 
+ * @brief Get the CPU time spent in the I2C interrupt handlers
+ * @return the time in ns
+ */
+uint64_t i2c_sim_cpu_ns(void);
+
+/** 
+ * @brief Get a snapshot of the counters of a bus
+ * @param bus the bus
+ * @param stats the struct to fill
+ */
+void i2c_sim_get_stats(i2c_bus_t bus, i2c_sim_stats_t *stats);
+
+
+#endif // I2C_SIM_H
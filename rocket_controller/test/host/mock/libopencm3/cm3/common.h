@@ -0,0 +1,21 @@
+/** 
+ * @file common.h
+ * @brief Host stand-in for libopencm3/cm3/common.h
+ */
+
+
+#ifndef MOCK_CM3_COMMON_H
+#define MOCK_CM3_COMMON_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mock_hw.h"
+
+#define MMIO32(addr) (*mock_mmio32(addr))
+
+#define BIT0 (1 << 0)
+
+
+#endif // MOCK_CM3_COMMON_H
@@ -0,0 +1,34 @@
+/** 
+ * @file cortex.h
+ * @brief Host stand-in for libopencm3/cm3/cortex.h
+ */
+
+
+#ifndef MOCK_CM3_CORTEX_H
+#define MOCK_CM3_CORTEX_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mock_hw.h"
+
+static inline uint32_t cm_mask_interrupts(uint32_t mask) {
+    uint32_t old = mock_irq_masked;
+    mock_irq_masked = mask;
+    return old;
+}
+
+static inline void cm_disable_interrupts(void) {
+    mock_irq_masked = true;
+}
+
+static inline void cm_enable_interrupts(void) {
+    mock_irq_masked = false;
+}
+
+#define CM_ATOMIC_BLOCK() \
+    for (uint32_t __save = cm_mask_interrupts(1), __my_cnt = 1; __my_cnt; __my_cnt = 0, cm_mask_interrupts(__save))
+
+
+#endif // MOCK_CM3_CORTEX_H
@@ -0,0 +1,19 @@
+/** 
+ * @file dwt.h
+ * @brief Host stand-in for libopencm3/cm3/dwt.h
+ */
+
+
+#ifndef MOCK_CM3_DWT_H
+#define MOCK_CM3_DWT_H
+
+
+#include "libopencm3/cm3/common.h"
+
+#define DWT_CYCCNT MMIO32(0xE0001004)
+
+bool dwt_enable_cycle_counter(void);
+uint32_t dwt_read_cycle_counter(void);
+
+
+#endif // MOCK_CM3_DWT_H
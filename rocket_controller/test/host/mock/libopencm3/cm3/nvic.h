@@ -0,0 +1,39 @@
+/** 
+ * @file nvic.h
+ * @brief Host stand-in for libopencm3/cm3/nvic.h
+ */
+
+
+#ifndef MOCK_CM3_NVIC_H
+#define MOCK_CM3_NVIC_H
+
+
+#include <stdint.h>
+
+#define NVIC_EXTI0_IRQ 6
+#define NVIC_EXTI1_IRQ 7
+#define NVIC_EXTI2_IRQ 8
+#define NVIC_EXTI3_IRQ 9
+#define NVIC_EXTI4_IRQ 10
+#define NVIC_DMA1_CHANNEL1_IRQ 11
+#define NVIC_DMA1_CHANNEL2_IRQ 12
+#define NVIC_DMA1_CHANNEL3_IRQ 13
+#define NVIC_DMA1_CHANNEL4_IRQ 14
+#define NVIC_DMA1_CHANNEL5_IRQ 15
+#define NVIC_DMA1_CHANNEL6_IRQ 16
+#define NVIC_DMA1_CHANNEL7_IRQ 17
+#define NVIC_USB_LP_CAN_RX0_IRQ 20
+#define NVIC_EXTI9_5_IRQ 23
+#define NVIC_I2C1_EV_IRQ 31
+#define NVIC_I2C1_ER_IRQ 32
+#define NVIC_I2C2_EV_IRQ 33
+#define NVIC_I2C2_ER_IRQ 34
+
+void nvic_enable_irq(uint8_t irqn);
+void nvic_disable_irq(uint8_t irqn);
+void nvic_clear_pending_irq(uint8_t irqn);
+void nvic_set_priority(uint8_t irqn, uint8_t priority);
+uint8_t nvic_get_irq_enabled(uint8_t irqn);
+
+
+#endif // MOCK_CM3_NVIC_H
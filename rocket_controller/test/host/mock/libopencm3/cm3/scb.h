@@ -0,0 +1,17 @@
+/** 
+ * @file scb.h
+ * @brief Host stand-in for libopencm3/cm3/scb.h
+ */
+
+
+#ifndef MOCK_CM3_SCB_H
+#define MOCK_CM3_SCB_H
+
+
+#include "libopencm3/cm3/common.h"
+
+#define SCB_ICSR MMIO32(0xE000ED04)
+#define SCB_ICSR_PENDSTSET (1 << 26)
+
+
+#endif // MOCK_CM3_SCB_H
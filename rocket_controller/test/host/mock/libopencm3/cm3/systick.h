@@ -0,0 +1,26 @@
+/** 
+ * @file systick.h
+ * @brief Host stand-in for libopencm3/cm3/systick.h
+ */
+
+
+#ifndef MOCK_CM3_SYSTICK_H
+#define MOCK_CM3_SYSTICK_H
+
+
+#include "libopencm3/cm3/common.h"
+
+#define STK_CSR MMIO32(0xE000E010)
+#define STK_RVR MMIO32(0xE000E014)
+#define STK_CVR MMIO32(0xE000E018)
+
+#define STK_CSR_CLKSOURCE_AHB (1 << 2)
+
+void systick_set_clocksource(uint8_t clocksource);
+void systick_set_reload(uint32_t value);
+void systick_interrupt_enable(void);
+void systick_counter_enable(void);
+uint32_t systick_get_value(void);
+
+
+#endif // MOCK_CM3_SYSTICK_H
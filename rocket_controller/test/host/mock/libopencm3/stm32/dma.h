@@ -0,0 +1,56 @@
+/** 
+ * @file dma.h
+ * @brief Host stand-in for libopencm3/stm32/dma.h
+ */
+
+
+#ifndef MOCK_STM32_DMA_H
+#define MOCK_STM32_DMA_H
+
+
+#include "libopencm3/cm3/common.h"
+
+#define DMA1 0x40020000
+
+#define DMA_CHANNEL1 1
+#define DMA_CHANNEL2 2
+#define DMA_CHANNEL3 3
+#define DMA_CHANNEL4 4
+#define DMA_CHANNEL5 5
+#define DMA_CHANNEL6 6
+#define DMA_CHANNEL7 7
+
+#define DMA_GIF (1 << 0)
+#define DMA_TCIF (1 << 1)
+#define DMA_HTIF (1 << 2)
+#define DMA_TEIF (1 << 3)
+
+#define DMA_CCR_PL_LOW (0 << 12)
+#define DMA_CCR_PL_MEDIUM (1 << 12)
+#define DMA_CCR_PL_HIGH (2 << 12)
+#define DMA_CCR_PL_VERY_HIGH (3 << 12)
+#define DMA_CCR_MSIZE_8BIT (0 << 10)
+#define DMA_CCR_PSIZE_8BIT (0 << 8)
+
+#define DMA_CNDTR(port, channel) MMIO32((port) + 0x0c + 20 * ((channel) - 1))
+
+void dma_channel_reset(uint32_t dma, uint8_t channel);
+void dma_clear_interrupt_flags(uint32_t dma, uint8_t channel, uint32_t interrupts);
+bool dma_get_interrupt_flag(uint32_t dma, uint8_t channel, uint32_t interrupts);
+void dma_set_peripheral_address(uint32_t dma, uint8_t channel, uint32_t address);
+void dma_set_memory_address(uint32_t dma, uint8_t channel, uint32_t address);
+void dma_set_number_of_data(uint32_t dma, uint8_t channel, uint16_t number);
+void dma_set_read_from_peripheral(uint32_t dma, uint8_t channel);
+void dma_set_read_from_memory(uint32_t dma, uint8_t channel);
+void dma_enable_memory_increment_mode(uint32_t dma, uint8_t channel);
+void dma_disable_memory_increment_mode(uint32_t dma, uint8_t channel);
+void dma_set_peripheral_size(uint32_t dma, uint8_t channel, uint32_t peripheral_size);
+void dma_set_memory_size(uint32_t dma, uint8_t channel, uint32_t mem_size);
+void dma_set_priority(uint32_t dma, uint8_t channel, uint32_t prio);
+void dma_enable_transfer_complete_interrupt(uint32_t dma, uint8_t channel);
+void dma_enable_transfer_error_interrupt(uint32_t dma, uint8_t channel);
+void dma_enable_channel(uint32_t dma, uint8_t channel);
+void dma_disable_channel(uint32_t dma, uint8_t channel);
+
+
+#endif // MOCK_STM32_DMA_H
@@ -0,0 +1,69 @@
+/** 
+ * @file gpio.h
+ * @brief Host stand-in for libopencm3/stm32/gpio.h
+ */
+
+
+#ifndef MOCK_STM32_GPIO_H
+#define MOCK_STM32_GPIO_H
+
+
+#include <stdint.h>
+
+#define GPIOA 0x40010800
+#define GPIOB 0x40010c00
+#define GPIOC 0x40011000
+
+#define GPIO0 (1 << 0)
+#define GPIO1 (1 << 1)
+#define GPIO2 (1 << 2)
+#define GPIO3 (1 << 3)
+#define GPIO4 (1 << 4)
+#define GPIO5 (1 << 5)
+#define GPIO6 (1 << 6)
+#define GPIO7 (1 << 7)
+#define GPIO8 (1 << 8)
+#define GPIO9 (1 << 9)
+#define GPIO10 (1 << 10)
+#define GPIO11 (1 << 11)
+#define GPIO12 (1 << 12)
+#define GPIO13 (1 << 13)
+#define GPIO14 (1 << 14)
+#define GPIO15 (1 << 15)
+
+#define GPIO_MODE_INPUT 0
+#define GPIO_MODE_OUTPUT_10_MHZ 1
+#define GPIO_MODE_OUTPUT_2_MHZ 2
+#define GPIO_MODE_OUTPUT_50_MHZ 3
+
+#define GPIO_CNF_INPUT_ANALOG 0
+#define GPIO_CNF_INPUT_FLOAT 1
+#define GPIO_CNF_INPUT_PULL_UPDOWN 2
+#define GPIO_CNF_OUTPUT_PUSHPULL 0
+#define GPIO_CNF_OUTPUT_OPENDRAIN 1
+#define GPIO_CNF_OUTPUT_ALTFN_PUSHPULL 2
+#define GPIO_CNF_OUTPUT_ALTFN_OPENDRAIN 3
+
+#define GPIO_BANK_SPI1_SCK GPIOA
+#define GPIO_SPI1_SCK GPIO5
+#define GPIO_SPI1_MISO GPIO6
+#define GPIO_SPI1_MOSI GPIO7
+#define GPIO_BANK_SPI2_SCK GPIOB
+#define GPIO_SPI2_SCK GPIO13
+#define GPIO_SPI2_MISO GPIO14
+#define GPIO_SPI2_MOSI GPIO15
+#define GPIO_BANK_I2C1_SCL GPIOB
+#define GPIO_I2C1_SCL GPIO6
+#define GPIO_I2C1_SDA GPIO7
+#define GPIO_BANK_I2C2_SCL GPIOB
+#define GPIO_I2C2_SCL GPIO10
+#define GPIO_I2C2_SDA GPIO11
+
+void gpio_set(uint32_t gpioport, uint16_t gpios);
+void gpio_clear(uint32_t gpioport, uint16_t gpios);
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios);
+void gpio_toggle(uint32_t gpioport, uint16_t gpios);
+void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios);
+
+
+#endif // MOCK_STM32_GPIO_H
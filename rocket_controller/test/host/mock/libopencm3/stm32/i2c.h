@@ -0,0 +1,70 @@
+/** 
+ * @file i2c.h
+ * @brief Host stand-in for libopencm3/stm32/i2c.h
+ */
+
+
+#ifndef MOCK_STM32_I2C_H
+#define MOCK_STM32_I2C_H
+
+
+#include "libopencm3/cm3/common.h"
+
+#define I2C1 0x40005400
+#define I2C2 0x40005800
+
+#define I2C_CR1(i2c) MMIO32((i2c) + 0x00)
+#define I2C_CR2(i2c) MMIO32((i2c) + 0x04)
+#define I2C_DR(i2c) MMIO32((i2c) + 0x10)
+#define I2C_SR1(i2c) MMIO32((i2c) + 0x14)
+#define I2C_SR2(i2c) MMIO32((i2c) + 0x18)
+
+#define I2C_CR1_START (1 << 8)
+#define I2C_CR1_STOP (1 << 9)
+#define I2C_CR1_ACK (1 << 10)
+
+#define I2C_CR2_ITERREN (1 << 8)
+#define I2C_CR2_ITEVTEN (1 << 9)
+#define I2C_CR2_ITBUFEN (1 << 10)
+
+#define I2C_SR1_SB (1 << 0)
+#define I2C_SR1_ADDR (1 << 1)
+#define I2C_SR1_BTF (1 << 2)
+#define I2C_SR1_RxNE (1 << 6)
+#define I2C_SR1_TxE (1 << 7)
+#define I2C_SR1_BERR (1 << 8)
+#define I2C_SR1_ARLO (1 << 9)
+#define I2C_SR1_AF (1 << 10)
+#define I2C_SR1_OVR (1 << 11)
+#define I2C_SR1_TIMEOUT (1 << 14)
+
+#define I2C_SR2_BUSY (1 << 1)
+
+#define I2C_WRITE 0
+#define I2C_READ 1
+
+enum i2c_speeds {
+    i2c_speed_sm_100k,
+    i2c_speed_fm_400k,
+};
+
+void i2c_reset(uint32_t i2c);
+void i2c_peripheral_enable(uint32_t i2c);
+void i2c_peripheral_disable(uint32_t i2c);
+void i2c_set_speed(uint32_t i2c, enum i2c_speeds speed, uint32_t clock_megahz);
+void i2c_send_start(uint32_t i2c);
+void i2c_send_stop(uint32_t i2c);
+void i2c_send_7bit_address(uint32_t i2c, uint8_t slave, uint8_t readwrite);
+void i2c_send_data(uint32_t i2c, uint8_t data);
+uint8_t i2c_get_data(uint32_t i2c);
+void i2c_enable_ack(uint32_t i2c);
+void i2c_disable_ack(uint32_t i2c);
+void i2c_enable_interrupt(uint32_t i2c, uint32_t interrupt);
+void i2c_disable_interrupt(uint32_t i2c, uint32_t interrupt);
+void i2c_enable_dma(uint32_t i2c);
+void i2c_disable_dma(uint32_t i2c);
+void i2c_set_dma_last_transfer(uint32_t i2c);
+void i2c_clear_dma_last_transfer(uint32_t i2c);
+
+
+#endif // MOCK_STM32_I2C_H
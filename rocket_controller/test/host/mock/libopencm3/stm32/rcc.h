@@ -0,0 +1,38 @@
+/** 
+ * @file rcc.h
+ * @brief Host stand-in for libopencm3/stm32/rcc.h
+ */
+
+
+#ifndef MOCK_STM32_RCC_H
+#define MOCK_STM32_RCC_H
+
+
+#include <stdint.h>
+
+enum rcc_periph_clken {
+    RCC_GPIOA, RCC_GPIOB, RCC_GPIOC, RCC_AFIO, RCC_USB, RCC_DMA1,
+    RCC_SPI1, RCC_SPI2, RCC_I2C1, RCC_I2C2,
+};
+
+struct rcc_clock_scale {
+    uint32_t ahb_frequency;
+    uint32_t apb1_frequency;
+    uint32_t apb2_frequency;
+};
+
+enum rcc_clock_hse {
+    RCC_CLOCK_HSE8_72MHZ,
+    RCC_CLOCK_HSE_END,
+};
+
+extern const struct rcc_clock_scale rcc_hse_configs[RCC_CLOCK_HSE_END];
+extern uint32_t rcc_ahb_frequency;
+extern uint32_t rcc_apb1_frequency;
+extern uint32_t rcc_apb2_frequency;
+
+void rcc_clock_setup_pll(const struct rcc_clock_scale *clock);
+void rcc_periph_clock_enable(enum rcc_periph_clken clken);
+
+
+#endif // MOCK_STM32_RCC_H
@@ -0,0 +1,47 @@
+/** 
+ * @file spi.h
+ * @brief Host stand-in for libopencm3/stm32/spi.h
+ */
+
+
+#ifndef MOCK_STM32_SPI_H
+#define MOCK_STM32_SPI_H
+
+
+#include "libopencm3/cm3/common.h"
+
+#define SPI1 0x40013000
+#define SPI2 0x40003800
+
+#define SPI_CR1(spi) MMIO32((spi) + 0x00)
+#define SPI_SR(spi) MMIO32((spi) + 0x08)
+#define SPI_DR(spi) MMIO32((spi) + 0x0c)
+
+#define SPI_SR_RXNE (1 << 0)
+#define SPI_SR_TXE (1 << 1)
+#define SPI_SR_BSY (1 << 7)
+
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_2 (0 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_4 (1 << 3)
+#define SPI_CR1_BAUDRATE_FPCLK_DIV_8 (2 << 3)
+#define SPI_CR1_CPOL_CLK_TO_0_WHEN_IDLE (0 << 1)
+#define SPI_CR1_CPOL_CLK_TO_1_WHEN_IDLE (1 << 1)
+#define SPI_CR1_CPHA_CLK_TRANSITION_1 (0 << 0)
+#define SPI_CR1_CPHA_CLK_TRANSITION_2 (1 << 0)
+#define SPI_CR1_DFF_8BIT (0 << 11)
+#define SPI_CR1_MSBFIRST (0 << 7)
+
+void spi_reset(uint32_t spi);
+int spi_init_master(uint32_t spi, uint32_t br, uint32_t cpol, uint32_t cpha, uint32_t dff, uint32_t lsbfirst);
+void spi_enable(uint32_t spi);
+void spi_disable(uint32_t spi);
+void spi_enable_software_slave_management(uint32_t spi);
+void spi_set_nss_high(uint32_t spi);
+uint16_t spi_xfer(uint32_t spi, uint16_t data);
+void spi_enable_rx_dma(uint32_t spi);
+void spi_enable_tx_dma(uint32_t spi);
+void spi_disable_rx_dma(uint32_t spi);
+void spi_disable_tx_dma(uint32_t spi);
+
+
+#endif // MOCK_STM32_SPI_H
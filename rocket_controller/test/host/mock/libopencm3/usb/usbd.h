@@ -0,0 +1,152 @@
+/** 
+ * @file usbd.h
+ * @brief Host stand-in for libopencm3/usb/usbd.h
+ */
+
+
+#ifndef MOCK_USB_USBD_H
+#define MOCK_USB_USBD_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct _usbd_device usbd_device;
+typedef struct _usbd_driver usbd_driver;
+
+extern const usbd_driver st_usbfs_v1_usb_driver;
+
+struct usb_setup_data {
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+} __attribute__((packed));
+
+enum usbd_request_return_codes {
+    USBD_REQ_NOTSUPP = 0,
+    USBD_REQ_HANDLED = 1,
+    USBD_REQ_NEXT_CALLBACK = 2,
+};
+
+typedef void (*usbd_endpoint_callback)(usbd_device *usbd_dev, uint8_t ep);
+typedef void (*usbd_set_config_callback)(usbd_device *usbd_dev, uint16_t wValue);
+typedef void (*usbd_control_complete_callback)(usbd_device *usbd_dev, struct usb_setup_data *req);
+typedef enum usbd_request_return_codes (*usbd_control_callback)(usbd_device *usbd_dev,
+        struct usb_setup_data *req, uint8_t **buf, uint16_t *len, usbd_control_complete_callback *complete);
+
+struct usb_device_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} __attribute__((packed));
+
+struct usb_endpoint_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bEndpointAddress;
+    uint8_t bmAttributes;
+    uint16_t wMaxPacketSize;
+    uint8_t bInterval;
+    const void *extra;
+    int extralen;
+} __attribute__((packed));
+
+struct usb_iface_assoc_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bFirstInterface;
+    uint8_t bInterfaceCount;
+    uint8_t bFunctionClass;
+    uint8_t bFunctionSubClass;
+    uint8_t bFunctionProtocol;
+    uint8_t iFunction;
+} __attribute__((packed));
+
+struct usb_interface_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bInterfaceNumber;
+    uint8_t bAlternateSetting;
+    uint8_t bNumEndpoints;
+    uint8_t bInterfaceClass;
+    uint8_t bInterfaceSubClass;
+    uint8_t bInterfaceProtocol;
+    uint8_t iInterface;
+    const struct usb_endpoint_descriptor *endpoint;
+    const void *extra;
+    int extralen;
+} __attribute__((packed));
+
+struct usb_interface {
+    uint8_t *cur_altsetting;
+    uint8_t num_altsetting;
+    const struct usb_iface_assoc_descriptor *iface_assoc;
+    const struct usb_interface_descriptor *altsetting;
+};
+
+struct usb_config_descriptor {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t wTotalLength;
+    uint8_t bNumInterfaces;
+    uint8_t bConfigurationValue;
+    uint8_t iConfiguration;
+    uint8_t bmAttributes;
+    uint8_t bMaxPower;
+    const struct usb_interface *interface;
+} __attribute__((packed));
+
+#define USB_DT_DEVICE 1
+#define USB_DT_CONFIGURATION 2
+#define USB_DT_INTERFACE 4
+#define USB_DT_ENDPOINT 5
+#define USB_DT_INTERFACE_ASSOCIATION 11
+#define USB_DT_DEVICE_SIZE 18
+#define USB_DT_CONFIGURATION_SIZE 9
+#define USB_DT_INTERFACE_SIZE 9
+#define USB_DT_ENDPOINT_SIZE 7
+#define USB_DT_INTERFACE_ASSOCIATION_SIZE 8
+
+#define USB_ENDPOINT_ATTR_CONTROL 0
+#define USB_ENDPOINT_ATTR_BULK 2
+#define USB_ENDPOINT_ATTR_INTERRUPT 3
+
+#define USB_CLASS_CDC 0x02
+#define USB_CLASS_DATA 0x0a
+#define USB_CLASS_MISCELLANEOUS 0xef
+
+#define USB_REQ_TYPE_IN 0x80
+#define USB_REQ_TYPE_CLASS 0x20
+#define USB_REQ_TYPE_INTERFACE 0x01
+#define USB_REQ_TYPE_TYPE 0x60
+#define USB_REQ_TYPE_RECIPIENT 0x1f
+
+usbd_device *usbd_init(const usbd_driver *driver, const struct usb_device_descriptor *dev,
+                       const struct usb_config_descriptor *conf, const char * const *strings, int num_strings,
+                       uint8_t *control_buffer, uint16_t control_buffer_size);
+int usbd_register_set_config_callback(usbd_device *usbd_dev, usbd_set_config_callback callback);
+void usbd_register_sof_callback(usbd_device *usbd_dev, void (*callback)(void));
+int usbd_register_control_callback(usbd_device *usbd_dev, uint8_t type, uint8_t type_mask,
+                                   usbd_control_callback callback);
+void usbd_poll(usbd_device *usbd_dev);
+void usbd_ep_setup(usbd_device *usbd_dev, uint8_t addr, uint8_t type, uint16_t max_size,
+                   usbd_endpoint_callback callback);
+uint16_t usbd_ep_write_packet(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len);
+uint16_t usbd_ep_read_packet(usbd_device *usbd_dev, uint8_t addr, void *buf, uint16_t len);
+void usbd_ep_nak_set(usbd_device *usbd_dev, uint8_t addr, uint8_t nak);
+
+
+#endif // MOCK_USB_USBD_H
@@ -0,0 +1,363 @@
+/** 
+ * @file lsm6ds3_sim.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Implementation of the simulated LSM6DS3TR-C on SPI 1
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "spi1_dma.h"
+
+#include "lsm6ds3_sim.h"
+
+#define REG_FIFO_CTRL1      0x06
+#define REG_FIFO_CTRL2      0x07
+#define REG_FIFO_CTRL4      0x09
+#define REG_FIFO_CTRL5      0x0A
+#define REG_WHO_AM_I        0x0F
+#define REG_CTRL3_C         0x12
+#define REG_FIFO_STATUS1    0x3A
+#define REG_FIFO_DATA_OUT_L 0x3E
+#define REG_FIFO_DATA_OUT_H 0x3F
+
+#define WHO_AM_I_LSM6DS3TR  0x6A
+#define CTRL3_C_SW_RESET    0x01
+#define FIFO_CTRL5_MODE     0x07
+#define FIFO_CTRL5_ODR_SHIFT 3
+#define FIFO_CTRL4_DS3_MASK 0x07
+
+#define STATUS2_WATERMARK   0x80
+#define STATUS2_OVER_RUN    0x40
+#define STATUS2_EMPTY       0x10
+
+/// 4 KB of FIFO
+#define FIFO_WORDS 2048
+
+/// Slot times kept for lsm6ds3_sim_slot_time()
+#define SLOT_TIMES 4096
+
+/// Words per data set
+#define SET_WORDS 3
+
+/// The 1666 Hz period, each lower rate code doubles it
+#define PERIOD_1666_NS 600000ULL
+
+static uint8_t g_regs[128];
+
+static uint64_t g_now_ns = 0;
+static uint32_t g_spi_hz = LSM6DS3_SIM_SPI_HZ;
+
+/// FIFO contents, the pattern position of the oldest word and the overrun flag
+static int16_t g_fifo[FIFO_WORDS];
+static uint32_t g_fifo_head = 0;
+static uint32_t g_fifo_count = 0;
+static uint16_t g_read_pos = 0;
+static bool g_over_run = false;
+
+/// The next slot to be taken and when
+static uint32_t g_slot = 0;
+static uint64_t g_next_slot_ns = 0;
+static uint64_t g_slot_ns[SLOT_TIMES];
+
+/// The burst in progress
+static bool g_busy = false;
+static uint64_t g_burst_end_ns = 0;
+static spi1_dma_done_cb_t g_done = NULL;
+
+static lsm6ds3_sim_stats_t g_stats;
+
+/** 
+ * @brief Get the data set 3 decimation set in FIFO_CTRL4
+ * 
+ * @return the decimation, 0 if data set 3 is not in the FIFO
+ */
+static uint32_t lsm6ds3_sim_hub_dec(void) {
+    static const uint8_t dec[8] = { 0, 1, 2, 3, 4, 8, 16, 32 };
+    return dec[g_regs[REG_FIFO_CTRL4] & FIFO_CTRL4_DS3_MASK];
+}
+
+/** 
+ * @brief Get the number of words in one repeat of the FIFO pattern
+ * 
+ * @return the pattern length
+ */
+static uint32_t lsm6ds3_sim_pattern_len(void) {
+    uint32_t dec = lsm6ds3_sim_hub_dec();
+    return dec ? dec * 2 * SET_WORDS + SET_WORDS : 2 * SET_WORDS;
+}
+
+/** 
+ * @brief Get the FIFO slot period, 0 if the FIFO is off
+ * 
+ * @return the period in ns
+ */
+static uint64_t lsm6ds3_sim_period_ns(void) {
+    uint8_t ctrl5 = g_regs[REG_FIFO_CTRL5];
+    uint8_t odr = (ctrl5 >> FIFO_CTRL5_ODR_SHIFT) & 0x0f;
+    if ((ctrl5 & FIFO_CTRL5_MODE) == 0 || odr < 2 || odr > 8) {
+        return 0;
+    }
+    return PERIOD_1666_NS << (8 - odr);
+}
+
+/** 
+ * @brief Empty the FIFO and restart the pattern
+ * 
+ */
+static void lsm6ds3_sim_fifo_clear(void) {
+    g_fifo_head = g_fifo_count = 0;
+    g_read_pos = 0;
+    g_over_run = false;
+}
+
+/** 
+ * @brief Store a word, losing the oldest if the FIFO is full
+ * @param word the word
+ * 
+ */
+static void lsm6ds3_sim_fifo_push(int16_t word) {
+    if (g_fifo_count == FIFO_WORDS) {
+        g_fifo_head = (g_fifo_head + 1) % FIFO_WORDS;
+        g_fifo_count--;
+        g_read_pos = (g_read_pos + 1) % lsm6ds3_sim_pattern_len();
+        g_over_run = true;
+        g_stats.overrun_words++;
+    }
+    g_fifo[(g_fifo_head + g_fifo_count) % FIFO_WORDS] = word;
+    g_fifo_count++;
+    if (g_fifo_count > g_stats.max_level) {
+        g_stats.max_level = g_fifo_count;
+    }
+}
+
+/** 
+ * @brief Take the slots that are due, storing them if the FIFO is on
+ * 
+ */
+static void lsm6ds3_sim_take_slots(void) {
+    uint64_t period = lsm6ds3_sim_period_ns();
+    if (period == 0) {
+        g_next_slot_ns = g_now_ns;
+        return;
+    }
+
+    while (g_next_slot_ns <= g_now_ns) {
+        uint32_t slot = g_slot++;
+        g_slot_ns[slot % SLOT_TIMES] = g_next_slot_ns;
+        g_next_slot_ns += period;
+
+        // The pattern position the first word of this slot lands on
+        uint32_t len = lsm6ds3_sim_pattern_len();
+        uint32_t pos = (g_read_pos + g_fifo_count) % len;
+        int16_t lo = (int16_t)(slot & 0x7fff);
+        int16_t hi = (int16_t)((slot >> 15) & 0x7fff);
+
+        lsm6ds3_sim_fifo_push(lo);
+        lsm6ds3_sim_fifo_push(hi);
+        lsm6ds3_sim_fifo_push(1);
+        lsm6ds3_sim_fifo_push(-lo);
+        lsm6ds3_sim_fifo_push(2);
+        lsm6ds3_sim_fifo_push(3);
+        if (lsm6ds3_sim_hub_dec() != 0 && pos == 0) {
+            lsm6ds3_sim_fifo_push(lo);
+            lsm6ds3_sim_fifo_push(hi);
+            lsm6ds3_sim_fifo_push(7);
+        }
+        g_stats.slots++;
+    }
+}
+
+/** 
+ * @brief Move the clock on by a number of SPI bytes, as a blocking access does
+ * @param bytes the bytes clocked
+ * 
+ */
+static void lsm6ds3_sim_clock_bytes(uint32_t bytes) {
+    uint64_t ns = (uint64_t)bytes * 8 * 1000000000ULL / g_spi_hz;
+    g_stats.bus_ns += ns;
+    g_now_ns += ns;
+    lsm6ds3_sim_take_slots();
+}
+
+/** 
+ * @brief Get the watermark set in FIFO_CTRL1/2
+ * 
+ * @return the watermark in words
+ */
+static uint32_t lsm6ds3_sim_watermark(void) {
+    return g_regs[REG_FIFO_CTRL1] | ((g_regs[REG_FIFO_CTRL2] & 0x07) << 8);
+}
+
+/** 
+ * @brief Read a register as the SPI interface would
+ * @param reg the register address
+ * 
+ * @return the value
+ */
+static uint8_t lsm6ds3_sim_reg(uint8_t reg) {
+    uint32_t unread = g_fifo_count;
+
+    switch (reg) {
+    case REG_FIFO_STATUS1:
+        return unread & 0xff;
+    case REG_FIFO_STATUS1 + 1:
+        return ((unread >> 8) & 0x07) | (unread == 0 ? STATUS2_EMPTY : 0)
+               | (g_over_run ? STATUS2_OVER_RUN : 0)
+               | (unread >= lsm6ds3_sim_watermark() ? STATUS2_WATERMARK : 0);
+    case REG_FIFO_STATUS1 + 2:
+        return g_read_pos & 0xff;
+    case REG_FIFO_STATUS1 + 3:
+        return (g_read_pos >> 8) & 0x03;
+    case REG_WHO_AM_I:
+        return WHO_AM_I_LSM6DS3TR;
+    default:
+        return g_regs[reg & 0x7f];
+    }
+}
+
+/** 
+ * @brief Pop the oldest FIFO word
+ * 
+ * @return the word, 0 if the FIFO is empty
+ */
+static int16_t lsm6ds3_sim_fifo_pop(void) {
+    if (g_fifo_count == 0) {
+        return 0;
+    }
+    int16_t word = g_fifo[g_fifo_head];
+    g_fifo_head = (g_fifo_head + 1) % FIFO_WORDS;
+    g_fifo_count--;
+    g_read_pos = (g_read_pos + 1) % lsm6ds3_sim_pattern_len();
+    g_over_run = false;
+    return word;
+}
+
+void lsm6ds3_sim_reset(uint32_t spi_hz) {
+    memset(g_regs, 0, sizeof(g_regs));
+    memset(&g_stats, 0, sizeof(g_stats));
+    g_now_ns = 0;
+    g_spi_hz = spi_hz;
+    lsm6ds3_sim_fifo_clear();
+    g_slot = 0;
+    g_next_slot_ns = 0;
+    g_busy = false;
+    g_done = NULL;
+}
+
+void lsm6ds3_sim_advance(uint32_t us) {
+    uint64_t end = g_now_ns + (uint64_t)us * 1000;
+
+    if (g_busy && g_burst_end_ns <= end) {
+        g_now_ns = g_burst_end_ns;
+        lsm6ds3_sim_take_slots();
+        g_busy = false;
+        if (g_done != NULL) {
+            g_done();
+        }
+    }
+    if (g_now_ns < end) {
+        g_now_ns = end;
+    }
+    lsm6ds3_sim_take_slots();
+}
+
+uint64_t lsm6ds3_sim_now(void) {
+    return g_now_ns / 1000;
+}
+
+uint32_t lsm6ds3_sim_slot_of(const int16_t *gyro) {
+    return (uint32_t)(uint16_t)gyro[0] | ((uint32_t)(uint16_t)gyro[1] << 15);
+}
+
+uint64_t lsm6ds3_sim_slot_time(uint32_t slot) {
+    return g_slot_ns[slot % SLOT_TIMES] / 1000;
+}
+
+uint32_t lsm6ds3_sim_level(void) {
+    return g_fifo_count;
+}
+
+void lsm6ds3_sim_get_stats(lsm6ds3_sim_stats_t *stats) {
+    *stats = g_stats;
+}
+
+void spi1_dma_init(void) {
+}
+
+void spi1_write_reg(uint8_t reg, uint8_t val) {
+    if (g_busy) {
+        g_stats.violations++;
+    }
+    g_stats.reg_writes++;
+    lsm6ds3_sim_clock_bytes(2);
+
+    reg &= 0x7f;
+    if (reg == REG_CTRL3_C && (val & CTRL3_C_SW_RESET)) {
+        memset(g_regs, 0, sizeof(g_regs));
+        lsm6ds3_sim_fifo_clear();
+        return;
+    }
+    g_regs[reg] = val;
+
+    if (reg == REG_FIFO_CTRL5 && (val & FIFO_CTRL5_MODE) == 0) {
+        lsm6ds3_sim_fifo_clear();
+    }
+}
+
+uint8_t spi1_read_reg(uint8_t reg) {
+    if (g_busy) {
+        g_stats.violations++;
+    }
+    g_stats.reg_reads++;
+    lsm6ds3_sim_clock_bytes(2);
+
+    return lsm6ds3_sim_reg(reg);
+}
+
+bool spi1_dma_read(uint8_t reg, uint8_t *buf, size_t len, spi1_dma_done_cb_t done) {
+    if (g_busy || len == 0) {
+        if (g_busy) {
+            g_stats.violations++;
+        }
+        return false;
+    }
+
+    // The data is taken as the burst starts, the caller only looks at it
+    // once done has been called
+    uint8_t addr = reg & 0x7f;
+    int16_t word = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (addr == REG_FIFO_DATA_OUT_L) {
+            if (g_fifo_count == 0) {
+                g_stats.stale_words++;
+            }
+            word = lsm6ds3_sim_fifo_pop();
+            buf[i] = (uint16_t)word & 0xff;
+            addr = REG_FIFO_DATA_OUT_H;
+        } else if (addr == REG_FIFO_DATA_OUT_H) {
+            buf[i] = ((uint16_t)word >> 8) & 0xff;
+            addr = REG_FIFO_DATA_OUT_L;
+        } else {
+            buf[i] = lsm6ds3_sim_reg(addr);
+            addr++;
+        }
+    }
+
+    uint64_t ns = (uint64_t)(len + 1) * 8 * 1000000000ULL / g_spi_hz;
+    g_stats.bursts++;
+    g_stats.burst_bytes += len + 1;
+    g_stats.bus_ns += ns;
+    g_busy = true;
+    g_burst_end_ns = g_now_ns + ns;
+    g_done = done;
+    return true;
+}
+
+bool spi1_dma_busy(void) {
+    return g_busy;
+}
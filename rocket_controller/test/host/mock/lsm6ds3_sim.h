@@ -0,0 +1,91 @@
+/** 
+ * @file lsm6ds3_sim.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Declarations for the simulated LSM6DS3TR-C on SPI 1
+ *
+ * lsm6ds3_sim.c replaces src/spi1_dma.c in host builds. Behind the spi1_dma.h
+ * functions sits a model of the sensor registers the driver uses and of its
+ * FIFO, which fills with gyro, accel and (with data set 3 enabled) mag words
+ * in the TR-C pattern order at the rate set in FIFO_CTRL5. Time is a
+ * simulated clock that only moves when lsm6ds3_sim_advance() is called or a
+ * blocking register access clocks its two bytes out. A DMA burst takes the
+ * time of its bytes at the SPI clock and its callback runs from
+ * lsm6ds3_sim_advance() once that time has passed, as the DMA interrupt would.
+ *
+ * Every ODR slot carries its own number in the gyro x and y words, so a test
+ * can tell which slots it got and when each was taken.
+ */
+
+
+#ifndef LSM6DS3_SIM_H
+#define LSM6DS3_SIM_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// SPI 1 clock of the firmware, 72 MHz / 8
+#define LSM6DS3_SIM_SPI_HZ 9000000
+
+/// Counters kept by the simulator
+typedef struct {
+    uint32_t reg_reads;
+    uint32_t reg_writes;
+    uint32_t bursts;
+    uint64_t burst_bytes;   ///< Bytes clocked by bursts, with the address byte
+    uint64_t bus_ns;        ///< Time SPI 1 was busy, bursts and register accesses
+    uint32_t slots;         ///< ODR slots stored in the FIFO
+    uint32_t max_level;     ///< Most words waiting in the FIFO
+    uint32_t overrun_words; ///< Words lost to a full FIFO
+    uint32_t stale_words;   ///< Words a burst read past the unread count
+    uint32_t violations;    ///< Register accesses or bursts started while a burst was running
+} lsm6ds3_sim_stats_t;
+
+/** 
+ * @brief Power up the sensor with an empty FIFO and the clock at 0
+ * @param spi_hz the SPI clock
+ */
+void lsm6ds3_sim_reset(uint32_t spi_hz);
+
+/** 
+ * @brief Move the simulated clock forward, storing the slots that fall in
+ * that time and finishing a burst that ends in it
+ * @param us the microseconds to advance
+ */
+void lsm6ds3_sim_advance(uint32_t us);
+
+/** 
+ * @brief Get the simulated clock
+ * @return microseconds since the reset
+ */
+uint64_t lsm6ds3_sim_now(void);
+
+/** 
+ * @brief Get the slot number a sample was taken from
+ * @param gyro the gyro words of the sample
+ * @return the slot number, counted from the reset
+ */
+uint32_t lsm6ds3_sim_slot_of(const int16_t *gyro);
+
+/** 
+ * @brief Get the time a slot was taken, only kept for the last 4096 slots
+ * @param slot the slot number
+ * @return the time in us
+ */
+uint64_t lsm6ds3_sim_slot_time(uint32_t slot);
+
+/** 
+ * @brief Get the words waiting in the FIFO
+ * @return the FIFO level
+ */
+uint32_t lsm6ds3_sim_level(void);
+
+/** 
+ * @brief Get a snapshot of the simulator counters
+ * @param stats the struct to fill
+ */
+void lsm6ds3_sim_get_stats(lsm6ds3_sim_stats_t *stats);
+
+
+#endif // LSM6DS3_SIM_H
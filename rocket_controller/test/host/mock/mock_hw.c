@@ -0,0 +1,200 @@
+/** 
+ * @file mock_hw.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-23
+ * @brief Do nothing definitions of the libopencm3 calls for host builds
+ *
+ * Every call is weak so a test can model the peripheral it is testing by
+ * defining the calls it cares about.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <libopencm3/cm3/common.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/dwt.h>
+#include <libopencm3/cm3/systick.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/exti.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/stm32/spi.h>
+#include <libopencm3/stm32/i2c.h>
+#include <libopencm3/usb/usbd.h>
+
+#include "mock_hw.h"
+
+#define WEAK __attribute__((weak))
+
+/// Registers touched by the firmware, found by address
+#define MOCK_MMIO_MAX 128
+
+static struct {
+    uint32_t addr;
+    volatile uint32_t value;
+} g_mmio[MOCK_MMIO_MAX];
+
+static int g_mmio_count = 0;
+
+volatile bool mock_irq_masked = false;
+
+volatile uint32_t *mock_mmio32(uint32_t addr) {
+    for (int i = 0; i < g_mmio_count; i++) {
+        if (g_mmio[i].addr == addr) {
+            return &g_mmio[i].value;
+        }
+    }
+    if (g_mmio_count == MOCK_MMIO_MAX) {
+        fprintf(stderr, "mock_mmio32: too many registers\n");
+        exit(2);
+    }
+    g_mmio[g_mmio_count].addr = addr;
+    return &g_mmio[g_mmio_count++].value;
+}
+
+const struct rcc_clock_scale rcc_hse_configs[RCC_CLOCK_HSE_END] = {
+    [RCC_CLOCK_HSE8_72MHZ] = { .ahb_frequency = 72000000, .apb1_frequency = 36000000, .apb2_frequency = 72000000 },
+};
+uint32_t rcc_ahb_frequency = 72000000;
+uint32_t rcc_apb1_frequency = 36000000;
+uint32_t rcc_apb2_frequency = 72000000;
+
+WEAK void rcc_clock_setup_pll(const struct rcc_clock_scale *clock) { (void)clock; }
+WEAK void rcc_periph_clock_enable(enum rcc_periph_clken clken) { (void)clken; }
+
+WEAK void nvic_enable_irq(uint8_t irqn) { (void)irqn; }
+WEAK void nvic_disable_irq(uint8_t irqn) { (void)irqn; }
+WEAK void nvic_clear_pending_irq(uint8_t irqn) { (void)irqn; }
+WEAK void nvic_set_priority(uint8_t irqn, uint8_t priority) { (void)irqn; (void)priority; }
+WEAK uint8_t nvic_get_irq_enabled(uint8_t irqn) { (void)irqn; return 1; }
+
+WEAK bool dwt_enable_cycle_counter(void) { return true; }
+WEAK uint32_t dwt_read_cycle_counter(void) { return DWT_CYCCNT; }
+
+WEAK void systick_set_clocksource(uint8_t clocksource) { (void)clocksource; }
+WEAK void systick_set_reload(uint32_t value) { STK_RVR = value; }
+WEAK void systick_interrupt_enable(void) {}
+WEAK void systick_counter_enable(void) {}
+WEAK uint32_t systick_get_value(void) { return STK_CVR; }
+
+WEAK void gpio_set(uint32_t gpioport, uint16_t gpios) { (void)gpioport; (void)gpios; }
+WEAK void gpio_clear(uint32_t gpioport, uint16_t gpios) { (void)gpioport; (void)gpios; }
+WEAK uint16_t gpio_get(uint32_t gpioport, uint16_t gpios) { (void)gpioport; (void)gpios; return 0; }
+WEAK void gpio_toggle(uint32_t gpioport, uint16_t gpios) { (void)gpioport; (void)gpios; }
+WEAK void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios) {
+    (void)gpioport; (void)mode; (void)cnf; (void)gpios;
+}
+
+WEAK void exti_set_trigger(uint32_t extis, enum exti_trigger_type trig) { (void)extis; (void)trig; }
+WEAK void exti_enable_request(uint32_t extis) { (void)extis; }
+WEAK void exti_disable_request(uint32_t extis) { (void)extis; }
+WEAK void exti_reset_request(uint32_t extis) { (void)extis; }
+WEAK void exti_select_source(uint32_t exti, uint32_t gpioport) { (void)exti; (void)gpioport; }
+WEAK uint32_t exti_get_flag_status(uint32_t exti) { (void)exti; return 0; }
+
+WEAK void dma_channel_reset(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_clear_interrupt_flags(uint32_t dma, uint8_t channel, uint32_t interrupts) {
+    (void)dma; (void)channel; (void)interrupts;
+}
+WEAK bool dma_get_interrupt_flag(uint32_t dma, uint8_t channel, uint32_t interrupts) {
+    (void)dma; (void)channel; (void)interrupts; return false;
+}
+WEAK void dma_set_peripheral_address(uint32_t dma, uint8_t channel, uint32_t address) {
+    (void)dma; (void)channel; (void)address;
+}
+WEAK void dma_set_memory_address(uint32_t dma, uint8_t channel, uint32_t address) {
+    (void)dma; (void)channel; (void)address;
+}
+WEAK void dma_set_number_of_data(uint32_t dma, uint8_t channel, uint16_t number) {
+    DMA_CNDTR(dma, channel) = number;
+}
+WEAK void dma_set_read_from_peripheral(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_set_read_from_memory(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_enable_memory_increment_mode(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_disable_memory_increment_mode(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_set_peripheral_size(uint32_t dma, uint8_t channel, uint32_t peripheral_size) {
+    (void)dma; (void)channel; (void)peripheral_size;
+}
+WEAK void dma_set_memory_size(uint32_t dma, uint8_t channel, uint32_t mem_size) {
+    (void)dma; (void)channel; (void)mem_size;
+}
+WEAK void dma_set_priority(uint32_t dma, uint8_t channel, uint32_t prio) { (void)dma; (void)channel; (void)prio; }
+WEAK void dma_enable_transfer_complete_interrupt(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_enable_transfer_error_interrupt(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_enable_channel(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+WEAK void dma_disable_channel(uint32_t dma, uint8_t channel) { (void)dma; (void)channel; }
+
+WEAK void spi_reset(uint32_t spi) { (void)spi; }
+WEAK int spi_init_master(uint32_t spi, uint32_t br, uint32_t cpol, uint32_t cpha, uint32_t dff, uint32_t lsbfirst) {
+    (void)spi; (void)br; (void)cpol; (void)cpha; (void)dff; (void)lsbfirst; return 0;
+}
+WEAK void spi_enable(uint32_t spi) { (void)spi; }
+WEAK void spi_disable(uint32_t spi) { (void)spi; }
+WEAK void spi_enable_software_slave_management(uint32_t spi) { (void)spi; }
+WEAK void spi_set_nss_high(uint32_t spi) { (void)spi; }
+WEAK uint16_t spi_xfer(uint32_t spi, uint16_t data) { (void)spi; (void)data; return 0; }
+WEAK void spi_enable_rx_dma(uint32_t spi) { (void)spi; }
+WEAK void spi_enable_tx_dma(uint32_t spi) { (void)spi; }
+WEAK void spi_disable_rx_dma(uint32_t spi) { (void)spi; }
+WEAK void spi_disable_tx_dma(uint32_t spi) { (void)spi; }
+
+WEAK void i2c_reset(uint32_t i2c) { (void)i2c; }
+WEAK void i2c_peripheral_enable(uint32_t i2c) { (void)i2c; }
+WEAK void i2c_peripheral_disable(uint32_t i2c) { (void)i2c; }
+WEAK void i2c_set_speed(uint32_t i2c, enum i2c_speeds speed, uint32_t clock_megahz) {
+    (void)i2c; (void)speed; (void)clock_megahz;
+}
+WEAK void i2c_send_start(uint32_t i2c) { I2C_CR1(i2c) |= I2C_CR1_START; }
+WEAK void i2c_send_stop(uint32_t i2c) { I2C_CR1(i2c) |= I2C_CR1_STOP; }
+WEAK void i2c_send_7bit_address(uint32_t i2c, uint8_t slave, uint8_t readwrite) {
+    I2C_DR(i2c) = (uint8_t)((slave << 1) | readwrite);
+}
+WEAK void i2c_send_data(uint32_t i2c, uint8_t data) { I2C_DR(i2c) = data; }
+WEAK uint8_t i2c_get_data(uint32_t i2c) { return I2C_DR(i2c) & 0xff; }
+WEAK void i2c_enable_ack(uint32_t i2c) { I2C_CR1(i2c) |= I2C_CR1_ACK; }
+WEAK void i2c_disable_ack(uint32_t i2c) { I2C_CR1(i2c) &= ~I2C_CR1_ACK; }
+WEAK void i2c_enable_interrupt(uint32_t i2c, uint32_t interrupt) { I2C_CR2(i2c) |= interrupt; }
+WEAK void i2c_disable_interrupt(uint32_t i2c, uint32_t interrupt) { I2C_CR2(i2c) &= ~interrupt; }
+WEAK void i2c_enable_dma(uint32_t i2c) { (void)i2c; }
+WEAK void i2c_disable_dma(uint32_t i2c) { (void)i2c; }
+WEAK void i2c_set_dma_last_transfer(uint32_t i2c) { (void)i2c; }
+WEAK void i2c_clear_dma_last_transfer(uint32_t i2c) { (void)i2c; }
+
+struct _usbd_driver {
+    int unused;
+};
+const usbd_driver st_usbfs_v1_usb_driver;
+
+WEAK usbd_device *usbd_init(const usbd_driver *driver, const struct usb_device_descriptor *dev,
+                            const struct usb_config_descriptor *conf, const char * const *strings, int num_strings,
+                            uint8_t *control_buffer, uint16_t control_buffer_size) {
+    (void)driver; (void)dev; (void)conf; (void)strings; (void)num_strings;
+    (void)control_buffer; (void)control_buffer_size;
+    return NULL;
+}
+WEAK int usbd_register_set_config_callback(usbd_device *usbd_dev, usbd_set_config_callback callback) {
+    (void)usbd_dev; (void)callback; return 0;
+}
+WEAK void usbd_register_sof_callback(usbd_device *usbd_dev, void (*callback)(void)) {
+    (void)usbd_dev; (void)callback;
+}
+WEAK int usbd_register_control_callback(usbd_device *usbd_dev, uint8_t type, uint8_t type_mask,
+                                        usbd_control_callback callback) {
+    (void)usbd_dev; (void)type; (void)type_mask; (void)callback; return 0;
+}
+WEAK void usbd_poll(usbd_device *usbd_dev) { (void)usbd_dev; }
+WEAK void usbd_ep_setup(usbd_device *usbd_dev, uint8_t addr, uint8_t type, uint16_t max_size,
+                        usbd_endpoint_callback callback) {
+    (void)usbd_dev; (void)addr; (void)type; (void)max_size; (void)callback;
+}
+WEAK uint16_t usbd_ep_write_packet(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len) {
+    (void)usbd_dev; (void)addr; (void)buf; return len;
+}
+WEAK uint16_t usbd_ep_read_packet(usbd_device *usbd_dev, uint8_t addr, void *buf, uint16_t len) {
+    (void)usbd_dev; (void)addr; (void)buf; (void)len; return 0;
+}
+WEAK void usbd_ep_nak_set(usbd_device *usbd_dev, uint8_t addr, uint8_t nak) { (void)usbd_dev; (void)addr; (void)nak; }
@@ -0,0 +1,33 @@
+/** 
+ * @file mock_hw.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-23
+ * @brief Host stand-ins for the libopencm3 hardware access used by the firmware
+ *
+ * The headers under mock/libopencm3 replace the real ones in host builds.
+ * Memory mapped registers are kept in a table by address, and every
+ * peripheral call has a weak do nothing definition in mock_hw.c that a
+ * test can replace with a model of the peripheral.
+ */
+
+
+#ifndef MOCK_HW_H
+#define MOCK_HW_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** 
+ * @brief Get the stand-in for a memory mapped register
+ * @param addr the address of the register
+ * 
+ * @return the register, all start at 0
+ */
+volatile uint32_t *mock_mmio32(uint32_t addr);
+
+/// true while the firmware has interrupts masked
+extern volatile bool mock_irq_masked;
+
+
+#endif // MOCK_HW_H
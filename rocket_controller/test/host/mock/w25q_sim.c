@@ -0,0 +1,289 @@
+/** 
+ * @file w25q_sim.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Implementation of the file backed W25Q128JV simulator
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "w25q.h"
+
+#include "w25q_sim.h"
+
+#define SECTOR_COUNT (W25Q_SIZE / W25Q_SECTOR_SIZE)
+
+const w25q_sim_timing_t w25q_sim_typical = {
+    .page_program = 400,
+    .sector_erase = 45000,
+    .block_erase = 150000,
+    .suspend = 20,
+};
+
+const w25q_sim_timing_t w25q_sim_worst = {
+    .page_program = 3000,
+    .sector_erase = 400000,
+    .block_erase = 2000000,
+    .suspend = 20,
+};
+
+typedef enum {
+    SIM_IDLE,
+    SIM_PROGRAMMING,
+    SIM_ERASING,
+    SIM_SUSPENDING,
+} sim_op_t;
+
+static uint8_t *g_image = NULL;
+static int g_fd = -1;
+
+static w25q_sim_timing_t g_timing;
+static uint64_t g_now = 0;
+
+/// The operation in progress and when it finishes
+static sim_op_t g_op = SIM_IDLE;
+static uint64_t g_done_at = 0;
+
+/// The erase in progress or suspended
+static uint32_t g_erase_addr = 0;
+static uint32_t g_erase_len = 0;
+static bool g_suspended = false;
+static uint64_t g_erase_left = 0;
+
+static uint32_t g_sector_erases[SECTOR_COUNT];
+
+static w25q_sim_stats_t g_stats;
+
+/** 
+ * @brief Finish the operation in progress if its time is up
+ * 
+ */
+static void w25q_sim_update(void) {
+    if (g_op == SIM_IDLE || g_now < g_done_at) {
+        return;
+    }
+
+    if (g_op == SIM_ERASING) {
+        memset(&g_image[g_erase_addr], 0xff, g_erase_len);
+        for (uint32_t s = 0; s < g_erase_len / W25Q_SECTOR_SIZE; s++) {
+            g_sector_erases[g_erase_addr / W25Q_SECTOR_SIZE + s]++;
+        }
+        g_stats.erases_done++;
+    } else if (g_op == SIM_SUSPENDING) {
+        g_suspended = true;
+    }
+    g_op = SIM_IDLE;
+}
+
+/** 
+ * @brief Check a command can be accepted, counting a violation if not
+ * 
+ * @return true if the flash is ready for a command
+ */
+static bool w25q_sim_ready(void) {
+    w25q_sim_update();
+    if (g_op != SIM_IDLE) {
+        g_stats.violations++;
+        return false;
+    }
+    return true;
+}
+
+/** 
+ * @brief Start an erase
+ * @param addr an address in the region
+ * @param len the size of the region
+ * @param time the time the erase takes
+ * 
+ * @return true if the erase was started
+ */
+static bool w25q_sim_erase(uint32_t addr, uint32_t len, uint32_t time) {
+    if (!w25q_sim_ready()) {
+        return false;
+    }
+    if (g_suspended) {
+        // Only reads and programs are allowed while an erase is suspended
+        g_stats.violations++;
+        return false;
+    }
+
+    g_erase_addr = (addr & (W25Q_SIZE - 1)) & ~(len - 1);
+    g_erase_len = len;
+    g_op = SIM_ERASING;
+    g_done_at = g_now + time;
+    return true;
+}
+
+int w25q_sim_open(const char *path, const w25q_sim_timing_t *timing) {
+    bool fresh = true;
+
+    if (path != NULL) {
+        g_fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (g_fd < 0) {
+            perror(path);
+            return 1;
+        }
+
+        struct stat st;
+        fstat(g_fd, &st);
+        if (st.st_size == W25Q_SIZE) {
+            fresh = false;
+        } else if (st.st_size != 0 || ftruncate(g_fd, W25Q_SIZE) != 0) {
+            fprintf(stderr, "%s: not a %lu byte image\n", path, W25Q_SIZE);
+            close(g_fd);
+            g_fd = -1;
+            return 1;
+        }
+        g_image = mmap(NULL, W25Q_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, g_fd, 0);
+    } else {
+        g_image = mmap(NULL, W25Q_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (g_image == MAP_FAILED) {
+        perror("mmap");
+        g_image = NULL;
+        return 1;
+    }
+    if (fresh) {
+        memset(g_image, 0xff, W25Q_SIZE);
+    }
+
+    g_timing = *timing;
+    g_now = 0;
+    g_op = SIM_IDLE;
+    g_suspended = false;
+    memset(g_sector_erases, 0, sizeof(g_sector_erases));
+    memset(&g_stats, 0, sizeof(g_stats));
+    return 0;
+}
+
+void w25q_sim_close(void) {
+    if (g_image != NULL) {
+        munmap(g_image, W25Q_SIZE);
+        g_image = NULL;
+    }
+    if (g_fd >= 0) {
+        close(g_fd);
+        g_fd = -1;
+    }
+}
+
+void w25q_sim_advance(uint32_t us) {
+    g_now += us;
+    w25q_sim_update();
+}
+
+uint64_t w25q_sim_now(void) {
+    return g_now;
+}
+
+uint8_t *w25q_sim_image(void) {
+    return g_image;
+}
+
+uint32_t w25q_sim_sector_erases(uint32_t sector) {
+    return g_sector_erases[sector % SECTOR_COUNT];
+}
+
+void w25q_sim_get_stats(w25q_sim_stats_t *stats) {
+    *stats = g_stats;
+}
+
+int w25q_init(void) {
+    return g_image == NULL;
+}
+
+void w25q_read(uint32_t addr, void *buf, size_t len) {
+    w25q_sim_ready();
+
+    // The read command carries on past the end of the array from address 0
+    uint8_t *out = buf;
+    for (size_t i = 0; i < len; i++) {
+        out[i] = g_image[(addr + i) & (W25Q_SIZE - 1)];
+    }
+}
+
+void w25q_page_program(uint32_t addr, const void *data, size_t len) {
+    const uint8_t *in = data;
+
+    if (!w25q_sim_ready()) {
+        return;
+    }
+    addr &= W25Q_SIZE - 1;
+    if (g_suspended && addr - g_erase_addr < g_erase_len) {
+        g_stats.violations++;
+        return;
+    }
+    if (len > W25Q_PAGE_SIZE - addr % W25Q_PAGE_SIZE) {
+        // The real part wraps to the start of the page
+        g_stats.violations++;
+        return;
+    }
+
+    // Programming can only clear bits
+    bool clean = true;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] & ~g_image[addr + i]) {
+            clean = false;
+        }
+        g_image[addr + i] &= in[i];
+    }
+    if (!clean) {
+        g_stats.violations++;
+    }
+
+    g_stats.page_programs++;
+    g_op = SIM_PROGRAMMING;
+    g_done_at = g_now + g_timing.page_program;
+}
+
+void w25q_erase_sector(uint32_t addr) {
+    if (w25q_sim_erase(addr, W25Q_SECTOR_SIZE, g_timing.sector_erase)) {
+        g_stats.sector_erases++;
+    }
+}
+
+void w25q_erase_block(uint32_t addr) {
+    if (w25q_sim_erase(addr, W25Q_BLOCK_SIZE, g_timing.block_erase)) {
+        g_stats.block_erases++;
+    }
+}
+
+void w25q_erase_suspend(void) {
+    w25q_sim_update();
+    if (g_op != SIM_ERASING) {
+        return;
+    }
+
+    g_stats.suspends++;
+    if (g_done_at - g_now <= g_timing.suspend) {
+        // Finishes before the suspend takes effect
+        return;
+    }
+    g_erase_left = g_done_at - g_now - g_timing.suspend;
+    g_op = SIM_SUSPENDING;
+    g_done_at = g_now + g_timing.suspend;
+}
+
+void w25q_erase_resume(void) {
+    if (!w25q_sim_ready() || !g_suspended) {
+        return;
+    }
+
+    g_suspended = false;
+    g_op = SIM_ERASING;
+    g_done_at = g_now + g_erase_left;
+}
+
+bool w25q_busy(void) {
+    w25q_sim_update();
+    return g_op != SIM_IDLE;
+}
@@ -0,0 +1,94 @@
+/** 
+ * @file w25q_sim.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Declarations for the file backed W25Q128JV simulator
+ *
+ * w25q_sim.c replaces src/w25q.c in host builds. The 16 MB array is a file
+ * mapped into memory so an image survives between runs and can be looked at
+ * with a hex editor. Programs, erases and suspends take the time given by a
+ * w25q_sim_timing_t on a simulated microsecond clock that only moves when
+ * w25q_sim_advance() is called, so a test decides how fast the firmware
+ * services the flash. Anything the real part would ignore or corrupt (a
+ * command while busy, programming bits that are not erased, programming
+ * inside a suspended erase) is counted as a violation.
+ */
+
+
+#ifndef W25Q_SIM_H
+#define W25Q_SIM_H
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/// How long each operation keeps the flash busy, in us
+typedef struct {
+    uint32_t page_program;
+    uint32_t sector_erase;
+    uint32_t block_erase;
+    uint32_t suspend;       ///< From the suspend command to busy clearing
+} w25q_sim_timing_t;
+
+/// Typical and maximum times from the W25Q128JV datasheet
+extern const w25q_sim_timing_t w25q_sim_typical;
+extern const w25q_sim_timing_t w25q_sim_worst;
+
+/// Counters kept by the simulator
+typedef struct {
+    uint32_t page_programs;
+    uint32_t sector_erases;
+    uint32_t block_erases;
+    uint32_t suspends;
+    uint32_t erases_done;   ///< Erases that have run to completion
+    uint32_t violations;    ///< Operations the real part would not carry out as asked
+} w25q_sim_stats_t;
+
+/** 
+ * @brief Open or create the backing image, a new image starts erased
+ * @param path the image file, NULL for an anonymous image
+ * @param timing the operation times to use
+ * @return 0 if successful
+ */
+int w25q_sim_open(const char *path, const w25q_sim_timing_t *timing);
+
+/** 
+ * @brief Unmap the image and close the file
+ */
+void w25q_sim_close(void);
+
+/** 
+ * @brief Move the simulated clock forward, completing any operation that
+ * finishes in that time
+ * @param us the microseconds to advance
+ */
+void w25q_sim_advance(uint32_t us);
+
+/** 
+ * @brief Get the simulated clock
+ * @return microseconds since the image was opened
+ */
+uint64_t w25q_sim_now(void);
+
+/** 
+ * @brief Get the image so a test can check or prepare it directly
+ * @return the W25Q_SIZE bytes of the array
+ */
+uint8_t *w25q_sim_image(void);
+
+/** 
+ * @brief Get the number of times a sector has been erased (block erases
+ * count once for every sector in the block)
+ * @param sector the sector number
+ * @return the erase count
+ */
+uint32_t w25q_sim_sector_erases(uint32_t sector);
+
+/** 
+ * @brief Get a snapshot of the simulator counters
+ * @param stats the struct to fill
+ */
+void w25q_sim_get_stats(w25q_sim_stats_t *stats);
+
+
+#endif // W25Q_SIM_H
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Build and run the host tests, from anywhere:
+#     test/host/run.sh [test_name ...]
+#
+# Each test is built from its own file, the firmware sources it covers and
+# the libopencm3 stand-ins in mock/. Stops with a non zero exit status at
+# the first test that fails to build or fails.
+
+cd "$(dirname "$0")/../.." || exit 1
+
+CC=${CC:-cc}
+CFLAGS="-O2 -std=gnu11 -Wall -Wno-unused-variable -Wno-unused-function -Iinclude -Isrc -Itest/host -Itest/host/mock"
+OUT=${OUT:-/tmp/rocket_controller_tests}
+MOCK=test/host/mock/mock_hw.c
+# The firmware hands DMA buffer addresses over as uint32_t, -no-pie keeps
+# the statics of the host build below 4 GB so they survive the cast
+CFLAGS="$CFLAGS -Wno-pointer-to-int-cast"
+LDFLAGS="-no-pie"
+
+# name: firmware sources
+TESTS="
+test_usb_cdc: src/usb_cdc.c src/perf.c
+test_flight_log: src/flight_log.c test/host/mock/w25q_sim.c
+test_sched: src/sched.c
+test_lsm6ds3: src/lsm6ds3.c test/host/mock/lsm6ds3_sim.c
+test_lsm6ds3_fifo: src/lsm6ds3.c test/host/mock/lsm6ds3_sim.c
+test_history: src/history.c src/flight_log.c src/logpack.c src/frame.c test/host/mock/w25q_sim.c
+test_i2c_bus: src/i2c_bus.c src/perf.c test/host/mock/i2c_sim.c
+test_spsc:
+test_frame: src/frame.c
+test_filt: src/filt.c
+test_dump: src/dump.c src/frame.c src/flight_log.c test/host/mock/w25q_sim.c
+"
+
+mkdir -p "$OUT"
+failed=0
+echo "$TESTS" | while IFS=: read -r name sources; do
+    [ -z "$name" ] && continue
+    if [ $# -gt 0 ] && ! echo " $* " | grep -q " $name "; then
+        continue
+    fi
+    echo "== $name"
+    if ! $CC $CFLAGS -o "$OUT/$name" "test/host/$name.c" $sources $MOCK $LDFLAGS -lm -lpthread; then
+        echo "$name: build failed"
+        exit 1
+    fi
+    "$OUT/$name" || exit 1
+done || failed=1
+
+exit $failed
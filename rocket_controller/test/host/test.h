@@ -0,0 +1,39 @@
+/** 
+ * @file test.h
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-23
+ * @brief Checks shared by the host tests
+ *
+ * CHECK() reports a failed condition and carries on so one run shows every
+ * failure, TEST_EXIT() prints the total and gives the exit code.
+ */
+
+
+#ifndef TEST_H
+#define TEST_H
+
+
+#include <stdio.h>
+#include <stdint.h>
+
+static uint32_t g_test_checks = 0;
+static uint32_t g_test_fails = 0;
+
+/// Check a condition, printing the condition and a message when it fails
+#define CHECK(cond, ...) do { \
+        g_test_checks++; \
+        if (!(cond)) { \
+            g_test_fails++; \
+            printf("  FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+/// Print the result and return the exit code from main()
+#define TEST_EXIT() ( \
+        printf("%u checks, %u failures\n", g_test_checks, g_test_fails), \
+        (g_test_fails == 0) ? 0 : 1)
+
+
+#endif // TEST_H
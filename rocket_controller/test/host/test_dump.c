@@ -0,0 +1,575 @@
+/** 
+ * @file test_dump.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the flight download, from the flash to tools/log_dump
+ *
+ * A flight is recorded by flight_log.c on the simulated W25Q128 and sent by
+ * dump.c through stand-ins for the USB ports. First the ports capture what
+ * is written, so the framing, the tx ring checks and the request queue can
+ * be checked one dump_service() at a time. Then each port is a pty and
+ * tools/log_dump, built into this test, is run in a child process on the
+ * two slave ends as it would be on /dev/ttyACM0 and /dev/ttyACM1. The
+ * device loop answers /bin/dump on the shell port as src/fs/bin.c does,
+ * sends a telemetry frame every pass and drops or corrupts some frames on
+ * the way out so the resends are used. The image must match the flight and
+ * nothing may be sent on the shell port.
+ */
+
+
+// For the pty calls
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "w25q.h"
+#include "flight_log.h"
+#include "frame.h"
+#include "telem.h"
+#include "usb_cdc.h"
+#include "dump.h"
+#include "w25q_sim.h"
+
+#include "test.h"
+
+// The host tool, its main() run in a child process
+#define main log_dump_main
+#include "../../tools/log_dump.c"
+#undef main
+
+/// Period of flight_log_service(), the log task period
+#define SERVICE_US 1000
+
+/// Bytes in the flight written, not a whole number of blocks
+#define FLIGHT_BYTES 100100
+
+/// Room in the tx ring of a port after a pass of the device loop, as if
+/// the host took everything each 1 ms
+#define PORT_RING_SIZE 1024
+
+/// DATA frames dropped and corrupted, one in this many
+#define DROP_EVERY 41
+#define CORRUPT_EVERY 29
+
+/// Longest a download through the ptys may take
+#define RUN_LIMIT_MS 20000
+
+/// A USB port as the firmware sees it
+typedef struct {
+    bool connected;
+    size_t space;           ///< Room left in the tx ring
+    int fd;                 ///< pty master, -1 to capture
+    uint8_t tx[4096];       ///< Written while captured
+    size_t tx_len;
+    uint8_t rx[256];        ///< Sent by the host while captured
+    size_t rx_len;
+    size_t rx_pos;
+    uint32_t writes;        ///< usb_cdc_port_write() calls
+} port_sim_t;
+
+static port_sim_t g_ports[USB_CDC_NUM_PORTS];
+
+/// DATA frames written to the telemetry pty and what was done to them
+static uint32_t g_frames_out = 0;
+static uint32_t g_dropped = 0;
+static uint32_t g_corrupted = 0;
+static uint32_t g_telem_frames = 0;
+
+/// Added to the clock, to pass the idle timeout without waiting for it
+static uint32_t g_clock_skip_ms = 0;
+
+/// The flight as flight_log_read() gives it
+static uint8_t *g_flight;
+static flight_log_entry_t g_entry;
+
+uint64_t timebase_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + (uint64_t)g_clock_skip_ms * 1000;
+}
+
+uint32_t timebase_now_ms(void) {
+    return timebase_now_us() / 1000;
+}
+
+bool usb_cdc_port_connected(usb_cdc_port_t port) {
+    return g_ports[port].connected;
+}
+
+size_t usb_cdc_port_write_space(usb_cdc_port_t port) {
+    return g_ports[port].space;
+}
+
+size_t usb_cdc_port_write(usb_cdc_port_t port, const void *data, size_t len) {
+    port_sim_t *p = &g_ports[port];
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+
+    p->writes++;
+    if (len > p->space) {
+        len = p->space;
+    }
+    p->space -= len;
+
+    if (p->fd < 0) {
+        if (len <= sizeof(p->tx) - p->tx_len) {
+            memcpy(&p->tx[p->tx_len], data, len);
+            p->tx_len += len;
+        }
+        return len;
+    }
+
+    // Frames come in one call each, only those longer than a telemetry
+    // record are blocks. log_dump does not ask for INFO again.
+    memcpy(frame, data, len);
+    if (port == USB_CDC_PORT_TELEM && len > FRAME_MAX_SIZE(sizeof(telem_imu_t))) {
+        g_frames_out++;
+        if (g_frames_out % DROP_EVERY == 0) {
+            g_dropped++;
+            return len;
+        }
+        if (g_frames_out % CORRUPT_EVERY == 0) {
+            // Kept non zero so the frame stays one frame that fails its CRC
+            frame[5] = (frame[5] == 0xFF) ? 0x01 : frame[5] + 1;
+            g_corrupted++;
+        }
+    }
+
+    // A host that stops reading loses bytes as the real ring would
+    if (write(p->fd, frame, len) < 0 && errno != EAGAIN) {
+        perror("write");
+    }
+    return len;
+}
+
+size_t usb_cdc_port_read(usb_cdc_port_t port, void *buf, size_t len) {
+    port_sim_t *p = &g_ports[port];
+
+    if (p->fd < 0) {
+        if (len > p->rx_len - p->rx_pos) {
+            len = p->rx_len - p->rx_pos;
+        }
+        memcpy(buf, &p->rx[p->rx_pos], len);
+        p->rx_pos += len;
+        return len;
+    }
+
+    ssize_t n = read(p->fd, buf, len);
+    return (n > 0) ? (size_t)n : 0;
+}
+
+/** 
+ * @brief Capture both ports, with the telemetry port open
+ * @param space the room in the tx rings
+ * 
+ */
+static void ports_capture(size_t space) {
+    memset(g_ports, 0, sizeof(g_ports));
+    for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+        g_ports[i].fd = -1;
+        g_ports[i].space = space;
+    }
+    g_ports[USB_CDC_PORT_TELEM].connected = true;
+}
+
+/** 
+ * @brief Queue a frame from the host on the captured telemetry port
+ * @param type the message type
+ * @param payload the payload
+ * @param len the length of the payload
+ * 
+ */
+static void host_send(dump_msg_t type, const void *payload, size_t len) {
+    port_sim_t *p = &g_ports[USB_CDC_PORT_TELEM];
+    p->rx[p->rx_len++] = 0;
+    p->rx_len += frame_encode(type, payload, len, &p->rx[p->rx_len]);
+}
+
+/** 
+ * @brief Ask for a run of blocks on the captured telemetry port
+ * @param offset the offset of the first block
+ * @param count the number of blocks, 0 clears the queue
+ * 
+ */
+static void host_request(uint32_t offset, uint16_t count) {
+    dump_req_t req = { .offset = offset, .count = count };
+    host_send(DUMP_MSG_REQ, &req, sizeof(req));
+}
+
+/** 
+ * @brief Take the next frame from what the telemetry port captured
+ * @param pos the position in the capture, advanced past the frame
+ * @param type set to the frame type
+ * @param payload set to the payload, inside the capture
+ * 
+ * @return the payload length, -1 at the end of the capture or for a bad frame
+ */
+static int captured_frame(size_t *pos, uint8_t *type, uint8_t **payload) {
+    port_sim_t *p = &g_ports[USB_CDC_PORT_TELEM];
+
+    while (*pos < p->tx_len && p->tx[*pos] == 0) {
+        (*pos)++;
+    }
+    uint8_t *end = memchr(&p->tx[*pos], 0, p->tx_len - *pos);
+    if (end == NULL) {
+        return -1;
+    }
+    uint8_t *start = &p->tx[*pos];
+    *pos = end - p->tx + 1;
+    return frame_decode(start, end - start, type, payload);
+}
+
+/** 
+ * @brief Check a DATA frame holds the given block of the flight
+ * @param payload the payload
+ * @param len the payload length
+ * @param offset the offset the block should be at
+ * 
+ * @return true if it does
+ */
+static bool block_matches(const uint8_t *payload, int len, uint32_t offset) {
+    dump_data_t block;
+    uint32_t want = g_entry.len - offset;
+    if (want > DUMP_BLOCK_SIZE) {
+        want = DUMP_BLOCK_SIZE;
+    }
+    if (len != (int)(sizeof(block.offset) + want)) {
+        return false;
+    }
+    memcpy(&block, payload, len);
+    return block.offset == offset && memcmp(block.data, &g_flight[offset], want) == 0;
+}
+
+/** 
+ * @brief Let simulated time pass with the recorder serviced
+ * @param us the time to pass
+ * 
+ */
+static void run_for(uint32_t us) {
+    for (uint32_t t = 0; t < us; t += SERVICE_US) {
+        w25q_sim_advance(SERVICE_US);
+        flight_log_service();
+    }
+}
+
+/** 
+ * @brief Record a flight and read it back as the reference
+ * 
+ */
+static void record_flight(void) {
+    uint8_t data[250];
+
+    CHECK(w25q_sim_open(NULL, &w25q_sim_typical) == 0, "open");
+    flight_log_init();
+    CHECK(flight_log_start() == 0, "start");
+    // Long enough for the first sector erase
+    run_for(500000);
+
+    for (uint32_t offset = 0; offset < FLIGHT_BYTES; ) {
+        size_t len = (FLIGHT_BYTES - offset < sizeof(data)) ? FLIGHT_BYTES - offset : sizeof(data);
+        for (size_t j = 0; j < len; j++) {
+            data[j] = (uint8_t)(((offset + j) * 13) ^ ((offset + j) >> 9));
+        }
+        offset += flight_log_write(data, len);
+        run_for(1000);
+    }
+    flight_log_stop();
+    for (uint32_t t = 0; t < 20000 && flight_log_recording(); t++) {
+        run_for(SERVICE_US);
+    }
+
+    CHECK(flight_log_get_flight(1, &g_entry), "flight found");
+    CHECK(g_entry.len >= FLIGHT_BYTES && g_entry.len % DUMP_BLOCK_SIZE != 0, "length %u", g_entry.len);
+    g_flight = malloc(g_entry.len);
+    for (uint32_t offset = 0; offset < g_entry.len; ) {
+        int n = flight_log_read(&g_entry, offset, &g_flight[offset], g_entry.len - offset);
+        if (n <= 0) {
+            CHECK(n > 0, "read back at %u", offset);
+            break;
+        }
+        offset += n;
+    }
+}
+
+/** 
+ * @brief The start and the INFO frame wait for room, requests are queued,
+ * cleared and served a block at a time
+ * 
+ */
+static void test_protocol(void) {
+    uint8_t type;
+    uint8_t *payload;
+    size_t pos = 0;
+
+    // Not open, nothing starts
+    ports_capture(0);
+    g_ports[USB_CDC_PORT_TELEM].connected = false;
+    CHECK(!dump_start(&g_entry), "started with the port closed");
+    CHECK(!dump_active(), "active");
+
+    // What the host sent before the start is thrown away
+    ports_capture(0);
+    host_send(DUMP_MSG_END, NULL, 0);
+    CHECK(dump_start(&g_entry), "start with a full ring");
+    CHECK(g_ports[USB_CDC_PORT_TELEM].tx_len == 0, "%zu bytes sent with no room",
+          g_ports[USB_CDC_PORT_TELEM].tx_len);
+    dump_service();
+    CHECK(dump_active(), "ended by an END from before the start");
+    CHECK(!dump_start(&g_entry), "started twice");
+
+    // The delimiter and INFO go together or not at all
+    g_ports[USB_CDC_PORT_TELEM].space = FRAME_MAX_SIZE(sizeof(dump_info_t));
+    host_request(0, 4);
+    dump_service();
+    CHECK(g_ports[USB_CDC_PORT_TELEM].tx_len == 0, "%zu bytes sent short of room",
+          g_ports[USB_CDC_PORT_TELEM].tx_len);
+    g_ports[USB_CDC_PORT_TELEM].space = 1 + FRAME_MAX_SIZE(sizeof(dump_info_t));
+    dump_service();
+    CHECK(g_ports[USB_CDC_PORT_TELEM].tx_len > 1 && g_ports[USB_CDC_PORT_TELEM].tx[0] == 0, "delimiter first");
+    int len = captured_frame(&pos, &type, &payload);
+    dump_info_t info = { 0 };
+    CHECK(len == sizeof(dump_info_t) && type == DUMP_MSG_INFO, "INFO %d type %u", len, type);
+    if (len == sizeof(dump_info_t)) {
+        memcpy(&info, payload, sizeof(info));
+    }
+    CHECK(info.seq == g_entry.seq && info.len == g_entry.len && info.block_size == DUMP_BLOCK_SIZE,
+          "info %u %u %u", info.seq, info.len, info.block_size);
+    CHECK(g_ports[USB_CDC_PORT_TELEM].tx_len == pos, "more than INFO sent");
+
+    // The four blocks asked for wait for room, then a clear drops them
+    dump_service();
+    CHECK(g_ports[USB_CDC_PORT_TELEM].tx_len == pos, "a block sent with no room");
+    host_request(0, 0);
+    g_ports[USB_CDC_PORT_TELEM].space = PORT_RING_SIZE;
+    dump_service();
+    CHECK(g_ports[USB_CDC_PORT_TELEM].tx_len == pos, "a cleared block sent");
+
+    // One block per frame's worth of room, in the order asked for
+    host_request(DUMP_BLOCK_SIZE, 2);
+    host_request((g_entry.len / DUMP_BLOCK_SIZE) * DUMP_BLOCK_SIZE, 3);
+    host_request(g_entry.len + DUMP_BLOCK_SIZE, 1);
+    uint32_t want[] = { DUMP_BLOCK_SIZE, 2 * DUMP_BLOCK_SIZE, (g_entry.len / DUMP_BLOCK_SIZE) * DUMP_BLOCK_SIZE };
+    for (int i = 0; i < 3; i++) {
+        g_ports[USB_CDC_PORT_TELEM].space = FRAME_MAX_SIZE(sizeof(dump_data_t));
+        dump_service();
+        len = captured_frame(&pos, &type, &payload);
+        CHECK(type == DUMP_MSG_DATA && block_matches(payload, len, want[i]), "block %d at %u", i, want[i]);
+        CHECK(captured_frame(&pos, &type, &payload) == -1, "more than one block for one block of room");
+    }
+    g_ports[USB_CDC_PORT_TELEM].space = PORT_RING_SIZE;
+    dump_service();
+    CHECK(captured_frame(&pos, &type, &payload) == -1, "a block past the end sent");
+
+    // A request holds off the idle timeout, then END stops the transfer
+    g_clock_skip_ms += DUMP_IDLE_MS - 100;
+    host_request(0, 0);
+    dump_service();
+    g_clock_skip_ms += 200;
+    dump_service();
+    CHECK(dump_active(), "timed out with requests arriving");
+    host_send(DUMP_MSG_END, NULL, 0);
+    dump_service();
+    CHECK(!dump_active(), "END ignored");
+
+    // A host that goes away is given up on
+    CHECK(dump_start(&g_entry), "restart");
+    dump_service();
+    g_clock_skip_ms += DUMP_IDLE_MS + 1;
+    dump_service();
+    CHECK(!dump_active(), "no idle timeout");
+    CHECK(g_ports[USB_CDC_PORT_SHELL].writes == 0, "%u writes to the shell port", g_ports[USB_CDC_PORT_SHELL].writes);
+}
+
+/** 
+ * @brief Open a pty in raw mode, the slave is kept open so the master
+ * stays usable between runs of the host
+ * @param master set to the non blocking master
+ * @param slave_path set to the slave's path
+ * 
+ */
+static void pty_open(int *master, char *slave_path) {
+    *master = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(*master >= 0 && grantpt(*master) == 0 && unlockpt(*master) == 0, "pty");
+    strcpy(slave_path, ptsname(*master));
+    fcntl(*master, F_SETFL, O_NONBLOCK);
+
+    int slave = open(slave_path, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+}
+
+/** 
+ * @brief Answer /bin/dump on the shell port as src/fs/bin.c does
+ * 
+ */
+static void shell_service(void) {
+    static char line[64];
+    static size_t len = 0;
+    char ch;
+
+    while (read(g_ports[USB_CDC_PORT_SHELL].fd, &ch, 1) == 1) {
+        if (ch != '\n' && ch != '\r') {
+            if (len < sizeof(line) - 1) {
+                line[len++] = ch;
+            }
+            continue;
+        }
+        line[len] = 0;
+        len = 0;
+
+        flight_log_entry_t entry;
+        if (strncmp(line, "/bin/dump", 9) == 0 && !dump_active()
+            && flight_log_get_flight(atoi(&line[9]) ? atoi(&line[9]) : 1, &entry)) {
+            dump_start(&entry);
+        }
+    }
+}
+
+/** 
+ * @brief Run log_dump in a child process with the device loop in this one
+ * @param resume true to pass -r
+ * @param image_path the image
+ * 
+ * @return the exit status of log_dump
+ */
+static int run_log_dump(bool resume, const char *image_path) {
+    static char shell_path[64] = "";
+    static char telem_path[64];
+    telem_imu_t imu = { 0 };
+
+    if (shell_path[0] == 0) {
+        pty_open(&g_ports[USB_CDC_PORT_SHELL].fd, shell_path);
+        pty_open(&g_ports[USB_CDC_PORT_TELEM].fd, telem_path);
+    }
+    g_ports[USB_CDC_PORT_SHELL].connected = true;
+    g_ports[USB_CDC_PORT_TELEM].connected = true;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        char *argv[8];
+        int argc = 0;
+        argv[argc++] = "log_dump";
+        if (resume) {
+            argv[argc++] = "-r";
+        }
+        argv[argc++] = "-f";
+        argv[argc++] = "1";
+        argv[argc++] = shell_path;
+        argv[argc++] = telem_path;
+        argv[argc++] = (char *)image_path;
+        argv[argc] = NULL;
+        _exit(log_dump_main(argc, argv));
+    }
+
+    int status = -1;
+    uint32_t start = timebase_now_ms();
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (timebase_now_ms() - start > RUN_LIMIT_MS) {
+            CHECK(false, "log_dump took over %u ms", RUN_LIMIT_MS);
+            kill(pid, SIGKILL);
+        }
+        for (int i = 0; i < USB_CDC_NUM_PORTS; i++) {
+            g_ports[i].space = PORT_RING_SIZE;
+        }
+
+        shell_service();
+        if (dump_active()) {
+            dump_service();
+        }
+
+        // Telemetry carries on between the blocks, as telem_send() sends it
+        uint8_t frame[FRAME_MAX_SIZE(sizeof(imu))];
+        imu.time_us = timebase_now_us();
+        size_t frame_len = frame_encode(TELEM_REC_IMU, &imu, sizeof(imu), frame);
+        if (usb_cdc_port_write_space(USB_CDC_PORT_TELEM) >= frame_len) {
+            usb_cdc_port_write(USB_CDC_PORT_TELEM, frame, frame_len);
+            g_telem_frames++;
+        }
+        usleep(1000);
+    }
+
+    // Take the END log_dump sent last
+    for (int i = 0; i < 10 && dump_active(); i++) {
+        dump_service();
+        usleep(1000);
+    }
+    return (WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+}
+
+/** 
+ * @brief Check the image holds the flight
+ * @param path the image
+ * 
+ * @return true if it does
+ */
+static bool image_matches(const char *path) {
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf = malloc(g_entry.len + 1);
+    size_t n = (f != NULL) ? fread(buf, 1, g_entry.len + 1, f) : 0;
+    bool ok = n == g_entry.len && memcmp(buf, g_flight, n) == 0;
+
+    if (f != NULL) {
+        fclose(f);
+    }
+    free(buf);
+    return ok;
+}
+
+/** 
+ * @brief Download through the ptys with frames lost, then resume a cut
+ * short image and refuse to resume one of another flight
+ * 
+ */
+static void test_log_dump(void) {
+    char image_path[] = "/tmp/test_dump_XXXXXX";
+    int fd = mkstemp(image_path);
+    close(fd);
+
+    memset(g_ports, 0, sizeof(g_ports));
+    CHECK(run_log_dump(false, image_path) == 0, "download failed");
+    CHECK(image_matches(image_path), "image differs");
+    CHECK(!dump_active(), "not ended");
+    CHECK(g_dropped > 0 && g_corrupted > 0 && g_telem_frames > 0, "%u dropped %u corrupted %u telemetry",
+          g_dropped, g_corrupted, g_telem_frames);
+    printf("  %u frames, %u dropped, %u corrupted, %u telemetry\n", g_frames_out, g_dropped, g_corrupted,
+           g_telem_frames);
+
+    // A part block past the last full one, as a download cut short leaves
+    CHECK(truncate(image_path, g_entry.len / 2 + 100) == 0, "truncate");
+    CHECK(run_log_dump(true, image_path) == 0, "resume failed");
+    CHECK(image_matches(image_path), "resumed image differs");
+
+    // The last full block differs, so the image is of some other flight
+    uint32_t cut = 20 * DUMP_BLOCK_SIZE + 10;
+    CHECK(truncate(image_path, cut) == 0, "truncate");
+    FILE *f = fopen(image_path, "r+b");
+    fseek(f, 19 * DUMP_BLOCK_SIZE + 3, SEEK_SET);
+    fputc(g_flight[19 * DUMP_BLOCK_SIZE + 3] ^ 0x80, f);
+    fclose(f);
+    CHECK(run_log_dump(true, image_path) == 1, "resumed onto another flight");
+    CHECK(!dump_active(), "not ended after refusing");
+
+    CHECK(g_ports[USB_CDC_PORT_SHELL].writes == 0, "%u writes to the shell port", g_ports[USB_CDC_PORT_SHELL].writes);
+    unlink(image_path);
+}
+
+int main(void) {
+    record_flight();
+    test_protocol();
+    test_log_dump();
+    w25q_sim_close();
+    return TEST_EXIT();
+}
@@ -0,0 +1,341 @@
+/** 
+ * @file test_filt.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the fixed point multi-rate FIR filters
+ *
+ * The Q15 coefficients of each design are checked against the passband and
+ * stopband limits given in filt.h. Each design is then run on its own, and
+ * the IMU chain as a whole, on sine waves and the gain of the fixed point
+ * code compared with the response of its coefficients.
+ *
+ * The gain is fitted against the input sine taken at the time given to each
+ * output. A linear phase filter with its group delay removed gives the
+ * input scaled by the gain, also when decimating aliases the tone, so a
+ * wrong timestamp shows as a wrong gain. Ramps check the timestamps
+ * directly: every output of a tap must equal the ramp at its own time.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "filt.h"
+
+#include "test.h"
+
+/// Input amplitude, counts
+#define AMPLITUDE 16000.0
+
+/// Phase of the test sines, keeps the samples at 0.25 and 0.5 off zero
+#define PHASE 1.2
+
+/// Inputs per sine
+#define INPUTS 4096
+
+/// Inputs per block, as read from the sensor FIFO
+#define BLOCK 16
+
+/// Gain error allowed from rounding, as a fraction of full scale
+#define GAIN_TOL (2.0 / AMPLITUDE)
+
+/// How close a cut-off must be to the gain given, dB
+#define CUTOFF_TOL_DB 0.1
+
+/// IMU sample period used for the timestamps, us
+#define PERIOD_US 600
+
+/// What a limit in filt.h gives
+typedef enum {
+    LIMIT_PASS,     ///< At least the gain, as rounded to 0.01 dB
+    LIMIT_CUTOFF,   ///< The gain to within CUTOFF_TOL_DB
+    LIMIT_STOP,     ///< At most the gain
+} limit_kind_t;
+
+/// A limit from the table in filt.h
+typedef struct {
+    double freq;
+    double db;
+    limit_kind_t kind;
+} limit_t;
+
+/// A design with its limits
+typedef struct {
+    const char *name;
+    const filt_design_t *design;
+    limit_t limits[3];
+} spec_t;
+
+static const spec_t g_specs[] = {
+    { "halfband15", &filt_halfband15,
+      { { 0.15, -0.25, LIMIT_PASS }, { 0.35, -31, LIMIT_STOP }, { 0.4, -63, LIMIT_STOP } } },
+    { "halfband19", &filt_halfband19,
+      { { 0.15, -0.08, LIMIT_PASS }, { 0.35, -40, LIMIT_STOP }, { 0.5, -78, LIMIT_STOP } } },
+    { "lowpass23", &filt_lowpass23,
+      { { 0.125, -0.31, LIMIT_PASS }, { 0.18, -6, LIMIT_CUTOFF }, { 0.25, -46, LIMIT_STOP } } },
+};
+
+/// Frequencies each design and the chain are run at, relative to the input rate
+static const double g_freqs[] = {
+    0.0, 0.02, 0.05, 0.1, 0.125, 0.15, 0.18, 0.2, 0.25, 0.3, 0.35, 0.4, 0.45, 0.5,
+};
+
+static filt_sample_t g_hist[FILT_IMU_HIST_LEN];
+
+/** 
+ * @brief Get the gain of a design's coefficients
+ * @param design the design
+ * @param freq the frequency relative to its input rate
+ * 
+ * @return the gain, signed
+ */
+static double response(const filt_design_t *design, double freq) {
+    int centre = design->taps / 2;
+    double sum = 0;
+    for (int k = 0; k < design->taps; k++) {
+        sum += design->coef[k] * cos(2 * M_PI * freq * (k - centre));
+    }
+    return sum / 32768;
+}
+
+/** 
+ * @brief Convert a gain to dB
+ * @param gain the gain
+ * 
+ * @return the gain in dB
+ */
+static double to_db(double gain) {
+    return 20 * log10(fabs(gain) + 1e-9);
+}
+
+/** 
+ * @brief Get an input of a sine wave, the same value on every channel
+ * @param freq the frequency relative to the input rate
+ * @param i the input number
+ * @param sample set to the input
+ * 
+ */
+static void sine(double freq, uint32_t i, filt_sample_t *sample) {
+    int16_t x = (int16_t)lround(AMPLITUDE * sin(2 * M_PI * freq * i + PHASE));
+    sample->time_us = i;
+    for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+        sample->ch[ch] = x;
+    }
+}
+
+/// Least squares fit of outputs against the input at their times
+typedef struct {
+    double num;
+    double den;
+    bool channels_differ;
+} fit_t;
+
+/** 
+ * @brief Add an output to a fit
+ * @param fit the fit
+ * @param freq the frequency of the input
+ * @param out the output, its time is the input number
+ * 
+ */
+static void fit_add(fit_t *fit, double freq, const filt_sample_t *out) {
+    double ref = AMPLITUDE * sin(2 * M_PI * freq * out->time_us + PHASE);
+    fit->num += ref * out->ch[0];
+    fit->den += ref * ref;
+    for (int ch = 1; ch < FILT_CHANNELS; ch++) {
+        fit->channels_differ |= out->ch[ch] != out->ch[0];
+    }
+}
+
+static void test_designs(void) {
+    printf("design limits\n");
+
+    for (size_t s = 0; s < sizeof(g_specs) / sizeof(g_specs[0]); s++) {
+        const spec_t *spec = &g_specs[s];
+        int32_t sum = 0;
+        for (int k = 0; k < spec->design->taps; k++) {
+            sum += spec->design->coef[k];
+        }
+        CHECK(sum == 32768, "%s: taps sum to %d", spec->name, sum);
+
+        for (int l = 0; l < 3; l++) {
+            const limit_t *limit = &spec->limits[l];
+            double db = to_db(response(spec->design, limit->freq));
+            bool met;
+            switch (limit->kind) {
+            case LIMIT_PASS:
+                met = db >= limit->db - 0.005;
+                break;
+            case LIMIT_CUTOFF:
+                met = fabs(db - limit->db) <= CUTOFF_TOL_DB;
+                break;
+            default:
+                met = db <= limit->db;
+                break;
+            }
+            CHECK(met, "%s: %.2f dB at %.3f, filt.h gives %g", spec->name, db, limit->freq, limit->db);
+        }
+    }
+}
+
+static void test_stages(void) {
+    printf("stages against their coefficients\n");
+
+    for (size_t s = 0; s < sizeof(g_specs) / sizeof(g_specs[0]); s++) {
+        const spec_t *spec = &g_specs[s];
+        double worst = 0, worst_freq = 0;
+        bool differ = false;
+
+        for (size_t f = 0; f < sizeof(g_freqs) / sizeof(g_freqs[0]); f++) {
+            filt_stage_t stage;
+            filt_stage_init(&stage, spec->design, g_hist);
+
+            fit_t fit = { 0 };
+            for (uint32_t i = 0; i < INPUTS; i++) {
+                filt_sample_t in, out;
+                sine(g_freqs[f], i, &in);
+                if (filt_stage_push(&stage, &in, &out)) {
+                    fit_add(&fit, g_freqs[f], &out);
+                }
+            }
+
+            double err = fabs(fit.num / fit.den - response(spec->design, g_freqs[f]));
+            if (err > worst) {
+                worst = err;
+                worst_freq = g_freqs[f];
+            }
+            differ |= fit.channels_differ;
+        }
+        CHECK(worst <= GAIN_TOL, "%s: gain off by %.1f counts at %.3f", spec->name, worst * AMPLITUDE, worst_freq);
+        CHECK(!differ, "%s: the channels differ on the same input", spec->name);
+    }
+}
+
+static void test_chain(void) {
+    printf("imu chain taps\n");
+    filt_chain_t chain;
+    filt_imu_chain_init(&chain, g_hist);
+
+    CHECK(filt_chain_factor(&chain, chain.est_tap) == 2, "estimator at 1/%u rate",
+          filt_chain_factor(&chain, chain.est_tap));
+    CHECK(filt_chain_factor(&chain, chain.log_tap) == 4, "logger at 1/%u rate",
+          filt_chain_factor(&chain, chain.log_tap));
+
+    // Once the histories are full every block gives a fixed number of
+    // outputs, the last stage fills after about 145 inputs
+    uint32_t uneven = 0;
+    for (uint32_t b = 0; b < INPUTS / BLOCK; b++) {
+        filt_sample_t in[BLOCK], est[BLOCK], log_out[BLOCK];
+        size_t n_est, n_log;
+        for (int j = 0; j < BLOCK; j++) {
+            sine(0.05, b * BLOCK + j, &in[j]);
+        }
+        filt_chain_process(&chain, in, BLOCK, est, &n_est, log_out, &n_log);
+        uneven += b >= 10 && (n_est != BLOCK / 2 || n_log != BLOCK / 4);
+    }
+    CHECK(uneven == 0, "%u blocks without %u estimator and %u logger outputs", uneven, BLOCK / 2, BLOCK / 4);
+
+    // Each tap against the product of the stages before it, a stage sees
+    // the frequency relative to its own input rate
+    double est_worst = 0, log_worst = 0;
+    for (size_t f = 0; f < sizeof(g_freqs) / sizeof(g_freqs[0]); f++) {
+        double freq = g_freqs[f];
+        double est_gain = response(&filt_halfband15, freq);
+        double log_gain = est_gain * response(&filt_halfband19, 2 * freq) * response(&filt_lowpass23, 4 * freq);
+
+        filt_imu_chain_init(&chain, g_hist);
+        fit_t est_fit = { 0 }, log_fit = { 0 };
+        for (uint32_t i = 0; i < INPUTS; i += BLOCK) {
+            filt_sample_t in[BLOCK], est[BLOCK], log_out[BLOCK];
+            size_t n_est, n_log;
+            for (int j = 0; j < BLOCK; j++) {
+                sine(freq, i + j, &in[j]);
+            }
+            filt_chain_process(&chain, in, BLOCK, est, &n_est, log_out, &n_log);
+            for (size_t k = 0; k < n_est; k++) {
+                fit_add(&est_fit, freq, &est[k]);
+            }
+            for (size_t k = 0; k < n_log; k++) {
+                fit_add(&log_fit, freq, &log_out[k]);
+            }
+        }
+        est_worst = fmax(est_worst, fabs(est_fit.num / est_fit.den - est_gain));
+        log_worst = fmax(log_worst, fabs(log_fit.num / log_fit.den - log_gain));
+    }
+    CHECK(est_worst <= GAIN_TOL, "estimator gain off by %.1f counts", est_worst * AMPLITUDE);
+    CHECK(log_worst <= 2 * GAIN_TOL, "logger gain off by %.1f counts", log_worst * AMPLITUDE);
+}
+
+static void test_timestamps(void) {
+    printf("group delay timestamps\n");
+    filt_chain_t chain;
+    filt_imu_chain_init(&chain, g_hist);
+
+    // A ramp through unity gain symmetric filters comes out unchanged, so
+    // each output must equal the ramp at the time it is given
+    const uint32_t start_us = 1000000;
+    uint32_t est_off = 0, log_off = 0, est_gap = 0, log_gap = 0;
+    uint32_t est_last = 0, log_last = 0, n_est_total = 0, n_log_total = 0;
+    for (uint32_t i = 0; i < INPUTS; i += BLOCK) {
+        filt_sample_t in[BLOCK], est[BLOCK], log_out[BLOCK];
+        size_t n_est, n_log;
+        for (int j = 0; j < BLOCK; j++) {
+            in[j].time_us = start_us + (i + j) * PERIOD_US;
+            for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+                in[j].ch[ch] = (int16_t)((i + j) * 7 - 14000 + ch * 100);
+            }
+        }
+        filt_chain_process(&chain, in, BLOCK, est, &n_est, log_out, &n_log);
+
+        for (size_t k = 0; k < n_est; k++) {
+            int32_t at = (est[k].time_us - start_us) / PERIOD_US;
+            for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+                est_off += abs(est[k].ch[ch] - (at * 7 - 14000 + ch * 100)) > 1;
+            }
+            est_gap += n_est_total++ > 0 && est[k].time_us - est_last != 2 * PERIOD_US;
+            est_last = est[k].time_us;
+        }
+        for (size_t k = 0; k < n_log; k++) {
+            int32_t at = (log_out[k].time_us - start_us) / PERIOD_US;
+            for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+                log_off += abs(log_out[k].ch[ch] - (at * 7 - 14000 + ch * 100)) > 1;
+            }
+            log_gap += n_log_total++ > 0 && log_out[k].time_us - log_last != 4 * PERIOD_US;
+            log_last = log_out[k].time_us;
+        }
+    }
+    CHECK(est_off == 0, "%u estimator values away from the ramp at their time", est_off);
+    CHECK(log_off == 0, "%u logger values away from the ramp at their time", log_off);
+    CHECK(est_gap == 0, "%u estimator outputs not %u us apart", est_gap, 2 * PERIOD_US);
+    CHECK(log_gap == 0, "%u logger outputs not %u us apart", log_gap, 4 * PERIOD_US);
+
+    // The first output is given the time of the centre of the inputs it
+    // was made from. A decimating stage gives it on the input after its
+    // history fills, so the estimator starts at input 1 + 7, the second
+    // stage at its own input 1 + 9 and the last at its input 11
+    filt_imu_chain_init(&chain, g_hist);
+    filt_sample_t in[256], est[256], log_out[256];
+    size_t n_est, n_log;
+    for (int i = 0; i < 256; i++) {
+        in[i].time_us = start_us + i * PERIOD_US;
+        for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+            in[i].ch[ch] = 0;
+        }
+    }
+    filt_chain_process(&chain, in, 256, est, &n_est, log_out, &n_log);
+    uint32_t est_first = 1 + 7;
+    uint32_t log_first = est_first + 2 * (1 + 9) + 4 * 11;
+    CHECK(n_est > 0 && est[0].time_us == start_us + est_first * PERIOD_US, "first estimator output at input %d",
+          n_est > 0 ? (int)((est[0].time_us - start_us) / PERIOD_US) : -1);
+    CHECK(n_log > 0 && log_out[0].time_us == start_us + log_first * PERIOD_US, "first logger output at input %d",
+          n_log > 0 ? (int)((log_out[0].time_us - start_us) / PERIOD_US) : -1);
+}
+
+int main(void) {
+    test_designs();
+    test_stages();
+    test_chain();
+    test_timestamps();
+    return TEST_EXIT();
+}
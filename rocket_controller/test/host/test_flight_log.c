@@ -0,0 +1,259 @@
+/** 
+ * @file test_flight_log.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Host test of the flight recorder on the simulated W25Q128
+ *
+ * Flights are recorded at 1 kHz with flight_log_service() run every 1 ms as
+ * the log task does, then read back through flight_log_read() and found
+ * again by a fresh flight_log_init() scan. The simulator counts anything
+ * the real flash would not do as asked, which must stay at zero even with
+ * the maximum datasheet times.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "w25q.h"
+#include "flight_log.h"
+#include "w25q_sim.h"
+
+#include "test.h"
+
+/// Period of flight_log_service(), the log task period
+#define SERVICE_US 1000
+
+/// The flight header written ahead of the data
+#define HEADER_SIZE 16
+
+#define SECTOR_COUNT (W25Q_SIZE / W25Q_SECTOR_SIZE)
+
+/** 
+ * @brief Let simulated time pass with the recorder serviced
+ * @param us the time to pass
+ * 
+ */
+static void run_for(uint32_t us) {
+    for (uint32_t t = 0; t < us; t += SERVICE_US) {
+        w25q_sim_advance(SERVICE_US);
+        flight_log_service();
+    }
+}
+
+/** 
+ * @brief The byte at an offset into a test flight
+ * @param seed differs between flights
+ * @param offset the offset into the flight data
+ * 
+ * @return the byte
+ */
+static uint8_t pattern(uint32_t seed, uint32_t offset) {
+    return (uint8_t)((offset * 7) ^ (offset >> 8) ^ seed);
+}
+
+/** 
+ * @brief Record a flight of 1 kHz records, waiting for the first erase first
+ * @param seed the pattern seed
+ * @param record the bytes per record
+ * @param count the number of records
+ * 
+ * @return the bytes dropped
+ */
+static uint32_t record_flight(uint32_t seed, size_t record, uint32_t count) {
+    uint8_t data[256];
+    flight_log_stats_t before;
+    flight_log_stats_t after;
+
+    flight_log_get_stats(&before);
+    CHECK(flight_log_start() == 0, "start");
+    // Long enough for the first sector erase even at the maximum time
+    run_for(500000);
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        for (size_t j = 0; j < record; j++) {
+            data[j] = pattern(seed, offset + j);
+        }
+        offset += flight_log_write(data, record);
+        run_for(1000);
+    }
+
+    flight_log_stop();
+    for (uint32_t t = 0; t < 20000 && flight_log_recording(); t++) {
+        run_for(SERVICE_US);
+    }
+    CHECK(!flight_log_recording(), "flush finished");
+
+    flight_log_get_stats(&after);
+    return after.bytes_dropped - before.bytes_dropped;
+}
+
+/** 
+ * @brief Read a flight back and compare it with the pattern
+ * @param n the flight number, 1 is the most recent
+ * @param seed the pattern seed
+ * @param len the bytes written
+ * 
+ * @return true if the data and the zero padding after it match
+ */
+static bool check_flight(int n, uint32_t seed, uint32_t len) {
+    flight_log_entry_t entry;
+    uint8_t buf[200];
+
+    if (!flight_log_get_flight(n, &entry) || entry.len < len
+        || entry.len - len >= W25Q_PAGE_SIZE) {
+        return false;
+    }
+
+    uint32_t offset = 0;
+    while (offset < entry.len) {
+        int got = flight_log_read(&entry, offset, buf, sizeof(buf));
+        if (got <= 0) {
+            return false;
+        }
+        for (int i = 0; i < got; i++, offset++) {
+            uint8_t want = (offset < len) ? pattern(seed, offset) : 0;
+            if (buf[i] != want) {
+                printf("  flight %d differs at %u: %02x want %02x\n", n, offset, buf[i], want);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** 
+ * @brief A flight is kept whole and found again by a fresh scan
+ * 
+ */
+static void test_record_and_rescan(void) {
+    printf("record and rescan\n");
+    w25q_sim_stats_t sim;
+
+    CHECK(w25q_sim_open(NULL, &w25q_sim_typical) == 0, "open");
+    CHECK(w25q_init() == 0, "init");
+    flight_log_init();
+    CHECK(flight_log_count() == 0, "empty chip has %d flights", flight_log_count());
+
+    uint32_t dropped = record_flight(1, 32, 20000);
+    CHECK(dropped == 0, "%u bytes dropped", dropped);
+    CHECK(flight_log_count() == 1, "%d flights", flight_log_count());
+    CHECK(check_flight(1, 1, 32 * 20000), "flight 1 reads back");
+
+    flight_log_entry_t first;
+    flight_log_get_flight(1, &first);
+    CHECK(first.start == 0, "starts at %u", first.start);
+
+    dropped = record_flight(2, 24, 5000);
+    CHECK(dropped == 0, "%u bytes dropped", dropped);
+
+    flight_log_entry_t second;
+    flight_log_get_flight(1, &second);
+    CHECK(second.seq == first.seq + 1, "seq %u after %u", second.seq, first.seq);
+    CHECK(second.start % W25Q_SECTOR_SIZE == 0 && second.start >= first.start + first.len,
+          "second flight at %u", second.start);
+
+    // As after a power cycle
+    flight_log_init();
+    CHECK(flight_log_count() == 2, "%d flights after rescan", flight_log_count());
+    CHECK(check_flight(1, 2, 24 * 5000), "flight 2 reads back after rescan");
+    CHECK(check_flight(2, 1, 32 * 20000), "flight 1 reads back after rescan");
+
+    w25q_sim_get_stats(&sim);
+    CHECK(sim.violations == 0, "%u violations", sim.violations);
+    CHECK(sim.suspends > 0, "erases were never suspended");
+    w25q_sim_close();
+}
+
+/** 
+ * @brief A flight that runs off the end of the chip carries on at address 0
+ * 
+ */
+static void test_wrap(void) {
+    printf("wrap around the end of the chip\n");
+    w25q_sim_stats_t sim;
+
+    CHECK(w25q_sim_open(NULL, &w25q_sim_typical) == 0, "open");
+
+    // An old flight in the third last sector with a page of data in the next
+    uint8_t *image = w25q_sim_image();
+    uint32_t old_start = (SECTOR_COUNT - 3) * W25Q_SECTOR_SIZE;
+    const uint32_t header[4] = { 0x544c4648, 41, 0, 0 };
+    memcpy(&image[old_start], header, sizeof(header));
+    memset(&image[old_start + HEADER_SIZE], 0x55, W25Q_SECTOR_SIZE - HEADER_SIZE);
+    memset(&image[old_start + W25Q_SECTOR_SIZE], 0x55, W25Q_PAGE_SIZE);
+
+    flight_log_init();
+    CHECK(flight_log_count() == 1, "%d flights", flight_log_count());
+
+    uint32_t dropped = record_flight(3, 32, 1000);
+    CHECK(dropped == 0, "%u bytes dropped", dropped);
+
+    flight_log_entry_t entry;
+    flight_log_get_flight(1, &entry);
+    CHECK(entry.seq == 42, "seq %u", entry.seq);
+    CHECK(entry.start == (SECTOR_COUNT - 1) * W25Q_SECTOR_SIZE, "starts at %u", entry.start);
+    CHECK(entry.start + HEADER_SIZE + entry.len > W25Q_SIZE, "does not wrap");
+    CHECK(check_flight(1, 3, 32 * 1000), "wrapped flight reads back");
+
+    flight_log_init();
+    CHECK(check_flight(1, 3, 32 * 1000), "wrapped flight reads back after rescan");
+
+    w25q_sim_get_stats(&sim);
+    CHECK(sim.violations == 0, "%u violations", sim.violations);
+    w25q_sim_close();
+}
+
+/** 
+ * @brief A flight recorded into an image file is there when it is opened again
+ * 
+ */
+static void test_file_image(void) {
+    printf("file backed image\n");
+    const char *path = "/tmp/rocket_controller_test_flash.bin";
+
+    unlink(path);
+    CHECK(w25q_sim_open(path, &w25q_sim_typical) == 0, "create");
+    flight_log_init();
+    uint32_t dropped = record_flight(5, 48, 3000);
+    CHECK(dropped == 0, "%u bytes dropped", dropped);
+    w25q_sim_close();
+
+    CHECK(w25q_sim_open(path, &w25q_sim_typical) == 0, "reopen");
+    flight_log_init();
+    CHECK(flight_log_count() == 1, "%d flights", flight_log_count());
+    CHECK(check_flight(1, 5, 48 * 3000), "flight reads back from the file");
+    w25q_sim_close();
+    unlink(path);
+}
+
+/** 
+ * @brief The maximum datasheet times may cost data but never break the
+ * command sequence
+ * 
+ */
+static void test_worst_case_timing(void) {
+    printf("maximum datasheet times\n");
+    w25q_sim_stats_t sim;
+
+    CHECK(w25q_sim_open(NULL, &w25q_sim_worst) == 0, "open");
+    flight_log_init();
+    record_flight(4, 64, 10000);
+
+    w25q_sim_get_stats(&sim);
+    CHECK(sim.violations == 0, "%u violations", sim.violations);
+    CHECK(sim.suspends > 0, "erases were never suspended");
+    CHECK(flight_log_count() == 1, "%d flights", flight_log_count());
+    w25q_sim_close();
+}
+
+int main(void) {
+    test_record_and_rescan();
+    test_wrap();
+    test_file_image();
+    test_worst_case_timing();
+    return TEST_EXIT();
+}
@@ -0,0 +1,195 @@
+/** 
+ * @file test_frame.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the COBS + CRC framing shared by telemetry, the flight log, dump and slog
+ *
+ * COBS is checked on its own from empty buffers to well past the 254 byte
+ * run where a code byte has to be added without a zero, with no zeros, all
+ * zeros and zeros at random. Whole frames are round tripped for every
+ * payload length up to FRAME_MAX_PAYLOAD - 1 and must stay within
+ * FRAME_MAX_SIZE() with the delimiter as their only zero. Every byte of a
+ * set of frames is then corrupted in turn, and frames are cut short or
+ * run together, and none of those may decode.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "frame.h"
+
+#include "test.h"
+
+/// Longest buffer given to COBS on its own
+#define COBS_MAX_LEN 600
+
+static uint32_t g_rand = 0x2545F491;
+
+/** 
+ * @brief A small xorshift generator
+ * 
+ * @return the next value
+ */
+static uint32_t rnd(void) {
+    g_rand ^= g_rand << 13;
+    g_rand ^= g_rand >> 17;
+    g_rand ^= g_rand << 5;
+    return g_rand;
+}
+
+/// How the test data is filled
+typedef enum {
+    FILL_NO_ZEROS,
+    FILL_ALL_ZEROS,
+    FILL_SOME_ZEROS,
+    FILL_COUNT
+} fill_t;
+
+static const char *g_fill_names[FILL_COUNT] = { "no zeros", "all zeros", "some zeros" };
+
+/** 
+ * @brief Fill a buffer with test data
+ * @param buf the buffer
+ * @param len its length
+ * @param fill what to fill it with
+ * 
+ */
+static void fill(uint8_t *buf, size_t len, fill_t fill) {
+    for (size_t i = 0; i < len; i++) {
+        switch (fill) {
+        case FILL_NO_ZEROS:
+            buf[i] = 1 + rnd() % 255;
+            break;
+        case FILL_ALL_ZEROS:
+            buf[i] = 0;
+            break;
+        default:
+            buf[i] = (rnd() % 8 == 0) ? 0 : rnd();
+            break;
+        }
+    }
+}
+
+/** 
+ * @brief Count the zero bytes in a buffer
+ * @param buf the buffer
+ * @param len its length
+ * 
+ * @return the number of zeros
+ */
+static size_t zeros(const uint8_t *buf, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        n += buf[i] == 0;
+    }
+    return n;
+}
+
+static void test_cobs(void) {
+    printf("cobs\n");
+    static uint8_t in[COBS_MAX_LEN];
+    static uint8_t enc[FRAME_COBS_MAX(COBS_MAX_LEN)];
+    static uint8_t out[FRAME_COBS_MAX(COBS_MAX_LEN)];
+
+    for (int f = 0; f < FILL_COUNT; f++) {
+        uint32_t bad_len = 0, bad_zero = 0, bad_data = 0;
+        for (size_t len = 0; len <= COBS_MAX_LEN; len++) {
+            fill(in, len, f);
+            size_t enc_len = frame_cobs_encode(in, len, enc);
+            bad_len += enc_len > FRAME_COBS_MAX(len);
+            bad_zero += zeros(enc, enc_len) != 0;
+            size_t out_len = frame_cobs_decode(enc, enc_len, out);
+            bad_data += out_len != len || memcmp(in, out, len) != 0;
+        }
+        CHECK(bad_len == 0, "%s: %u encodings longer than FRAME_COBS_MAX", g_fill_names[f], bad_len);
+        CHECK(bad_zero == 0, "%s: %u encodings hold a zero", g_fill_names[f], bad_zero);
+        CHECK(bad_data == 0, "%s: %u lengths did not round trip", g_fill_names[f], bad_data);
+    }
+
+    // The edges of a run: 253, 254 and 255 bytes without a zero
+    for (size_t len = 253; len <= 255; len++) {
+        memset(in, 0x55, len);
+        size_t enc_len = frame_cobs_encode(in, len, enc);
+        CHECK(enc_len == len + 1 + (len >= 254), "%zu bytes encoded to %zu", len, enc_len);
+        CHECK(enc[0] == (len >= 254 ? 0xff : len + 1), "%zu bytes start with code 0x%02x", len, enc[0]);
+    }
+
+    CHECK(frame_cobs_decode((const uint8_t[]){ 0x00, 0x01 }, 2, out) == 0, "a zero code was accepted");
+    CHECK(frame_cobs_decode((const uint8_t[]){ 0x05, 0x01, 0x02 }, 3, out) == 0, "a code past the end was accepted");
+}
+
+static void test_round_trip(void) {
+    printf("frame round trip\n");
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+
+    for (int f = 0; f < FILL_COUNT; f++) {
+        uint32_t bad_len = 0, bad_zero = 0, bad_data = 0;
+        for (size_t len = 0; len < FRAME_MAX_PAYLOAD; len++) {
+            uint8_t type = rnd();
+            fill(payload, len, f);
+            size_t frame_len = frame_encode(type, payload, len, frame);
+            bad_len += frame_len > FRAME_MAX_SIZE(len);
+            bad_zero += zeros(frame, frame_len) != 1 || frame[frame_len - 1] != 0;
+
+            uint8_t got_type;
+            uint8_t *got;
+            int got_len = frame_decode(frame, frame_len - 1, &got_type, &got);
+            bad_data += got_len != (int)len || got_type != type || memcmp(got, payload, len) != 0;
+        }
+        CHECK(bad_len == 0, "%s: %u frames longer than FRAME_MAX_SIZE", g_fill_names[f], bad_len);
+        CHECK(bad_zero == 0, "%s: %u frames with a zero before the delimiter", g_fill_names[f], bad_zero);
+        CHECK(bad_data == 0, "%s: %u payload lengths did not round trip", g_fill_names[f], bad_data);
+    }
+
+    // The check value of CRC-16/CCITT-FALSE
+    CHECK(frame_crc16(0xffff, (const uint8_t *)"123456789", 9) == 0x29b1, "crc of the check string 0x%04x",
+          frame_crc16(0xffff, (const uint8_t *)"123456789", 9));
+}
+
+static void test_corrupt(void) {
+    printf("corrupt frames\n");
+    static const size_t lens[] = { 0, 1, 14, 20, 60, 200, FRAME_MAX_PAYLOAD - 1 };
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    uint8_t copy[2 * FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    uint8_t type;
+    uint8_t *got;
+
+    for (int f = 0; f < FILL_COUNT; f++) {
+        uint32_t tried = 0, accepted = 0, cut = 0, joined = 0;
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            fill(payload, lens[l], f);
+            size_t frame_len = frame_encode(0x5a, payload, lens[l], frame) - 1;
+
+            // Every byte, by a random non-zero xor and by becoming a zero
+            for (size_t i = 0; i < frame_len; i++) {
+                for (int k = 0; k < 2; k++) {
+                    memcpy(copy, frame, frame_len);
+                    copy[i] = k ? 0 : copy[i] ^ (1 + rnd() % 255);
+                    tried++;
+                    accepted += frame_decode(copy, frame_len, &type, &got) >= 0;
+                }
+            }
+
+            // Missing its last byte, or run into the next frame by a lost delimiter
+            memcpy(copy, frame, frame_len);
+            cut += frame_decode(copy, frame_len - 1, &type, &got) >= 0;
+            memcpy(copy, frame, frame_len);
+            memcpy(&copy[frame_len], frame, frame_len);
+            joined += frame_decode(copy, 2 * frame_len, &type, &got) >= 0;
+        }
+        CHECK(accepted == 0, "%s: %u of %u corrupted frames accepted", g_fill_names[f], accepted, tried);
+        CHECK(cut == 0, "%s: %u frames cut short accepted", g_fill_names[f], cut);
+        CHECK(joined == 0, "%s: %u joined frames accepted", g_fill_names[f], joined);
+    }
+}
+
+int main(void) {
+    test_cobs();
+    test_round_trip();
+    test_corrupt();
+    return TEST_EXIT();
+}
@@ -0,0 +1,221 @@
+/** 
+ * @file test_history.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Host test that replays a launch through the history into the flight log
+ *
+ * Samples arrive at the pad rates, then at the boost rates once the history
+ * is triggered, with history_service() and flight_log_service() run every
+ * 1 ms as the log task does and the flash simulated by w25q_sim.c. The
+ * flight is read back, its frames decoded and every IMU sample from before
+ * launch to the stop must be there with no gap. After the stop the history
+ * must go back to the pad ring without counting anything as dropped.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "w25q.h"
+#include "flight_log.h"
+#include "frame.h"
+#include "logpack.h"
+#include "history.h"
+#include "slog.h"
+#include "w25q_sim.h"
+
+#include "test.h"
+
+/// Sample periods on the pad and in boost, in us
+#define PAD_IMU_US 2404         // 416 Hz
+#define PAD_SLOW_US 100000      // 10 Hz mag and baro
+#define BOOST_IMU_US 600        // 1666 Hz
+#define BOOST_MAG_US 10000      // 100 Hz
+#define BOOST_BARO_US 20000     // 50 Hz
+
+/// A little more than the whole flight
+#define MAX_IMU_SAMPLES 32768
+
+/// Times of the IMU samples decoded from the flight
+static uint32_t g_imu_times[MAX_IMU_SAMPLES];
+static uint32_t g_imu_count = 0;
+
+/// The sample times in the replay
+static uint32_t g_now_us = 0;
+static uint32_t g_next_imu = 0;
+static uint32_t g_next_mag = 0;
+static uint32_t g_next_baro = 0;
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+/** 
+ * @brief Push the samples due in the next millisecond then run the log task
+ * @param imu_us the IMU period
+ * @param mag_us the magnetometer period
+ * @param baro_us the barometer period
+ * 
+ */
+static void tick(uint32_t imu_us, uint32_t mag_us, uint32_t baro_us) {
+    g_now_us += 1000;
+
+    while (g_next_imu <= g_now_us) {
+        telem_imu_t imu = { .time_us = g_next_imu, .accel = { 100, -200, 2048 }, .gyro = { 1, 2, 3 } };
+        imu.accel[0] += g_next_imu % 7;
+        history_push(TELEM_REC_IMU, &imu, sizeof(imu));
+        g_next_imu += imu_us;
+    }
+    while (g_next_mag <= g_now_us) {
+        telem_mag_t mag = { .time_us = g_next_mag, .mag = { 300, 20, -400 } };
+        history_push(TELEM_REC_MAG, &mag, sizeof(mag));
+        g_next_mag += mag_us;
+    }
+    while (g_next_baro <= g_now_us) {
+        telem_baro_t baro = { .time_us = g_next_baro, .pressure = 1580000, .temperature = 20 << 16 };
+        history_push(TELEM_REC_BARO, &baro, sizeof(baro));
+        g_next_baro += baro_us;
+    }
+
+    history_service();
+    flight_log_service();
+    w25q_sim_advance(1000);
+}
+
+/** 
+ * @brief Collect the IMU sample times from a decoded block
+ * 
+ */
+static void collect(telem_rec_type_t type, const void *rec, size_t len, void *ctx) {
+    (void)len; (void)ctx;
+    if (type == TELEM_REC_IMU && g_imu_count < MAX_IMU_SAMPLES) {
+        const telem_imu_t *imu = rec;
+        g_imu_times[g_imu_count++] = imu->time_us;
+    }
+}
+
+/** 
+ * @brief Read the most recent flight and decode its IMU samples
+ * 
+ * @return the number of corrupt frames
+ */
+static uint32_t decode_flight(void) {
+    static uint8_t data[1024 * 1024];
+    flight_log_entry_t entry;
+    uint32_t corrupt = 0;
+
+    g_imu_count = 0;
+    if (!flight_log_get_flight(1, &entry) || entry.len > sizeof(data)) {
+        return 1;
+    }
+    uint32_t offset = 0;
+    while (offset < entry.len) {
+        int got = flight_log_read(&entry, offset, &data[offset], entry.len - offset);
+        if (got <= 0) {
+            return 1;
+        }
+        offset += got;
+    }
+
+    size_t start = 0;
+    for (size_t i = 0; i < entry.len; i++) {
+        if (data[i] != 0) {
+            continue;
+        }
+        if (i > start) {
+            uint8_t type;
+            uint8_t *payload;
+            int len = frame_decode(&data[start], i - start, &type, &payload);
+            if (len < 0 || (type == TELEM_REC_PACKED && logpack_decode(payload, len, collect, NULL) < 0)) {
+                corrupt++;
+            }
+        }
+        start = i + 1;
+    }
+    return corrupt;
+}
+
+/** 
+ * @brief Replay a launch and check the flight log holds it without a gap
+ * @param timing the flash times
+ * @param pad_ms the time on the pad
+ * 
+ */
+static void replay_launch(const w25q_sim_timing_t *timing, uint32_t pad_ms) {
+    history_stats_t stats;
+    w25q_sim_stats_t sim;
+
+    history_get_stats(&stats);
+    uint32_t dropped = stats.dropped;
+
+    CHECK(w25q_sim_open(NULL, timing) == 0, "open");
+    flight_log_init();
+    g_now_us = g_next_imu = g_next_mag = g_next_baro = 0;
+
+    history_arm();
+    for (uint32_t ms = 0; ms < pad_ms; ms++) {
+        tick(PAD_IMU_US, PAD_SLOW_US, PAD_SLOW_US);
+    }
+    uint32_t launch_us = g_now_us;
+
+    history_trigger();
+    for (uint32_t ms = 0; ms < 4000; ms++) {
+        tick(BOOST_IMU_US, BOOST_MAG_US, BOOST_BARO_US);
+    }
+    uint32_t last_imu = g_next_imu - BOOST_IMU_US;
+
+    history_stop();
+    uint32_t ms = 0;
+    while (flight_log_recording() && ms++ < 20000) {
+        history_service();
+        flight_log_service();
+        w25q_sim_advance(1000);
+    }
+    CHECK(!flight_log_recording(), "flight log still recording");
+    CHECK(!history_triggered(), "history still triggered after the stop");
+
+    history_get_stats(&stats);
+    dropped = stats.dropped - dropped;
+    CHECK(dropped == 0, "%u samples dropped, %u in the ring at most", dropped, stats.high_water);
+
+    // Samples after landing go round the pad ring again
+    uint32_t discarded = stats.discarded;
+    dropped = stats.dropped;
+    for (uint32_t i = 0; i < 1000; i++) {
+        telem_imu_t imu = { .time_us = g_now_us + i };
+        history_push(TELEM_REC_IMU, &imu, sizeof(imu));
+    }
+    history_get_stats(&stats);
+    CHECK(stats.dropped == dropped, "%u samples dropped after landing", stats.dropped - dropped);
+    CHECK(stats.discarded > discarded, "the ring did not go back to discarding");
+
+    CHECK(decode_flight() == 0, "corrupt frames in the flight");
+    CHECK(g_imu_count > 0 && g_imu_times[0] < launch_us - 100000,
+          "history starts at %u us, launch at %u us", g_imu_count ? g_imu_times[0] : 0, launch_us);
+    CHECK(g_imu_count > 0 && g_imu_times[g_imu_count - 1] == last_imu,
+          "flight ends at %u us, last sample at %u us", g_imu_count ? g_imu_times[g_imu_count - 1] : 0, last_imu);
+
+    uint32_t gaps = 0;
+    for (uint32_t i = 1; i < g_imu_count; i++) {
+        // No spacing is longer than the pad one
+        uint32_t dt = g_imu_times[i] - g_imu_times[i - 1];
+        if (dt == 0 || dt > PAD_IMU_US) {
+            gaps++;
+        }
+    }
+    CHECK(gaps == 0, "%u gaps in %u IMU samples", gaps, g_imu_count);
+
+    w25q_sim_get_stats(&sim);
+    CHECK(sim.violations == 0, "%u flash violations", sim.violations);
+    w25q_sim_close();
+}
+
+int main(void) {
+    printf("launch with typical flash times\n");
+    replay_launch(&w25q_sim_typical, 2000);
+    // Long enough on the pad for the erases at their maximum times
+    printf("launch with the maximum flash times\n");
+    replay_launch(&w25q_sim_worst, 15000);
+    return TEST_EXIT();
+}
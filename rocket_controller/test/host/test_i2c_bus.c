@@ -0,0 +1,320 @@
+/** 
+ * @file test_i2c_bus.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the I2C transaction engine against the simulated buses
+ *
+ * i2c_sim.c stands in for I2C 1, I2C 2 and their DMA channels. Reads and
+ * writes must move the right bytes in the bit times a 400 kHz bus takes,
+ * the two buses must run at the same time, a NACK must fail only its own
+ * transaction and a full queue must refuse the submit. A lost interrupt and
+ * a device holding SDA must fail the transaction at its deadline and leave
+ * the bus working, and i2c_transfer() must give up. Transaction buffers
+ * are static since the DMA is given 32 bit addresses.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <libopencm3/stm32/i2c.h>
+
+#include "slog.h"
+#include "i2c_bus.h"
+#include "i2c_sim.h"
+
+#include "test.h"
+
+#define MAG_ADDR 0x1E
+#define BARO_ADDR 0x46
+
+/// Bit times of a register read: start, address, register, restart, address, data, stop
+#define READ_BITS(len) (1 + 9 + 9 + 1 + 9 + 9 * (len) + 1)
+
+/// Bit times of a register write: start, address, register, data, stop
+#define WRITE_BITS(len) (1 + 9 + 9 + 9 * (len) + 1)
+
+static uint8_t g_mag_regs[256];
+static uint8_t g_baro_regs[256];
+
+static uint8_t g_buf[I2C_NUM_BUSES][8];
+static i2c_txn_t g_txn[8];
+
+/// The engine's counters at the last setup(), they are not reset by i2c_bus_init()
+static i2c_stats_t g_base[I2C_NUM_BUSES];
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+/** 
+ * @brief Reset the buses with a device on each
+ * @param irq_ns the CPU time of each interrupt
+ * 
+ */
+static void setup(uint32_t irq_ns) {
+    for (int i = 0; i < 256; i++) {
+        g_mag_regs[i] = (uint8_t)i;
+        g_baro_regs[i] = (uint8_t)(0x80 + i);
+    }
+    memset(g_buf, 0, sizeof(g_buf));
+    memset(g_txn, 0, sizeof(g_txn));
+
+    i2c_sim_reset(irq_ns);
+    i2c_sim_add_device(I2C_BUS_1, MAG_ADDR, g_mag_regs);
+    i2c_sim_add_device(I2C_BUS_2, BARO_ADDR, g_baro_regs);
+    i2c_bus_init(I2C_BUS_1);
+    i2c_bus_init(I2C_BUS_2);
+    i2c_get_stats(I2C_BUS_1, &g_base[I2C_BUS_1]);
+    i2c_get_stats(I2C_BUS_2, &g_base[I2C_BUS_2]);
+}
+
+/** 
+ * @brief Get the engine's counters since the last setup()
+ * @param bus the bus
+ * @param stats the counters to fill
+ * 
+ */
+static void get_stats(i2c_bus_t bus, i2c_stats_t *stats) {
+    i2c_get_stats(bus, stats);
+    stats->txns -= g_base[bus].txns;
+    stats->errors -= g_base[bus].errors;
+    stats->bytes -= g_base[bus].bytes;
+    stats->rejected -= g_base[bus].rejected;
+}
+
+/** 
+ * @brief Run until both buses are idle
+ * @param limit_ns the longest to run
+ * 
+ * @return the time they went idle
+ */
+static uint64_t run_idle(uint64_t limit_ns) {
+    uint64_t t = i2c_sim_now_ns();
+
+    while (t < limit_ns && !(i2c_sim_idle(I2C_BUS_1) && i2c_sim_idle(I2C_BUS_2))) {
+        t += I2C_SIM_BIT_NS / 5;
+        i2c_sim_run_until(t);
+    }
+    return t;
+}
+
+/** 
+ * @brief Reads by DMA and by the single byte path, and a write
+ * 
+ */
+static void test_read_write(void) {
+    printf("read and write\n");
+    setup(0);
+
+    g_txn[0] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x68, .read = true, .len = 6, .buf = g_buf[0] };
+    CHECK(i2c_submit(I2C_BUS_1, &g_txn[0]), "submit");
+    run_idle(1000000);
+    CHECK(g_txn[0].status == I2C_TXN_DONE, "status %d", g_txn[0].status);
+    CHECK(memcmp(g_buf[0], &g_mag_regs[0x68], 6) == 0, "read %02x %02x .. %02x", g_buf[0][0], g_buf[0][1],
+          g_buf[0][5]);
+
+    i2c_sim_stats_t sim;
+    i2c_sim_get_stats(I2C_BUS_1, &sim);
+    CHECK(sim.busy_ns == READ_BITS(6) * I2C_SIM_BIT_NS, "6 byte read took %lu ns", (unsigned long)sim.busy_ns);
+    CHECK(sim.irqs == 6, "%u interrupts", sim.irqs);
+
+    g_txn[1] = (i2c_txn_t){ .addr = BARO_ADDR, .reg = 0x01, .read = true, .len = 1, .buf = g_buf[1] };
+    CHECK(i2c_submit(I2C_BUS_2, &g_txn[1]), "submit");
+    run_idle(2000000);
+    CHECK(g_txn[1].status == I2C_TXN_DONE && g_buf[1][0] == 0x81, "status %d, read %02x", g_txn[1].status,
+          g_buf[1][0]);
+    i2c_sim_get_stats(I2C_BUS_2, &sim);
+    CHECK(sim.busy_ns == READ_BITS(1) * I2C_SIM_BIT_NS, "1 byte read took %lu ns", (unsigned long)sim.busy_ns);
+
+    g_buf[1][0] = 0x5A;
+    g_buf[1][1] = 0xA5;
+    g_txn[2] = (i2c_txn_t){ .addr = BARO_ADDR, .reg = 0x36, .read = false, .len = 2, .buf = g_buf[1] };
+    CHECK(i2c_submit(I2C_BUS_2, &g_txn[2]), "submit");
+    run_idle(3000000);
+    CHECK(g_txn[2].status == I2C_TXN_DONE, "status %d", g_txn[2].status);
+    CHECK(g_baro_regs[0x36] == 0x5A && g_baro_regs[0x37] == 0xA5, "wrote %02x %02x", g_baro_regs[0x36],
+          g_baro_regs[0x37]);
+    i2c_sim_get_stats(I2C_BUS_2, &sim);
+    CHECK(sim.busy_ns == (READ_BITS(1) + WRITE_BITS(2)) * I2C_SIM_BIT_NS, "busy %lu ns",
+          (unsigned long)sim.busy_ns);
+
+    i2c_stats_t stats;
+    get_stats(I2C_BUS_2, &stats);
+    CHECK(stats.txns == 2 && stats.bytes == 3 && stats.errors == 0, "%u txns, %u bytes, %u errors", stats.txns,
+          stats.bytes, stats.errors);
+}
+
+/** 
+ * @brief Transactions on the two buses run at the same time
+ * 
+ */
+static void test_overlap(void) {
+    printf("both buses at once\n");
+    setup(1000);
+
+    for (int i = 0; i < 3; i++) {
+        g_txn[i] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x68, .read = true, .len = 6, .buf = g_buf[0] };
+        g_txn[4 + i] = (i2c_txn_t){ .addr = BARO_ADDR, .reg = 0x1D, .read = true, .len = 6, .buf = g_buf[1] };
+        CHECK(i2c_submit(I2C_BUS_1, &g_txn[i]) && i2c_submit(I2C_BUS_2, &g_txn[4 + i]), "submit %d", i);
+    }
+    uint64_t end = run_idle(10000000);
+
+    i2c_sim_stats_t sim1;
+    i2c_sim_stats_t sim2;
+    i2c_sim_get_stats(I2C_BUS_1, &sim1);
+    i2c_sim_get_stats(I2C_BUS_2, &sim2);
+    for (int i = 0; i < 3; i++) {
+        CHECK(g_txn[i].status == I2C_TXN_DONE && g_txn[4 + i].status == I2C_TXN_DONE, "txn %d", i);
+    }
+    CHECK(memcmp(g_buf[1], &g_baro_regs[0x1D], 6) == 0, "bus 2 data");
+
+    // The wire time of each bus is at least the bits, and the two mostly overlap
+    uint64_t bits_ns = 3 * READ_BITS(6) * I2C_SIM_BIT_NS;
+    uint64_t overlap = i2c_sim_overlap_ns();
+    CHECK(sim1.busy_ns >= bits_ns && sim2.busy_ns >= bits_ns, "busy %lu and %lu ns",
+          (unsigned long)sim1.busy_ns, (unsigned long)sim2.busy_ns);
+    CHECK(overlap > 9 * bits_ns / 10, "overlap %lu ns of %lu", (unsigned long)overlap, (unsigned long)bits_ns);
+    CHECK(end < sim1.busy_ns + sim2.busy_ns, "finished at %lu ns", (unsigned long)end);
+
+    // One bus waits while the other's handler runs, never longer than one handler
+    CHECK(i2c_sim_cpu_ns() == (uint64_t)(sim1.irqs + sim2.irqs) * 1000, "cpu %lu ns for %u interrupts",
+          (unsigned long)i2c_sim_cpu_ns(), sim1.irqs + sim2.irqs);
+    CHECK(sim1.irq_wait_max_ns + sim2.irq_wait_max_ns > 0, "no interrupt waited");
+    CHECK(sim1.irq_wait_max_ns <= 1000 && sim2.irq_wait_max_ns <= 1000, "waited %lu and %lu ns",
+          (unsigned long)sim1.irq_wait_max_ns, (unsigned long)sim2.irq_wait_max_ns);
+}
+
+/** 
+ * @brief A NACK fails its transaction and the queue carries on, a full queue
+ * refuses
+ * 
+ */
+static void test_errors(void) {
+    printf("nack and full queue\n");
+    setup(0);
+
+    g_txn[0] = (i2c_txn_t){ .addr = 0x30, .reg = 0x00, .read = true, .len = 6, .buf = g_buf[0] };
+    g_txn[1] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x4F, .read = true, .len = 1, .buf = g_buf[0] + 6 };
+    CHECK(i2c_submit(I2C_BUS_1, &g_txn[0]) && i2c_submit(I2C_BUS_1, &g_txn[1]), "submit");
+    run_idle(1000000);
+    CHECK(g_txn[0].status == I2C_TXN_ERROR, "status %d", g_txn[0].status);
+    CHECK(g_txn[1].status == I2C_TXN_DONE && g_buf[0][6] == 0x4F, "status %d, read %02x", g_txn[1].status,
+          g_buf[0][6]);
+
+    i2c_stats_t stats;
+    i2c_sim_stats_t sim;
+    get_stats(I2C_BUS_1, &stats);
+    i2c_sim_get_stats(I2C_BUS_1, &sim);
+    CHECK(stats.errors == 1 && stats.txns == 1 && sim.naks == 1, "%u errors, %u txns, %u naks", stats.errors,
+          stats.txns, sim.naks);
+
+    // One in progress and I2C_QUEUE_LEN waiting
+    for (int i = 0; i < I2C_QUEUE_LEN + 1; i++) {
+        g_txn[i] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x68, .read = true, .len = 6, .buf = g_buf[0] };
+        CHECK(i2c_submit(I2C_BUS_1, &g_txn[i]), "submit %d", i);
+    }
+    g_txn[I2C_QUEUE_LEN + 1] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x68, .read = true, .len = 6,
+                                            .buf = g_buf[0] };
+    CHECK(!i2c_submit(I2C_BUS_1, &g_txn[I2C_QUEUE_LEN + 1]), "submit to a full queue");
+    run_idle(5000000);
+    get_stats(I2C_BUS_1, &stats);
+    CHECK(stats.rejected == 1 && stats.txns == 1 + I2C_QUEUE_LEN + 1, "%u rejected, %u txns", stats.rejected,
+          stats.txns);
+}
+
+/** 
+ * @brief Run until a time, checking for timeouts as the sensor polls would
+ * @param bus the bus to check
+ * @param until_ns when to stop
+ * 
+ * @return the number of recoveries
+ */
+static uint32_t run_polled(i2c_bus_t bus, uint64_t until_ns) {
+    uint32_t recovered = 0;
+
+    while (i2c_sim_now_ns() < until_ns) {
+        i2c_sim_run_until(i2c_sim_now_ns() + 50000);
+        recovered += i2c_check_timeout(bus);
+    }
+    return recovered;
+}
+
+/** 
+ * @brief A lost interrupt and a held SDA are recovered at the deadline,
+ * i2c_transfer() gives up, and a stuck stop does not hang a submit
+ * 
+ */
+static void test_timeouts(void) {
+    printf("timeouts and recovery\n");
+    setup(0);
+
+    // The start's interrupt is lost, the next transaction waits behind it
+    i2c_sim_lose_irq(I2C_BUS_1);
+    g_txn[0] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x68, .read = true, .len = 6, .buf = g_buf[0] };
+    g_txn[1] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x4F, .read = true, .len = 1, .buf = g_buf[0] + 6 };
+    CHECK(i2c_submit(I2C_BUS_1, &g_txn[0]) && i2c_submit(I2C_BUS_1, &g_txn[1]), "submit");
+    uint32_t early = run_polled(I2C_BUS_1, I2C_TXN_TIMEOUT_US * 1000 / 2);
+    CHECK(early == 0 && g_txn[0].status == I2C_TXN_QUEUED, "recovered %u times before the deadline, status %d",
+          early, g_txn[0].status);
+    uint32_t recovered = run_polled(I2C_BUS_1, 3 * I2C_TXN_TIMEOUT_US * 1000);
+    CHECK(recovered == 1 && g_txn[0].status == I2C_TXN_ERROR, "recovered %u times, status %d", recovered,
+          g_txn[0].status);
+    CHECK(g_txn[1].status == I2C_TXN_DONE && g_buf[0][6] == 0x4F, "next status %d, read %02x", g_txn[1].status,
+          g_buf[0][6]);
+
+    i2c_stats_t stats;
+    i2c_sim_stats_t sim;
+    get_stats(I2C_BUS_1, &stats);
+    i2c_sim_get_stats(I2C_BUS_1, &sim);
+    CHECK(stats.timeouts == 1 && stats.errors == 1 && stats.txns == 1, "%u timeouts, %u errors, %u txns",
+          stats.timeouts, stats.errors, stats.txns);
+    CHECK(sim.lost_irqs == 1 && sim.resets == 2 && sim.scl_clocks == 0 && sim.gpio_stops == 1,
+          "%u lost, %u resets, %u clocks, %u stops", sim.lost_irqs, sim.resets, sim.scl_clocks, sim.gpio_stops);
+
+    // A device holds SDA through 5 more clocks, so no start can go out
+    setup(0);
+    i2c_sim_hold_sda(I2C_BUS_2, 5);
+    g_txn[0] = (i2c_txn_t){ .addr = BARO_ADDR, .reg = 0x1D, .read = true, .len = 6, .buf = g_buf[1] };
+    CHECK(i2c_submit(I2C_BUS_2, &g_txn[0]), "submit");
+    recovered = run_polled(I2C_BUS_2, 2 * I2C_TXN_TIMEOUT_US * 1000);
+    i2c_sim_get_stats(I2C_BUS_2, &sim);
+    CHECK(recovered == 1 && g_txn[0].status == I2C_TXN_ERROR, "recovered %u times, status %d", recovered,
+          g_txn[0].status);
+    CHECK(sim.scl_clocks == 5 && sim.gpio_stops == 1, "%u clocks, %u stops", sim.scl_clocks, sim.gpio_stops);
+
+    g_txn[1] = (i2c_txn_t){ .addr = BARO_ADDR, .reg = 0x1D, .read = true, .len = 6, .buf = g_buf[1] };
+    CHECK(i2c_submit(I2C_BUS_2, &g_txn[1]), "submit after recovery");
+    run_idle(i2c_sim_now_ns() + 1000000);
+    CHECK(g_txn[1].status == I2C_TXN_DONE && memcmp(g_buf[1], &g_baro_regs[0x1D], 6) == 0, "status %d",
+          g_txn[1].status);
+
+    // i2c_transfer() works on a good bus and gives up at the deadline
+    setup(0);
+    CHECK(i2c_read_regs(I2C_BUS_1, MAG_ADDR, 0x4F, g_buf[0], 1) && g_buf[0][0] == 0x4F, "transfer read %02x",
+          g_buf[0][0]);
+    i2c_sim_lose_irq(I2C_BUS_1);
+    uint64_t start_ns = i2c_sim_now_ns();
+    CHECK(!i2c_read_regs(I2C_BUS_1, MAG_ADDR, 0x4F, g_buf[0], 1), "transfer with a lost interrupt");
+    uint64_t took_ns = i2c_sim_now_ns() - start_ns;
+    CHECK(took_ns > I2C_TXN_TIMEOUT_US * 1000 && took_ns < 2 * I2C_TXN_TIMEOUT_US * 1000, "gave up after %lu ns",
+          (unsigned long)took_ns);
+
+    // A stop bit that never clears does not hold a submit with interrupts masked
+    setup(0);
+    I2C_CR1(I2C1) |= I2C_CR1_STOP;
+    g_txn[0] = (i2c_txn_t){ .addr = MAG_ADDR, .reg = 0x68, .read = true, .len = 6, .buf = g_buf[0] };
+    CHECK(i2c_submit(I2C_BUS_1, &g_txn[0]), "submit with STOP stuck");
+    I2C_CR1(I2C1) &= ~I2C_CR1_STOP;
+    run_idle(i2c_sim_now_ns() + 1000000);
+    CHECK(g_txn[0].status == I2C_TXN_DONE, "status %d", g_txn[0].status);
+}
+
+int main(void) {
+    test_read_write();
+    test_overlap();
+    test_errors();
+    test_timeouts();
+    return TEST_EXIT();
+}
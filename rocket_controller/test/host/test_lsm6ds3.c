@@ -0,0 +1,219 @@
+/** 
+ * @file test_lsm6ds3.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the LSM6DS3 driver against the simulated sensor
+ *
+ * The driver runs as the acq task drives it, every 1 ms a finished block is
+ * parsed and then lsm6ds3_poll() checks the FIFO level, with lsm6ds3_sim.c
+ * standing in for SPI 1 and the sensor. Every slot taken must come out once,
+ * in order, with its time stamp no later than the slot and less than one
+ * period early, and no burst may read past the unread count or start while
+ * the bus is in use.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "timebase.h"
+#include "slog.h"
+#include "lsm6ds3.h"
+#include "lsm6ds3_sim.h"
+
+#include "test.h"
+
+/// Period of the acq task
+#define TASK_US 1000
+
+/// What came out of the driver
+typedef struct {
+    uint32_t samples;
+    uint32_t next_slot;     ///< The slot the next sample should be
+    uint32_t gaps;
+    uint32_t bad_data;
+    uint32_t mags;
+    uint32_t last_mag_slot;
+    uint32_t bad_mag;
+    int64_t min_err_us;     ///< Time stamp less the time the slot was taken
+    int64_t max_err_us;
+    uint32_t bursts;        ///< Bursts started by lsm6ds3_poll()
+    lsm6ds3_stats_t base;   ///< The driver counters at the start
+} run_result_t;
+
+void timebase_init(void) {
+}
+
+uint64_t timebase_now_us(void) {
+    return lsm6ds3_sim_now();
+}
+
+uint32_t timebase_now_ms(void) {
+    return lsm6ds3_sim_now() / 1000;
+}
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+/** 
+ * @brief Start a run, the first sample may be any slot
+ * @param result the results to reset
+ * 
+ */
+static void result_reset(run_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    result->min_err_us = INT64_MAX;
+    result->max_err_us = INT64_MIN;
+    lsm6ds3_get_stats(&result->base);
+}
+
+/** 
+ * @brief Run the acq task's part of the driver for a while
+ * @param ms the time to run
+ * @param result the results so far
+ * @param check_times false to skip the time stamp check
+ * 
+ */
+static void run(uint32_t ms, run_result_t *result, bool check_times) {
+    lsm6ds3_sample_t samples[LSM6DS3_MAX_SAMPLES];
+
+    for (uint32_t t = 0; t < ms * 1000; t += TASK_US) {
+        lsm6ds3_sim_advance(TASK_US);
+
+        size_t n = lsm6ds3_read(samples, LSM6DS3_MAX_SAMPLES);
+        for (size_t i = 0; i < n; i++) {
+            const lsm6ds3_sample_t *s = &samples[i];
+            uint32_t slot = lsm6ds3_sim_slot_of(s->gyro);
+
+            if (result->samples > 0 && slot != result->next_slot) {
+                result->gaps++;
+            }
+            result->next_slot = slot + 1;
+            if (s->gyro[2] != 1 || s->accel[0] != -s->gyro[0] || s->accel[1] != 2 || s->accel[2] != 3) {
+                result->bad_data++;
+            }
+            if (s->mag_valid) {
+                if (lsm6ds3_sim_slot_of(s->mag) != slot || s->mag[2] != 7
+                    || (result->mags > 0 && slot - result->last_mag_slot != LSM6DS3_HUB_DEC)) {
+                    result->bad_mag++;
+                }
+                result->last_mag_slot = slot;
+                result->mags++;
+            }
+            if (check_times) {
+                int64_t err = (int64_t)s->time_us - (int64_t)lsm6ds3_sim_slot_time(slot);
+                result->min_err_us = err < result->min_err_us ? err : result->min_err_us;
+                result->max_err_us = err > result->max_err_us ? err : result->max_err_us;
+            }
+            result->samples++;
+        }
+
+        result->bursts += lsm6ds3_poll();
+    }
+}
+
+/** 
+ * @brief Check the counters of a run that should have lost nothing
+ * @param result the results
+ * @param period_us the slot period the times were checked at
+ * 
+ */
+static void check_run(const run_result_t *result, uint32_t period_us) {
+    lsm6ds3_stats_t stats;
+    lsm6ds3_sim_stats_t sim;
+
+    lsm6ds3_get_stats(&stats);
+    lsm6ds3_sim_get_stats(&sim);
+    stats.bursts -= result->base.bursts;
+    stats.polls -= result->base.polls;
+    stats.fifo_overruns -= result->base.fifo_overruns;
+    stats.resyncs -= result->base.resyncs;
+
+    CHECK(result->samples > 0, "no samples");
+    CHECK(result->gaps == 0, "%u gaps in %u samples", result->gaps, result->samples);
+    CHECK(result->bad_data == 0, "%u samples with the wrong data", result->bad_data);
+    // What is left in the FIFO is less than a burst
+    CHECK(sim.slots - result->samples < LSM6DS3_BURST_SLOTS + 1, "%u slots taken, %u samples",
+          sim.slots, result->samples);
+    CHECK(result->min_err_us >= 0 && result->max_err_us < period_us,
+          "time stamps %ld to %ld us after the slot", (long)result->min_err_us, (long)result->max_err_us);
+    CHECK(stats.fifo_overruns == 0 && sim.overrun_words == 0, "%u overruns, %u words lost",
+          stats.fifo_overruns, sim.overrun_words);
+    CHECK(stats.resyncs == 0, "%u resyncs", stats.resyncs);
+    CHECK(sim.stale_words == 0, "%u stale words read", sim.stale_words);
+    CHECK(sim.violations == 0, "%u accesses while a burst was running", sim.violations);
+    CHECK(result->bursts == stats.bursts, "%u bursts started, %u finished", result->bursts, stats.bursts);
+    CHECK(stats.polls > stats.bursts, "%u polls for %u bursts", stats.polls, stats.bursts);
+}
+
+/** 
+ * @brief Bursts are started from the FIFO level alone
+ * 
+ */
+static void test_polled_bursts(void) {
+    printf("1666 Hz polled every 1 ms\n");
+    run_result_t result;
+
+    lsm6ds3_sim_reset(LSM6DS3_SIM_SPI_HZ);
+    CHECK(lsm6ds3_init() == 0, "init");
+    result_reset(&result);
+    run(10000, &result, true);
+    check_run(&result, LSM6DS3_PERIOD_US);
+
+    // The level stays near one burst
+    lsm6ds3_sim_stats_t sim;
+    lsm6ds3_sim_get_stats(&sim);
+    uint32_t burst_words = LSM6DS3_BURST_SLOTS * 2 * LSM6DS3_SET_WORDS;
+    CHECK(sim.max_level < burst_words + 4 * 2 * LSM6DS3_SET_WORDS, "FIFO reached %u words", sim.max_level);
+}
+
+/** 
+ * @brief Sensor hub words are attached to the slot they were stored in
+ * 
+ */
+static void test_hub(void) {
+    printf("sensor hub\n");
+    run_result_t result;
+
+    lsm6ds3_sim_reset(LSM6DS3_SIM_SPI_HZ);
+    CHECK(lsm6ds3_init() == 0, "init");
+    lsm6ds3_enable_hub(0x1e, 0x68);
+    result_reset(&result);
+    run(5000, &result, true);
+    check_run(&result, LSM6DS3_PERIOD_US);
+
+    CHECK(result.mags >= result.samples / LSM6DS3_HUB_DEC, "%u mag samples in %u", result.mags, result.samples);
+    CHECK(result.bad_mag == 0, "%u bad mag samples", result.bad_mag);
+}
+
+/** 
+ * @brief A rate change carries on without a gap
+ * 
+ */
+static void test_rate_change(void) {
+    printf("rate change\n");
+    run_result_t result;
+
+    lsm6ds3_sim_reset(LSM6DS3_SIM_SPI_HZ);
+    CHECK(lsm6ds3_init() == 0, "init");
+    // Samples already in the FIFO are timed at the new rate
+    lsm6ds3_set_odr(LSM6DS3_ODR_416HZ);
+    result_reset(&result);
+    run(100, &result, false);
+    run(2000, &result, true);
+
+    lsm6ds3_set_odr(LSM6DS3_ODR_1666HZ);
+    run(100, &result, false);
+    run(2000, &result, true);
+    check_run(&result, 4 * LSM6DS3_PERIOD_US);
+    CHECK(lsm6ds3_period_us() == LSM6DS3_PERIOD_US, "period %u us", lsm6ds3_period_us());
+}
+
+int main(void) {
+    test_polled_bursts();
+    test_hub();
+    test_rate_change();
+    return TEST_EXIT();
+}
@@ -0,0 +1,186 @@
+/** 
+ * @file test_lsm6ds3_fifo.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the LSM6DS3 FIFO parser on recorded FIFO images
+ *
+ * Each image in test/host/fifo is a run of FIFO bursts, written by
+ * tools/gen_fifo_images.py, with the sample, resync, mag and gap counts the
+ * parser must give. Every word holds its slot number, so each sample can be
+ * checked for the right gyro, accel and mag words, a time stamp of exactly
+ * its slot time, and the mag only on every hub_dec'th slot. A burst captured
+ * from a board can be checked the same way by writing it in the same layout.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timebase.h"
+#include "slog.h"
+#include "lsm6ds3.h"
+
+#include "test.h"
+
+#define IMAGE_DIR "test/host/fifo/"
+
+/// Time of slot 0 in every image
+#define T0_US 1000000
+
+/// Value of words past the unread count
+#define STALE 0x7FFF
+
+/// Image header, all fields little endian
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint8_t hub_dec;
+    uint8_t reserved;
+    uint16_t period_us;
+    uint32_t samples;
+    uint32_t resyncs;
+    uint32_t mags;
+    uint32_t gaps;
+    uint32_t bursts;
+} image_header_t;
+
+void timebase_init(void) {
+}
+
+uint64_t timebase_now_us(void) {
+    return 0;
+}
+
+uint32_t timebase_now_ms(void) {
+    return 0;
+}
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+/** 
+ * @brief Read a whole file
+ * @param path the file
+ * @param len set to its length
+ * 
+ * @return the contents, NULL if it could not be read
+ */
+static uint8_t *read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*len);
+    if (data != NULL && fread(data, 1, *len, f) != *len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+/** 
+ * @brief Parse an image and check what comes out
+ * @param name the image file in IMAGE_DIR
+ * 
+ */
+static void check_image(const char *name) {
+    printf("%s\n", name);
+    char path[64];
+    size_t len;
+
+    snprintf(path, sizeof(path), IMAGE_DIR "%s", name);
+    uint8_t *data = read_file(path, &len);
+    CHECK(data != NULL, "cannot read %s", path);
+    if (data == NULL) {
+        return;
+    }
+
+    image_header_t header;
+    memcpy(&header, data, sizeof(header));
+    CHECK(len >= sizeof(header) && memcmp(header.magic, "L6FI", 4) == 0, "not an image");
+
+    lsm6ds3_parser_t parser;
+    lsm6ds3_parser_init(&parser, header.hub_dec);
+    parser.period_us = header.period_us;
+
+    // Room for more than the driver's array so an overflow is seen
+    lsm6ds3_sample_t samples[2 * LSM6DS3_MAX_SAMPLES];
+    uint32_t count = 0;
+    uint32_t mags = 0;
+    uint32_t gaps = 0;
+    uint32_t bad_data = 0;
+    uint32_t bad_time = 0;
+    uint32_t bad_mag = 0;
+    uint32_t most = 0;
+    int32_t last_slot = -1;
+
+    size_t pos = sizeof(header);
+    uint32_t bursts = 0;
+    while (pos + 6 <= len) {
+        uint32_t time_us;
+        uint16_t block_len;
+        memcpy(&time_us, data + pos, 4);
+        memcpy(&block_len, data + pos + 4, 2);
+        pos += 6;
+        if (pos + block_len > len) {
+            break;
+        }
+
+        size_t n = lsm6ds3_fifo_parse(&parser, data + pos, block_len, time_us, samples, 2 * LSM6DS3_MAX_SAMPLES);
+        most = n > most ? n : most;
+        for (size_t i = 0; i < n; i++) {
+            const lsm6ds3_sample_t *s = &samples[i];
+            int32_t slot = s->gyro[0];
+
+            if (s->gyro[1] != -slot || s->gyro[2] != 1 || s->accel[0] != slot || s->accel[1] != 2
+                || s->accel[2] != 3 || slot == STALE) {
+                bad_data++;
+            }
+            if (s->time_us != T0_US + (uint32_t)slot * header.period_us) {
+                bad_time++;
+            }
+            bool mag_slot = header.hub_dec && slot % header.hub_dec == 0;
+            if (s->mag_valid != mag_slot || (mag_slot && (s->mag[0] != slot || s->mag[1] != 5 || s->mag[2] != 7))) {
+                bad_mag++;
+            }
+            mags += s->mag_valid;
+            if (last_slot >= 0 && slot != last_slot + 1) {
+                gaps++;
+            }
+            last_slot = slot;
+            count++;
+        }
+
+        pos += block_len;
+        bursts++;
+    }
+
+    CHECK(pos == len && bursts == header.bursts, "%u of %u bursts read", bursts, header.bursts);
+    CHECK(count == header.samples, "%u samples, %u expected", count, header.samples);
+    CHECK(parser.resyncs == header.resyncs, "%u resyncs, %u expected", parser.resyncs, header.resyncs);
+    CHECK(gaps == header.gaps, "%u gaps, %u expected", gaps, header.gaps);
+    CHECK(mags == header.mags, "%u mag samples, %u expected", mags, header.mags);
+    CHECK(bad_data == 0, "%u samples with the wrong words", bad_data);
+    CHECK(bad_time == 0, "%u samples with the wrong time", bad_time);
+    CHECK(bad_mag == 0, "%u samples with the wrong mag", bad_mag);
+    CHECK(most <= LSM6DS3_MAX_SAMPLES, "%u samples from one burst", most);
+
+    free(data);
+}
+
+int main(void) {
+    check_image("split.bin");
+    check_image("split_hub.bin");
+    check_image("backlog.bin");
+    check_image("overrun.bin");
+    check_image("stale.bin");
+    return TEST_EXIT();
+}
@@ -0,0 +1,170 @@
+/** 
+ * @file test_sched.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Host test of the scheduler on a simulated clock
+ *
+ * The clock moves on 1 us every time it is read, so a release can fall
+ * between the scan for a ready task and the wait, and the wait stands in
+ * for wfi being woken just before each SysTick by some other interrupt.
+ * Sleeping without looking again would then start every task a whole ms
+ * late. The order tasks run in and the counters are checked too.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "mock_hw.h"
+#include "timebase.h"
+#include "sched.h"
+
+#include "test.h"
+
+static uint64_t g_now_us = 0;
+static uint32_t g_waits = 0;
+static bool g_wait_unmasked = false;
+static jmp_buf g_done;
+
+/// Runs left before sched_run() is left
+static uint32_t g_runs_left = 0;
+
+/// The order the tasks ran in
+static char g_order[64];
+static uint32_t g_order_len = 0;
+
+void timebase_init(void) {
+}
+
+uint64_t timebase_now_us(void) {
+    return g_now_us++;
+}
+
+uint32_t timebase_now_ms(void) {
+    return g_now_us / 1000;
+}
+
+void sched_host_wait(void) {
+    if (!mock_irq_masked) {
+        g_wait_unmasked = true;
+    }
+    g_waits++;
+    // Woken 1 us before the next tick
+    g_now_us += 999 - g_now_us % 1000;
+}
+
+/** 
+ * @brief Count a run and leave sched_run() after the last
+ * @param c the character recorded for the task
+ * 
+ */
+static void ran(char c) {
+    if (g_order_len < sizeof(g_order) - 1) {
+        g_order[g_order_len++] = c;
+    }
+    if (--g_runs_left == 0) {
+        longjmp(g_done, 1);
+    }
+}
+
+static void task_a(void) { ran('a'); }
+static void task_b(void) { ran('b'); }
+static void task_c(void) { ran('c'); }
+
+/** 
+ * @brief Slow enough to make the next release of the 1 ms task late
+ * 
+ */
+static void task_slow(void) {
+    g_now_us += 2500;
+    ran('s');
+}
+
+/** 
+ * @brief Run the scheduler for a number of task runs
+ * @param runs the number of runs
+ * 
+ */
+static void run(uint32_t runs) {
+    g_runs_left = runs;
+    g_order_len = 0;
+    if (setjmp(g_done) == 0) {
+        sched_run();
+    }
+    g_order[g_order_len] = 0;
+}
+
+/** 
+ * @brief A release between the scan and the wait is not slept through
+ * 
+ */
+static void test_no_missed_wakeup(void) {
+    printf("release just after the scan\n");
+    sched_stats_t stats;
+
+    g_now_us = 0;
+    g_waits = 0;
+    sched_init();
+    int id = sched_add_periodic("a", task_a, 1, 0, SCHED_PRIO_HIGHEST);
+    run(1000);
+
+    sched_get_stats(id, &stats);
+    // The last run leaves sched_run() before it is counted
+    CHECK(stats.runs == 999, "%u runs", stats.runs);
+    CHECK(stats.max_latency < 10, "started up to %u us late", stats.max_latency);
+    CHECK(stats.overruns == 0, "%u overruns", stats.overruns);
+    CHECK(g_now_us < 1001000, "1000 runs took %lu us", (unsigned long)g_now_us);
+    CHECK(g_waits >= 999, "only waited %u times", g_waits);
+    CHECK(!g_wait_unmasked, "waited with interrupts enabled");
+    CHECK(!mock_irq_masked, "left interrupts masked");
+}
+
+/** 
+ * @brief Priority first then the earliest deadline
+ * 
+ */
+static void test_order(void) {
+    printf("priority and deadline order\n");
+
+    g_now_us = 0;
+    sched_init();
+    sched_add_periodic("c", task_c, 1, 0, 3);
+    sched_add_periodic("b", task_b, 1, 5, 1);
+    sched_add_periodic("a", task_a, 1, 2, 1);
+    run(6);
+
+    CHECK(strcmp(g_order, "abcabc") == 0, "ran %s", g_order);
+}
+
+/** 
+ * @brief Latency and run time are counted in us and missed releases are
+ * skipped and counted
+ * 
+ */
+static void test_counters(void) {
+    printf("counters in us\n");
+    sched_stats_t fast;
+    sched_stats_t slow;
+
+    g_now_us = 0;
+    sched_init();
+    int fast_id = sched_add_periodic("a", task_a, 1, 0, SCHED_PRIO_HIGHEST);
+    int slow_id = sched_add_periodic("s", task_slow, 10, 0, 2);
+    run(200);
+
+    sched_get_stats(fast_id, &fast);
+    sched_get_stats(slow_id, &slow);
+    CHECK(slow.max_runtime >= 2500 && slow.max_runtime < 2510, "slow run took %u us", slow.max_runtime);
+    CHECK(fast.max_latency >= 1500 && fast.max_latency < 2510, "fast task up to %u us late", fast.max_latency);
+    CHECK(fast.overruns > 0, "missed releases not counted");
+    CHECK(slow.overruns == 0, "%u slow overruns", slow.overruns);
+}
+
+int main(void) {
+    test_no_missed_wakeup();
+    test_order();
+    test_counters();
+    return TEST_EXIT();
+}
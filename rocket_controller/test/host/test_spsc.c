@@ -0,0 +1,293 @@
+/** 
+ * @file test_spsc.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host test of the typed single producer, single consumer queue
+ *
+ * The single thread checks cover push and pop, the overflow count, the high
+ * water mark and spans that wrap the end of the ring. Then a producer and a
+ * consumer thread run against each other, each switching between single,
+ * batch and in-place access at random. Every record carries its sequence
+ * number and a check word over its other fields, so a record read before it
+ * was fully written, read twice, or skipped is seen by the consumer.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "spsc.h"
+
+#include "test.h"
+
+/// From the C library's sched.h, which include/sched.h hides
+int sched_yield(void);
+
+/// Records passed in each stress run
+#define STRESS_RECORDS 1000000
+
+/// A record the size of a telemetry sample
+typedef struct {
+    uint32_t seq;
+    int16_t data[5];
+    uint32_t check;
+} rec_t;
+
+SPSC_DECLARE(small_queue, rec_t, 4)
+SPSC_DECLARE(stress_queue, rec_t, 16)
+
+static stress_queue_t g_queue;
+
+/// Drop records when the queue is full rather than wait for room
+static bool g_drop;
+
+/// Consumer results
+static uint32_t g_received;
+static uint32_t g_bad_check;
+static uint32_t g_bad_order;
+
+/// Producer results
+static uint32_t g_pushed;
+static bool g_producer_done;
+
+/** 
+ * @brief Fill in a record
+ * @param rec the record
+ * @param seq its sequence number
+ * 
+ */
+static void rec_make(rec_t *rec, uint32_t seq) {
+    rec->seq = seq;
+    rec->check = seq * 2654435761u;
+    for (int i = 0; i < 5; i++) {
+        rec->data[i] = (int16_t)(seq * (i + 3));
+        rec->check ^= (uint16_t)rec->data[i] << (i * 3);
+    }
+}
+
+/** 
+ * @brief Check a record is as rec_make() wrote it
+ * @param rec the record
+ * 
+ * @return true if it is
+ */
+static bool rec_ok(const rec_t *rec) {
+    rec_t expect;
+    rec_make(&expect, rec->seq);
+    return memcmp(&expect, rec, sizeof(expect)) == 0;
+}
+
+/** 
+ * @brief A small xorshift generator, one per thread
+ * @param state the generator state
+ * 
+ * @return the next value
+ */
+static uint32_t rnd(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static void *producer(void *arg) {
+    (void)arg;
+    uint32_t state = 0x12345678;
+    uint32_t seq = 0;
+    rec_t batch[8];
+
+    while (seq < STRESS_RECORDS) {
+        uint32_t start = seq;
+        uint32_t how = rnd(&state) % 3;
+        if (how == 0) {
+            rec_t rec;
+            rec_make(&rec, seq);
+            if (stress_queue_push(&g_queue, &rec)) {
+                g_pushed++;
+                seq++;
+            } else if (g_drop) {
+                seq++;
+            }
+        } else if (how == 1) {
+            size_t n = 1 + rnd(&state) % 8;
+            if (n > STRESS_RECORDS - seq) {
+                n = STRESS_RECORDS - seq;
+            }
+            for (size_t i = 0; i < n; i++) {
+                rec_make(&batch[i], seq + i);
+            }
+            size_t done = stress_queue_push_n(&g_queue, batch, n);
+            g_pushed += done;
+            // Without drops the records refused are offered again
+            seq += g_drop ? n : done;
+        } else {
+            rec_t *span;
+            size_t n = stress_queue_write_span(&g_queue, &span);
+            size_t want = 1 + rnd(&state) % 8;
+            n = n < want ? n : want;
+            if (n > STRESS_RECORDS - seq) {
+                n = STRESS_RECORDS - seq;
+            }
+            for (size_t i = 0; i < n; i++) {
+                rec_make(&span[i], seq + i);
+            }
+            stress_queue_commit(&g_queue, n);
+            g_pushed += n;
+            seq += n;
+        }
+        // Give a consumer on the same core the chance to make room
+        if (seq == start) {
+            sched_yield();
+        }
+    }
+    __atomic_store_n(&g_producer_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/** 
+ * @brief Check a record received by the consumer
+ * @param rec the record
+ * @param next the sequence number expected, moved on past it
+ * 
+ */
+static void consume(const rec_t *rec, uint32_t *next) {
+    if (!rec_ok(rec)) {
+        g_bad_check++;
+    }
+    // With drops records may be skipped but never repeated or reordered
+    if (g_drop ? rec->seq < *next : rec->seq != *next) {
+        g_bad_order++;
+    }
+    *next = rec->seq + 1;
+    g_received++;
+}
+
+static void *consumer(void *arg) {
+    (void)arg;
+    uint32_t state = 0x9E3779B9;
+    uint32_t next = 0;
+    rec_t batch[8];
+
+    while (true) {
+        // Read before the queue is found empty, so no record is left behind
+        bool done = __atomic_load_n(&g_producer_done, __ATOMIC_ACQUIRE);
+        uint32_t start = g_received;
+        uint32_t how = rnd(&state) % 3;
+        if (how == 0) {
+            rec_t rec;
+            if (stress_queue_pop(&g_queue, &rec)) {
+                consume(&rec, &next);
+            }
+        } else if (how == 1) {
+            size_t n = stress_queue_pop_n(&g_queue, batch, 1 + rnd(&state) % 8);
+            for (size_t i = 0; i < n; i++) {
+                consume(&batch[i], &next);
+            }
+        } else {
+            const rec_t *span;
+            size_t n = stress_queue_read_span(&g_queue, &span);
+            for (size_t i = 0; i < n; i++) {
+                consume(&span[i], &next);
+            }
+            stress_queue_release(&g_queue, n);
+        }
+
+        if (done && stress_queue_len(&g_queue) == 0) {
+            break;
+        }
+        if (g_received == start) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_single_thread(void) {
+    printf("single thread\n");
+    static small_queue_t q;
+    rec_t rec;
+    small_queue_init(&q);
+
+    CHECK(!small_queue_pop(&q, &rec), "pop from an empty queue");
+    for (uint32_t i = 0; i < 4; i++) {
+        rec_make(&rec, i);
+        CHECK(small_queue_push(&q, &rec), "push %u refused", i);
+    }
+    rec_make(&rec, 4);
+    CHECK(!small_queue_push(&q, &rec), "push to a full queue");
+    CHECK(q.overflows == 1 && q.high_water == 4, "overflows %u, high water %u", q.overflows, q.high_water);
+
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK(small_queue_pop(&q, &rec) && rec.seq == i && rec_ok(&rec), "pop %u gave %u", i, rec.seq);
+    }
+
+    // Head at 4, tail at 3: the free space wraps the end of the ring
+    rec_t *wspan;
+    size_t n = small_queue_write_span(&q, &wspan);
+    CHECK(n == 3 && wspan == &q.entries[0], "write span of %zu", n);
+
+    rec_t batch[5];
+    for (uint32_t i = 0; i < 5; i++) {
+        rec_make(&batch[i], 4 + i);
+    }
+    n = small_queue_push_n(&q, batch, 5);
+    CHECK(n == 3 && q.overflows == 3, "push_n of 5 into 3 gave %zu, overflows %u", n, q.overflows);
+
+    // Queued 3, 4, 5, 6 from entry 3 round to entry 2
+    const rec_t *rspan;
+    n = small_queue_read_span(&q, &rspan);
+    CHECK(n == 1 && rspan->seq == 3, "read span of %zu from %u", n, rspan->seq);
+
+    n = small_queue_pop_n(&q, batch, 5);
+    CHECK(n == 4, "pop_n gave %zu", n);
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(batch[i].seq == 3 + i && rec_ok(&batch[i]), "record %u is %u", i, batch[i].seq);
+    }
+    CHECK(small_queue_len(&q) == 0 && small_queue_space(&q) == 4, "len %zu", small_queue_len(&q));
+}
+
+/** 
+ * @brief Run the producer and consumer against each other
+ * @param drop true to drop records when the queue is full
+ * 
+ */
+static void stress(bool drop) {
+    printf("two threads, %s\n", drop ? "dropping when full" : "waiting when full");
+    pthread_t threads[2];
+
+    stress_queue_init(&g_queue);
+    g_drop = drop;
+    g_pushed = 0;
+    g_received = 0;
+    g_bad_check = 0;
+    g_bad_order = 0;
+    g_producer_done = false;
+
+    pthread_create(&threads[0], NULL, producer, NULL);
+    pthread_create(&threads[1], NULL, consumer, NULL);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    CHECK(g_bad_check == 0, "%u records torn", g_bad_check);
+    CHECK(g_bad_order == 0, "%u records out of order", g_bad_order);
+    CHECK(g_received == g_pushed, "%u received of %u pushed", g_received, g_pushed);
+    CHECK(g_queue.high_water <= 16, "high water %u", g_queue.high_water);
+    if (drop) {
+        CHECK(g_pushed + g_queue.overflows == STRESS_RECORDS, "%u pushed and %u overflows of %u", g_pushed,
+              g_queue.overflows, STRESS_RECORDS);
+    } else {
+        CHECK(g_received == STRESS_RECORDS, "%u of %u received", g_received, STRESS_RECORDS);
+    }
+    printf("  %u records, %u overflows, high water %u\n", g_received, g_queue.overflows, g_queue.high_water);
+}
+
+int main(void) {
+    test_single_thread();
+    stress(false);
+    stress(true);
+    return TEST_EXIT();
+}
@@ -0,0 +1,403 @@
+/** 
+ * @file test_usb_cdc.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-23
+ * @brief Host test of the usb_cdc tx engine against a mocked usbd_ep_write_packet
+ *
+ * Build and run from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host -Itest/host/mock -o test_usb_cdc test/host/test_usb_cdc.c
+ *         src/usb_cdc.c src/perf.c test/host/mock/mock_hw.c && ./test_usb_cdc
+ *
+ * The mock is the USB peripheral and the host: each IN end point holds one
+ * packet, the host collects up to USB_BULK_PER_FRAME packets a frame from
+ * it and each collection runs the end point callback, as the interrupt
+ * would. A start of frame runs the SOF callback.
+ *
+ * The old engine loaded one packet per SOF, 64 bytes a frame. The test
+ * checks the data arrives intact and in order, the zero length packet
+ * rules, that nothing is sent to a closed port and how many packets a frame
+ * the engine now keeps up with.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <libopencm3/usb/usbd.h>
+#include <libopencm3/usb/cdc.h>
+
+#include "usb_cdc.h"
+#include "usb_cdc_desc.h"
+
+#include "test.h"
+
+/// Bulk packets a full speed host can take from one end point in a frame
+#define USB_BULK_PER_FRAME 19
+
+/// Packets recorded per end point
+#define MAX_PACKETS 4096
+
+/// Bytes collected by the host per end point
+#define MAX_STREAM (256 * 1024)
+
+/// An IN end point as the mock sees it
+typedef struct {
+    uint8_t addr;
+    usbd_endpoint_callback callback;
+    bool loaded;
+    uint8_t packet[64];
+    uint16_t len;
+    uint32_t double_loads;          ///< Packets written while one was waiting
+
+    uint16_t lens[MAX_PACKETS];     ///< Length of every packet collected
+    uint32_t packets;
+    uint8_t stream[MAX_STREAM];     ///< Every byte collected
+    uint32_t bytes;
+} mock_ep_t;
+
+static struct {
+    int unused;
+} g_device;
+
+static void (*g_sof_callback)(void);
+static usbd_set_config_callback g_set_config;
+static usbd_control_callback g_control;
+
+/// Run after every packet the host collects, NULL for none
+static void (*g_on_packet)(void);
+
+static mock_ep_t g_eps[2] = {
+    { .addr = SHELL_EP_IN },
+    { .addr = TELEM_EP_IN },
+};
+
+/** 
+ * @brief Find the mock of an IN end point
+ * @param addr the end point address
+ * 
+ * @return the end point or NULL
+ */
+static mock_ep_t *mock_ep(uint8_t addr) {
+    for (int i = 0; i < 2; i++) {
+        if (g_eps[i].addr == addr) {
+            return &g_eps[i];
+        }
+    }
+    return NULL;
+}
+
+usbd_device *usbd_init(const usbd_driver *driver, const struct usb_device_descriptor *dev,
+                       const struct usb_config_descriptor *conf, const char * const *strings, int num_strings,
+                       uint8_t *control_buffer, uint16_t control_buffer_size) {
+    (void)driver; (void)dev; (void)conf; (void)strings; (void)num_strings;
+    (void)control_buffer; (void)control_buffer_size;
+    return (usbd_device *)&g_device;
+}
+
+int usbd_register_set_config_callback(usbd_device *usbd_dev, usbd_set_config_callback callback) {
+    (void)usbd_dev;
+    g_set_config = callback;
+    return 0;
+}
+
+void usbd_register_sof_callback(usbd_device *usbd_dev, void (*callback)(void)) {
+    (void)usbd_dev;
+    g_sof_callback = callback;
+}
+
+int usbd_register_control_callback(usbd_device *usbd_dev, uint8_t type, uint8_t type_mask,
+                                   usbd_control_callback callback) {
+    (void)usbd_dev; (void)type; (void)type_mask;
+    g_control = callback;
+    return 0;
+}
+
+void usbd_ep_setup(usbd_device *usbd_dev, uint8_t addr, uint8_t type, uint16_t max_size,
+                   usbd_endpoint_callback callback) {
+    (void)usbd_dev; (void)type; (void)max_size;
+    mock_ep_t *ep = mock_ep(addr);
+    if (ep != NULL) {
+        ep->callback = callback;
+    }
+}
+
+uint16_t usbd_ep_write_packet(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len) {
+    (void)usbd_dev;
+    mock_ep_t *ep = mock_ep(addr);
+    if (ep == NULL) {
+        return 0;
+    }
+
+    // The hardware refuses a packet while the last one is still waiting
+    if (ep->loaded) {
+        ep->double_loads++;
+        return 0;
+    }
+    memcpy(ep->packet, buf, len);
+    ep->len = len;
+    ep->loaded = true;
+    return len;
+}
+
+/** 
+ * @brief Run one USB frame: the SOF then the host collecting packets
+ * 
+ * @return the number of packets collected
+ */
+static uint32_t mock_frame(void) {
+    uint32_t collected = 0;
+
+    g_sof_callback();
+    for (int i = 0; i < 2; i++) {
+        mock_ep_t *ep = &g_eps[i];
+        for (int n = 0; n < USB_BULK_PER_FRAME && ep->loaded; n++) {
+            if (ep->packets < MAX_PACKETS) {
+                ep->lens[ep->packets] = ep->len;
+            }
+            ep->packets++;
+            if (ep->bytes + ep->len <= MAX_STREAM) {
+                memcpy(&ep->stream[ep->bytes], ep->packet, ep->len);
+            }
+            ep->bytes += ep->len;
+            ep->loaded = false;
+            collected++;
+
+            // The transfer complete interrupt
+            ep->callback((usbd_device *)&g_device, ep->addr);
+            if (g_on_packet != NULL) {
+                g_on_packet();
+            }
+        }
+    }
+    return collected;
+}
+
+/** 
+ * @brief Open or close a port as the host would
+ * @param iface the communication interface of the port
+ * @param open true to open
+ * 
+ */
+static void mock_open(uint16_t iface, bool open) {
+    struct usb_setup_data req = {
+        .bmRequestType = USB_REQ_TYPE_CLASS | USB_REQ_TYPE_INTERFACE,
+        .bRequest = USB_CDC_REQ_SET_CONTROL_LINE_STATE,
+        .wValue = open ? 3 : 0,
+        .wIndex = iface,
+    };
+    uint8_t *buf = NULL;
+    uint16_t len = 0;
+    g_control((usbd_device *)&g_device, &req, &buf, &len, NULL);
+}
+
+/** 
+ * @brief Forget the packets collected so far
+ * 
+ */
+static void mock_clear(void) {
+    for (int i = 0; i < 2; i++) {
+        g_eps[i].packets = 0;
+        g_eps[i].bytes = 0;
+        g_eps[i].double_loads = 0;
+    }
+}
+
+/** 
+ * @brief Run frames until the tx engine goes quiet
+ * 
+ */
+static void mock_drain(void) {
+    for (int i = 0; i < 16; i++) {
+        mock_frame();
+    }
+}
+
+/** 
+ * @brief Check the zero length packet rules for a write of a given size
+ * @param len the number of bytes to write
+ * 
+ */
+static void test_zlp(size_t len) {
+    uint8_t data[256];
+    mock_ep_t *ep = mock_ep(SHELL_EP_IN);
+
+    for (size_t i = 0; i < len; i++) {
+        data[i] = (uint8_t)i;
+    }
+    mock_clear();
+    usb_cdc_write(data, len);
+    mock_drain();
+
+    uint32_t full = len / 64;
+    uint32_t want = full + 1;   // The last packet is short or a ZLP
+    CHECK(ep->packets == want, "%zu bytes: %u packets, want %u", len, ep->packets, want);
+    for (uint32_t i = 0; i < full && i < ep->packets; i++) {
+        CHECK(ep->lens[i] == 64, "%zu bytes: packet %u is %u bytes", len, i, ep->lens[i]);
+    }
+    if (ep->packets == want) {
+        CHECK(ep->lens[want - 1] == len % 64, "%zu bytes: last packet %u bytes, want %zu",
+              len, ep->lens[want - 1], len % 64);
+    }
+    CHECK(ep->bytes == len && memcmp(ep->stream, data, len) == 0, "%zu bytes: data differs", len);
+}
+
+static uint8_t g_stream_data[MAX_STREAM];
+static size_t g_stream_written;
+
+/** 
+ * @brief Top up the tx ring with the rest of the stream
+ * 
+ */
+static void stream_refill(void) {
+    g_stream_written += usb_cdc_write(&g_stream_data[g_stream_written], sizeof(g_stream_data) - g_stream_written);
+}
+
+/** 
+ * @brief Stream a large block through the ring and measure the rate
+ * @param each_packet top up the ring after every packet rather than once a frame
+ * 
+ */
+static void test_throughput(bool each_packet) {
+    mock_ep_t *ep = mock_ep(SHELL_EP_IN);
+    usb_cdc_stats_t before, after;
+
+    for (size_t i = 0; i < sizeof(g_stream_data); i++) {
+        g_stream_data[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    mock_clear();
+    usb_cdc_get_stats(&before);
+    g_stream_written = 0;
+    g_on_packet = each_packet ? stream_refill : NULL;
+
+    uint32_t frames = 0;
+    uint32_t max_per_frame = 0;
+    while (ep->bytes < sizeof(g_stream_data) && frames < 100000) {
+        stream_refill();
+        uint32_t n = mock_frame();
+        if (n > max_per_frame) {
+            max_per_frame = n;
+        }
+        frames++;
+    }
+    g_on_packet = NULL;
+    mock_drain();
+    usb_cdc_get_stats(&after);
+
+    CHECK(ep->bytes == sizeof(g_stream_data), "collected %u of %zu bytes", ep->bytes, sizeof(g_stream_data));
+    CHECK(memcmp(ep->stream, g_stream_data, sizeof(g_stream_data)) == 0, "streamed data differs");
+    CHECK(ep->double_loads == 0, "%u packets written over a waiting one", ep->double_loads);
+    CHECK(after.tx_bytes - before.tx_bytes == sizeof(g_stream_data), "tx_bytes %u",
+          after.tx_bytes - before.tx_bytes);
+
+    double per_frame = (double)sizeof(g_stream_data) / frames;
+    printf("  %s: %.0f bytes/frame (%.0f KB/s), %u packets/frame at most\n",
+           each_packet ? "topped up every packet" : "topped up once a frame",
+           per_frame, per_frame * 1000 / 1024, max_per_frame);
+    if (each_packet) {
+        CHECK(max_per_frame == USB_BULK_PER_FRAME, "%u packets/frame", max_per_frame);
+    } else {
+        // The 1 KB ring, not the engine, limits a once a frame producer
+        CHECK(per_frame > 15 * 64, "%.0f bytes/frame", per_frame);
+    }
+}
+
+/** 
+ * @brief Check the engine keeps the end point busy from the completion
+ * callback while the ring has data, not just at each SOF
+ * 
+ */
+static void test_back_to_back(void) {
+    uint8_t data[1024];
+
+    memset(data, 0x5a, sizeof(data));
+    mock_clear();
+    size_t n = usb_cdc_write(data, sizeof(data));
+    CHECK(n == sizeof(data), "ring took %zu bytes", n);
+
+    // 16 full packets then the ZLP, all in one frame
+    uint32_t first = mock_frame();
+    CHECK(first == n / 64 + 1, "%u packets in the first frame", first);
+    mock_drain();
+}
+
+/** 
+ * @brief Check nothing is sent while the port is closed and writes are
+ * sent once it is opened
+ * 
+ */
+static void test_closed_port(void) {
+    mock_ep_t *ep = mock_ep(SHELL_EP_IN);
+
+    mock_open(SHELL_COMM_IFACE, false);
+    mock_drain();
+    mock_clear();
+    usb_cdc_write("hello", 5);
+    mock_drain();
+    CHECK(ep->packets == 0, "%u packets sent to a closed port", ep->packets);
+
+    mock_open(SHELL_COMM_IFACE, true);
+    mock_drain();
+    CHECK(ep->bytes == 5 && memcmp(ep->stream, "hello", 5) == 0, "%u bytes after opening", ep->bytes);
+}
+
+/** 
+ * @brief Check the telemetry port runs alongside the shell
+ * 
+ */
+static void test_two_ports(void) {
+    static uint8_t shell[4000];
+    static uint8_t telem[4000];
+    mock_ep_t *shell_ep = mock_ep(SHELL_EP_IN);
+    mock_ep_t *telem_ep = mock_ep(TELEM_EP_IN);
+
+    for (size_t i = 0; i < sizeof(shell); i++) {
+        shell[i] = (uint8_t)i;
+        telem[i] = (uint8_t)~i;
+    }
+    mock_open(TELEM_COMM_IFACE, true);
+    mock_clear();
+
+    size_t shell_done = 0, telem_done = 0;
+    for (int f = 0; f < 1000 && (shell_done < sizeof(shell) || telem_done < sizeof(telem)); f++) {
+        shell_done += usb_cdc_port_write(USB_CDC_PORT_SHELL, &shell[shell_done], sizeof(shell) - shell_done);
+        telem_done += usb_cdc_port_write(USB_CDC_PORT_TELEM, &telem[telem_done], sizeof(telem) - telem_done);
+        mock_frame();
+    }
+    mock_drain();
+
+    CHECK(shell_ep->bytes == sizeof(shell) && memcmp(shell_ep->stream, shell, sizeof(shell)) == 0,
+          "shell got %u bytes", shell_ep->bytes);
+    CHECK(telem_ep->bytes == sizeof(telem) && memcmp(telem_ep->stream, telem, sizeof(telem)) == 0,
+          "telemetry got %u bytes", telem_ep->bytes);
+}
+
+int main(void) {
+    usb_cdc_init();
+    g_set_config((usbd_device *)&g_device, 1);
+    mock_open(SHELL_COMM_IFACE, true);
+
+    printf("zero length packets\n");
+    test_zlp(1);
+    test_zlp(63);
+    test_zlp(64);
+    test_zlp(100);
+    test_zlp(128);
+    test_zlp(200);
+
+    printf("back to back packets\n");
+    test_back_to_back();
+
+    printf("closed port\n");
+    test_closed_port();
+
+    printf("throughput, the one packet per SOF engine managed 64 bytes/frame (62 KB/s)\n");
+    test_throughput(false);
+    test_throughput(true);
+
+    printf("two ports\n");
+    test_two_ports();
+
+    return TEST_EXIT();
+}
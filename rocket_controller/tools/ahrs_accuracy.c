@@ -0,0 +1,476 @@
+/** 
+ * @file ahrs_accuracy.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host tool that checks the fixed point attitude filter against a double precision reference
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o ahrs_accuracy tools/ahrs_accuracy.c src/ahrs.c -lm
+ *
+ * Usage:
+ *     ahrs_accuracy [-s period_shift]
+ *
+ * Flights are simulated from a known attitude and the gyro, accelerometer
+ * and magnetometer counts it gives, with noise and a gyro bias. The counts
+ * go to src/ahrs.c and to the same Mahony filter written in doubles with the
+ * same gains and accelerometer gating. Each phase is switched as
+ * phase.c switches it, and each phase prints the following:
+ *   - the largest and RMS angle between the fixed point and double
+ *     attitudes, the error the fixed point arithmetic adds
+ *   - the largest and final tilt error of the fixed point filter against
+ *     the true attitude
+ *   - the RMS and largest error of ahrs_vertical_accel() in m/s^2, the
+ *     input of the altitude filter
+ *
+ * The flight has a 20 s pad on a 5 degree rail, a 3 s boost at 8 g rolling
+ * at 2 rev/s, and a 15 s coast with the accelerometer reading drag alone,
+ * close to 1 g for the first 2 s, while the rocket turns over. It is run
+ * once with the phase gating and once with the accelerometer left on
+ * through boost and coast, when only the 1 g magnitude check keeps drag
+ * out of the attitude. Last comes a parachute descent swinging 15 degrees
+ * on its riser. The filter runs every 2^period_shift IMU samples (default
+ * 2, as at 1666 Hz with the estimator tap).
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "fixed.h"
+#include "lsm6ds3.h"
+#include "ahrs.h"
+
+#define PI 3.14159265358979
+#define G 9.80665
+#define DEG (PI / 180.0)
+
+/// Sensor scales, as the drivers set them
+#define GYRO_DPS_PER_COUNT 0.070
+#define ACCEL_G_PER_COUNT LSM6DS3_ACCEL_G_PER_COUNT
+#define MAG_GAUSS_PER_COUNT 0.0015
+
+/// Sensor noise (1 sigma) and gyro bias
+#define GYRO_NOISE_DPS 0.1
+#define GYRO_BIAS_DPS 0.3
+#define ACCEL_NOISE_G 0.002
+#define MAG_NOISE_GAUSS 0.003
+
+/// Magnetometer samples are given every this many filter updates, 100 Hz
+#define MAG_EVERY 4
+
+/// Earth field, north and up, Gauss
+static const double g_field[3] = { 0.22, 0, -0.42 };
+
+/// What the simulated rocket is doing at one instant
+typedef struct {
+    double rate[3];         ///< Body rates, rad/s
+    double force[3];        ///< Specific force in the body frame, m/s^2
+    bool gravity_only;      ///< force is gravity alone, it is set from the attitude
+} motion_t;
+
+/// A phase of a simulated flight
+typedef struct {
+    const char *name;
+    double seconds;
+    bool accel_enabled;     ///< ahrs_set_accel_enabled() for the phase
+    void (*motion)(double t, const double q[4], motion_t *m);
+} phase_t;
+
+/// Error totals of one phase
+typedef struct {
+    uint32_t samples;
+    double ref_max_deg;
+    double ref_sq;
+    double tilt_max_deg;
+    double tilt_deg;
+    double vert_max;
+    double vert_sq;
+} errors_t;
+
+/// The double precision reference filter
+static double g_ref_q[4];
+static double g_ref_integral[3];
+static bool g_ref_accel_enabled;
+
+/// The simulated rocket
+static double g_true_q[4];
+
+static uint32_t g_rand = 0x2545F491;
+
+/** 
+ * @brief Draw from a normal distribution
+ * 
+ * @return the value, mean 0 and sigma 1
+ */
+static double gauss(void) {
+    double u[2];
+    for (int i = 0; i < 2; i++) {
+        g_rand ^= g_rand << 13;
+        g_rand ^= g_rand >> 17;
+        g_rand ^= g_rand << 5;
+        u[i] = (g_rand + 1.0) / 4294967297.0;
+    }
+    return sqrt(-2 * log(u[0])) * cos(2 * PI * u[1]);
+}
+
+/** 
+ * @brief Rotate a body vector into the earth frame
+ * @param q the attitude, body to earth
+ * @param v the body vector
+ * @param out the earth vector
+ * 
+ */
+static void to_earth(const double q[4], const double v[3], double out[3]) {
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+    out[0] = (1 - 2 * (y * y + z * z)) * v[0] + 2 * (x * y - w * z) * v[1] + 2 * (x * z + w * y) * v[2];
+    out[1] = 2 * (x * y + w * z) * v[0] + (1 - 2 * (x * x + z * z)) * v[1] + 2 * (y * z - w * x) * v[2];
+    out[2] = 2 * (x * z - w * y) * v[0] + 2 * (y * z + w * x) * v[1] + (1 - 2 * (x * x + y * y)) * v[2];
+}
+
+/** 
+ * @brief Rotate an earth vector into the body frame
+ * @param q the attitude, body to earth
+ * @param v the earth vector
+ * @param out the body vector
+ * 
+ */
+static void to_body(const double q[4], const double v[3], double out[3]) {
+    double c[4] = { q[0], -q[1], -q[2], -q[3] };
+    to_earth(c, v, out);
+}
+
+/** 
+ * @brief Turn a quaternion by a body rotation vector, exactly
+ * @param q the attitude, normalised after
+ * @param r the rotation vector, rad
+ * 
+ */
+static void quat_turn(double q[4], const double r[3]) {
+    double angle = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+    double d[4] = { 1, 0, 0, 0 };
+    if (angle > 0) {
+        double s = sin(angle / 2) / angle;
+        d[0] = cos(angle / 2);
+        d[1] = r[0] * s;
+        d[2] = r[1] * s;
+        d[3] = r[2] * s;
+    }
+    double n[4];
+    n[0] = q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3];
+    n[1] = q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2];
+    n[2] = q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1];
+    n[3] = q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0];
+    double norm = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2] + n[3] * n[3]);
+    for (int i = 0; i < 4; i++) {
+        q[i] = n[i] / norm;
+    }
+}
+
+/** 
+ * @brief Find the angle between two attitudes
+ * @param a the first
+ * @param b the second
+ * 
+ * @return the angle in degrees
+ */
+static double quat_angle_deg(const double a[4], const double b[4]) {
+    double dot = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    return 2 * acos(dot > 1 ? 1 : dot) / DEG;
+}
+
+/** 
+ * @brief Find the angle between the vertical of two attitudes
+ * @param a the first
+ * @param b the second
+ * 
+ * @return the angle in degrees
+ */
+static double tilt_error_deg(const double a[4], const double b[4]) {
+    static const double up[3] = { 0, 0, 1 };
+    double ua[3], ub[3];
+    to_body(a, up, ua);
+    to_body(b, up, ub);
+    double dot = ua[0] * ub[0] + ua[1] * ub[1] + ua[2] * ub[2];
+    return acos(dot > 1 ? 1 : (dot < -1 ? -1 : dot)) / DEG;
+}
+
+/** 
+ * @brief Cross product a x b added to err
+ * @param a the first vector
+ * @param b the second vector
+ * @param err the sum
+ * 
+ */
+static void add_cross(const double a[3], const double b[3], double err[3]) {
+    err[0] += a[1] * b[2] - a[2] * b[1];
+    err[1] += a[2] * b[0] - a[0] * b[2];
+    err[2] += a[0] * b[1] - a[1] * b[0];
+}
+
+/** 
+ * @brief Normalise a vector
+ * @param v the vector
+ * @param out the unit vector
+ * 
+ * @return false if it has no length
+ */
+static bool normalise(const double v[3], double out[3]) {
+    double len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (len == 0) {
+        return false;
+    }
+    for (int i = 0; i < 3; i++) {
+        out[i] = v[i] / len;
+    }
+    return true;
+}
+
+/** 
+ * @brief The Mahony update of src/ahrs.c in double precision
+ * @param gyro the raw gyro counts
+ * @param accel the raw accelerometer counts
+ * @param mag the raw magnetometer counts, NULL if there is no new sample
+ * @param dt the sample period, s
+ * 
+ */
+static void ref_update(const int16_t gyro[3], const int16_t accel[3], const int16_t mag[3], double dt) {
+    double err[3] = { 0, 0, 0 };
+    double v[3], unit[3];
+    static const double up[3] = { 0, 0, 1 };
+
+    for (int i = 0; i < 3; i++) {
+        v[i] = accel[i];
+    }
+    double g_len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) * ACCEL_G_PER_COUNT;
+    if (g_ref_accel_enabled && fabs(g_len - 1) <= AHRS_ACCEL_GATE_G && normalise(v, unit)) {
+        double g[3];
+        to_body(g_ref_q, up, g);
+        add_cross(unit, g, err);
+    }
+
+    if (mag != NULL) {
+        for (int i = 0; i < 3; i++) {
+            v[i] = mag[i];
+        }
+        if (normalise(v, unit)) {
+            // Reference field: the measured field's horizontal and vertical parts
+            double h[3], ref[3], w[3];
+            to_earth(g_ref_q, unit, h);
+            ref[0] = sqrt(h[0] * h[0] + h[1] * h[1]);
+            ref[1] = 0;
+            ref[2] = h[2];
+            to_body(g_ref_q, ref, w);
+            add_cross(unit, w, err);
+        }
+    }
+
+    double r[3];
+    for (int i = 0; i < 3; i++) {
+        g_ref_integral[i] += AHRS_KI * err[i] * dt;
+        if (g_ref_integral[i] > 0.2) {
+            g_ref_integral[i] = 0.2;
+        } else if (g_ref_integral[i] < -0.2) {
+            g_ref_integral[i] = -0.2;
+        }
+        double rate = gyro[i] * GYRO_DPS_PER_COUNT * DEG + AHRS_KP * err[i] + g_ref_integral[i];
+        r[i] = rate * dt;
+    }
+    quat_turn(g_ref_q, r);
+}
+
+/** 
+ * @brief Turn a value into sensor counts
+ * @param value the value in sensor units
+ * @param per_count the units per count
+ * 
+ * @return the counts, saturated
+ */
+static int16_t counts(double value, double per_count) {
+    double c = round(value / per_count);
+    return c > 32767 ? 32767 : (c < -32768 ? -32768 : (int16_t)c);
+}
+
+static void pad_motion(double t, const double q[4], motion_t *m) {
+    (void)t;
+    (void)q;
+    memset(m, 0, sizeof(*m));
+    m->gravity_only = true;
+}
+
+static void boost_motion(double t, const double q[4], motion_t *m) {
+    (void)q;
+    memset(m, 0, sizeof(*m));
+    // 2 rev/s of roll and a small coning wobble
+    m->rate[0] = 3 * DEG * sin(2 * PI * 1.5 * t);
+    m->rate[1] = 3 * DEG * cos(2 * PI * 1.5 * t);
+    m->rate[2] = 2 * 2 * PI;
+    m->force[2] = 8 * G;
+    m->force[0] = 0.3 * G * sin(2 * PI * 4 * t);
+}
+
+static void coast_motion(double t, const double q[4], motion_t *m) {
+    (void)q;
+    memset(m, 0, sizeof(*m));
+    // Drag alone, falling from 1.2 g with the speed and near 1 g for the
+    // first 2 s, with a little side force from coning. The rocket turns over
+    // at 2 deg/s and the roll winds down.
+    double drag = 1.2 * G / ((1 + 0.1 * t) * (1 + 0.1 * t));
+    m->force[2] = -drag;
+    m->force[0] = 0.05 * G * sin(2 * PI * t);
+    m->rate[0] = 2 * DEG;
+    m->rate[2] = 2 * PI * exp(-t / 4);
+}
+
+static void descent_motion(double t, const double q[4], motion_t *m) {
+    (void)q;
+    memset(m, 0, sizeof(*m));
+    // A 15 degree pendulum swing under the parachute at 0.5 Hz. The riser
+    // tension is all the accelerometer feels, so it reads along the body
+    // axis: gravity's share of the riser plus the swing's centripetal part.
+    double w = 2 * PI * 0.5;
+    double amp = 15 * DEG;
+    double arm = G / (w * w);
+    double angle = amp * sin(w * t);
+    double angle_rate = amp * w * cos(w * t);
+    m->rate[0] = angle_rate;
+    m->force[2] = G * cos(angle) + arm * angle_rate * angle_rate;
+}
+
+/** 
+ * @brief Run phases one after the other and print the errors of each
+ * @param title the flight name
+ * @param phases the phases
+ * @param count the number of phases
+ * @param tilt_deg the starting tilt of the rocket, the filter starts level
+ * @param gated false to leave the accelerometer on in every phase
+ * @param shift the period shift
+ * 
+ */
+static void run_flight(const char *title, const phase_t *phases, size_t count, double tilt_deg, bool gated,
+                       uint8_t shift) {
+    double dt = LSM6DS3_PERIOD_US * 1e-6 * (1 << shift);
+    double gyro_bias[3] = { GYRO_BIAS_DPS, -GYRO_BIAS_DPS, GYRO_BIAS_DPS / 2 };
+    uint32_t step = 0;
+
+    printf("%s%s\n", title, gated ? "" : ", accelerometer never gated");
+    printf("  %-8s %14s %14s %11s %14s\n", "phase", "vs double deg", "tilt max deg", "final deg",
+           "vert m/s^2");
+
+    ahrs_init();
+    ahrs_set_period_shift(shift);
+    memset(g_ref_integral, 0, sizeof(g_ref_integral));
+    g_ref_q[0] = 1;
+    g_ref_q[1] = g_ref_q[2] = g_ref_q[3] = 0;
+    g_true_q[0] = cos(tilt_deg / 2 * DEG);
+    g_true_q[1] = sin(tilt_deg / 2 * DEG);
+    g_true_q[2] = g_true_q[3] = 0;
+
+    for (size_t p = 0; p < count; p++) {
+        const phase_t *phase = &phases[p];
+        errors_t e;
+        memset(&e, 0, sizeof(e));
+        bool accel = phase->accel_enabled || !gated;
+        ahrs_set_accel_enabled(accel);
+        g_ref_accel_enabled = accel;
+
+        for (double t = 0; t < phase->seconds; t += dt, step++) {
+            motion_t m;
+            phase->motion(t, g_true_q, &m);
+            if (m.gravity_only) {
+                static const double up[3] = { 0, 0, 1 };
+                to_body(g_true_q, up, m.force);
+                for (int i = 0; i < 3; i++) {
+                    m.force[i] *= G;
+                }
+            }
+
+            // Sample at the middle of the turn, as the filter integrates it
+            double r[3];
+            for (int i = 0; i < 3; i++) {
+                r[i] = m.rate[i] * dt;
+            }
+            quat_turn(g_true_q, r);
+
+            int16_t gyro[3], accel_c[3], mag[3];
+            double field[3];
+            to_body(g_true_q, g_field, field);
+            for (int i = 0; i < 3; i++) {
+                gyro[i] = counts(m.rate[i] / DEG + gyro_bias[i] + GYRO_NOISE_DPS * gauss(), GYRO_DPS_PER_COUNT);
+                accel_c[i] = counts(m.force[i] / G + ACCEL_NOISE_G * gauss(), ACCEL_G_PER_COUNT);
+                mag[i] = counts(field[i] + MAG_NOISE_GAUSS * gauss(), MAG_GAUSS_PER_COUNT);
+            }
+            const int16_t *mag_in = step % MAG_EVERY == 0 ? mag : NULL;
+
+            ahrs_update(gyro, accel_c, mag_in);
+            ref_update(gyro, accel_c, mag_in, dt);
+
+            q30_t fq[4];
+            double q[4];
+            ahrs_get_quat(fq);
+            for (int i = 0; i < 4; i++) {
+                q[i] = fq[i] / (double)Q30_ONE;
+            }
+
+            double ref_err = quat_angle_deg(q, g_ref_q);
+            e.ref_max_deg = fmax(e.ref_max_deg, ref_err);
+            e.ref_sq += ref_err * ref_err;
+            e.tilt_deg = tilt_error_deg(q, g_true_q);
+            e.tilt_max_deg = fmax(e.tilt_max_deg, e.tilt_deg);
+
+            // Upwards acceleration with gravity removed, against the truth
+            double f_earth[3];
+            to_earth(g_true_q, m.force, f_earth);
+            double vert = ahrs_vertical_accel(accel_c) * ACCEL_G_PER_COUNT * G - G;
+            double vert_err = vert - (f_earth[2] - G);
+            e.vert_max = fmax(e.vert_max, fabs(vert_err));
+            e.vert_sq += vert_err * vert_err;
+            e.samples++;
+        }
+
+        printf("  %-8s %6.3f %6.3f %14.2f %11.2f %6.3f %6.2f\n", phase->name, e.ref_max_deg,
+               sqrt(e.ref_sq / e.samples), e.tilt_max_deg, e.tilt_deg, sqrt(e.vert_sq / e.samples),
+               e.vert_max);
+    }
+}
+
+int main(int argc, char **argv) {
+    static const phase_t flight[] = {
+        { "pad", 20, true, pad_motion },
+        { "boost", 3, false, boost_motion },
+        { "coast", 15, false, coast_motion },
+    };
+    static const phase_t descent[] = {
+        { "descent", 30, true, descent_motion },
+    };
+    uint8_t shift = 2;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+        case 's':
+            shift = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s period_shift]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (shift > AHRS_MAX_PERIOD_SHIFT) {
+        fprintf(stderr, "period_shift must be at most %u\n", AHRS_MAX_PERIOD_SHIFT);
+        return 2;
+    }
+
+    printf("filter at %.1f Hz, columns: fixed point against double max/RMS, tilt against truth, "
+           "vertical accel error RMS/max\n", 1e6 / (LSM6DS3_PERIOD_US << shift));
+    // On a launch rail 5 degrees off vertical
+    run_flight("flight", flight, sizeof(flight) / sizeof(flight[0]), 5, true, shift);
+    run_flight("flight", flight, sizeof(flight) / sizeof(flight[0]), 5, false, shift);
+    run_flight("parachute", descent, 1, 0, true, shift);
+
+    return 0;
+}
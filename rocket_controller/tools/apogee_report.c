@@ -0,0 +1,608 @@
+/** 
+ * @file apogee_report.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host tool that reports the apogee detection delay on simulated and replayed flights
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o apogee_report tools/apogee_report.c src/altitude.c src/ahrs.c
+ *         src/phase.c src/frame.c src/logpack.c -lm
+ *
+ * Usage:
+ *     apogee_report
+ *     apogee_report capture.bin ...
+ *
+ * The samples go through the same chain as in acq.c: raw IMU counts into
+ * the attitude filter, ahrs_vertical_accel() into alt_predict(), pressures
+ * into alt_update_baro(), and phase_update() after each IMU sample. The
+ * phase's rates and accelerometer gating are taken from phase.c through a
+ * stand-in acq_configure().
+ *
+ * Without files, flights are simulated with drag and a gravity turn from
+ * the launch rail, and with sensor noise, gyro bias and roll. The delay is
+ * from the true apogee, when the climb rate crosses zero, to detection.
+ * The height lost is how far the rocket has fallen from the true peak by
+ * then. The tilt is the attitude filter's error at apogee, and the velocity
+ * errors are the altitude filter's at apogee and the largest in the coast,
+ * which the detector works from. The drag only
+ * scenario has drag close to 1 g for much of the coast. It runs a second
+ * time with the accelerometer correcting the attitude in every phase, the
+ * filter before it was gated, to show what drag does to the attitude and
+ * so to apogee.
+ *
+ * A telemetry capture or flight log dump is replayed at its logged rates,
+ * and its true apogee is taken as the peak of the barometer altitude
+ * averaged over APOGEE_SMOOTH_S. The magnetometer is left out, it only
+ * steers the heading.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "frame.h"
+#include "logpack.h"
+#include "telem.h"
+#include "slog.h"
+#include "history.h"
+#include "acq.h"
+#include "ahrs.h"
+#include "altitude.h"
+#include "phase.h"
+
+#define PI 3.14159265358979
+#define G 9.80665
+#define DEG (PI / 180.0)
+
+/// Sensor scales and noise (1 sigma)
+#define GYRO_DPS_PER_COUNT 0.070
+#define GYRO_NOISE_DPS 0.1
+#define GYRO_BIAS_DPS 0.3
+#define ACCEL_NOISE_G 0.003
+#define PRESSURE_NOISE_PA 1.0
+
+/// Decimation to the estimator tap, as filt_imu_chain_init()
+#define EST_FACTOR_SHIFT 1
+
+/// Seconds on the pad before launch, enough for the ground altitude
+#define PAD_S 10.0
+
+/// Seconds simulated after the true apogee
+#define AFTER_APOGEE_S 5.0
+
+/// Rail length, the rocket does not turn before leaving it, m
+#define RAIL_M 3.0
+
+/// Below this speed the rocket no longer follows its flight path, m/s
+#define TURN_MIN_V 10.0
+
+/// Width of the average the true apogee of a replay is found with, s
+#define APOGEE_SMOOTH_S 0.5
+
+/// Most records held from a capture
+#define MAX_RECORDS 2000000
+
+/// A simulated flight
+typedef struct {
+    const char *name;
+    double rail_deg;        ///< Launch rail off vertical
+    double thrust_g;        ///< Thrust over the weight at launch
+    double burn_s;
+    double drag_per_v2;     ///< Drag deceleration over the speed squared, 1/m
+    double roll_dps;        ///< Roll rate during the burn, wound down after
+} flight_t;
+
+/// Results of one run
+typedef struct {
+    double apogee_s;        ///< True apogee, from launch
+    double apogee_m;        ///< True apogee height
+    double detect_s;        ///< Detection time, from launch, < 0 if never
+    double detect_m;        ///< True height at detection
+    double est_peak_m;      ///< Highest height estimate
+    double tilt_deg;        ///< Attitude filter tilt error at apogee
+    double velocity_err;    ///< Velocity estimate at apogee, m/s
+    double velocity_err_max; ///< Largest velocity error in the coast, m/s
+    double launch_s;        ///< Phase changes from launch, < 0 if never
+    double burnout_s;
+} result_t;
+
+/// A record of a capture
+typedef struct {
+    uint8_t type;
+    union {
+        telem_imu_t imu;
+        telem_baro_t baro;
+    } rec;
+} replay_rec_t;
+
+/// Rates of the current phase, set through acq_configure()
+static uint32_t g_est_period_us;
+static uint32_t g_baro_period_us;
+
+/// Leave the accelerometer correction on in every phase
+static bool g_never_gate = false;
+
+static replay_rec_t *g_recs;
+static size_t g_count = 0;
+
+static uint32_t g_rand = 0x9E3779B9;
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+void history_arm(void) {
+}
+
+void history_trigger(void) {
+}
+
+void history_stop(void) {
+}
+
+void acq_configure(const acq_config_t *config) {
+    uint8_t shift = LSM6DS3_ODR_1666HZ - config->imu_odr + EST_FACTOR_SHIFT;
+
+    ahrs_set_period_shift(shift);
+    ahrs_set_accel_enabled(config->ahrs_accel || g_never_gate);
+    g_est_period_us = LSM6DS3_PERIOD_US << shift;
+
+    switch (config->baro_odr) {
+    case BMP588_ODR_25HZ:
+        g_baro_period_us = 40000;
+        break;
+    case BMP588_ODR_10HZ:
+        g_baro_period_us = 100000;
+        break;
+    case BMP588_ODR_5HZ:
+        g_baro_period_us = 200000;
+        break;
+    default:
+        g_baro_period_us = 20000;
+        break;
+    }
+}
+
+/** 
+ * @brief Draw from a normal distribution
+ * 
+ * @return the value, mean 0 and sigma 1
+ */
+static double gauss(void) {
+    double u[2];
+    for (int i = 0; i < 2; i++) {
+        g_rand ^= g_rand << 13;
+        g_rand ^= g_rand >> 17;
+        g_rand ^= g_rand << 5;
+        u[i] = (g_rand + 1.0) / 4294967297.0;
+    }
+    return sqrt(-2 * log(u[0])) * cos(2 * PI * u[1]);
+}
+
+/** 
+ * @brief Turn a value into sensor counts
+ * @param value the value in sensor units
+ * @param per_count the units per count
+ * 
+ * @return the counts, saturated
+ */
+static int16_t counts(double value, double per_count) {
+    double c = round(value / per_count);
+    return c > 32767 ? 32767 : (c < -32768 ? -32768 : (int16_t)c);
+}
+
+/** 
+ * @brief Standard atmosphere pressure
+ * @param height the altitude, m
+ * 
+ * @return the pressure in Pa / 64, as the BMP588 gives it
+ */
+static uint32_t pressure_at(double height) {
+    double pa = 101325 * pow(1 - 2.25577e-5 * height, 5.25588);
+    return (uint32_t)lround((pa + PRESSURE_NOISE_PA * gauss()) * 64);
+}
+
+/** 
+ * @brief Reset the filters and the phase, as acq_init() does
+ * 
+ */
+static void chain_init(void) {
+    ahrs_init();
+    alt_init();
+    phase_init();
+}
+
+/** 
+ * @brief Run one estimator sample through the chain, as acq_estimate() does
+ * @param gyro the gyro counts
+ * @param accel the accelerometer counts
+ * @param dt_us the time since the last sample
+ * @param time_us the time of the sample
+ * 
+ */
+static void chain_imu(const int16_t gyro[3], const int16_t accel[3], uint32_t dt_us, uint32_t time_us) {
+    ahrs_update(gyro, accel, NULL);
+    float accel_up = ahrs_vertical_accel(accel) * LSM6DS3_ACCEL_G_PER_COUNT * (float)G - (float)G;
+    alt_predict(accel_up, dt_us * 1e-6f, time_us);
+    phase_update(accel_up, time_us / 1000);
+}
+
+/** 
+ * @brief Find the tilt error of the attitude filter
+ * @param pitch the true angle off vertical, rad
+ * @param roll the true roll angle, rad
+ * 
+ * @return the angle between the true and estimated vertical, degrees
+ */
+static double tilt_error_deg(double pitch, double roll) {
+    // The true vertical in the body frame: pitch about earth x then roll about z
+    double up[3] = { sin(pitch) * sin(roll), sin(pitch) * cos(roll), cos(pitch) };
+    q30_t fq[4];
+    double q[4];
+    ahrs_get_quat(fq);
+    for (int i = 0; i < 4; i++) {
+        q[i] = fq[i] / (double)Q30_ONE;
+    }
+    double est[3] = {
+        2 * (q[1] * q[3] - q[0] * q[2]),
+        2 * (q[0] * q[1] + q[2] * q[3]),
+        q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3],
+    };
+    double dot = up[0] * est[0] + up[1] * est[1] + up[2] * est[2];
+    return acos(dot > 1 ? 1 : (dot < -1 ? -1 : dot)) / DEG;
+}
+
+/** 
+ * @brief Simulate a flight through the chain
+ * @param flight the flight
+ * @param result the results
+ * 
+ */
+static void simulate(const flight_t *flight, result_t *result) {
+    double gyro_bias[3] = { GYRO_BIAS_DPS, -GYRO_BIAS_DPS, GYRO_BIAS_DPS / 2 };
+    double dt = 1e-4;
+    double t = 0;
+    double y = 0, z = 0, vy = 0, vz = 0;
+    double pitch = flight->rail_deg * DEG;
+    double roll = 0;
+    double next_est = 0, next_baro = 0;
+    double last_est = 0;
+    double tilt_deg = 0;
+    double velocity = 0;
+    bool climbing = false;
+    phase_t phase = PHASE_PAD;
+
+    memset(result, 0, sizeof(*result));
+    result->detect_s = result->launch_s = result->burnout_s = -1;
+    result->apogee_s = -1;
+    g_rand = 0x9E3779B9;
+    chain_init();
+
+    while (result->apogee_s < 0 || t < PAD_S + result->apogee_s + AFTER_APOGEE_S) {
+        double flight_t = t - PAD_S;
+        double thrust = flight_t >= 0 && flight_t < flight->burn_s ? flight->thrust_g * G : 0;
+        double v = sqrt(vy * vy + vz * vz);
+        double drag = flight->drag_per_v2 * v * v;
+        double roll_rate = flight->roll_dps * DEG * (flight_t < flight->burn_s ? 1 : exp(-(flight_t - flight->burn_s) / 4));
+        if (flight_t < 0) {
+            roll_rate = 0;
+        }
+
+        // Along the nose, which follows the flight path off the rail
+        double force = thrust - drag;
+        double pitch_rate = 0;
+        bool on_rail = flight_t < 0 || sqrt(y * y + z * z) < RAIL_M;
+        if (on_rail) {
+            if (flight_t >= 0 && force > G * cos(pitch)) {
+                double a = force - G * cos(pitch);
+                vy -= a * sin(pitch) * dt;
+                vz += a * cos(pitch) * dt;
+            }
+        } else {
+            vy += -force * sin(pitch) * dt;
+            vz += (force * cos(pitch) - G) * dt;
+            // Too slow near apogee for the fins to turn it, it keeps its attitude
+            if (v > TURN_MIN_V) {
+                double path = atan2(-vy, vz);
+                pitch_rate = (path - pitch) / dt;
+                pitch = path;
+            }
+        }
+        y += vy * dt;
+        z += vz * dt;
+        roll += roll_rate * dt;
+
+        climbing |= vz > 1;
+        if (climbing && vz <= 0 && result->apogee_s < 0) {
+            result->apogee_s = flight_t;
+            result->apogee_m = z;
+            result->tilt_deg = tilt_deg;
+            result->velocity_err = velocity;
+        }
+
+        if (t >= next_est) {
+            // On the pad and rail the accelerometer holds the rocket up
+            double f_nose = on_rail && force <= G * cos(pitch) ? G * cos(pitch) : force;
+            double f_side = on_rail && force <= G * cos(pitch) ? G * sin(pitch) : 0;
+            double body[3] = { f_side * sin(roll), f_side * cos(roll), f_nose };
+            double rate[3] = { pitch_rate * cos(roll), -pitch_rate * sin(roll), roll_rate };
+            int16_t gyro[3], accel[3];
+            for (int i = 0; i < 3; i++) {
+                gyro[i] = counts(rate[i] / DEG + gyro_bias[i] + GYRO_NOISE_DPS * gauss(), GYRO_DPS_PER_COUNT);
+                accel[i] = counts(body[i] / G + ACCEL_NOISE_G * gauss(), LSM6DS3_ACCEL_G_PER_COUNT);
+            }
+            uint32_t time_us = (uint32_t)(t * 1e6);
+            chain_imu(gyro, accel, (uint32_t)((t - last_est) * 1e6), time_us);
+            last_est = t;
+            next_est += g_est_period_us * 1e-6;
+            tilt_deg = tilt_error_deg(pitch, roll);
+
+            alt_state_t alt;
+            alt_get_state(&alt);
+            velocity = alt.velocity - vz;
+            if (phase_get() == PHASE_COAST && fabs(velocity) > result->velocity_err_max) {
+                result->velocity_err_max = fabs(velocity);
+            }
+
+            phase_t now = phase_get();
+            if (now != phase) {
+                if (now == PHASE_BOOST) {
+                    result->launch_s = flight_t;
+                } else if (now == PHASE_COAST) {
+                    result->burnout_s = flight_t;
+                }
+                phase = now;
+            }
+            if (alt_apogee() && result->detect_s < 0) {
+                result->detect_s = flight_t;
+                result->detect_m = z;
+            }
+        }
+        if (t >= next_baro) {
+            alt_update_baro(pressure_at(z));
+            next_baro += g_baro_period_us * 1e-6;
+        }
+        t += dt;
+    }
+
+    alt_state_t alt;
+    alt_get_state(&alt);
+    result->est_peak_m = alt.max_height;
+}
+
+/** 
+ * @brief Print the line of one simulated run
+ * @param name the run name
+ * @param r the results
+ * 
+ */
+static void print_result(const char *name, const result_t *r) {
+    printf("%-40s %8.2f %8.1f %8.2f %8.2f", name, r->launch_s, r->burnout_s, r->apogee_s, r->apogee_m);
+    if (r->detect_s < 0) {
+        printf(" %9s %8s", "never", "-");
+    } else {
+        printf(" %9.0f %8.2f", (r->detect_s - r->apogee_s) * 1000, r->apogee_m - r->detect_m);
+    }
+    printf(" %8.2f %7.2f %6.2f %6.2f\n", r->est_peak_m - r->apogee_m, r->tilt_deg, r->velocity_err,
+           r->velocity_err_max);
+}
+
+/** 
+ * @brief Add a record from a capture
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * 
+ */
+static void add_record(telem_rec_type_t type, const void *rec, size_t len) {
+    if (g_count == MAX_RECORDS) {
+        return;
+    }
+    if ((type == TELEM_REC_IMU && len == sizeof(telem_imu_t))
+        || (type == TELEM_REC_BARO && len == sizeof(telem_baro_t))) {
+        g_recs[g_count].type = type;
+        memcpy(&g_recs[g_count].rec, rec, len);
+        g_count++;
+    }
+}
+
+static void add_packed(telem_rec_type_t type, const void *rec, size_t len, void *ctx) {
+    (void)ctx;
+    add_record(type, rec, len);
+}
+
+/** 
+ * @brief Read the IMU and barometer records of a capture
+ * @param path the capture
+ * 
+ * @return true if it could be read
+ */
+static bool load_capture(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+
+    g_count = 0;
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    size_t frame_len = 0;
+    int ch;
+    while ((ch = fgetc(in)) != EOF) {
+        if (ch != 0) {
+            if (frame_len < sizeof(frame)) {
+                frame[frame_len++] = ch;
+            }
+            continue;
+        }
+
+        uint8_t type;
+        uint8_t *payload;
+        int len = frame_len ? frame_decode(frame, frame_len, &type, &payload) : -1;
+        if (len >= 0 && type == TELEM_REC_PACKED) {
+            logpack_decode(payload, len, add_packed, NULL);
+        } else if (len >= 0) {
+            add_record(type, payload, len);
+        }
+        frame_len = 0;
+    }
+
+    fclose(in);
+    return true;
+}
+
+/** 
+ * @brief Find the peak of the averaged barometer altitude of a capture
+ * @param peak_us set to its time
+ * 
+ * @return the peak altitude above the first readings, m
+ */
+static double replay_baro_peak(uint32_t *peak_us) {
+    double best = -1e9;
+    double ground = 0;
+    uint32_t ground_count = 0;
+
+    for (size_t i = 0; i < g_count; i++) {
+        if (g_recs[i].type != TELEM_REC_BARO) {
+            continue;
+        }
+        uint32_t t0 = g_recs[i].rec.baro.time_us;
+        double sum = 0;
+        uint32_t n = 0;
+        for (size_t j = i; j < g_count; j++) {
+            if (g_recs[j].type != TELEM_REC_BARO) {
+                continue;
+            }
+            if (g_recs[j].rec.baro.time_us - t0 > APOGEE_SMOOTH_S * 1e6) {
+                break;
+            }
+            sum += alt_pressure_to_altitude(g_recs[j].rec.baro.pressure);
+            n++;
+        }
+        double h = sum / n;
+        if (ground_count < ALT_GROUND_SAMPLES) {
+            ground += alt_pressure_to_altitude(g_recs[i].rec.baro.pressure) / ALT_GROUND_SAMPLES;
+            ground_count++;
+            continue;
+        }
+        if (h - ground > best) {
+            best = h - ground;
+            *peak_us = t0 + (uint32_t)(APOGEE_SMOOTH_S * 0.5e6);
+        }
+    }
+    return best;
+}
+
+/** 
+ * @brief Replay a capture through the chain and print its delay
+ * @param path the capture
+ * 
+ */
+static void replay(const char *path) {
+    if (!load_capture(path)) {
+        return;
+    }
+
+    chain_init();
+    uint32_t last_us = 0;
+    uint8_t shift = 0xFF;
+    bool detected = false;
+    uint32_t detect_us = 0;
+    for (size_t i = 0; i < g_count; i++) {
+        if (g_recs[i].type == TELEM_REC_BARO) {
+            alt_update_baro(g_recs[i].rec.baro.pressure);
+            continue;
+        }
+
+        const telem_imu_t *imu = &g_recs[i].rec.imu;
+        uint32_t gap_us = last_us ? imu->time_us - last_us : LSM6DS3_PERIOD_US;
+        last_us = imu->time_us;
+        if (gap_us == 0 || gap_us > 1000000) {
+            continue;
+        }
+
+        // The logged rate is a power of 2 below the full rate
+        uint8_t s = 0;
+        while (s < AHRS_MAX_PERIOD_SHIFT && (uint32_t)(LSM6DS3_PERIOD_US << s) * 3 / 2 < gap_us) {
+            s++;
+        }
+        if (s != shift) {
+            ahrs_set_period_shift(s);
+            shift = s;
+        }
+
+        // The record is packed, its fields are copied out
+        int16_t gyro[3], accel[3];
+        for (int j = 0; j < 3; j++) {
+            gyro[j] = imu->gyro[j];
+            accel[j] = imu->accel[j];
+        }
+        chain_imu(gyro, accel, gap_us, imu->time_us);
+        if (alt_apogee() && !detected) {
+            detected = true;
+            detect_us = imu->time_us;
+        }
+    }
+
+    uint32_t peak_us = 0;
+    double peak_m = replay_baro_peak(&peak_us);
+    alt_state_t alt;
+    alt_get_state(&alt);
+
+    printf("%s: %zu records, baro peak %.1f m at %.2f s", path, g_count, peak_m, peak_us * 1e-6);
+    if (detected) {
+        printf(", detected at %.2f s, delay %.0f ms, filter peak %.1f m\n", detect_us * 1e-6,
+               ((double)detect_us - peak_us) / 1000.0, alt.max_height);
+    } else {
+        printf(", apogee never detected\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    static const flight_t flights[] = {
+        { "vertical", 0, 8, 3, 2.5e-4, 720 },
+        { "10 deg rail", 10, 8, 3, 2.5e-4, 720 },
+        { "slow motor, 3 g", 5, 3, 6, 2.0e-4, 180 },
+        { "drag only coast near 1 g", 10, 10, 2.5, 4.0e-4, 720 },
+    };
+
+    g_recs = malloc(MAX_RECORDS * sizeof(*g_recs));
+    if (g_recs == NULL) {
+        return 1;
+    }
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            replay(argv[i]);
+        }
+        return 0;
+    }
+
+    printf("Times from launch in s, delay from the true apogee in ms, heights in m, tilt in degrees,\n"
+           "velocity error at apogee and largest in the coast in m/s\n");
+    printf("%-40s %8s %8s %8s %8s %9s %8s %8s %7s %6s %6s\n", "flight", "launch", "burnout", "apogee", "height",
+           "delay", "lost", "peak err", "tilt",
+           "v err", "max");
+    for (size_t i = 0; i < sizeof(flights) / sizeof(flights[0]); i++) {
+        result_t result;
+        simulate(&flights[i], &result);
+        print_result(flights[i].name, &result);
+    }
+
+    // The drag only coast with the accelerometer correcting throughout
+    const flight_t *drag = &flights[sizeof(flights) / sizeof(flights[0]) - 1];
+    result_t result;
+    char name[64];
+    g_never_gate = true;
+    simulate(drag, &result);
+    g_never_gate = false;
+    snprintf(name, sizeof(name), "%s, never gated", drag->name);
+    print_result(name, &result);
+
+    free(g_recs);
+    return 0;
+}
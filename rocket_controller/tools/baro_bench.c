@@ -0,0 +1,94 @@
+/**
+ * @file baro_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-16
+ * @brief Host tool that compares the table pressure to altitude conversion
+ * with libm
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o baro_bench tools/baro_bench.c src/altitude.c -lm
+ *
+ * Prints the time per conversion of the table and of powf() and the largest
+ * error of both against the exact double precision formula over 0 m to
+ * 3000 m. The times are host nanoseconds, the ratio between them is what
+ * matters. On the target powf() is soft float and much slower again.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "altitude.h"
+
+/// Pressure range checked, Pa / 64, about 3000 m to 0 m
+#define BENCH_LOW (70100UL * 64)
+#define BENCH_HIGH (101330UL * 64)
+
+/// Passes over the range when timing
+#define BENCH_PASSES 20
+
+/// Keeps the conversions from being optimised away
+static volatile float g_sink;
+
+static double exact_m(uint32_t pressure) {
+    return 44330.0 * (1.0 - pow(pressure / 64.0 / 101325.0, 0.190295));
+}
+
+static float libm_m(uint32_t pressure) {
+    float pa = pressure / 64.0f;
+
+    return 44330.0f * (1.0f - powf(pa / 101325.0f, 0.190295f));
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Time a conversion over the range
+ * @param convert the conversion
+ *
+ * @return the time per call in ns
+ */
+static double time_ns(float (*convert)(uint32_t)) {
+    double start = now_s();
+    for (int pass = 0; pass < BENCH_PASSES; pass++) {
+        for (uint32_t p = BENCH_LOW; p <= BENCH_HIGH; p++) {
+            g_sink = convert(p);
+        }
+    }
+    double calls = (double)BENCH_PASSES * (BENCH_HIGH - BENCH_LOW + 1);
+
+    return (now_s() - start) * 1e9 / calls;
+}
+
+/**
+ * @brief Find the largest error over the range
+ * @param convert the conversion
+ *
+ * @return the error in mm
+ */
+static double max_error_mm(float (*convert)(uint32_t)) {
+    double worst = 0;
+    for (uint32_t p = BENCH_LOW; p <= BENCH_HIGH; p++) {
+        double err = fabs(convert(p) - exact_m(p)) * 1000.0;
+        if (err > worst) {
+            worst = err;
+        }
+    }
+
+    return worst;
+}
+
+int main(void) {
+    printf("%-8s %10s %14s\n", "", "ns/call", "max err (mm)");
+    printf("%-8s %10.2f %14.1f\n", "table", time_ns(alt_pressure_to_altitude),
+           max_error_mm(alt_pressure_to_altitude));
+    printf("%-8s %10.2f %14.1f\n", "powf", time_ns(libm_m), max_error_mm(libm_m));
+
+    return 0;
+}
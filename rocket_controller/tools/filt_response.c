@@ -0,0 +1,141 @@
+/** 
+ * @file filt_response.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-18
+ * @brief Host tool that measures the IMU filter chain
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o filt_response tools/filt_response.c src/filt.c -lm
+ *
+ * Sine waves are run through the fixed point chain from filt_imu_chain_init()
+ * and the gain at the estimator and logger taps is printed against the
+ * frequency relative to the IMU rate (0.5 is the Nyquist frequency, at
+ * 1666 Hz 0.1 is 167 Hz). Frequencies above a tap's own Nyquist frequency
+ * show how much is aliased into its band.
+ *
+ * The time per input sample of the whole chain is printed last. It is host
+ * nanoseconds, on the target see the filt zone in /dev/perf.
+ */
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "filt.h"
+
+#define PI 3.14159265358979
+
+/// Input amplitude, counts
+#define AMPLITUDE 16000.0
+
+/// Inputs per frequency, the first are skipped while the chain fills
+#define INPUTS 4096
+#define SETTLE 256
+
+/// Inputs per block, as read from the sensor FIFO
+#define BLOCK 16
+
+/// Blocks run when timing
+#define TIMING_BLOCKS 200000
+
+static filt_sample_t g_hist[FILT_IMU_HIST_LEN];
+static filt_sample_t g_est[BLOCK];
+static filt_sample_t g_log[BLOCK];
+
+/** 
+ * @brief Convert a peak amplitude to a gain in dB
+ * @param peak the peak output
+ * 
+ * @return the gain
+ */
+static double gain_db(double peak) {
+    if (peak < 0.5) {
+        return -99.9;
+    }
+    return 20 * log10(peak / AMPLITUDE);
+}
+
+/** 
+ * @brief Run a sine wave through a fresh chain
+ * @param freq the frequency relative to the input rate
+ * @param est_db set to the estimator tap gain
+ * @param log_db set to the logger tap gain
+ * 
+ */
+static void measure(double freq, double *est_db, double *log_db) {
+    filt_chain_t chain;
+    filt_imu_chain_init(&chain, g_hist);
+
+    double est_peak = 0;
+    double log_peak = 0;
+    uint32_t est_seen = 0;
+    uint32_t log_seen = 0;
+
+    for (int i = 0; i < INPUTS; i += BLOCK) {
+        filt_sample_t in[BLOCK];
+        for (int j = 0; j < BLOCK; j++) {
+            int16_t x = (int16_t)lround(AMPLITUDE * sin(2 * PI * freq * (i + j)));
+            in[j].time_us = i + j;
+            for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+                in[j].ch[ch] = x;
+            }
+        }
+
+        size_t n_est, n_log;
+        filt_chain_process(&chain, in, BLOCK, g_est, &n_est, g_log, &n_log);
+        for (size_t k = 0; k < n_est; k++) {
+            double y = fabs((double)g_est[k].ch[0]);
+            if (est_seen++ > SETTLE && y > est_peak) {
+                est_peak = y;
+            }
+        }
+        for (size_t k = 0; k < n_log; k++) {
+            double y = fabs((double)g_log[k].ch[0]);
+            if (log_seen++ > SETTLE / 4 && y > log_peak) {
+                log_peak = y;
+            }
+        }
+    }
+
+    *est_db = gain_db(est_peak);
+    *log_db = gain_db(log_peak);
+}
+
+int main(void) {
+    filt_chain_t chain;
+    filt_imu_chain_init(&chain, g_hist);
+    printf("estimator 1/%u rate, logger 1/%u rate\n",
+           filt_chain_factor(&chain, chain.est_tap), filt_chain_factor(&chain, chain.log_tap));
+
+    printf("%6s %10s %10s\n", "freq", "est (dB)", "log (dB)");
+    static const double freqs[] = {
+        0.0, 0.01, 0.02, 0.03, 0.04, 0.05, 0.06, 0.07, 0.08, 0.09, 0.1,
+        0.125, 0.15, 0.175, 0.2, 0.25, 0.3, 0.35, 0.4, 0.45, 0.5,
+    };
+    for (size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++) {
+        double est_db, log_db;
+        // Keep away from exact sub-multiples so the peak is seen
+        measure(freqs[i] + 0.0003, &est_db, &log_db);
+        printf("%6.3f %10.2f %10.2f\n", freqs[i], est_db, log_db);
+    }
+
+    filt_sample_t in[BLOCK];
+    for (int j = 0; j < BLOCK; j++) {
+        for (int ch = 0; ch < FILT_CHANNELS; ch++) {
+            in[j].ch[ch] = (int16_t)(j * 1000 - ch * 3000);
+        }
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long b = 0; b < TIMING_BLOCKS; b++) {
+        size_t n_est, n_log;
+        filt_chain_process(&chain, in, BLOCK, g_est, &n_est, g_log, &n_log);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%.1f ns per input sample (6 channels)\n", ns / ((double)TIMING_BLOCKS * BLOCK));
+
+    return 0;
+}
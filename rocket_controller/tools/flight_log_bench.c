@@ -0,0 +1,284 @@
+/** 
+ * @file flight_log_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Host tool that measures the flight recorder against a simulated W25Q128
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host/mock -o flight_log_bench tools/flight_log_bench.c
+ *         src/flight_log.c test/host/mock/w25q_sim.c
+ *
+ * Usage:
+ *     flight_log_bench [-p service_us] [-s seconds] [image]
+ *
+ * Records are written at a sustained 1 kHz while flight_log_service() runs
+ * every service_us (1000 by default, the log task period in main.c), with
+ * the flash taking the typical and then the maximum datasheet times. For
+ * every record the time from flight_log_write() to the page holding its
+ * last byte being programmed is the write latency, the worst and 99th
+ * percentile are reported with the bytes dropped and the least space left
+ * in the page buffers. Logging starts once the first sector of the flight
+ * is erased, the time that takes is reported as the start up gap.
+ *
+ * Each run uses a fresh anonymous image. If a file is given the last run
+ * is recorded into it and the file is kept to look at afterwards.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "w25q.h"
+#include "flight_log.h"
+#include "w25q_sim.h"
+
+/// Period of the records
+#define SAMPLE_US 1000
+
+/// Latency histogram resolution and range
+#define HIST_BIN_US 100
+#define HIST_BINS 100000
+
+/// Records in flight between write and program, more than two page buffers hold
+#define PENDING_MAX 1024
+
+static uint32_t g_service_us = 1000;
+
+static uint32_t g_hist[HIST_BINS];
+
+/// Results of one run
+typedef struct {
+    uint64_t startup_us;
+    uint64_t worst_us;
+    uint64_t p99_us;
+    uint32_t dropped;
+    size_t min_space;
+    uint32_t suspends;
+    uint32_t violations;
+} bench_result_t;
+
+/** 
+ * @brief Let simulated time pass with the recorder serviced as the firmware does
+ * @param us the time to pass
+ * 
+ */
+static void run_for(uint64_t us) {
+    for (uint64_t t = 0; t < us; t += g_service_us) {
+        w25q_sim_advance(g_service_us);
+        flight_log_service();
+    }
+}
+
+/** 
+ * @brief Get the number of flight bytes programmed so far
+ * @param base the stats when the flight started
+ * 
+ * @return the bytes from the start of the flight header
+ */
+static uint32_t programmed(const flight_log_stats_t *base) {
+    flight_log_stats_t stats;
+    flight_log_get_stats(&stats);
+    return (stats.pages_written - base->pages_written) * W25Q_PAGE_SIZE;
+}
+
+/** 
+ * @brief Record one flight and measure it, on the flash w25q_sim_open() set up
+ * @param record the bytes per record
+ * @param seconds the length of the flight
+ * @param result set to the results
+ * 
+ */
+static void bench(size_t record, uint32_t seconds, bench_result_t *result) {
+    static uint32_t pending_end[PENDING_MAX];
+    static uint64_t pending_at[PENDING_MAX];
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    uint8_t data[256];
+    flight_log_stats_t base;
+    flight_log_stats_t stats;
+    w25q_sim_stats_t sim;
+
+    memset(result, 0, sizeof(*result));
+    memset(g_hist, 0, sizeof(g_hist));
+    result->min_space = SIZE_MAX;
+
+    flight_log_get_stats(&base);
+    w25q_sim_get_stats(&sim);
+    uint32_t erases = sim.erases_done;
+    uint64_t start = w25q_sim_now();
+    flight_log_start();
+    uint32_t offset = 16;   // the flight header
+    do {
+        run_for(g_service_us);
+        w25q_sim_get_stats(&sim);
+    } while (sim.erases_done == erases);
+    result->startup_us = w25q_sim_now() - start;
+
+    uint32_t samples = seconds * (1000000 / SAMPLE_US);
+    for (uint32_t i = 0; i < samples; i++) {
+        for (size_t j = 0; j < record; j++) {
+            data[j] = (uint8_t)(i + j);
+        }
+        size_t space = flight_log_space();
+        if (space < result->min_space) {
+            result->min_space = space;
+        }
+        size_t accepted = flight_log_write(data, record);
+        offset += accepted;
+        if (accepted == record && head - tail < PENDING_MAX) {
+            pending_end[head % PENDING_MAX] = offset;
+            pending_at[head % PENDING_MAX] = w25q_sim_now();
+            head++;
+        }
+
+        for (uint32_t t = 0; t < SAMPLE_US; t += g_service_us) {
+            run_for(g_service_us);
+            uint32_t done = programmed(&base);
+            while (tail != head && pending_end[tail % PENDING_MAX] <= done) {
+                uint64_t latency = w25q_sim_now() - pending_at[tail % PENDING_MAX];
+                if (latency > result->worst_us) {
+                    result->worst_us = latency;
+                }
+                g_hist[latency / HIST_BIN_US < HIST_BINS ? latency / HIST_BIN_US : HIST_BINS - 1]++;
+                tail++;
+            }
+        }
+    }
+
+    flight_log_stop();
+    while (flight_log_recording()) {
+        run_for(g_service_us);
+    }
+
+    // The padded last page was programmed on stop, not by the samples
+    uint32_t measured = 0;
+    for (uint32_t i = 0; i < HIST_BINS; i++) {
+        measured += g_hist[i];
+    }
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < HIST_BINS; i++) {
+        seen += g_hist[i];
+        if (seen * 100ULL >= measured * 99ULL) {
+            result->p99_us = (uint64_t)(i + 1) * HIST_BIN_US;
+            break;
+        }
+    }
+
+    flight_log_get_stats(&stats);
+    w25q_sim_get_stats(&sim);
+    result->dropped = stats.bytes_dropped - base.bytes_dropped;
+    result->suspends = stats.erase_suspends - base.erase_suspends;
+    result->violations = sim.violations;
+}
+
+/** 
+ * @brief Fill the chip with back to back flights and report how evenly the
+ * sectors were erased
+ * @param laps the number of times to go round the chip
+ * 
+ */
+static void wear(uint32_t laps) {
+    uint8_t data[32] = {0};
+    uint32_t sectors = W25Q_SIZE / W25Q_SECTOR_SIZE;
+
+    w25q_sim_open(NULL, &w25q_sim_typical);
+    flight_log_init();
+
+    // 32 KB/s flights of 30 s, 960 KB each
+    uint32_t flights = 0;
+    while (true) {
+        uint32_t min = UINT32_MAX;
+        for (uint32_t s = 0; s < sectors; s++) {
+            if (w25q_sim_sector_erases(s) < min) {
+                min = w25q_sim_sector_erases(s);
+            }
+        }
+        if (min >= laps) {
+            break;
+        }
+
+        flight_log_start();
+        run_for(50000);
+        for (uint32_t i = 0; i < 30000; i++) {
+            flight_log_write(data, sizeof(data));
+            run_for(SAMPLE_US);
+        }
+        flight_log_stop();
+        while (flight_log_recording()) {
+            run_for(g_service_us);
+        }
+        flights++;
+    }
+
+    uint32_t min = UINT32_MAX;
+    uint32_t max = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        uint32_t n = w25q_sim_sector_erases(s);
+        min = n < min ? n : min;
+        max = n > max ? n : max;
+    }
+    printf("\nwear: %u flights of 960 KB, sector erases min %u max %u\n", flights, min, max);
+    w25q_sim_close();
+}
+
+int main(int argc, char **argv) {
+    static const size_t records[] = { 32, 64, 128 };
+    const char *image = NULL;
+    uint32_t seconds = 60;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:s:")) != -1) {
+        switch (opt) {
+        case 'p':
+            g_service_us = strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            seconds = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-p service_us] [-s seconds] [image]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind < argc) {
+        image = argv[optind];
+    }
+    if (g_service_us == 0 || SAMPLE_US % g_service_us != 0) {
+        fprintf(stderr, "service_us must divide %u\n", SAMPLE_US);
+        return 2;
+    }
+
+    printf("1 kHz records for %u s, flight_log_service() every %u us\n", seconds, g_service_us);
+    printf("%-8s %6s %10s %10s %10s %8s %6s %9s %10s\n", "timing", "record", "startup", "worst",
+           "p99", "dropped", "space", "suspends", "violations");
+
+    for (int t = 0; t < 2; t++) {
+        const w25q_sim_timing_t *timing = t ? &w25q_sim_worst : &w25q_sim_typical;
+        for (size_t r = 0; r < sizeof(records) / sizeof(records[0]); r++) {
+            bench_result_t result;
+
+            // Each run on a fresh chip, only the last is kept in a file
+            bool last = t == 1 && r == sizeof(records) / sizeof(records[0]) - 1;
+            if (image != NULL && last) {
+                unlink(image);
+            }
+            if (w25q_sim_open(last ? image : NULL, timing) != 0) {
+                return 1;
+            }
+            flight_log_init();
+
+            bench(records[r], seconds, &result);
+            printf("%-8s %5zuB %8.1fms %8.1fms %8.1fms %7uB %5zuB %9u %10u\n", t ? "max" : "typical",
+                   records[r], result.startup_us / 1000.0, result.worst_us / 1000.0, result.p99_us / 1000.0,
+                   result.dropped, result.min_space, result.suspends, result.violations);
+            w25q_sim_close();
+        }
+    }
+
+    wear(2);
+    return 0;
+}
@@ -0,0 +1,296 @@
+/** 
+ * @file fmt_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-22
+ * @brief Host tool that checks and measures the compact formatter
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o fmt_bench tools/fmt_bench.c src/fmt.c -lm
+ *
+ * Usage:
+ *     fmt_bench
+ *
+ * fmt_snprintf() is checked against the C library snprintf() for integer,
+ * hex, string and width conversions, and %q against a long double
+ * reference. Then the console lines of the firmware are formatted with both
+ * to time them per character, and the deepest stack used by each is found
+ * by painting the stack before the call.
+ *
+ * The numbers are host ones and the C library is glibc, not the newlib of
+ * the target. Flash is not measured here: tools/fmt_size.py links the same
+ * lines for the target against newlib-nano.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "fmt.h"
+
+/// Random cases of each kind checked
+#define CHECK_CASES 1000000
+
+/// Times the lines are formatted when timing
+#define TIMING_PASSES 200000
+
+/// Stack painted below the caller when measuring
+#define PAINT_SIZE 32768
+#define PAINT_BYTE 0xA5
+
+static uint32_t g_fails = 0;
+
+/// The lowest address painted by stack_paint()
+static volatile uintptr_t g_paint_bottom;
+
+static uint32_t g_rand_state = 12345;
+
+/** 
+ * @brief A repeatable random number (xorshift)
+ * 
+ * @return the number
+ */
+static uint32_t rand32(void) {
+    g_rand_state ^= g_rand_state << 13;
+    g_rand_state ^= g_rand_state >> 17;
+    g_rand_state ^= g_rand_state << 5;
+    return g_rand_state;
+}
+
+/** 
+ * @brief A random value with its size spread evenly over the bits
+ * 
+ * @return the value
+ */
+static uint32_t rand_value(void) {
+    return rand32() >> (rand32() % 32);
+}
+
+/** 
+ * @brief Compare two outputs and report a difference
+ * @param format the format used
+ * @param got the output of fmt_snprintf()
+ * @param want the expected output
+ * 
+ */
+static void check(const char *format, const char *got, const char *want) {
+    if (strcmp(got, want) != 0) {
+        if (g_fails < 10) {
+            printf("  FAIL \"%s\": got \"%s\" want \"%s\"\n", format, got, want);
+        }
+        g_fails++;
+    }
+}
+
+/** 
+ * @brief Check integer, hex, character and string conversions against snprintf
+ * 
+ */
+static void check_integers(void) {
+    static const char *const formats[] = {
+        "%d", "%i", "%u", "%x", "%X", "%ld", "%lu", "%lx",
+        "%8d", "%-8d", "%08d", "%-08d", "%3u", "%06u", "%08x", "%-6X|",
+        "[%d %u %x]", "%5u.%06u",
+    };
+    static const char *const strings[] = { "", "a", "imu", "flight log" };
+    char got[64];
+    char want[64];
+
+    for (uint32_t i = 0; i < CHECK_CASES; i++) {
+        const char *format = formats[i % (sizeof(formats) / sizeof(formats[0]))];
+        uint32_t a = rand_value();
+        uint32_t b = rand_value();
+        uint32_t c = rand_value();
+
+        // Pass both as int, or as long when the format says so
+        if (strchr(format, 'l') != NULL) {
+            bool is_signed = strchr(format, 'd') != NULL;
+            long la = is_signed ? (long)(int32_t)a : (long)a;
+            fmt_snprintf(got, sizeof(got), format, la);
+            snprintf(want, sizeof(want), format, la);
+        } else {
+            fmt_snprintf(got, sizeof(got), format, a, b, c);
+            snprintf(want, sizeof(want), format, a, b, c);
+        }
+        check(format, got, want);
+    }
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        const char *s = strings[i % 4];
+        int width = rand32() % 12;
+        int prec = rand32() % 6;
+        fmt_snprintf(got, sizeof(got), "%*s|%-*s|%.*s|%c", width, s, width, s, prec, s, 'a' + i % 26);
+        snprintf(want, sizeof(want), "%*s|%-*s|%.*s|%c", width, s, width, s, prec, s, 'a' + i % 26);
+        check("%s", got, want);
+    }
+}
+
+/** 
+ * @brief Check %q against a long double reference rounded half away from zero
+ * 
+ */
+static void check_fixed(void) {
+    char format[16];
+    char got[64];
+    char want[64];
+
+    for (uint32_t i = 0; i < CHECK_CASES; i++) {
+        int32_t value = (int32_t)rand_value();
+        if (rand32() & 1) {
+            value = -value;
+        }
+        unsigned frac_bits = rand32() % 32;
+        unsigned prec = rand32() % 10;
+        snprintf(format, sizeof(format), "%%.%uq%u", prec, frac_bits);
+
+        // 2^31 * 10^9 fits the 64 bit mantissa, so this is exact
+        long double pow10 = powl(10, prec);
+        long double scaled = floorl(fabsl(ldexpl(value, -(int)frac_bits)) * pow10 + 0.5L);
+        uint64_t whole = (uint64_t)(scaled / pow10);
+        uint64_t frac = (uint64_t)(scaled - (long double)whole * pow10);
+        const char *sign = (value < 0 && scaled != 0) ? "-" : "";
+        if (prec > 0) {
+            snprintf(want, sizeof(want), "%s%llu.%0*llu", sign, (unsigned long long)whole, (int)prec,
+                     (unsigned long long)frac);
+        } else {
+            snprintf(want, sizeof(want), "%s%llu", sign, (unsigned long long)whole);
+        }
+
+        fmt_snprintf(got, sizeof(got), format, value);
+        check(format, got, want);
+    }
+}
+
+/** 
+ * @brief Check cutting short at every buffer size
+ * 
+ */
+static void check_truncation(void) {
+    char got[64];
+    char want[64];
+    const char *format = "[%5u.%06u] phase %d at %x ms, q %.4q30";
+
+    for (size_t size = 1; size < 48; size++) {
+        size_t len = fmt_snprintf(got, size, format, 12u, 345678u, -3, 0xbeefu, (int32_t)(0.7071 * (1 << 30)));
+        snprintf(want, size, "[%5u.%06u] phase %d at %x ms, q %s", 12u, 345678u, -3, 0xbeefu, "0.7071");
+        check(format, got, want);
+        if (len != strlen(want)) {
+            g_fails++;
+        }
+    }
+}
+
+/** 
+ * @brief Format the firmware's console lines
+ * @param use_fmt true for fmt_snprintf(), false for snprintf()
+ * @param buf the buffer
+ * @param size the size of the buffer
+ * 
+ * @return the number of characters written
+ */
+static __attribute__((noinline)) size_t format_lines(bool use_fmt, char *buf, size_t size) {
+    static volatile uint32_t v[8] = { 1234567, 42, 987654, 3, 123456, 65535, 0xdeadbeef, 7 };
+    static volatile int32_t q = 759250125;  // 0.7071 in Q30
+    size_t len = 0;
+
+    if (use_fmt) {
+        len += fmt_snprintf(buf, size, "[%5u.%06u] phase %u at %u ms\r\n", v[0] / 1000000, v[0] % 1000000, v[7], v[2]);
+        len += fmt_snprintf(buf, size, "%s %lu %lu %lu %lu\r\n", "acq", (unsigned long)v[2], (unsigned long)v[3],
+                            (unsigned long)v[4], (unsigned long)v[5]);
+        len += fmt_snprintf(buf, size, "i2c%d %lu error, address 0x%x\r\n", (int)v[7], (unsigned long)v[1], v[6]);
+        len += fmt_snprintf(buf, size, "q: %.4q30 %.4q30 %.4q30 %.4q30\r\n", q, -q, q >> 1, -(q >> 2));
+    } else {
+        len += snprintf(buf, size, "[%5u.%06u] phase %u at %u ms\r\n", v[0] / 1000000, v[0] % 1000000, v[7], v[2]);
+        len += snprintf(buf, size, "%s %lu %lu %lu %lu\r\n", "acq", (unsigned long)v[2], (unsigned long)v[3],
+                        (unsigned long)v[4], (unsigned long)v[5]);
+        len += snprintf(buf, size, "i2c%d %lu error, address 0x%x\r\n", (int)v[7], (unsigned long)v[1], v[6]);
+        // newlib needs soft-float doubles for this
+        len += snprintf(buf, size, "q: %.4f %.4f %.4f %.4f\r\n", q / 1073741824.0, -q / 1073741824.0,
+                        (q >> 1) / 1073741824.0, -(q >> 2) / 1073741824.0);
+    }
+    return len;
+}
+
+/** 
+ * @brief Time the console lines
+ * @param use_fmt true for fmt_snprintf(), false for snprintf()
+ * 
+ * @return nanoseconds per character
+ */
+static double time_lines(bool use_fmt) {
+    char buf[96];
+    size_t chars = 0;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < TIMING_PASSES; i++) {
+        chars += format_lines(use_fmt, buf, sizeof(buf));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return ns / chars;
+}
+
+/** 
+ * @brief Fill the stack below the caller with PAINT_BYTE
+ * 
+ */
+static __attribute__((noinline)) void stack_paint(void) {
+    volatile uint8_t area[PAINT_SIZE];
+    for (size_t i = 0; i < sizeof(area); i++) {
+        area[i] = PAINT_BYTE;
+    }
+    g_paint_bottom = (uintptr_t)area;
+}
+
+/** 
+ * @brief Find the deepest stack used by the console lines
+ * @param use_fmt true for fmt_snprintf(), false for snprintf()
+ * 
+ * @return the bytes used below the caller
+ */
+static __attribute__((noinline)) size_t stack_used(bool use_fmt) {
+    uint8_t *top = __builtin_frame_address(0);
+    char buf[96];
+
+    stack_paint();
+    volatile uint8_t *bottom = (volatile uint8_t *)g_paint_bottom;
+    format_lines(use_fmt, buf, sizeof(buf));
+
+    // Reads the stack below the frame, fine for a measurement on the host
+    size_t i = 0;
+    while (bottom + i < top && bottom[i] == PAINT_BYTE) {
+        i++;
+    }
+    return top - (bottom + i);
+}
+
+int main(void) {
+    printf("checking against snprintf\n");
+    check_integers();
+    check_fixed();
+    check_truncation();
+    printf("  %u failures\n", g_fails);
+
+    char buf[96];
+    printf("\nconsole lines (%zu characters)\n", format_lines(true, buf, sizeof(buf)));
+
+    // Once first so both start warm
+    time_lines(true);
+    time_lines(false);
+    double fmt_ns = time_lines(true);
+    double libc_ns = time_lines(false);
+    printf("  time  fmt_snprintf %.1f ns/char  snprintf %.1f ns/char (%.1fx)\n", fmt_ns, libc_ns,
+           libc_ns / fmt_ns);
+
+    size_t fmt_stack = stack_used(true);
+    size_t libc_stack = stack_used(false);
+    printf("  stack fmt_snprintf %zu bytes  snprintf %zu bytes\n", fmt_stack, libc_stack);
+
+    return g_fails ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+"""
+@file fmt_size.py
+@author Jack Duignan (JackpDuignan@gmail.com)
+@date 2025-06-22
+@brief Compare the flash used by fmt_snprintf() against newlib-nano snprintf() on the target
+
+Run by hand from the rocket_controller directory with:
+    python3 tools/fmt_size.py [arm-none-eabi-gcc]
+
+tools/fmt_bench.c measures speed and stack on the host, where only glibc is
+at hand. This is its flash step. The console lines of fmt_bench are built
+into small Cortex-M3 programs, linked with newlib-nano and --gc-sections as
+the firmware is:
+    - none: the same values written out without formatting
+    - fmt: fmt_snprintf(), %q for the fixed point values
+    - nano: newlib-nano snprintf(), the fixed point lines left out
+    - nano float: newlib-nano snprintf() with _printf_float and %.4f
+The text each adds over "none" is the flash the formatter costs.
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+## Flags of the firmware build (platformio.ini) for the STM32F103
+CFLAGS = ["-mcpu=cortex-m3", "-mthumb", "-Os", "-ffunction-sections", "-fdata-sections"]
+LDFLAGS = ["-Wl,--gc-sections", "--specs=nano.specs", "--specs=nosys.specs"]
+
+## The console lines of fmt_bench.c, {f} is the formatting call
+PROGRAM = r"""
+#include <stdint.h>
+#include <stdio.h>
+#include "fmt.h"
+
+volatile uint32_t v[8] = { 1234567, 42, 987654, 3, 123456, 65535, 0xdeadbeef, 7 };
+volatile int32_t q = 759250125;
+char buf[96];
+volatile size_t out;
+
+int main(void) {
+#if defined(NONE)
+    for (int i = 0; i < 8; i++) {
+        buf[i] = (char)v[i];
+    }
+    buf[8] = (char)q;
+#else
+    out += {f}(buf, sizeof(buf), "[%5u.%06u] phase %u at %u ms\r\n", v[0] / 1000000, v[0] % 1000000, v[7], v[2]);
+    out += {f}(buf, sizeof(buf), "%s %lu %lu %lu %lu\r\n", "acq", (unsigned long)v[2], (unsigned long)v[3],
+               (unsigned long)v[4], (unsigned long)v[5]);
+    out += {f}(buf, sizeof(buf), "i2c%d %lu error, address 0x%x\r\n", (int)v[7], (unsigned long)v[1], v[6]);
+#if defined(FMT)
+    out += fmt_snprintf(buf, sizeof(buf), "q: %.4q30 %.4q30\r\n", q, -q);
+#elif defined(FLOAT)
+    out += snprintf(buf, sizeof(buf), "q: %.4f %.4f\r\n", q / 1073741824.0, -q / 1073741824.0);
+#endif
+#endif
+    return 0;
+}
+"""
+
+## name, formatting call, define, extra sources, extra link flags
+VARIANTS = [
+    ("none", "snprintf", "NONE", [], []),
+    ("fmt", "fmt_snprintf", "FMT", [os.path.join("src", "fmt.c")], []),
+    ("nano", "snprintf", "NANO", [], []),
+    ("nano float", "snprintf", "FLOAT", [], ["-u", "_printf_float"]),
+]
+
+
+def text_size(gcc, elf):
+    """The text of a linked program from size"""
+    out = subprocess.run([gcc.replace("gcc", "size"), elf], check=True, capture_output=True, text=True).stdout
+    return int(out.splitlines()[1].split()[0])
+
+
+def main():
+    gcc = sys.argv[1] if len(sys.argv) > 1 else "arm-none-eabi-gcc"
+    sizes = {}
+    with tempfile.TemporaryDirectory() as tmp:
+        for name, call, define, sources, ldflags in VARIANTS:
+            src = os.path.join(tmp, "main.c")
+            with open(src, "w") as f:
+                f.write(PROGRAM.replace("{f}", call))
+            elf = os.path.join(tmp, define + ".elf")
+            subprocess.run([gcc] + CFLAGS + ["-D" + define, "-Iinclude", src] + sources
+                           + LDFLAGS + ldflags + ["-o", elf], check=True)
+            sizes[name] = text_size(gcc, elf)
+
+    print("%-12s %8s %8s" % ("", "text", "added"))
+    for name, _, _, _, _ in VARIANTS:
+        print("%-12s %8d %8d" % (name, sizes[name], sizes[name] - sizes["none"]))
+
+
+if __name__ == "__main__":
+    main()
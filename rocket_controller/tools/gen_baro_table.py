@@ -0,0 +1,187 @@
+"""
+@file gen_baro_table.py
+@author Jack Duignan (JackpDuignan@gmail.com)
+@date 2025-06-16
+@brief Generate the pressure to altitude lookup table in include/baro_alt_table.h
+
+Run by PlatformIO before every build (extra_scripts in platformio.ini), or by
+hand from the rocket_controller directory with:
+    python3 tools/gen_baro_table.py
+
+The table holds the standard atmosphere altitude in mm at evenly spaced
+pressures so the firmware can linearly interpolate instead of calling powf().
+Pressures are in the BMP588 units of Pa / 64 and the spacing is a power of
+two so the index and fraction are a shift and a mask.
+
+The altitude is convex in pressure so a straight line between two exact
+points always sits above the curve. Each point is lowered by half of the
+largest gap of its neighbouring segments, which roughly halves the maximum
+error.
+
+The generator checks the interpolation exactly as the firmware does it and
+writes the maximum error into the header. The file is only rewritten when
+its contents change so it does not force a rebuild.
+"""
+
+import math
+import os
+
+## Standard atmosphere constants, matching the old powf() conversion
+SEA_LEVEL_PA = 101325.0
+ALT_SCALE_M = 44330.0
+EXPONENT = 0.190295
+
+## Units of the pressure reading per Pa
+COUNTS_PER_PA = 64
+
+## Log2 of the table spacing in pressure counts, 2^15 counts = 512 Pa
+SHIFT = 15
+
+## Pressures the table must cover, about -700 m to 5500 m
+MIN_PA = 50000
+MAX_PA = 110000
+
+## Altitude range the error is documented for, m
+CHECK_MIN_M = 0
+CHECK_MAX_M = 3000
+
+## Pressure counts between error checks
+CHECK_STEP = 1
+
+
+def altitude_m(pa):
+    return ALT_SCALE_M * (1.0 - (pa / SEA_LEVEL_PA) ** EXPONENT)
+
+
+def pressure_pa(alt_m):
+    return SEA_LEVEL_PA * (1.0 - alt_m / ALT_SCALE_M) ** (1.0 / EXPONENT)
+
+
+def segment_sag(lo, hi):
+    """Largest distance from the chord of one segment down to the curve, m"""
+    h_lo = altitude_m(lo / COUNTS_PER_PA)
+    h_hi = altitude_m(hi / COUNTS_PER_PA)
+    worst = 0.0
+    for k in range(1, 64):
+        p = lo + (hi - lo) * k / 64
+        chord = h_lo + (h_hi - h_lo) * k / 64
+        worst = max(worst, chord - altitude_m(p / COUNTS_PER_PA))
+    return worst
+
+
+def build_table():
+    base_index = (MIN_PA * COUNTS_PER_PA) >> SHIFT
+    end_index = -((-MAX_PA * COUNTS_PER_PA) >> SHIFT)
+    base = base_index << SHIFT
+    step = 1 << SHIFT
+    points = [base + i * step for i in range(end_index - base_index + 1)]
+
+    sags = [segment_sag(points[i], points[i + 1]) for i in range(len(points) - 1)]
+    table = []
+    for i, p in enumerate(points):
+        near = sags[max(i - 1, 0):i + 1]
+        offset = max(near) / 2
+        table.append(round((altitude_m(p / COUNTS_PER_PA) - offset) * 1000))
+
+    return base, table
+
+
+def lookup_mm(base, table, pressure):
+    """The firmware interpolation, integer for integer"""
+    if pressure <= base:
+        return table[0]
+    offset = pressure - base
+    index = offset >> SHIFT
+    if index >= len(table) - 1:
+        return table[-1]
+    frac = offset & ((1 << SHIFT) - 1)
+    return table[index] + (((table[index + 1] - table[index]) * frac) >> SHIFT)
+
+
+def max_error_mm(base, table, lo_m, hi_m):
+    lo = int(pressure_pa(hi_m) * COUNTS_PER_PA)
+    hi = int(pressure_pa(lo_m) * COUNTS_PER_PA) + 1
+    worst = 0.0
+    for pressure in range(lo, hi + 1, CHECK_STEP):
+        exact = altitude_m(pressure / COUNTS_PER_PA) * 1000
+        worst = max(worst, abs(lookup_mm(base, table, pressure) - exact))
+    return worst
+
+
+def render(base, table):
+    err_range = max_error_mm(base, table, CHECK_MIN_M, CHECK_MAX_M)
+
+    lines = [
+        "/**",
+        " * @file baro_alt_table.h",
+        " * @author Jack Duignan (JackpDuignan@gmail.com)",
+        " * @date 2025-06-16",
+        " * @brief Pressure to altitude lookup table",
+        " *",
+        " * GENERATED by tools/gen_baro_table.py, do not edit.",
+        " *",
+        " * Standard atmosphere altitude in mm every %d Pa from %.0f Pa to %.0f Pa."
+        % ((1 << SHIFT) // COUNTS_PER_PA, base / COUNTS_PER_PA,
+           (base + (len(table) - 1) * (1 << SHIFT)) / COUNTS_PER_PA),
+        " * Maximum interpolation error against the exact formula is %.1f mm"
+        % err_range,
+        " * between %d m and %d m." % (CHECK_MIN_M, CHECK_MAX_M),
+        " */",
+        "",
+        "",
+        "#ifndef BARO_ALT_TABLE_H",
+        "#define BARO_ALT_TABLE_H",
+        "",
+        "",
+        "#include <stdint.h>",
+        "",
+        "/// Pressure of the first entry in Pa / 64",
+        "#define BARO_ALT_TABLE_BASE %dUL" % base,
+        "",
+        "/// Log2 of the spacing between entries in Pa / 64",
+        "#define BARO_ALT_TABLE_SHIFT %d" % SHIFT,
+        "",
+        "/// Number of entries",
+        "#define BARO_ALT_TABLE_LEN %d" % len(table),
+        "",
+        "/// Maximum error over %d m to %d m, mm" % (CHECK_MIN_M, CHECK_MAX_M),
+        "#define BARO_ALT_TABLE_MAX_ERROR_MM %d" % math.ceil(err_range),
+        "",
+        "/// Altitude in mm at each entry, highest altitude first",
+        "static const int32_t g_baro_alt_table[BARO_ALT_TABLE_LEN] = {",
+    ]
+    for i in range(0, len(table), 8):
+        lines.append("    " + " ".join("%d," % v for v in table[i:i + 8]))
+    lines += [
+        "};",
+        "",
+        "",
+        "#endif // BARO_ALT_TABLE_H",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def generate(project_dir):
+    path = os.path.join(project_dir, "include", "baro_alt_table.h")
+    base, table = build_table()
+    text = render(base, table)
+
+    try:
+        with open(path) as f:
+            if f.read() == text:
+                return
+    except OSError:
+        pass
+
+    with open(path, "w") as f:
+        f.write(text)
+    print("Generated " + path)
+
+
+try:
+    Import("env")  # noqa: F821, provided when run by PlatformIO
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
@@ -0,0 +1,219 @@
+"""
+@file gen_fifo_images.py
+@author Jack Duignan (JackpDuignan@gmail.com)
+@date 2025-06-25
+@brief Generate the LSM6DS3 FIFO images in test/host/fifo for test_lsm6ds3_fifo
+
+Run by hand from the rocket_controller directory with:
+    python3 tools/gen_fifo_images.py
+
+Each image is the run of SPI bursts the driver would read from the FIFO,
+four status bytes then the FIFO words, with the time each burst was read.
+The sensor is modelled as a queue of words in FIFO pattern order, gyro then
+accel for every slot and the sensor hub mag after the accel of every
+hub_dec'th slot. Every word carries its slot number so the test can tell
+which slot each parsed sample came from without a second model of the
+parser: gyro (slot, -slot, 1), accel (slot, 2, 3), mag (slot, 5, 7).
+
+The images cover reads that split slots and patterns across bursts, a
+backlog past the eight bits of FIFO_STATUS1, words lost to overruns, and
+bursts longer than the unread count including ones read from an empty
+FIFO. The random sizes come from a fixed seed so the files only change when
+this script does.
+
+File layout, all little endian:
+    header: "L6FI", u8 hub_dec, u8 0, u16 period_us, u32 samples, u32 resyncs,
+            u32 mags, u32 gaps, u32 bursts
+    burst:  u32 time_us, u16 len, len bytes of STATUS1..4 and FIFO words
+samples, mags and gaps are what the parser must give, a gap being a slot
+that does not follow the one before.
+"""
+
+import os
+import random
+import struct
+
+## Where the images go, relative to the rocket_controller directory
+OUT_DIR = os.path.join("test", "host", "fifo")
+
+## Matches LSM6DS3_PERIOD_US, 1666 Hz
+PERIOD_US = 1000000 // 1666
+
+## Time of slot 0
+T0_US = 1000000
+
+## Matches LSM6DS3_HUB_DEC
+HUB_DEC = 8
+
+## Largest burst the driver reads, LSM6DS3_BURST_WORDS
+MAX_BURST_WORDS = 16 * 2 * 3 + 16 // HUB_DEC * 3
+
+## FIFO size in words
+FIFO_WORDS = 2048
+
+## Value of words past the unread count
+STALE = 0x7FFF
+
+STATUS2_EMPTY = 0x10
+STATUS2_OVER_RUN = 0x40
+
+
+class Fifo:
+    """The sensor's FIFO and what the parser should make of it"""
+
+    def __init__(self, hub_dec):
+        self.hub_dec = hub_dec
+        self.pattern_len = hub_dec * 6 + 3 if hub_dec else 6
+        self.words = []             # (slot, value) in read order
+        self.read_pos = 0           # Pattern position of the next word to read
+        self.slot = 0               # Next slot to be taken
+        self.slot_words = {}        # Words of each slot not yet read
+        self.lost = set()           # Slots that lost a word
+        self.resyncs = 0
+        self.over_run = False
+        self.bursts = []
+
+    def take(self, slots):
+        """Store the next slots"""
+        for _ in range(slots):
+            s = self.slot
+            words = [s, -s, 1, s, 2, 3]
+            if self.hub_dec and s % self.hub_dec == 0:
+                words += [s, 5, 7]
+            for value in words:
+                self.words.append((s, value))
+            self.slot_words[s] = len(words)
+            self.slot += 1
+        if len(self.words) > FIFO_WORDS:
+            raise ValueError("FIFO overrun not modelled by take()")
+
+    def drop(self, count):
+        """Lose the oldest words, as an overrun does"""
+        if count % self.pattern_len == 0:
+            raise ValueError("a drop of whole patterns is not seen by the parser")
+        if count > len(self.words):
+            raise ValueError("cannot drop more words than the FIFO holds")
+        for s, _ in self.words[:count]:
+            self.lost.add(s)
+        del self.words[:count]
+        self.read_pos = (self.read_pos + count) % self.pattern_len
+        self.over_run = True
+        self.resyncs += 1
+
+    def burst(self, count, stale=0, empty_len=0):
+        """Read count words, with stale words after them"""
+        unread = len(self.words)
+        count = min(count, unread)
+        if stale and count < unread:
+            raise ValueError("stale words can only follow the last unread word")
+        status2 = (unread >> 8) & 0x07
+        if unread == 0:
+            status2 |= STATUS2_EMPTY
+            stale = max(stale, empty_len)
+        if self.over_run:
+            status2 |= STATUS2_OVER_RUN
+            self.over_run = False
+        block = bytes([unread & 0xFF, status2, self.read_pos & 0xFF, self.read_pos >> 8])
+
+        for s, value in self.words[:count]:
+            block += struct.pack("<h", value)
+            self.slot_words[s] -= 1
+        block += struct.pack("<h", STALE) * stale
+        del self.words[:count]
+        self.read_pos = (self.read_pos + count) % self.pattern_len
+
+        # Time stamped with the newest slot in the FIFO
+        time_us = T0_US + (self.slot - 1) * PERIOD_US
+        self.bursts.append((time_us, block))
+
+    def drain(self, rng, keep=0):
+        """Read random sized bursts until at most keep words are left"""
+        while len(self.words) > keep:
+            self.burst(rng.randint(1, MAX_BURST_WORDS))
+
+    def image(self):
+        """The image file contents"""
+        done = [s for s, left in self.slot_words.items() if left == 0 and s not in self.lost]
+        done.sort()
+        mags = sum(1 for s in done if self.hub_dec and s % self.hub_dec == 0)
+        gaps = sum(1 for a, b in zip(done, done[1:]) if b != a + 1)
+
+        data = struct.pack("<4sBBHIIIII", b"L6FI", self.hub_dec, 0, PERIOD_US, len(done),
+                           self.resyncs, mags, gaps, len(self.bursts))
+        for time_us, block in self.bursts:
+            data += struct.pack("<IH", time_us, len(block)) + block
+        return data
+
+
+def split(hub_dec, rng):
+    """Slots and patterns split across bursts of every size"""
+    fifo = Fifo(hub_dec)
+    for _ in range(300):
+        fifo.take(rng.randint(1, 20))
+        fifo.drain(rng, keep=60)
+    return fifo
+
+
+def backlog(rng):
+    """More unread words than FIFO_STATUS1 holds"""
+    fifo = Fifo(0)
+    fifo.take(300)
+    fifo.drain(rng)
+    fifo.take(330)
+    while fifo.words:
+        fifo.burst(MAX_BURST_WORDS)
+    return fifo
+
+
+def overrun(rng):
+    """Words lost from the front of the FIFO, a random count and one slot's worth"""
+    fifo = Fifo(HUB_DEC)
+    for i in range(200):
+        fifo.take(rng.randint(1, 20))
+        if i % 40 == 39:
+            fifo.drop(rng.randint(1, min(50, len(fifo.words))))
+        elif i % 40 == 19:
+            fifo.drop(6)
+        fifo.drain(rng, keep=60)
+    fifo.drain(rng)
+    return fifo
+
+
+def stale(rng):
+    """Bursts longer than the unread count, some from an empty FIFO"""
+    fifo = Fifo(HUB_DEC)
+    for i in range(200):
+        fifo.take(rng.randint(1, 20))
+        while fifo.words:
+            count = rng.randint(1, MAX_BURST_WORDS)
+            fifo.burst(count, stale=rng.randint(1, 12) if count >= len(fifo.words) else 0)
+        if i % 10 == 0:
+            fifo.burst(MAX_BURST_WORDS, empty_len=rng.randint(1, MAX_BURST_WORDS))
+    return fifo
+
+
+def write(name, fifo):
+    """Write an image if its contents changed"""
+    path = os.path.join(OUT_DIR, name)
+    data = fifo.image()
+    if os.path.exists(path):
+        with open(path, "rb") as f:
+            if f.read() == data:
+                return
+    with open(path, "wb") as f:
+        f.write(data)
+    print("wrote %s, %d bursts" % (path, len(fifo.bursts)))
+
+
+def main():
+    rng = random.Random(6)
+    os.makedirs(OUT_DIR, exist_ok=True)
+    write("split.bin", split(0, rng))
+    write("split_hub.bin", split(HUB_DEC, rng))
+    write("backlog.bin", backlog(rng))
+    write("overrun.bin", overrun(rng))
+    write("stale.bin", stale(rng))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,278 @@
+/** 
+ * @file i2c_bus_sim.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host tool that runs the magnetometer and barometer reads on the simulated I2C buses
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host/mock -no-pie -Wno-pointer-to-int-cast -o i2c_bus_sim
+ *         tools/i2c_bus_sim.c src/i2c_bus.c src/lis2mdl.c src/bmp588.c src/perf.c
+ *         test/host/mock/i2c_sim.c test/host/mock/mock_hw.c
+ *
+ * Usage:
+ *     i2c_bus_sim [-s seconds] [-i irq_ns]
+ *
+ * The LIS2MDL on I2C 1 and the BMP588 on I2C 2 are read at the rates of
+ * each flight phase, so both buses run at once as they do in flight. Each
+ * scenario is run twice: polled as acq_service() does by default, calling
+ * lis2mdl_poll() and bmp588_poll() from a 1 ms task a few times per sample
+ * period, and with lis2mdl_start_read() and bmp588_start_read() called the
+ * moment each sensor has new data, as the data ready interrupts do on boards
+ * that wire them. The tool sets the status register bit when a sample is
+ * taken and clears it when the sample is read.
+ *
+ * For each bus the transactions and bytes per second, the share
+ * of the bus in use, the time and interrupts per transaction and the
+ * longest an interrupt waited behind the other bus's are printed. Then the
+ * time both buses were busy at once, the CPU time the interrupt handlers
+ * took (irq_ns each), the time blocking reads would have spun for the same
+ * data, and the latency from new data to its handler.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "timebase.h"
+#include "slog.h"
+#include "i2c_bus.h"
+#include "lis2mdl.h"
+#include "bmp588.h"
+#include "i2c_sim.h"
+
+#define BMP588_ADDR 0x46
+
+/// Status registers and their new data bits
+#define LIS2MDL_REG_STATUS 0x67
+#define LIS2MDL_ZYXDA 0x08
+#define BMP588_REG_INT_STATUS 0x27
+#define BMP588_DRDY 0x01
+
+/// Period of the acq task and its status reads per sample period, as acq.c
+#define TASK_NS 1000000ULL
+#define POLLS_PER_PERIOD 4
+
+/// Default CPU time of one interrupt handler, about 150 cycles at 72 MHz
+#define IRQ_NS 2000
+
+/// Sensor rates of a flight phase
+typedef struct {
+    const char *name;
+    uint32_t mag_hz;
+    uint32_t baro_hz;
+} scenario_t;
+
+/// New data to handler latency of one sensor
+typedef struct {
+    uint64_t ready_ns;      ///< When the newest sample was taken
+    uint32_t samples;
+    uint64_t total_us;
+    uint32_t max_us;
+} latency_t;
+
+static uint8_t g_mag_regs[256];
+static uint8_t g_baro_regs[256];
+
+/// The engine's counters at the start of the scenario
+static i2c_stats_t g_base[I2C_NUM_BUSES];
+
+static latency_t g_mag_latency;
+static latency_t g_baro_latency;
+
+void timebase_init(void) {
+}
+
+uint64_t timebase_now_us(void) {
+    return i2c_sim_now_ns() / 1000;
+}
+
+uint32_t timebase_now_ms(void) {
+    return i2c_sim_now_ns() / 1000000;
+}
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+/** 
+ * @brief Add a sample to a latency
+ * @param latency the latency
+ * 
+ */
+static void latency_add(latency_t *latency) {
+    uint32_t us = (i2c_sim_now_ns() - latency->ready_ns) / 1000;
+
+    latency->samples++;
+    latency->total_us += us;
+    if (us > latency->max_us) {
+        latency->max_us = us;
+    }
+}
+
+static void mag_handler(const lis2mdl_sample_t *sample) {
+    (void)sample;
+    g_mag_regs[LIS2MDL_REG_STATUS] &= ~LIS2MDL_ZYXDA;
+    latency_add(&g_mag_latency);
+}
+
+static void baro_handler(const bmp588_sample_t *sample) {
+    (void)sample;
+    g_baro_regs[BMP588_REG_INT_STATUS] &= ~BMP588_DRDY;
+    latency_add(&g_baro_latency);
+}
+
+/** 
+ * @brief Print the line of one bus
+ * @param name the bus name
+ * @param bus the bus
+ * @param seconds the simulated time
+ * 
+ */
+static void print_bus(const char *name, i2c_bus_t bus, uint32_t seconds) {
+    i2c_stats_t stats;
+    i2c_sim_stats_t sim;
+
+    i2c_get_stats(bus, &stats);
+    i2c_sim_get_stats(bus, &sim);
+    stats.txns -= g_base[bus].txns;
+    stats.bytes -= g_base[bus].bytes;
+    uint32_t txns = stats.txns ? stats.txns : 1;
+
+    printf("  %-6s %8.1f %8.2f %6.2f%% %8.1f %8.1f %9.1f\n", name, (double)stats.txns / seconds,
+           stats.bytes / 1024.0 / seconds, 100.0 * sim.busy_ns / (seconds * 1e9), sim.busy_ns / 1000.0 / txns,
+           (double)sim.irqs / txns, sim.irq_wait_max_ns / 1000.0);
+}
+
+/** 
+ * @brief Run a scenario and print its results
+ * @param scenario the rates
+ * @param polled true to poll the status registers, false to read as data
+ * is ready
+ * @param seconds the simulated time
+ * @param irq_ns the CPU time of one interrupt handler
+ * 
+ */
+static void run(const scenario_t *scenario, bool polled, uint32_t seconds, uint32_t irq_ns) {
+    uint64_t mag_period = 1000000000ULL / scenario->mag_hz;
+    uint64_t baro_period = 1000000000ULL / scenario->baro_hz;
+    uint64_t end = (uint64_t)seconds * 1000000000ULL;
+    // The sensors are not in step with the task
+    uint64_t next_mag = 300000;
+    uint64_t next_baro = 700000;
+    uint64_t next_task = 0;
+    uint64_t mag_polled = 0;
+    uint64_t baro_polled = 0;
+    uint32_t missed = 0;
+
+    i2c_sim_reset(irq_ns);
+    i2c_sim_add_device(I2C_BUS_1, LIS2MDL_ADDR, g_mag_regs);
+    i2c_sim_add_device(I2C_BUS_2, BMP588_ADDR, g_baro_regs);
+    i2c_bus_init(I2C_BUS_1);
+    i2c_bus_init(I2C_BUS_2);
+    i2c_get_stats(I2C_BUS_1, &g_base[I2C_BUS_1]);
+    i2c_get_stats(I2C_BUS_2, &g_base[I2C_BUS_2]);
+    memset(&g_mag_latency, 0, sizeof(g_mag_latency));
+    memset(&g_baro_latency, 0, sizeof(g_baro_latency));
+    g_mag_regs[LIS2MDL_REG_STATUS] = 0;
+    g_baro_regs[BMP588_REG_INT_STATUS] = 0;
+
+    while (next_mag < end || next_baro < end) {
+        uint64_t next = next_mag < next_baro ? next_mag : next_baro;
+        if (polled && next_task < next) {
+            next = next_task;
+        }
+
+        i2c_sim_run_until(next);
+        if (next == next_mag) {
+            g_mag_regs[LIS2MDL_REG_STATUS] |= LIS2MDL_ZYXDA;
+            g_mag_latency.ready_ns = next;
+            if (!polled) {
+                missed += !lis2mdl_start_read();
+            }
+            next_mag += mag_period;
+        }
+        if (next == next_baro) {
+            g_baro_regs[BMP588_REG_INT_STATUS] |= BMP588_DRDY;
+            g_baro_latency.ready_ns = next;
+            if (!polled) {
+                missed += !bmp588_start_read();
+            }
+            next_baro += baro_period;
+        }
+        if (polled && next == next_task) {
+            if (next - mag_polled >= mag_period / POLLS_PER_PERIOD) {
+                mag_polled = next;
+                lis2mdl_poll();
+            }
+            if (next - baro_polled >= baro_period / POLLS_PER_PERIOD) {
+                baro_polled = next;
+                bmp588_poll();
+            }
+            next_task += TASK_NS;
+        }
+    }
+    i2c_sim_run_until(end);
+
+    i2c_sim_stats_t sim1;
+    i2c_sim_stats_t sim2;
+    i2c_sim_get_stats(I2C_BUS_1, &sim1);
+    i2c_sim_get_stats(I2C_BUS_2, &sim2);
+
+    printf("%s, %s: mag %u Hz, baro %u Hz\n", scenario->name, polled ? "polled" : "data ready lines",
+           scenario->mag_hz, scenario->baro_hz);
+    print_bus("I2C 1", I2C_BUS_1, seconds);
+    print_bus("I2C 2", I2C_BUS_2, seconds);
+    printf("  both buses busy %.1f us/s, interrupts %.1f us/s of CPU, blocking reads would spin %.1f us/s\n",
+           i2c_sim_overlap_ns() / 1000.0 / seconds, i2c_sim_cpu_ns() / 1000.0 / seconds,
+           (sim1.busy_ns + sim2.busy_ns) / 1000.0 / seconds);
+    printf("  new data to handler: mag %.1f us (max %u), baro %.1f us (max %u), %u reads refused\n",
+           (double)g_mag_latency.total_us / (g_mag_latency.samples ? g_mag_latency.samples : 1),
+           g_mag_latency.max_us,
+           (double)g_baro_latency.total_us / (g_baro_latency.samples ? g_baro_latency.samples : 1),
+           g_baro_latency.max_us, missed);
+}
+
+int main(int argc, char **argv) {
+    static const scenario_t scenarios[] = {
+        { "pad", 10, 10 },
+        { "flight", LIS2MDL_ODR_HZ, BMP588_ODR_HZ },
+        { "flight, baro matched", LIS2MDL_ODR_HZ, LIS2MDL_ODR_HZ },
+    };
+    uint32_t seconds = 10;
+    uint32_t irq_ns = IRQ_NS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:i:")) != -1) {
+        switch (opt) {
+        case 's':
+            seconds = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            irq_ns = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds] [-i irq_ns]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds == 0) {
+        fprintf(stderr, "seconds must not be 0\n");
+        return 2;
+    }
+
+    lis2mdl_set_handler(mag_handler);
+    bmp588_set_handler(baro_handler);
+
+    printf("%u s simulated per scenario, %u ns per interrupt\n", seconds, irq_ns);
+    printf("  %-6s %8s %8s %7s %8s %8s %9s\n", "bus", "txns/s", "KB/s", "busy", "us/txn", "irq/txn",
+           "wait_us");
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        run(&scenarios[i], true, seconds, irq_ns);
+        run(&scenarios[i], false, seconds, irq_ns);
+    }
+    return 0;
+}
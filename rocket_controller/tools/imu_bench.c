@@ -0,0 +1,150 @@
+/** 
+ * @file imu_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host tool that measures the LSM6DS3 FIFO read path against the simulated sensor
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host/mock -o imu_bench tools/imu_bench.c
+ *         src/lsm6ds3.c test/host/mock/lsm6ds3_sim.c
+ *
+ * Usage:
+ *     imu_bench [-s seconds] [-k spi_khz]
+ *
+ * For every rate, with and without the sensor hub, and for acq task periods
+ * of 1, 2, 5 and 10 ms the driver is run as acq_service() runs it: parse a
+ * finished block then check the FIFO level with lsm6ds3_poll(). Reported are
+ * the samples delivered, the FIFO words lost to overruns, the bursts and SPI bytes per second, the
+ * share of the bus in use, the time the CPU spends in the blocking level
+ * checks, the highest FIFO level and the oldest a sample was when it was
+ * parsed. Only one burst is started per check, so the task must run at
+ * least once per burst of LSM6DS3_BURST_SLOTS slots.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "timebase.h"
+#include "slog.h"
+#include "lsm6ds3.h"
+#include "lsm6ds3_sim.h"
+
+/// Bytes clocked by one blocking register read
+#define REG_READ_BYTES 2
+
+void timebase_init(void) {
+}
+
+uint64_t timebase_now_us(void) {
+    return lsm6ds3_sim_now();
+}
+
+uint32_t timebase_now_ms(void) {
+    return lsm6ds3_sim_now() / 1000;
+}
+
+void slog_write(slog_id_t id, uint32_t a0, uint32_t a1, uint32_t a2) {
+    (void)id; (void)a0; (void)a1; (void)a2;
+}
+
+/** 
+ * @brief Run the driver and print one line of results
+ * @param odr the rate
+ * @param hub true to read the sensor hub too
+ * @param task_us the acq task period
+ * @param seconds the simulated time
+ * @param spi_hz the SPI clock
+ * 
+ */
+static void bench(lsm6ds3_odr_t odr, bool hub, uint32_t task_us, uint32_t seconds, uint32_t spi_hz) {
+    lsm6ds3_sample_t samples[LSM6DS3_MAX_SAMPLES];
+    lsm6ds3_stats_t base;
+    lsm6ds3_stats_t stats;
+    lsm6ds3_sim_stats_t sim;
+    uint32_t delivered = 0;
+    uint64_t max_age = 0;
+
+    lsm6ds3_sim_reset(spi_hz);
+    if (lsm6ds3_init() != 0) {
+        printf("init failed\n");
+        exit(1);
+    }
+    if (hub) {
+        lsm6ds3_enable_hub(0x1e, 0x68);
+    }
+    lsm6ds3_set_odr(odr);
+    lsm6ds3_get_stats(&base);
+    lsm6ds3_sim_get_stats(&sim);
+    uint32_t reg_reads = sim.reg_reads;
+
+    for (uint64_t t = 0; t < (uint64_t)seconds * 1000000; t += task_us) {
+        lsm6ds3_sim_advance(task_us);
+
+        size_t n = lsm6ds3_read(samples, LSM6DS3_MAX_SAMPLES);
+        for (size_t i = 0; i < n; i++) {
+            uint32_t slot = lsm6ds3_sim_slot_of(samples[i].gyro);
+            uint64_t age = lsm6ds3_sim_now() - lsm6ds3_sim_slot_time(slot);
+            if (age > max_age) {
+                max_age = age;
+            }
+            delivered++;
+        }
+
+        lsm6ds3_poll();
+    }
+
+    lsm6ds3_get_stats(&stats);
+    lsm6ds3_sim_get_stats(&sim);
+    // The blocking reads move the clock on too
+    double elapsed = lsm6ds3_sim_now() / 1e6;
+    double bus_share = 100.0 * sim.bus_ns / (elapsed * 1e9);
+    uint64_t check_ns = (uint64_t)(sim.reg_reads - reg_reads) * REG_READ_BYTES * 8 * 1000000000ULL / spi_hz;
+    uint32_t hz = (LSM6DS3_ODR_HZ + 1) >> (LSM6DS3_ODR_1666HZ - odr);
+
+    printf("%5u %4s %5.1f %9.1f %7u %9.1f %9.2f %6.2f%% %9.1f %6u %8.2f\n", hz, hub ? "on" : "off",
+           task_us / 1000.0, delivered / elapsed, sim.overrun_words,
+           (stats.bursts - base.bursts) / elapsed, sim.burst_bytes / 1024.0 / elapsed, bus_share,
+           check_ns / 1000.0 / elapsed, sim.max_level, max_age / 1000.0);
+}
+
+int main(int argc, char **argv) {
+    static const lsm6ds3_odr_t odrs[] = { LSM6DS3_ODR_416HZ, LSM6DS3_ODR_833HZ, LSM6DS3_ODR_1666HZ };
+    static const uint32_t tasks_us[] = { 1000, 2000, 5000, 10000 };
+    uint32_t seconds = 20;
+    uint32_t spi_hz = LSM6DS3_SIM_SPI_HZ;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:k:")) != -1) {
+        switch (opt) {
+        case 's':
+            seconds = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            spi_hz = strtoul(optarg, NULL, 0) * 1000;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds] [-k spi_khz]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (seconds == 0 || spi_hz == 0) {
+        fprintf(stderr, "seconds and spi_khz must not be 0\n");
+        return 2;
+    }
+
+    printf("%u s simulated per line, SPI at %u kHz\n", seconds, spi_hz / 1000);
+    printf("%5s %4s %5s %9s %7s %9s %9s %7s %9s %6s %8s\n", "odr", "hub", "task", "samples/s", "lost_w",
+           "bursts/s", "KB/s", "bus", "poll_us/s", "level", "age_ms");
+    for (size_t o = 0; o < sizeof(odrs) / sizeof(odrs[0]); o++) {
+        for (int hub = 0; hub < 2; hub++) {
+            for (size_t t = 0; t < sizeof(tasks_us) / sizeof(tasks_us[0]); t++) {
+                bench(odrs[o], hub, tasks_us[t], seconds, spi_hz);
+            }
+        }
+    }
+    return 0;
+}
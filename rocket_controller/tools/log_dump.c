@@ -0,0 +1,389 @@
+/** 
+ * @file log_dump.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-20
+ * @brief Host tool that downloads a flight with /bin/dump
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o log_dump tools/log_dump.c src/frame.c
+ *
+ * Usage:
+ *     log_dump [-r] [-f flight] /dev/ttyACM0 /dev/ttyACM1 flight.bin
+ *
+ * The shell port (the first) is sent /bin/dump, the flight comes over the
+ * telemetry port (the second) and is written to the image as raw flight
+ * log data (decode it with telem_decode). Telemetry frames on the port are
+ * skipped and do not count as the device answering. Blocks are asked
+ * for a window at a time, any block that is skipped or fails its CRC is
+ * asked for again and everything outstanding is asked for again after a
+ * timeout. With -r an existing image is resumed: its last full block is
+ * fetched again and checked so an image of another flight is not extended.
+ *
+ * The protocol is described in dump.h.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dump.h"
+#include "frame.h"
+
+/// Time without a frame before everything outstanding is asked for again
+#define TIMEOUT_MS 500
+
+/// Timeouts in a row before giving up
+#define MAX_TIMEOUTS 10
+
+/// Time to wait for the device to answer /bin/dump
+#define START_TIMEOUT_MS 2000
+
+/// Time given to the device to end a download left running
+#define END_WAIT_MS 100
+
+#define READ_FRAME_TIMEOUT (-2)
+
+/// The telemetry port
+static int g_tty;
+
+/// Blocks asked for and not yet seen, in the order the device sends them
+static uint32_t g_fifo[DUMP_MAX_REQS];
+static unsigned g_fifo_head = 0;
+static unsigned g_fifo_len = 0;
+
+static unsigned long g_bad_frames = 0;
+static unsigned long g_resent = 0;
+
+/** 
+ * @brief Get the time
+ * 
+ * @return seconds from an arbitrary start
+ */
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** 
+ * @brief Write all of a buffer to the port
+ * @param data the data
+ * @param len the length of the data
+ * 
+ */
+static void tty_write(const void *data, size_t len) {
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = write(g_tty, p, len);
+        if (n <= 0) {
+            perror("write");
+            exit(1);
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+/** 
+ * @brief Send a message to the device
+ * @param type the message type
+ * @param payload the payload
+ * @param len the length of the payload
+ * 
+ */
+static void send_msg(dump_msg_t type, const void *payload, size_t len) {
+    uint8_t frame[FRAME_MAX_SIZE(sizeof(dump_req_t))];
+    tty_write(frame, frame_encode(type, payload, len, frame));
+}
+
+/** 
+ * @brief Ask for a run of blocks and note them as outstanding
+ * @param block the first block
+ * @param count the number of blocks
+ * @param block_size the size of a block
+ * 
+ */
+static void request(uint32_t block, uint16_t count, uint16_t block_size) {
+    dump_req_t req = { .offset = block * block_size, .count = count };
+    send_msg(DUMP_MSG_REQ, &req, sizeof(req));
+    for (uint16_t i = 0; i < count; i++) {
+        g_fifo[(g_fifo_head + g_fifo_len++) % DUMP_MAX_REQS] = block + i;
+    }
+}
+
+/** 
+ * @brief Read the next frame
+ * @param timeout_ms the longest to wait, 0 to only take what has arrived
+ * @param type set to the frame type
+ * @param payload set to the payload
+ * 
+ * @return the length of the payload or READ_FRAME_TIMEOUT
+ */
+static int read_frame(int timeout_ms, uint8_t *type, uint8_t **payload) {
+    static uint8_t buf[4096];
+    static size_t buf_len = 0, buf_pos = 0;
+    static uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    static size_t frame_len = 0;
+    static bool overflow = false;
+
+    while (true) {
+        while (buf_pos < buf_len) {
+            uint8_t ch = buf[buf_pos++];
+            if (ch != 0) {
+                if (frame_len < sizeof(frame)) {
+                    frame[frame_len++] = ch;
+                } else {
+                    overflow = true;
+                }
+                continue;
+            }
+
+            int len = (frame_len && !overflow) ? frame_decode(frame, frame_len, type, payload) : -1;
+            if (len < 0 && frame_len) {
+                g_bad_frames++;
+            }
+            frame_len = 0;
+            overflow = false;
+            if (len >= 0) {
+                return len;
+            }
+        }
+
+        struct pollfd pfd = { .fd = g_tty, .events = POLLIN };
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            return READ_FRAME_TIMEOUT;
+        }
+        ssize_t n = read(g_tty, buf, sizeof(buf));
+        if (n <= 0) {
+            perror("read");
+            exit(1);
+        }
+        buf_len = n;
+        buf_pos = 0;
+    }
+}
+
+/** 
+ * @brief Read the next frame of the download, skipping telemetry
+ * @param deadline the time to give up at, from now_s()
+ * @param type set to the frame type
+ * @param payload set to the payload
+ * 
+ * @return the length of the payload or READ_FRAME_TIMEOUT
+ */
+static int read_dump_frame(double deadline, uint8_t *type, uint8_t **payload) {
+    while (true) {
+        double left_ms = (deadline - now_s()) * 1000;
+        int len = read_frame(left_ms > 0 ? (int)left_ms : 0, type, payload);
+        if (len == READ_FRAME_TIMEOUT || (*type >= DUMP_MSG_INFO && *type <= DUMP_MSG_END)) {
+            return len;
+        }
+    }
+}
+
+/** 
+ * @brief Open a port in raw mode
+ * @param path the port
+ * 
+ * @return the file descriptor
+ */
+static int tty_open(const char *path) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+int main(int argc, char *argv[]) {
+    bool resume = false;
+    int flight = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rf:")) != -1) {
+        if (opt == 'r') {
+            resume = true;
+        } else if (opt == 'f') {
+            flight = atoi(optarg);
+        } else {
+            optind = argc;
+            break;
+        }
+    }
+    if (argc - optind != 3) {
+        fprintf(stderr, "usage: %s [-r] [-f flight] shell_tty telem_tty image\n", argv[0]);
+        return 1;
+    }
+    const char *image_path = argv[optind + 2];
+
+    int shell = tty_open(argv[optind]);
+    g_tty = tty_open(argv[optind + 1]);
+
+    // End a download that was left running and give the device time to
+    // see it before asking for ours on the shell
+    uint8_t delim = 0;
+    tty_write(&delim, 1);
+    send_msg(DUMP_MSG_END, NULL, 0);
+    usleep(END_WAIT_MS * 1000);
+
+    char cmd[32];
+    int cmd_len = snprintf(cmd, sizeof(cmd), "\n/bin/dump %d\n", flight);
+    if (write(shell, cmd, cmd_len) != cmd_len) {
+        perror("write");
+        return 1;
+    }
+
+    uint8_t type;
+    uint8_t *payload;
+    int len;
+    double start = now_s();
+    do {
+        len = read_dump_frame(start + START_TIMEOUT_MS / 1e3, &type, &payload);
+    } while (len >= 0 && !(type == DUMP_MSG_INFO && len == sizeof(dump_info_t)));
+    if (len < 0) {
+        fprintf(stderr, "no answer, check the flight exists (cat /var/log/flight_%d) and the telemetry port\n",
+                flight);
+        return 1;
+    }
+    dump_info_t info;
+    memcpy(&info, payload, sizeof(info));
+    uint16_t bs = info.block_size;
+    uint32_t total = (info.len + bs - 1) / bs;
+    fprintf(stderr, "flight %d: seq %u, %u bytes\n", flight, info.seq, info.len);
+
+    int image = open(image_path, O_RDWR | O_CREAT | (resume ? 0 : O_TRUNC), 0644);
+    if (image < 0) {
+        perror(image_path);
+        return 1;
+    }
+
+    // Fetch the last full block again to check the image is of this flight
+    uint32_t next = 0;
+    int64_t check_block = -1;
+    struct stat st;
+    if (resume && fstat(image, &st) == 0 && st.st_size >= bs) {
+        next = st.st_size / bs - 1;
+        if (next >= total) {
+            next = total - 1;
+        }
+        check_block = next;
+        fprintf(stderr, "resuming at %u bytes\n", (next + 1) * bs);
+    }
+
+    uint8_t *got = calloc(total ? total : 1, 1);
+    uint32_t done = next;
+    int timeouts = 0;
+    start = now_s();
+    double last_data = start;
+
+    while (done < total) {
+        // Keep the window full
+        while (g_fifo_len < DUMP_MAX_REQS && next < total) {
+            uint32_t count = DUMP_MAX_REQS - g_fifo_len;
+            if (count > total - next) {
+                count = total - next;
+            }
+            request(next, count, bs);
+            next += count;
+        }
+
+        // Timed from the last block, the telemetry does not hold it off
+        len = read_dump_frame(last_data + TIMEOUT_MS / 1e3, &type, &payload);
+        if (len == READ_FRAME_TIMEOUT) {
+            if (++timeouts > MAX_TIMEOUTS) {
+                fprintf(stderr, "device stopped answering\n");
+                return 1;
+            }
+
+            // Clear what the device holds and ask for it all again
+            dump_req_t clear = { 0, 0 };
+            send_msg(DUMP_MSG_REQ, &clear, sizeof(clear));
+            unsigned count = g_fifo_len;
+            g_fifo_len = 0;
+            for (unsigned i = 0; i < count; i++) {
+                request(g_fifo[(g_fifo_head + i) % DUMP_MAX_REQS], 1, bs);
+                g_resent++;
+            }
+            last_data = now_s();
+            continue;
+        }
+        if (type != DUMP_MSG_DATA || len < (int)sizeof(uint32_t) || len > (int)sizeof(dump_data_t)) {
+            continue;
+        }
+        timeouts = 0;
+        last_data = now_s();
+
+        dump_data_t block;
+        memcpy(&block, payload, len);
+        uint32_t b = block.offset / bs;
+        size_t n = len - sizeof(block.offset);
+
+        // Blocks come in the order asked for, any passed over were lost
+        unsigned pos = 0;
+        while (pos < g_fifo_len && g_fifo[(g_fifo_head + pos) % DUMP_MAX_REQS] != b) {
+            pos++;
+        }
+        if (pos == g_fifo_len) {
+            continue;
+        }
+        for (unsigned i = 0; i <= pos; i++) {
+            uint32_t lost = g_fifo[g_fifo_head];
+            g_fifo_head = (g_fifo_head + 1) % DUMP_MAX_REQS;
+            g_fifo_len--;
+            if (lost != b && !got[lost]) {
+                request(lost, 1, bs);
+                g_resent++;
+            }
+        }
+
+        if (got[b]) {
+            continue;
+        }
+        if ((int64_t)b == check_block) {
+            uint8_t old[DUMP_BLOCK_SIZE];
+            if (pread(image, old, n, block.offset) != (ssize_t)n || memcmp(old, block.data, n) != 0) {
+                fprintf(stderr, "the image is not of this flight, not resuming\n");
+                send_msg(DUMP_MSG_END, NULL, 0);
+                return 1;
+            }
+        } else if (pwrite(image, block.data, n, block.offset) != (ssize_t)n) {
+            perror(image_path);
+            return 1;
+        }
+        got[b] = 1;
+        done++;
+    }
+
+    send_msg(DUMP_MSG_END, NULL, 0);
+    if (ftruncate(image, info.len) != 0) {
+        perror(image_path);
+    }
+    close(image);
+
+    double secs = now_s() - start;
+    double bytes = info.len - (double)(check_block + 1) * bs;
+    fprintf(stderr, "%.0f bytes in %.2f s, %.3f MB/s, %lu blocks sent again, %lu bad frames\n",
+            bytes, secs, secs > 0 ? bytes / secs / 1e6 : 0.0, g_resent, g_bad_frames);
+
+    free(got);
+    close(g_tty);
+    close(shell);
+    return 0;
+}
@@ -0,0 +1,339 @@
+/** 
+ * @file logpack_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-19
+ * @brief Host tool that measures the packed flight log encoding
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o logpack_bench tools/logpack_bench.c src/logpack.c src/frame.c -lm
+ *
+ * Usage:
+ *     logpack_bench capture.bin
+ *     logpack_bench
+ *
+ * The records of a telemetry capture (or a flight log dump, packed blocks
+ * are expanded first) are replayed through the encoder. Without a file a
+ * flight is made up: each phase at the logging rates from phase.c with
+ * sensor noise, spin and jittered timestamps.
+ *
+ * The size of the log as one frame per record is compared against packed
+ * blocks, every block is decoded again and checked against its records,
+ * and the encode time per record is printed. It is host nanoseconds, the
+ * encoder runs on the target inside the acquisition task.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "frame.h"
+#include "logpack.h"
+#include "telem.h"
+
+#define PI 3.14159265358979
+
+/// Most records held
+#define MAX_RECORDS 2000000
+
+/// Times the records are encoded when timing
+#define TIMING_PASSES 20
+
+/// A record as history holds it
+typedef struct {
+    uint8_t type;
+    uint8_t len;
+    union {
+        telem_imu_t imu;
+        telem_mag_t mag;
+        telem_baro_t baro;
+    } rec;
+} bench_rec_t;
+
+static bench_rec_t *g_recs;
+static size_t g_count = 0;
+
+/// Checking of decoded blocks against the records that went in
+static size_t g_check_pos;
+static size_t g_mismatches = 0;
+
+/** 
+ * @brief Add a record
+ * @param type the record type
+ * @param rec the record
+ * @param len the size of the record
+ * 
+ */
+static void add_record(telem_rec_type_t type, const void *rec, size_t len) {
+    if (g_count == MAX_RECORDS || len > sizeof(g_recs[0].rec)) {
+        return;
+    }
+    g_recs[g_count].type = type;
+    g_recs[g_count].len = len;
+    memcpy(&g_recs[g_count].rec, rec, len);
+    g_count++;
+}
+
+/** 
+ * @brief Add a record from a packed block
+ * 
+ */
+static void add_packed(telem_rec_type_t type, const void *rec, size_t len, void *ctx) {
+    (void)ctx;
+    add_record(type, rec, len);
+}
+
+/** 
+ * @brief Read the records of a capture
+ * @param path the capture
+ * 
+ * @return true if it could be read
+ */
+static bool load_capture(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return false;
+    }
+
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    size_t frame_len = 0;
+    int ch;
+    while ((ch = fgetc(in)) != EOF) {
+        if (ch != 0) {
+            if (frame_len < sizeof(frame)) {
+                frame[frame_len++] = ch;
+            }
+            continue;
+        }
+
+        uint8_t type;
+        uint8_t *payload;
+        int len = frame_len ? frame_decode(frame, frame_len, &type, &payload) : -1;
+        if (len >= 0 && type == TELEM_REC_PACKED) {
+            logpack_decode(payload, len, add_packed, NULL);
+        } else if (len >= 0 && type < LOGPACK_NUM_TYPES) {
+            add_record(type, payload, len);
+        }
+        frame_len = 0;
+    }
+
+    fclose(in);
+    return true;
+}
+
+/** 
+ * @brief Get a normally distributed random number
+ * 
+ * @return the number, standard deviation 1
+ */
+static double noise(void) {
+    static uint32_t state = 0x12345678;
+    double sum = 0;
+
+    // Sum of uniforms is close enough to normal
+    for (int i = 0; i < 12; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        sum += state / 4294967296.0;
+    }
+    return sum - 6;
+}
+
+/** 
+ * @brief Make up a flight
+ * 
+ */
+static void synth_flight(void) {
+    /// Phase length and logging rates: IMU (the logger tap, 1/4 of the
+    /// sensor), mag, baro
+    static const struct {
+        double secs;
+        double imu_hz, mag_hz, baro_hz;
+    } phases[] = {
+        { 10, 104, 10, 10 },        // pad
+        { 3, 416.5, 100, 50 },      // boost
+        { 20, 208.25, 100, 50 },    // coast
+        { 3, 416.5, 100, 50 },      // apogee
+        { 60, 52, 20, 25 },         // descent
+    };
+
+    // Counts per unit: accel 16 g, gyro 2000 dps, mag 1.5 mG
+    const double per_g = 2048, per_dps = 14.29, per_mg = 0.667;
+
+    double t0 = 0;
+    double burnout = 0;
+    double h = 0, v = 0;
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+        double next_imu = t0, next_mag = t0, next_baro = t0;
+        double end = t0 + phases[p].secs;
+        double dt = 1e-4;
+        if (p == 2) {
+            burnout = t0;
+        }
+
+        for (double t = t0; t < end; t += dt) {
+            double a = 9.81;        // acceleration felt, m/s^2
+            double spin = 0;        // roll rate, dps
+            double vib = 0;         // vibration left after the filters, g
+            if (p == 1) {
+                a = 90;
+                spin = 360 * (t - t0);
+                vib = 0.3;
+            } else if (p == 2 || p == 3) {
+                a = -0.0015 * v * fabs(v);
+                spin = 1080 * exp(-(t - burnout) / 8);
+            } else if (p == 4) {
+                spin = 20;
+            }
+
+            // Under the parachute the descent rate is steady
+            if (p == 4) {
+                v = -8;
+            } else if (p != 0) {
+                v += (a - 9.81) * dt;
+            }
+            h += v * dt;
+
+            uint32_t time_us = (uint32_t)(t * 1e6);
+            if (t >= next_imu) {
+                telem_imu_t imu;
+                imu.time_us = (uint32_t)(next_imu * 1e6);
+                imu.accel[0] = lround(per_g * vib * noise() + 4 * noise());
+                imu.accel[1] = lround(per_g * vib * noise() + 4 * noise());
+                imu.accel[2] = lround(per_g * a / 9.81 + per_g * vib * noise() + 4 * noise());
+                imu.gyro[0] = lround(3 * noise() + per_dps * 2 * sin(t));
+                imu.gyro[1] = lround(3 * noise() + per_dps * 2 * cos(t));
+                imu.gyro[2] = lround(per_dps * spin + 3 * noise());
+                add_record(TELEM_REC_IMU, &imu, sizeof(imu));
+                next_imu += 1 / phases[p].imu_hz;
+            }
+            if (t >= next_mag) {
+                double angle = 0.5 * spin * (t - t0) * PI / 180;
+                telem_mag_t mag;
+                mag.time_us = time_us + lround(20 * noise());
+                mag.mag[0] = lround(per_mg * 250 * cos(angle) + 2 * noise());
+                mag.mag[1] = lround(per_mg * 250 * sin(angle) + 2 * noise());
+                mag.mag[2] = lround(per_mg * -450 + 2 * noise());
+                add_record(TELEM_REC_MAG, &mag, sizeof(mag));
+                next_mag += 1 / phases[p].mag_hz;
+            }
+            if (t >= next_baro) {
+                telem_baro_t baro;
+                double pa = 101325 * pow(1 - 2.25577e-5 * h, 5.25588);
+                baro.time_us = time_us + lround(20 * noise());
+                baro.pressure = lround((pa + noise()) * 64);
+                baro.temperature = lround((20 - 0.0065 * h + 0.01 * noise()) * 65536);
+                add_record(TELEM_REC_BARO, &baro, sizeof(baro));
+                next_baro += 1 / phases[p].baro_hz;
+            }
+        }
+        t0 = end;
+    }
+}
+
+/** 
+ * @brief Check a decoded record against the next one that went in
+ * 
+ */
+static void check_record(telem_rec_type_t type, const void *rec, size_t len, void *ctx) {
+    (void)ctx;
+    const bench_rec_t *want = &g_recs[g_check_pos++];
+    if (want->type != type || want->len != len || memcmp(&want->rec, rec, len) != 0) {
+        g_mismatches++;
+    }
+}
+
+/** 
+ * @brief Encode every record as the flight log would hold it
+ * @param raw_bytes set to the size as one frame per record
+ * @param packed_bytes set to the size as packed blocks
+ * @param blocks set to the number of blocks
+ * 
+ */
+static void measure_size(size_t *raw_bytes, size_t *packed_bytes, size_t *blocks) {
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    logpack_t pack;
+    size_t first = 0;
+
+    *raw_bytes = 0;
+    *packed_bytes = 0;
+    *blocks = 0;
+    logpack_init(&pack);
+
+    for (size_t i = 0; i <= g_count; i++) {
+        if (i < g_count) {
+            *raw_bytes += frame_encode(g_recs[i].type, &g_recs[i].rec, g_recs[i].len, frame);
+            if (logpack_add(&pack, g_recs[i].type, &g_recs[i].rec, g_recs[i].len)) {
+                continue;
+            }
+        }
+        if (pack.len == 0) {
+            break;
+        }
+
+        // The block is full (or the records ran out), write and check it
+        *packed_bytes += frame_encode(TELEM_REC_PACKED, pack.buf, pack.len, frame);
+        (*blocks)++;
+        g_check_pos = first;
+        if (logpack_decode(pack.buf, pack.len, check_record, NULL) != (int)(i - first)) {
+            g_mismatches++;
+        }
+        first = i;
+        logpack_init(&pack);
+        if (i < g_count) {
+            i--;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    g_recs = malloc(MAX_RECORDS * sizeof(g_recs[0]));
+    if (g_recs == NULL) {
+        return 1;
+    }
+
+    if (argc > 1) {
+        if (!load_capture(argv[1])) {
+            return 1;
+        }
+    } else {
+        synth_flight();
+    }
+    if (g_count == 0) {
+        fprintf(stderr, "no records\n");
+        return 1;
+    }
+
+    size_t raw_bytes, packed_bytes, blocks;
+    measure_size(&raw_bytes, &packed_bytes, &blocks);
+    printf("%zu records, %zu blocks, %.1f records per block\n",
+           g_count, blocks, (double)g_count / blocks);
+    printf("frame per record %zu bytes, packed %zu bytes, ratio %.2f\n",
+           raw_bytes, packed_bytes, (double)raw_bytes / packed_bytes);
+    printf("%.2f bytes per record, %zu mismatches\n", (double)packed_bytes / g_count, g_mismatches);
+
+    logpack_t pack;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int pass = 0; pass < TIMING_PASSES; pass++) {
+        logpack_init(&pack);
+        for (size_t i = 0; i < g_count; i++) {
+            if (!logpack_add(&pack, g_recs[i].type, &g_recs[i].rec, g_recs[i].len)) {
+                logpack_init(&pack);
+                logpack_add(&pack, g_recs[i].type, &g_recs[i].rec, g_recs[i].len);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%.1f ns per record encoded\n", ns / ((double)TIMING_PASSES * g_count));
+
+    free(g_recs);
+    return g_mismatches ? 1 : 0;
+}
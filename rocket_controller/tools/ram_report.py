@@ -0,0 +1,90 @@
+"""
+@file ram_report.py
+@author Jack Duignan (JackpDuignan@gmail.com)
+@date 2025-06-25
+@brief Report the static RAM use of the firmware and check the stack has room
+
+Run by PlatformIO after every link (extra_scripts in platformio.ini), or by
+hand from the rocket_controller directory with:
+    python3 tools/ram_report.py .pio/build/genericSTM32F103C8/firmware.elf [ram_bytes]
+
+The linker only fails once .data and .bss no longer fit at all, but the
+stack grows down into whatever they leave and nothing checks it. This
+prints the .data and .bss totals against the RAM of the part, what is left
+for the stack, and the largest variables so the next cut is easy to find.
+The build fails if less than MIN_STACK bytes are left.
+"""
+
+import os
+import subprocess
+import sys
+
+## Least RAM that must be left for the main stack and the interrupt frames
+MIN_STACK = 2048
+
+## Variables listed
+TOP = 15
+
+## RAM of the STM32F103C8 when not given
+DEFAULT_RAM = 20 * 1024
+
+
+def sections(size_tool, elf):
+    """Sizes of the sections from size -A"""
+    out = subprocess.run([size_tool, "-A", elf], check=True, capture_output=True, text=True).stdout
+    result = {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0].startswith(".") and fields[1].isdigit():
+            result[fields[0]] = int(fields[1])
+    return result
+
+
+def variables(nm_tool, elf):
+    """(size, name) of every variable in RAM, largest first"""
+    out = subprocess.run([nm_tool, "-S", "--size-sort", "-t", "d", elf],
+                         check=True, capture_output=True, text=True).stdout
+    result = []
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] in "bBdD":
+            result.append((int(fields[1]), fields[3]))
+    result.sort(reverse=True)
+    return result
+
+
+def report(elf, ram, size_tool, nm_tool):
+    """Print the report, returns 1 if the stack is left too little room"""
+    sizes = sections(size_tool, elf)
+    data = sizes.get(".data", 0)
+    bss = sizes.get(".bss", 0)
+    left = ram - data - bss
+
+    print("RAM %d B: .data %d B, .bss %d B, %d B left for the stack (%d B needed)"
+          % (ram, data, bss, left, MIN_STACK))
+    for size, name in variables(nm_tool, elf)[:TOP]:
+        print("  %6d %s" % (size, name))
+
+    if left < MIN_STACK:
+        print("ram_report: only %d B left for the stack" % left)
+        return 1
+    return 0
+
+
+def post_link(source, target, env):
+    """PlatformIO post action on the linked elf"""
+    cc = env.subst("$CC")
+    ram = int(env.BoardConfig().get("upload.maximum_ram_size", DEFAULT_RAM))
+    return report(target[0].get_abspath(), ram, cc.replace("gcc", "size"), cc.replace("gcc", "nm"))
+
+
+try:
+    Import("env")  # noqa: F821, provided when run by PlatformIO
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", post_link)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        if len(sys.argv) < 2:
+            print("usage: %s firmware.elf [ram_bytes]" % os.path.basename(sys.argv[0]))
+            sys.exit(2)
+        sys.exit(report(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_RAM,
+                        "arm-none-eabi-size", "arm-none-eabi-nm"))
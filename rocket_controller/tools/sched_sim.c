@@ -0,0 +1,224 @@
+/** 
+ * @file sched_sim.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-24
+ * @brief Host tool that runs the scheduler on a simulated clock and reports jitter
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host/mock -o sched_sim tools/sched_sim.c src/sched.c
+ *         test/host/mock/mock_hw.c -lm
+ *
+ * Usage:
+ *     sched_sim [-s seconds] [-x load] [-r seed]
+ *
+ * The tasks of main.c are added with the same periods and priorities but
+ * their bodies only move the simulated clock on by a modelled run time,
+ * scaled by load (1.0 by default). The clock stands still otherwise, and
+ * when no task is ready sched_host_wait() moves it to the next SysTick as
+ * wfi would. For every task the time from its release to its start is
+ * collected, and the mean, 99th percentile and worst are reported with the
+ * spread of the start to start interval. The scheduler's own counters are
+ * printed alongside as a check that they agree.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "timebase.h"
+#include "sched.h"
+
+/// Wake up from wfi and the SysTick handler
+#define WAKE_US 2
+
+/// Latency histogram of 1 us bins
+#define HIST_BINS 20000
+
+/// A modelled task
+typedef struct {
+    const char *name;
+    uint32_t period_ms;
+    uint8_t priority;
+    uint32_t base_us;       ///< Shortest run
+    uint32_t spread_us;     ///< Extra run time, uniform
+    uint32_t slow_one_in;   ///< How often a slow run happens
+    uint32_t slow_us;       ///< Extra time of a slow run
+    int id;
+    // Measured
+    uint64_t release;
+    uint64_t last_start;
+    uint32_t runs;
+    uint32_t missed;
+    uint64_t latency_sum;
+    uint32_t latency_max;
+    uint32_t hist[HIST_BINS];
+    double interval_sum;
+    double interval_sq_sum;
+    uint32_t interval_min;
+    uint32_t interval_max;
+} sim_task_t;
+
+/// Run times are a guess at the firmware at the boost rates: acquisition
+/// with the odd FIFO burst, the log task with the odd page program, the
+/// shell with the odd file being formatted
+static sim_task_t g_sim_tasks[] = {
+    { .name = "acq", .period_ms = 1, .priority = SCHED_PRIO_HIGHEST,
+      .base_us = 60, .spread_us = 120, .slow_one_in = 50, .slow_us = 350 },
+    { .name = "log", .period_ms = 1, .priority = 2,
+      .base_us = 20, .spread_us = 60, .slow_one_in = 8, .slow_us = 250 },
+    { .name = "cli", .period_ms = 1, .priority = SCHED_PRIO_LOWEST,
+      .base_us = 15, .spread_us = 40, .slow_one_in = 200, .slow_us = 1500 },
+};
+
+#define SIM_NUM_TASKS (sizeof(g_sim_tasks) / sizeof(g_sim_tasks[0]))
+
+static uint64_t g_now_us = 0;
+static uint64_t g_end_us = 0;
+static uint64_t g_idle_us = 0;
+static double g_load = 1.0;
+
+void timebase_init(void) {
+}
+
+uint64_t timebase_now_us(void) {
+    return g_now_us;
+}
+
+uint32_t timebase_now_ms(void) {
+    return g_now_us / 1000;
+}
+
+/** 
+ * @brief Print the results and stop
+ * 
+ */
+static void report(void) {
+    printf("%-4s %8s %7s %8s %8s %8s %9s %9s %9s | %8s %8s %8s\n", "task", "runs", "missed", "mean_us",
+           "p99_us", "max_us", "ivl_sd_us", "ivl_min", "ivl_max", "overruns", "max_late", "max_run");
+
+    for (size_t i = 0; i < SIM_NUM_TASKS; i++) {
+        sim_task_t *t = &g_sim_tasks[i];
+        sched_stats_t stats;
+        sched_get_stats(t->id, &stats);
+
+        uint32_t p99 = 0;
+        uint32_t seen = 0;
+        for (uint32_t b = 0; b < HIST_BINS; b++) {
+            seen += t->hist[b];
+            if (seen * 100ULL >= t->runs * 99ULL) {
+                p99 = b;
+                break;
+            }
+        }
+
+        uint32_t n = t->runs - 1;
+        double mean = t->interval_sum / n;
+        double sd = sqrt(t->interval_sq_sum / n - mean * mean);
+        printf("%-4s %8u %7u %8.1f %8u %8u %9.1f %9u %9u | %8lu %8lu %8lu\n", t->name, t->runs, t->missed,
+               (double)t->latency_sum / t->runs, p99, t->latency_max, sd, t->interval_min, t->interval_max,
+               (unsigned long)stats.overruns, (unsigned long)stats.max_latency, (unsigned long)stats.max_runtime);
+    }
+    printf("idle %.1f%%\n", 100.0 * g_idle_us / g_now_us);
+    exit(0);
+}
+
+void sched_host_wait(void) {
+    if (g_now_us >= g_end_us) {
+        report();
+    }
+    uint64_t wait = 1000 - g_now_us % 1000 + WAKE_US;
+    g_now_us += wait;
+    g_idle_us += wait;
+}
+
+/** 
+ * @brief Model a run of a task
+ * @param t the task
+ * 
+ */
+static void sim_run(sim_task_t *t) {
+    uint64_t start = g_now_us;
+    uint32_t period = t->period_ms * 1000;
+
+    uint32_t latency = start - t->release;
+    t->latency_sum += latency;
+    if (latency > t->latency_max) {
+        t->latency_max = latency;
+    }
+    t->hist[latency < HIST_BINS ? latency : HIST_BINS - 1]++;
+
+    if (t->runs > 0) {
+        uint32_t interval = start - t->last_start;
+        t->interval_sum += interval;
+        t->interval_sq_sum += (double)interval * interval;
+        if (t->runs == 1 || interval < t->interval_min) {
+            t->interval_min = interval;
+        }
+        if (interval > t->interval_max) {
+            t->interval_max = interval;
+        }
+    }
+    t->last_start = start;
+    t->runs++;
+
+    uint32_t run = t->base_us + rand() % (t->spread_us + 1);
+    if (rand() % t->slow_one_in == 0) {
+        run += t->slow_us;
+    }
+    g_now_us += (uint64_t)(run * g_load);
+
+    // As the scheduler moves the release on
+    t->release += period;
+    while (t->release + period < g_now_us) {
+        t->release += period;
+        t->missed++;
+    }
+
+    if (g_now_us >= g_end_us) {
+        report();
+    }
+}
+
+static void sim_acq(void) { sim_run(&g_sim_tasks[0]); }
+static void sim_log(void) { sim_run(&g_sim_tasks[1]); }
+static void sim_cli(void) { sim_run(&g_sim_tasks[2]); }
+
+static const sched_task_fn_t g_sim_fns[SIM_NUM_TASKS] = { sim_acq, sim_log, sim_cli };
+
+int main(int argc, char **argv) {
+    uint32_t seconds = 60;
+    unsigned seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:x:r:")) != -1) {
+        switch (opt) {
+        case 's':
+            seconds = strtoul(optarg, NULL, 0);
+            break;
+        case 'x':
+            g_load = strtod(optarg, NULL);
+            break;
+        case 'r':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds] [-x load] [-r seed]\n", argv[0]);
+            return 2;
+        }
+    }
+    srand(seed);
+    g_end_us = (uint64_t)seconds * 1000000;
+
+    printf("%u s simulated, run times x%.2f\n", seconds, g_load);
+    sched_init();
+    for (size_t i = 0; i < SIM_NUM_TASKS; i++) {
+        sim_task_t *t = &g_sim_tasks[i];
+        t->id = sched_add_periodic(t->name, g_sim_fns[i], t->period_ms, 0, t->priority);
+        t->release = g_now_us;
+    }
+    sched_run();
+}
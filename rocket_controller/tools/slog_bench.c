@@ -0,0 +1,122 @@
+/** 
+ * @file slog_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-21
+ * @brief Host tool that measures the cost of a system log message against formatting it
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host/mock -o slog_bench tools/slog_bench.c src/slog.c
+ *         src/slog_fmt.c src/fmt.c src/frame.c test/host/mock/mock_hw.c
+ *
+ * Usage:
+ *     slog_bench
+ *
+ * The same messages are logged with SLOG(), and formatted into a line with
+ * the time, as the syslog reader prints them, with fmt_snprintf() and with
+ * the C library snprintf(). The first is what the firmware pays where the
+ * message is logged, the others what an immediate format would cost there.
+ * slog_format() is the cost moved to the reader.
+ *
+ * Times are host nanoseconds per message over many calls, so the clock is
+ * read only around the loop. The clock slog_write() reads is a counter
+ * here, on the target it is the SysTick read of timebase_now_us().
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "flight_log.h"
+#include "fmt.h"
+#include "slog.h"
+
+/// Messages timed per method
+#define PASSES 2000000
+
+/// Stand-in for the clock
+static uint64_t g_now_us = 0;
+
+/// Keeps the output from being optimised away
+static volatile uint32_t g_sink;
+
+uint64_t timebase_now_us(void) {
+    return g_now_us += 10;
+}
+
+bool flight_log_recording(void) {
+    return false;
+}
+
+size_t flight_log_write(const void *data, size_t len) {
+    (void)data;
+    return len;
+}
+
+size_t flight_log_space(void) {
+    return 0;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void log_slog(uint32_t i) {
+    SLOG(SLOG_I2C_ERROR, i & 1, 0x1e);
+}
+
+static void log_fmt(uint32_t i) {
+    char line[SLOG_LINE_MAX];
+    uint32_t time_us = (uint32_t)timebase_now_us();
+    g_sink = fmt_snprintf(line, sizeof(line), "[%5u.%06u] i2c%u error, address 0x%x\r\n",
+                          (unsigned)(time_us / 1000000), (unsigned)(time_us % 1000000), (unsigned)(i & 1), 0x1eu);
+}
+
+static void log_snprintf(uint32_t i) {
+    char line[SLOG_LINE_MAX];
+    uint32_t time_us = (uint32_t)timebase_now_us();
+    g_sink = snprintf(line, sizeof(line), "[%5u.%06u] i2c%u error, address 0x%x\r\n",
+                      (unsigned)(time_us / 1000000), (unsigned)(time_us % 1000000), (unsigned)(i & 1), 0x1eu);
+}
+
+static void read_slog_format(uint32_t i) {
+    char line[SLOG_LINE_MAX];
+    slog_rec_t rec = { 0 };
+    rec.id = SLOG_I2C_ERROR;
+    rec.args[0] = i & 1;
+    rec.args[1] = 0x1e;
+    g_sink = slog_format(&rec, SLOG_REC_LEN(2), line, sizeof(line));
+}
+
+/** 
+ * @brief Time one method
+ * @param method logs or formats one message
+ * 
+ * @return the time per message in ns
+ */
+static double time_ns(void (*method)(uint32_t)) {
+    double start = now_s();
+    for (uint32_t i = 0; i < PASSES; i++) {
+        method(i);
+    }
+
+    return (now_s() - start) * 1e9 / PASSES;
+}
+
+int main(void) {
+    printf("ns per message, %u messages\n", PASSES);
+    printf("%-28s %8.1f\n", "SLOG()", time_ns(log_slog));
+    printf("%-28s %8.1f\n", "fmt_snprintf() of the line", time_ns(log_fmt));
+    printf("%-28s %8.1f\n", "snprintf() of the line", time_ns(log_snprintf));
+    printf("%-28s %8.1f\n", "slog_format() when read", time_ns(read_slog_format));
+
+    slog_stats_t stats;
+    slog_get_stats(&stats);
+    printf("%lu written, %lu lost from the full ring\n", (unsigned long)stats.writes, (unsigned long)stats.lost);
+
+    return 0;
+}
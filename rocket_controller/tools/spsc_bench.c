@@ -0,0 +1,227 @@
+/** 
+ * @file spsc_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host tool that compares the spsc.h queue against the CBUF.h macros
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o spsc_bench tools/spsc_bench.c
+ *
+ * Usage:
+ *     spsc_bench
+ *
+ * A batch of records is pushed and then popped, over and over, through a
+ * 16 entry CBUF.h ring a record at a time and through an spsc.h queue a
+ * record at a time, in batches with push_n()/pop_n() and in place with the
+ * spans. It is done for bytes, as usb_cdc and history use CBUF.h, and for
+ * a 16 byte record the size of a telemetry sample, as acq uses spsc.h.
+ *
+ * Times are host nanoseconds per record pushed and popped, from one thread.
+ * The spsc.h barriers are a full fence on the host but a dmb on the target,
+ * so the host overstates what they cost. test/host/test_spsc.c covers the
+ * queue from two threads.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "CBUF.h"
+#include "spsc.h"
+
+/// Records pushed then popped per round, half the ring
+#define BATCH 8
+
+/// Rounds timed per method
+#define ROUNDS 2000000
+
+/// A record the size of a telemetry sample
+typedef struct {
+    uint32_t time_us;
+    int16_t data[6];
+} rec_t;
+
+SPSC_DECLARE(byte_queue, uint8_t, 16)
+SPSC_DECLARE(rec_queue, rec_t, 16)
+
+static struct {
+    volatile uint8_t m_get_idx;
+    volatile uint8_t m_put_idx;
+    uint8_t m_entry[16];
+} g_byte_cbuf;
+
+static struct {
+    volatile uint8_t m_get_idx;
+    volatile uint8_t m_put_idx;
+    rec_t m_entry[16];
+} g_rec_cbuf;
+
+static byte_queue_t g_byte_queue;
+static rec_queue_t g_rec_queue;
+
+/// Keeps what is popped from being optimised away
+static volatile uint32_t g_sink;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** 
+ * @brief Time rounds of one method
+ * @param round pushes then pops BATCH records
+ * 
+ * @return the time per record in ns
+ */
+static double time_ns(void (*round)(uint32_t)) {
+    double start = now_s();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        round(i);
+    }
+
+    return (now_s() - start) * 1e9 / ((double)ROUNDS * BATCH);
+}
+
+static void byte_cbuf(uint32_t i) {
+    uint32_t sum = 0;
+    for (int k = 0; k < BATCH; k++) {
+        if (CBUF_Space(g_byte_cbuf) != 0) {
+            CBUF_Push(g_byte_cbuf, (uint8_t)(i + k));
+        }
+    }
+    while (!CBUF_IsEmpty(g_byte_cbuf)) {
+        sum += CBUF_Pop(g_byte_cbuf);
+    }
+    g_sink = sum;
+}
+
+static void byte_spsc(uint32_t i) {
+    uint32_t sum = 0;
+    uint8_t b;
+    for (int k = 0; k < BATCH; k++) {
+        b = i + k;
+        byte_queue_push(&g_byte_queue, &b);
+    }
+    while (byte_queue_pop(&g_byte_queue, &b)) {
+        sum += b;
+    }
+    g_sink = sum;
+}
+
+static void byte_spsc_n(uint32_t i) {
+    uint8_t batch[BATCH];
+    for (int k = 0; k < BATCH; k++) {
+        batch[k] = i + k;
+    }
+    byte_queue_push_n(&g_byte_queue, batch, BATCH);
+    size_t n = byte_queue_pop_n(&g_byte_queue, batch, BATCH);
+    g_sink = batch[0] + batch[n - 1];
+}
+
+static void byte_spsc_span(uint32_t i) {
+    uint32_t sum = 0;
+    int k = 0;
+    while (k < BATCH) {
+        uint8_t *wspan;
+        size_t n = byte_queue_write_span(&g_byte_queue, &wspan);
+        n = n < (size_t)(BATCH - k) ? n : (size_t)(BATCH - k);
+        for (size_t j = 0; j < n; j++) {
+            wspan[j] = i + k + j;
+        }
+        byte_queue_commit(&g_byte_queue, n);
+        k += n;
+    }
+    const uint8_t *rspan;
+    size_t n;
+    while ((n = byte_queue_read_span(&g_byte_queue, &rspan)) != 0) {
+        for (size_t j = 0; j < n; j++) {
+            sum += rspan[j];
+        }
+        byte_queue_release(&g_byte_queue, n);
+    }
+    g_sink = sum;
+}
+
+static void rec_cbuf(uint32_t i) {
+    uint32_t sum = 0;
+    rec_t rec = { 0 };
+    for (int k = 0; k < BATCH; k++) {
+        rec.time_us = i + k;
+        if (CBUF_Space(g_rec_cbuf) != 0) {
+            CBUF_Push(g_rec_cbuf, rec);
+        }
+    }
+    while (!CBUF_IsEmpty(g_rec_cbuf)) {
+        rec = CBUF_Pop(g_rec_cbuf);
+        sum += rec.time_us;
+    }
+    g_sink = sum;
+}
+
+static void rec_spsc(uint32_t i) {
+    uint32_t sum = 0;
+    rec_t rec = { 0 };
+    for (int k = 0; k < BATCH; k++) {
+        rec.time_us = i + k;
+        rec_queue_push(&g_rec_queue, &rec);
+    }
+    while (rec_queue_pop(&g_rec_queue, &rec)) {
+        sum += rec.time_us;
+    }
+    g_sink = sum;
+}
+
+static void rec_spsc_n(uint32_t i) {
+    rec_t batch[BATCH] = { 0 };
+    for (int k = 0; k < BATCH; k++) {
+        batch[k].time_us = i + k;
+    }
+    rec_queue_push_n(&g_rec_queue, batch, BATCH);
+    size_t n = rec_queue_pop_n(&g_rec_queue, batch, BATCH);
+    g_sink = batch[0].time_us + batch[n - 1].time_us;
+}
+
+static void rec_spsc_span(uint32_t i) {
+    uint32_t sum = 0;
+    int k = 0;
+    while (k < BATCH) {
+        rec_t *wspan;
+        size_t n = rec_queue_write_span(&g_rec_queue, &wspan);
+        n = n < (size_t)(BATCH - k) ? n : (size_t)(BATCH - k);
+        for (size_t j = 0; j < n; j++) {
+            memset(&wspan[j], 0, sizeof(rec_t));
+            wspan[j].time_us = i + k + j;
+        }
+        rec_queue_commit(&g_rec_queue, n);
+        k += n;
+    }
+    const rec_t *rspan;
+    size_t n;
+    while ((n = rec_queue_read_span(&g_rec_queue, &rspan)) != 0) {
+        for (size_t j = 0; j < n; j++) {
+            sum += rspan[j].time_us;
+        }
+        rec_queue_release(&g_rec_queue, n);
+    }
+    g_sink = sum;
+}
+
+int main(void) {
+    CBUF_Init(g_byte_cbuf);
+    CBUF_Init(g_rec_cbuf);
+    byte_queue_init(&g_byte_queue);
+    rec_queue_init(&g_rec_queue);
+
+    printf("%u records pushed then popped per round, ns per record\n", BATCH);
+    printf("%-20s %10s %10s\n", "", "bytes", "16 B recs");
+    printf("%-20s %10.2f %10.2f\n", "CBUF.h", time_ns(byte_cbuf), time_ns(rec_cbuf));
+    printf("%-20s %10.2f %10.2f\n", "spsc.h push/pop", time_ns(byte_spsc), time_ns(rec_spsc));
+    printf("%-20s %10.2f %10.2f\n", "spsc.h push_n/pop_n", time_ns(byte_spsc_n), time_ns(rec_spsc_n));
+    printf("%-20s %10.2f %10.2f\n", "spsc.h spans", time_ns(byte_spsc_span), time_ns(rec_spsc_span));
+
+    return 0;
+}
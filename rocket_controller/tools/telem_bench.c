@@ -0,0 +1,285 @@
+/** 
+ * @file telem_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-25
+ * @brief Host tool that measures telemetry records sent as CSV text against frames
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o telem_bench tools/telem_bench.c src/frame.c src/fmt.c
+ *
+ * Usage:
+ *     telem_bench [-n records]
+ *
+ * The same records, in the mix the boost phase sends (16 IMU to 1 mag and
+ * 1 baro, see phase.h), are turned into CSV lines with fmt_snprintf() as
+ * the firmware would format them, and into frames with frame_encode() as
+ * telem_send() does. The lines hold raw counts as the frames do, there is no
+ * float formatting on the target. Then each stream is read back, the CSV
+ * with strtol() and the frames with frame_decode() as tools/telem_decode
+ * does, and every record is checked.
+ *
+ * Rates are host records per second, the M3 is many times slower but the
+ * ratio between the paths is what carries over. The bytes per record are
+ * exact and set the rate a link of a given speed can carry.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fmt.h"
+#include "frame.h"
+#include "telem.h"
+
+/// Records when not given
+#define DEFAULT_RECORDS 2000000
+
+/// Records in one repeat of the boost mix
+#define MIX_LEN 18
+
+/// Longest CSV line
+#define LINE_MAX 64
+
+/// A record of any type
+typedef struct {
+    telem_rec_type_t type;
+    union {
+        telem_imu_t imu;
+        telem_mag_t mag;
+        telem_baro_t baro;
+    };
+} rec_t;
+
+/// Keeps results from being optimised away
+static volatile uint32_t g_sink;
+
+static uint32_t g_rand = 0x9E3779B9;
+
+static uint32_t rnd(void) {
+    g_rand ^= g_rand << 13;
+    g_rand ^= g_rand >> 17;
+    g_rand ^= g_rand << 5;
+    return g_rand;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/** 
+ * @brief Make a record with sensor-like values
+ * @param rec the record
+ * @param i its number, the mix position is taken from it
+ * 
+ */
+static void rec_make(rec_t *rec, uint32_t i) {
+    uint32_t time_us = i * 600;
+    uint32_t pos = i % MIX_LEN;
+
+    memset(rec, 0, sizeof(*rec));
+    if (pos == 0) {
+        rec->type = TELEM_REC_MAG;
+        rec->mag.time_us = time_us;
+        for (int j = 0; j < 3; j++) {
+            rec->mag.mag[j] = (int16_t)(rnd() % 2000) - 1000;
+        }
+    } else if (pos == 1) {
+        rec->type = TELEM_REC_BARO;
+        rec->baro.time_us = time_us;
+        rec->baro.pressure = 6400000 + rnd() % 64000;
+        rec->baro.temperature = 1500000 + rnd() % 65536;
+    } else {
+        rec->type = TELEM_REC_IMU;
+        rec->imu.time_us = time_us;
+        for (int j = 0; j < 3; j++) {
+            rec->imu.accel[j] = (int16_t)rnd();
+            rec->imu.gyro[j] = (int16_t)(rnd() % 4000) - 2000;
+        }
+    }
+}
+
+/** 
+ * @brief Format a record as a CSV line, with the columns of telem_decode
+ * @param rec the record
+ * @param line the buffer, LINE_MAX bytes
+ * 
+ * @return the line length
+ */
+static size_t csv_encode(const rec_t *rec, char *line) {
+    // The records are packed, fields are copied out as the firmware would
+    uint32_t time_us;
+    int16_t v[6];
+    switch (rec->type) {
+    case TELEM_REC_IMU:
+        time_us = rec->imu.time_us;
+        memcpy(v, rec->imu.accel, sizeof(v));
+        return fmt_snprintf(line, LINE_MAX, "imu,%lu,%d,%d,%d,%d,%d,%d\n", (unsigned long)time_us,
+                            v[0], v[1], v[2], v[3], v[4], v[5]);
+    case TELEM_REC_MAG:
+        time_us = rec->mag.time_us;
+        memcpy(v, rec->mag.mag, 3 * sizeof(int16_t));
+        return fmt_snprintf(line, LINE_MAX, "mag,%lu,%d,%d,%d\n", (unsigned long)time_us, v[0], v[1], v[2]);
+    default:
+        return fmt_snprintf(line, LINE_MAX, "baro,%lu,%lu,%ld\n", (unsigned long)rec->baro.time_us,
+                            (unsigned long)rec->baro.pressure, (long)rec->baro.temperature);
+    }
+}
+
+/** 
+ * @brief Read a CSV line back into a record
+ * @param line the line, up to and without its newline
+ * @param rec the record
+ * 
+ * @return true if the line was understood
+ */
+static bool csv_decode(const char *line, rec_t *rec) {
+    long v[7];
+    int n = 0;
+    const char *p = strchr(line, ',');
+
+    while (p != NULL && *p == ',' && n < 7) {
+        char *end;
+        v[n++] = strtol(p + 1, &end, 10);
+        p = end;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    if (strncmp(line, "imu", 3) == 0 && n == 7) {
+        rec->type = TELEM_REC_IMU;
+        rec->imu.time_us = v[0];
+        for (int j = 0; j < 3; j++) {
+            rec->imu.accel[j] = v[1 + j];
+            rec->imu.gyro[j] = v[4 + j];
+        }
+    } else if (strncmp(line, "mag", 3) == 0 && n == 4) {
+        rec->type = TELEM_REC_MAG;
+        rec->mag.time_us = v[0];
+        for (int j = 0; j < 3; j++) {
+            rec->mag.mag[j] = v[1 + j];
+        }
+    } else if (strncmp(line, "baro", 4) == 0 && n == 3) {
+        rec->type = TELEM_REC_BARO;
+        rec->baro.time_us = v[0];
+        rec->baro.pressure = v[1];
+        rec->baro.temperature = v[2];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/** 
+ * @brief Get the size of a record's payload
+ * @param rec the record
+ * 
+ * @return the size in bytes
+ */
+static size_t rec_len(const rec_t *rec) {
+    switch (rec->type) {
+    case TELEM_REC_IMU:
+        return sizeof(telem_imu_t);
+    case TELEM_REC_MAG:
+        return sizeof(telem_mag_t);
+    default:
+        return sizeof(telem_baro_t);
+    }
+}
+
+/** 
+ * @brief Check a decoded record against the one sent
+ * @param got the decoded record
+ * @param want the record sent
+ * 
+ * @return true if they match
+ */
+static bool rec_equal(const rec_t *got, const rec_t *want) {
+    return got->type == want->type && memcmp(&got->imu, &want->imu, rec_len(want)) == 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t count = DEFAULT_RECORDS;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') {
+            count = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n records]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    rec_t *recs = malloc(count * sizeof(rec_t));
+    char *csv = malloc((size_t)count * LINE_MAX);
+    uint8_t *frames = malloc((size_t)count * FRAME_MAX_SIZE(sizeof(telem_imu_t)) /* the largest record */);
+    if (recs == NULL || csv == NULL || frames == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        rec_make(&recs[i], i);
+    }
+
+    // Encode, as the firmware would
+    double start = now_s();
+    size_t csv_bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        csv_bytes += csv_encode(&recs[i], &csv[csv_bytes]);
+    }
+    double csv_encode_s = now_s() - start;
+
+    start = now_s();
+    size_t frame_bytes = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        frame_bytes += frame_encode(recs[i].type, &recs[i].imu, rec_len(&recs[i]), &frames[frame_bytes]);
+    }
+    double frame_encode_s = now_s() - start;
+
+    // Decode, as the host does
+    uint32_t csv_bad = 0;
+    uint32_t n = 0;
+    start = now_s();
+    for (char *line = csv; line < &csv[csv_bytes]; n++) {
+        char *end = memchr(line, '\n', &csv[csv_bytes] - line);
+        *end = 0;
+        rec_t rec;
+        csv_bad += n >= count || !csv_decode(line, &rec) || !rec_equal(&rec, &recs[n]);
+        line = end + 1;
+    }
+    double csv_decode_s = now_s() - start;
+    csv_bad += n != count;
+
+    uint32_t frame_bad = 0;
+    n = 0;
+    start = now_s();
+    for (uint8_t *frame = frames; frame < &frames[frame_bytes]; n++) {
+        uint8_t *end = memchr(frame, 0, &frames[frame_bytes] - frame);
+        uint8_t type;
+        uint8_t *payload;
+        int len = frame_decode(frame, end - frame, &type, &payload);
+        frame_bad += n >= count || len != (int)rec_len(&recs[n]) || type != recs[n].type
+                     || memcmp(payload, &recs[n].imu, len) != 0;
+        frame = end + 1;
+    }
+    double frame_decode_s = now_s() - start;
+    frame_bad += n != count;
+    g_sink = csv_bad + frame_bad;
+
+    printf("%u records, 16 imu : 1 mag : 1 baro\n", count);
+    printf("%-8s %10s %14s %14s %8s\n", "", "B/record", "encode rec/s", "decode rec/s", "errors");
+    printf("%-8s %10.2f %14.0f %14.0f %8u\n", "csv", (double)csv_bytes / count, count / csv_encode_s,
+           count / csv_decode_s, csv_bad);
+    printf("%-8s %10.2f %14.0f %14.0f %8u\n", "frames", (double)frame_bytes / count, count / frame_encode_s,
+           count / frame_decode_s, frame_bad);
+
+    free(recs);
+    free(csv);
+    free(frames);
+    return (csv_bad || frame_bad) ? 1 : 0;
+}
@@ -0,0 +1,163 @@
+/** 
+ * @file telem_decode.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-02
+ * @brief Host tool that turns a binary telemetry stream back into CSV
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -o telem_decode tools/telem_decode.c src/frame.c src/logpack.c src/slog_fmt.c src/fmt.c
+ *
+ * Usage:
+ *     stty -F /dev/ttyACM1 raw && telem_decode /dev/ttyACM1 > flight.csv
+ *     telem_decode capture.bin > flight.csv
+ *
+ * Each record becomes one line with the record type in the first column:
+ *     imu,time_us,ax,ay,az,gx,gy,gz
+ *     mag,time_us,mx,my,mz
+ *     baro,time_us,pressure_pa,temperature_c
+ *     syslog,time_us,"message"
+ *
+ * Packed blocks from a flight log are expanded to the same lines.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "frame.h"
+#include "logpack.h"
+#include "slog.h"
+#include "telem.h"
+
+/// Counts of what was decoded
+static unsigned long g_records = 0;
+static unsigned long g_bad_frames = 0;
+
+/** 
+ * @brief Print one decoded record as a line of CSV
+ * @param type the frame type
+ * @param payload the record
+ * @param len the length of the record
+ * 
+ * @return true if the record was understood
+ */
+static bool print_record(uint8_t type, const uint8_t *payload, int len) {
+    switch (type) {
+    case TELEM_REC_IMU: {
+        telem_imu_t rec;
+        if (len != sizeof(rec)) {
+            return false;
+        }
+        memcpy(&rec, payload, sizeof(rec));
+        printf("imu,%u,%d,%d,%d,%d,%d,%d\n", rec.time_us,
+               rec.accel[0], rec.accel[1], rec.accel[2],
+               rec.gyro[0], rec.gyro[1], rec.gyro[2]);
+        return true;
+    }
+    case TELEM_REC_MAG: {
+        telem_mag_t rec;
+        if (len != sizeof(rec)) {
+            return false;
+        }
+        memcpy(&rec, payload, sizeof(rec));
+        printf("mag,%u,%d,%d,%d\n", rec.time_us, rec.mag[0], rec.mag[1], rec.mag[2]);
+        return true;
+    }
+    case TELEM_REC_BARO: {
+        telem_baro_t rec;
+        if (len != sizeof(rec)) {
+            return false;
+        }
+        memcpy(&rec, payload, sizeof(rec));
+        printf("baro,%u,%.2f,%.3f\n", rec.time_us, rec.pressure / 64.0, rec.temperature / 65536.0);
+        return true;
+    }
+    case TELEM_REC_SYSLOG: {
+        // Messages are formatted here, the device only stores the arguments
+        slog_rec_t rec;
+        char text[SLOG_LINE_MAX];
+        if (len < (int)SLOG_REC_LEN(0) || len > (int)sizeof(rec)) {
+            return false;
+        }
+        memcpy(&rec, payload, len);
+        slog_format(&rec, len, text, sizeof(text));
+        printf("syslog,%u,\"%s\"\n", rec.time_us, text);
+        return true;
+    }
+    }
+    return false;
+}
+
+/** 
+ * @brief Print a record from a packed block
+ * @param type the record type
+ * @param rec the record
+ * @param len the length of the record
+ * @param ctx unused
+ * 
+ */
+static void print_packed(telem_rec_type_t type, const void *rec, size_t len, void *ctx) {
+    (void)ctx;
+    if (print_record(type, rec, len)) {
+        g_records++;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    FILE *in = stdin;
+    if (argc > 1) {
+        in = fopen(argv[1], "rb");
+        if (in == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    uint8_t frame[FRAME_MAX_SIZE(FRAME_MAX_PAYLOAD)];
+    size_t frame_len = 0;
+    bool overflow = false;
+    int ch;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while ((ch = fgetc(in)) != EOF) {
+        if (ch != 0) {
+            if (frame_len < sizeof(frame)) {
+                frame[frame_len++] = ch;
+            } else {
+                overflow = true;
+            }
+            continue;
+        }
+
+        // End of frame, anything that fails to decode is counted and skipped
+        uint8_t type;
+        uint8_t *payload;
+        int len = (frame_len && !overflow) ? frame_decode(frame, frame_len, &type, &payload) : -1;
+        if (len >= 0 && type == TELEM_REC_PACKED) {
+            if (logpack_decode(payload, len, print_packed, NULL) < 0) {
+                g_bad_frames++;
+            }
+        } else if (len >= 0 && print_record(type, payload, len)) {
+            g_records++;
+        } else if (frame_len) {
+            g_bad_frames++;
+        }
+        frame_len = 0;
+        overflow = false;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%lu records, %lu bad frames, %.0f records/s\n",
+            g_records, g_bad_frames, secs > 0 ? g_records / secs : 0.0);
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
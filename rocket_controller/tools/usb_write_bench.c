@@ -0,0 +1,190 @@
+/** 
+ * @file usb_write_bench.c
+ * @author Jack Duignan (JackpDuignan@gmail.com)
+ * @date 2025-06-23
+ * @brief Host tool that compares the usb_cdc tx write paths
+ *
+ * Build from the rocket_controller directory with:
+ *     cc -O2 -Iinclude -Itest/host/mock -o usb_write_bench tools/usb_write_bench.c
+ *         src/usb_cdc.c src/perf.c test/host/mock/mock_hw.c
+ *
+ * Usage:
+ *     usb_write_bench
+ *
+ * Writes of each size are timed through the per byte path the shell used
+ * (usb_cdc_send_byte(), a CBUF_Push() each), usb_cdc_write() (at most two
+ * memcpy()s) and reserve/commit. The ring is filled then emptied by a
+ * mocked IN end point between timed runs so only the producer side is
+ * timed. Times are host nanoseconds, the ratios carry over to the target.
+ */
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <libopencm3/usb/usbd.h>
+#include <libopencm3/usb/cdc.h>
+
+#include "usb_cdc.h"
+
+/// Shell interface and IN end point, as in usb_cdc_desc.h
+#define SHELL_COMM_IFACE 0
+#define SHELL_EP_IN 0x82
+
+/// Bytes written per timed run, just under the ring size
+#define RUN_BYTES 960
+
+/// Timed runs per write size
+#define RUNS 20000
+
+static struct {
+    int unused;
+} g_device;
+
+static usbd_endpoint_callback g_tx_callback;
+static usbd_control_callback g_control;
+static usbd_set_config_callback g_set_config;
+
+usbd_device *usbd_init(const usbd_driver *driver, const struct usb_device_descriptor *dev,
+                       const struct usb_config_descriptor *conf, const char * const *strings, int num_strings,
+                       uint8_t *control_buffer, uint16_t control_buffer_size) {
+    (void)driver; (void)dev; (void)conf; (void)strings; (void)num_strings;
+    (void)control_buffer; (void)control_buffer_size;
+    return (usbd_device *)&g_device;
+}
+
+int usbd_register_set_config_callback(usbd_device *usbd_dev, usbd_set_config_callback callback) {
+    (void)usbd_dev;
+    g_set_config = callback;
+    return 0;
+}
+
+int usbd_register_control_callback(usbd_device *usbd_dev, uint8_t type, uint8_t type_mask,
+                                   usbd_control_callback callback) {
+    (void)usbd_dev; (void)type; (void)type_mask;
+    g_control = callback;
+    return 0;
+}
+
+void usbd_ep_setup(usbd_device *usbd_dev, uint8_t addr, uint8_t type, uint16_t max_size,
+                   usbd_endpoint_callback callback) {
+    (void)usbd_dev; (void)type; (void)max_size;
+    if (addr == SHELL_EP_IN) {
+        g_tx_callback = callback;
+    }
+}
+
+/** 
+ * @brief Empty the tx ring through the IN end point callback
+ * 
+ */
+static void drain(void) {
+    while (usb_cdc_write_space() < 1024) {
+        g_tx_callback((usbd_device *)&g_device, SHELL_EP_IN);
+    }
+    // The ZLP and going idle
+    g_tx_callback((usbd_device *)&g_device, SHELL_EP_IN);
+    g_tx_callback((usbd_device *)&g_device, SHELL_EP_IN);
+}
+
+/** 
+ * @brief Get the time
+ * 
+ * @return nanoseconds
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// The write paths
+typedef enum {
+    PATH_PER_BYTE,
+    PATH_WRITE,
+    PATH_RESERVE,
+} path_t;
+
+static const char *const g_path_names[] = { "send_byte", "write", "reserve/commit" };
+
+/** 
+ * @brief Time a write path
+ * @param path the path
+ * @param size the bytes per write
+ * 
+ * @return nanoseconds per byte
+ */
+static double time_path(path_t path, size_t size) {
+    uint8_t data[RUN_BYTES];
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)i;
+    }
+
+    for (int run = 0; run < RUNS; run++) {
+        drain();
+        uint64_t start = now_ns();
+        for (size_t done = 0; done + size <= RUN_BYTES; done += size) {
+            switch (path) {
+            case PATH_PER_BYTE:
+                for (size_t i = 0; i < size; i++) {
+                    usb_cdc_send_byte(data[done + i]);
+                }
+                break;
+            case PATH_WRITE:
+                usb_cdc_write(&data[done], size);
+                break;
+            case PATH_RESERVE: {
+                size_t len;
+                uint8_t *buf = usb_cdc_write_reserve(&len);
+                if (len > size) {
+                    len = size;
+                }
+                memcpy(buf, &data[done], len);
+                usb_cdc_write_commit(len);
+                break;
+            }
+            }
+        }
+        total += now_ns() - start;
+    }
+    return (double)total / ((double)RUNS * (RUN_BYTES / size) * size);
+}
+
+int main(void) {
+    static const size_t sizes[] = { 1, 4, 16, 64, 192, 480 };
+
+    usb_cdc_init();
+    g_set_config((usbd_device *)&g_device, 1);
+    struct usb_setup_data req = {
+        .bmRequestType = USB_REQ_TYPE_CLASS | USB_REQ_TYPE_INTERFACE,
+        .bRequest = USB_CDC_REQ_SET_CONTROL_LINE_STATE,
+        .wValue = 3,
+        .wIndex = SHELL_COMM_IFACE,
+    };
+    uint8_t *buf = NULL;
+    uint16_t len = 0;
+    g_control((usbd_device *)&g_device, &req, &buf, &len, NULL);
+
+    printf("ns/byte (bytes/ns)\n");
+    printf("%6s", "size");
+    for (int p = 0; p < 3; p++) {
+        printf(" %22s", g_path_names[p]);
+    }
+    printf("\n");
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double per_byte = time_path(PATH_PER_BYTE, sizes[s]);
+        printf("%6zu", sizes[s]);
+        for (int p = 0; p < 3; p++) {
+            double ns = (p == PATH_PER_BYTE) ? per_byte : time_path(p, sizes[s]);
+            printf("   %6.3f (%5.2f) %5.1fx", ns, 1 / ns, per_byte / ns);
+        }
+        printf("\n");
+    }
+    return 0;
+}